@@ -39,6 +39,10 @@ static struct option longopts[] =
     { "grep", required_argument, 0, 'g' },
     { "timezone", required_argument, 0, 'm' },
     { "set-verbosity", required_argument, 0, 'q' },
+    { "binary", no_argument, 0, 'B' },
+    { "server-grep", no_argument, 0, 'S' },
+    { "filter-levels", required_argument, 0, 'L' },
+    { "compress", no_argument, 0, 'Z' },
     { NULL, 0, 0, 0 }
 };
 // --------------------------------------------------------------------------
@@ -54,6 +58,8 @@ static void print_help()
     printf("[-x|--reconnect-delay] msec - Pause for repeat connect to LogServer. Default: 5000 msec.\n");
     printf("[-w|--logfile] logfile      - Save log to 'logfile'.\n");
     printf("[-z|--logfile-truncate]     - Truncate log file before write. Use with -w|--logfile \n");
+    printf("[-B|--binary]               - Receive logs as binary records (date and time are formatted by client).\n");
+    printf("[-Z|--compress]             - Ask LogServer to compress the stream (lz4).\n");
 
     printf("\n");
     printf("Commands:\n");
@@ -68,9 +74,12 @@ static void print_help()
 
     printf("[-f | --filter] logname                   - ('filter mode'). View log only from 'logname'(regexp)\n");
     printf("[-g | --grep pattern                      - Print lines matching a pattern (c++ regexp)\n");
+    printf("[-S | --server-grep]                      - Apply --grep pattern on LogServer side (less traffic).\n");
+    printf("[-L | --filter-levels] info,warn,crit,... - Send only these levels (LogServer side, for structured logs).\n");
 
     printf("\n");
     printf("Note: 'objName' - regexp for name of log. Default: ALL logs.\n");
+    printf("      'objName', 'logname' and --server-grep pattern must be no longer than %d symbols.\n", (int)LogServerTypes::lsMessage::MAXLOGNAME);
     printf("\n");
     printf("Special commands:\n");
     printf("[-o | --off] [objName]                    - Off the write log file (if enabled).\n");
@@ -120,12 +129,16 @@ int main( int argc, char** argv )
     string logfile("");
     bool logtruncate = false;
     std::string textfilter("");
+    bool binary = false;
+    bool serverFilter = false;
+    bool compress = false;
+    Debug::type levelFilter = Debug::NONE;
 
     try
     {
         while(1)
         {
-            opt = getopt_long(argc, argv, "chvlf:a:p:i:d:s:n:eorbx:w:zt:g:uby:m:q:", longopts, &optindex);
+            opt = getopt_long(argc, argv, "chvlf:a:p:i:d:s:n:eorbx:w:zt:g:uby:m:q:BSL:Z", longopts, &optindex);
 
             if( opt == -1 )
                 break;
@@ -352,6 +365,22 @@ int main( int argc, char** argv )
                     verb = 1;
                     break;
 
+                case 'B':
+                    binary = true;
+                    break;
+
+                case 'S':
+                    serverFilter = true;
+                    break;
+
+                case 'Z':
+                    compress = true;
+                    break;
+
+                case 'L':
+                    levelFilter = Debug::value(optarg);
+                    break;
+
                 case '?':
                 default:
                     printf("Unknown argumnet\n");
@@ -366,11 +395,33 @@ int main( int argc, char** argv )
             dlog.addLevel( Debug::type(Debug::CRIT | Debug::WARN | Debug::INFO) );
         }
 
+        // фильтр (regexp) передаётся в lsMessage::logname, длинный был бы обрезан
+        const size_t maxlen = LogServerTypes::lsMessage::MAXLOGNAME;
+
+        for( const auto& c : vcmd )
+        {
+            if( c.logfilter.size() > maxlen )
+            {
+                cerr << "(log): logname filter '" << c.logfilter << "' is too long (max " << maxlen << " symbols)" << endl;
+                return 1;
+            }
+        }
+
+        if( logfilter.size() > maxlen )
+        {
+            cerr << "(log): logname filter '" << logfilter << "' is too long (max " << maxlen << " symbols)" << endl;
+            return 1;
+        }
+
         LogReader lr;
         lr.setCommandOnlyMode(cmdonly);
         lr.setinTimeout(tout);
         lr.setReconnectDelay(rdelay);
         lr.setTextFilter(textfilter);
+        lr.setBinaryMode(binary);
+        lr.setServerFilter(serverFilter);
+        lr.setCompressMode(compress);
+        lr.setLevelFilter(levelFilter);
 
         if( !logfile.empty() )
             lr.log()->logFile(logfile, logtruncate);
@@ -17,6 +17,7 @@
 %def_enable uwebsocket
 %def_enable clickhouse
 %def_enable opcua
+%def_enable lz4
 
 %ifarch %ix86
 %def_enable com485f
@@ -84,6 +85,10 @@ BuildRequires: libmosquitto-devel
 BuildRequires: libopen62541-devel libopen62541pp-devel >= 0.3.0-alt1
 %endif
 
+%if_enabled lz4
+BuildRequires: liblz4-devel
+%endif
+
 
 %if_enabled netdata
 BuildRequires: netdata
@@ -421,7 +426,7 @@ Libraries needed to develop for uniset OPC UA extension
 %if "%__gcc_version_major" < "12"
 %add_optflags -std=c++17
 %endif
-%configure %{subst_enable docs} %{subst_enable mysql} %{subst_enable sqlite} %{subst_enable pgsql} %{subst_enable python} %{subst_enable rrd} %{subst_enable io} %{subst_enable logicproc} %{subst_enable tests} %{subst_enable mqtt} %{subst_enable api} %{subst_enable netdata} %{subst_enable logdb} %{subst_enable com485f} %{subst_enable opentsdb} %{subst_enable uwebsocket} %{subst_enable clickhouse} %{subst_enable opcua}
+%configure %{subst_enable docs} %{subst_enable mysql} %{subst_enable sqlite} %{subst_enable pgsql} %{subst_enable python} %{subst_enable rrd} %{subst_enable io} %{subst_enable logicproc} %{subst_enable tests} %{subst_enable mqtt} %{subst_enable api} %{subst_enable netdata} %{subst_enable logdb} %{subst_enable com485f} %{subst_enable opentsdb} %{subst_enable uwebsocket} %{subst_enable clickhouse} %{subst_enable opcua} %{subst_enable lz4}
 %make_build
 
 %install
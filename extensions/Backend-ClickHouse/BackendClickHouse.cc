@@ -16,6 +16,8 @@
 // -------------------------------------------------------------------------
 #include <sstream>
 #include <iomanip>
+#include <cstdio>
+#include <algorithm>
 #include "Exceptions.h"
 #include "UniSetTypes.h"
 #include "unisetstd.h"
@@ -62,7 +64,10 @@ BackendClickHouse::BackendClickHouse( uniset::ObjectId objId, xmlNode* cnode,
     db = unisetstd::make_unique<ClickHouseInterface>();
     dyntags = unisetstd::make_unique<uniset::ClickHouseTagsConfig>();
 
-    createColumns();
+    ibuf = unisetstd::make_unique<DataBlock>();
+    wbuf = unisetstd::make_unique<DataBlock>();
+    tmpTagKeys = std::make_shared<clickhouse::ColumnString>();
+    tmpTagValues = std::make_shared<clickhouse::ColumnString>();
 
     init(cnode);
 
@@ -75,6 +80,10 @@ BackendClickHouse::BackendClickHouse( uniset::ObjectId objId, xmlNode* cnode,
 // -----------------------------------------------------------------------------
 BackendClickHouse::~BackendClickHouse()
 {
+    stopWriter();
+
+    if( spill )
+        spill->close();
 }
 // -----------------------------------------------------------------------------
 void BackendClickHouse::init( xmlNode* cnode )
@@ -93,6 +102,9 @@ void BackendClickHouse::init( xmlNode* cnode )
     bufSize = conf->getArgPInt("--" + prefix + "-buf-size", it.getProp("bufMaxSize"), bufSize);
     bufSyncTime = conf->getArgPInt("--" + prefix + "-buf-sync-time", it.getProp("bufSyncTimeout"), bufSyncTime);
 
+    compression = ( conf->getArg2Param("--" + prefix + "-compression", it.getProp("compression"), "lz4") != "none" );
+    db->setCompression(compression);
+
     const string tblname = conf->getArg2Param("--" + prefix + "-dbtablename", it.getProp("dtablebname"), "main_history");
     fullTableName = dbname.empty() ? tblname : dbname + "." + tblname;
 
@@ -174,21 +186,71 @@ void BackendClickHouse::init( xmlNode* cnode )
 
     }
 
+    // теги, не меняющиеся во время работы, формируем заранее
+    for( auto&& p : clickhouseParams )
+    {
+        auto& inf = p.second;
+        inf.tagKeys = std::make_shared<clickhouse::ColumnString>();
+        inf.tagValues = std::make_shared<clickhouse::ColumnString>();
+
+        for( const auto& t : inf.tags )
+        {
+            inf.tagKeys->Append(t.first);
+            inf.tagValues->Append(t.second);
+        }
+
+        for( const auto& t : globalTags )
+        {
+            inf.tagKeys->Append(t.first);
+            inf.tagValues->Append(t.second);
+        }
+
+        inf.dynTags = dyntags->hasTags(p.first);
+    }
+
+    const string spillDir = conf->getArg2Param("--" + prefix + "-spill-dir", it.getProp("spillDir"), "");
+
+    if( !spillDir.empty() )
+    {
+        size_t segSize = conf->getArgPInt("--" + prefix + "-spill-segment-size", it.getProp("spillSegmentSize"), 4 * 1024 * 1024);
+        size_t maxSegments = conf->getArgPInt("--" + prefix + "-spill-max-segments", it.getProp("spillMaxSegments"), 64);
+        spillReplayBatch = conf->getArgPInt("--" + prefix + "-spill-replay-batch", it.getProp("spillReplayBatch"), spillReplayBatch);
+        spillReplayPause = conf->getArgPInt("--" + prefix + "-spill-replay-pause", it.getProp("spillReplayPause"), spillReplayPause);
+
+        try
+        {
+            auto j = unisetstd::make_unique<SpillJournal>(spillDir, segSize, maxSegments);
+            j->open();
+            spill = std::move(j);
+            myinfo << myname << "(init): spill journal '" << spillDir << "'"
+                   << " pending " << spill->getPending() << " records" << endl;
+        }
+        catch( const std::exception& ex )
+        {
+            mycrit << myname << "(init): spill journal '" << spillDir << "' open error: " << ex.what() << endl;
+        }
+    }
+
     myinfo << myname << "(init): " << clickhouseParams.size() << " sensors.." << endl;
 }
 //--------------------------------------------------------------------------------
-void BackendClickHouse::createColumns()
+BackendClickHouse::DataBlock::DataBlock()
 {
     colTimeStamp = std::make_shared<clickhouse::ColumnDateTime64>(9);
     colValue = std::make_shared<clickhouse::ColumnFloat64>();
-    colName = std::make_shared<clickhouse::ColumnString>();
-    colNodeName = std::make_shared<clickhouse::ColumnString>();
-    colProducer = std::make_shared<clickhouse::ColumnString>();
+    colName = std::make_shared<ColumnLCString>();
+    colNodeName = std::make_shared<ColumnLCString>();
+    colProducer = std::make_shared<ColumnLCString>();
     arrTagKeys = std::make_shared<clickhouse::ColumnArray>(std::make_shared<clickhouse::ColumnString>());
     arrTagValues = std::make_shared<clickhouse::ColumnArray>(std::make_shared<clickhouse::ColumnString>());
 }
 //--------------------------------------------------------------------------------------------
-void BackendClickHouse::clearData()
+size_t BackendClickHouse::DataBlock::size() const
+{
+    return colTimeStamp->Size();
+}
+//--------------------------------------------------------------------------------------------
+void BackendClickHouse::DataBlock::clear()
 {
     colTimeStamp->Clear();
     colValue->Clear();
@@ -198,6 +260,19 @@ void BackendClickHouse::clearData()
     arrTagKeys->Clear();
     arrTagValues->Clear();
 }
+//--------------------------------------------------------------------------------------------
+clickhouse::Block BackendClickHouse::DataBlock::makeBlock() const
+{
+    clickhouse::Block blk(7, colTimeStamp->Size());
+    blk.AppendColumn("timestamp", colTimeStamp);
+    blk.AppendColumn("value", colValue);
+    blk.AppendColumn("name", colName);
+    blk.AppendColumn("nodename", colNodeName);
+    blk.AppendColumn("producer", colProducer);
+    blk.AppendColumn("tags.name", arrTagKeys);
+    blk.AppendColumn("tags.value", arrTagValues);
+    return blk;
+}
 //--------------------------------------------------------------------------------
 void BackendClickHouse::help_print( int argc, const char* const* argv )
 {
@@ -213,11 +288,18 @@ void BackendClickHouse::help_print( int argc, const char* const* argv )
     cout << "--clickhouse-dbname name                     - DB name" << endl;
     cout << "--clickhouse-tags 'TAG1=VAL1 TAG2=VAL2...'   - tags for data" << endl;
     cout << "--clickhouse-reconnect-time msec             - Time for attempts to connect to DB. Default: 5 sec" << endl;
+    cout << "--clickhouse-compression lz4|none            - Data compression. Default: lz4" << endl;
     cout << endl;
     cout << "--clickhouse-buf-size  sz        - Buffer before save to DB. Default: 500" << endl;
     cout << "--clickhouse-buf-maxsize  sz     - Maximum size for buffer (drop messages). Default: 5000" << endl;
     cout << "--clickhouse-buf-sync-time msec  - Time period for forced data writing to DB. Default: 5 sec" << endl;
     cout << endl;
+    cout << "--clickhouse-spill-dir path             - Save data to disk journal when DB unavailable. Default: '' (disabled)" << endl;
+    cout << "--clickhouse-spill-segment-size bytes   - Journal segment size. Default: 4194304" << endl;
+    cout << "--clickhouse-spill-max-segments num     - Max segments (oldest are removed on overflow). Default: 64" << endl;
+    cout << "--clickhouse-spill-replay-batch num     - Records per replay step after reconnect. Default: 5000" << endl;
+    cout << "--clickhouse-spill-replay-pause msec    - Pause between replay steps. Default: 1000 msec" << endl;
+    cout << endl;
     cout << "--clickhouse-heartbeat-id name   - ID for heartbeat sensor." << endl;
     cout << "--clickhouse-heartbeat-max val   - max value for heartbeat sensor." << endl;
     cout << endl;
@@ -307,6 +389,24 @@ void BackendClickHouse::askSensors( UniversalIO::UIOCommand cmd )
 
 }
 // -----------------------------------------------------------------------------
+const std::string& BackendClickHouse::objectName( uniset::ObjectId id )
+{
+    auto it = nameCache.find(id);
+
+    if( it != nameCache.end() )
+        return it->second;
+
+    std::string name;
+    auto oinf = uniset_conf()->oind->getObjectInfo(id);
+
+    if( oinf )
+        name = oinf->name;
+    else if( id == uniset::AdminID )
+        name = "uniset-admin";
+
+    return nameCache.emplace(id, name).first->second;
+}
+// -----------------------------------------------------------------------------
 void BackendClickHouse::sensorInfo( const uniset::SensorMessage* sm )
 {
     auto it = clickhouseParams.find(sm->id);
@@ -314,86 +414,66 @@ void BackendClickHouse::sensorInfo( const uniset::SensorMessage* sm )
     if( it == clickhouseParams.end() )
         return;
 
-    auto oinf = uniset_conf()->oind->getObjectInfo(sm->id);
-
-    if( !oinf )
-    {
-        mycrit << myname << "(sensorInfo): unknown object info for sensor_id=" << sm->id << endl;
-        return;
-    }
-
-    auto suppinf = uniset_conf()->oind->getObjectInfo(sm->supplier);
-    auto nodeinf = uniset_conf()->oind->getObjectInfo(sm->node);
-
     try
     {
-        colTimeStamp->Append( uniset::timespec_to_nanosec(sm->sm_tv) );
-        colValue->Append(sm->value);
-        colName->Append(oinf->name);
-
-        if( nodeinf )
-            colNodeName->Append(nodeinf->name);
-        else
-            colNodeName->Append("");
-
-        if( suppinf )
-            colProducer->Append(suppinf->name);
-        else if( sm->supplier == uniset::AdminID )
-            colProducer->Append("uniset-admin");
-        else
-            colProducer->Append("");
-
-        // TAGS
-        auto key = std::make_shared<clickhouse::ColumnString>();
-        auto val = std::make_shared<clickhouse::ColumnString>();
-
-        for( const auto& t : it->second.tags )
-        {
-            key->Append(t.first);
-            val->Append(t.second);
-        }
+        const auto& inf = it->second;
+        const std::string& nodename = objectName(sm->node);
+        const std::string& producer = objectName(sm->supplier);
 
-        // GLOBAL TAGS
-        for( const auto& t : globalTags )
-        {
-            key->Append(t.first);
-            val->Append(t.second);
-        }
-
-        // dyn tags
         // обновляем значения в динамических тегах
         dyntags->updateTags(sm->id, sm->value);
-        auto dtags = dyntags->getTags(sm->id);
-
-        for( const auto& t : dtags )
-        {
-            key->Append(t.key);
-            val->Append(t.value);
-        }
 
-        // save tags
-        arrTagKeys->AppendAsColumn(key);
-        arrTagValues->AppendAsColumn(val);
+        auto tagKeys = inf.tagKeys;
+        auto tagValues = inf.tagValues;
 
-        if( colTimeStamp->Size() >= bufSize )
+        if( inf.dynTags )
         {
-            if( flushBuffer() )
-                return;
+            tmpTagKeys->Clear();
+            tmpTagValues->Clear();
+            tmpTagKeys->Append(inf.tagKeys);
+            tmpTagValues->Append(inf.tagValues);
 
-            if( colTimeStamp->Size() >= bufMaxSize )
+            for( const auto& t : dyntags->getTags(sm->id) )
             {
-                mycrit << "BUFFER OVERFLOW! MaxBufSize=" << bufMaxSize
-                       << ". ALL DATA LOST!" << endl;
-                clearData();
+                tmpTagKeys->Append(t.key);
+                tmpTagValues->Append(t.value);
             }
+
+            tagKeys = tmpTagKeys;
+            tagValues = tmpTagValues;
         }
 
-        if( !timerIsOn )
+        size_t sz = 0;
+
         {
-            timerIsOn = true;
-            askTimer(tmFlushBuffer, bufSyncTime, 1);
-            return;
+            std::lock_guard<std::mutex> lk(ibufMutex);
+            ibuf->colTimeStamp->Append( uniset::timespec_to_nanosec(sm->sm_tv) );
+            ibuf->colValue->Append(sm->value);
+            ibuf->colName->Append(inf.name);
+            ibuf->colNodeName->Append(nodename);
+            ibuf->colProducer->Append(producer);
+            ibuf->arrTagKeys->AppendAsColumn(tagKeys);
+            ibuf->arrTagValues->AppendAsColumn(tagValues);
+
+            sz = ibuf->size();
+
+            // поток записи не успевает (или нет связи с БД)
+            if( sz >= bufMaxSize )
+            {
+                if( spill )
+                    spillBlock(*ibuf);
+                else
+                {
+                    mycrit << "BUFFER OVERFLOW! MaxBufSize=" << bufMaxSize
+                           << ". ALL DATA LOST!" << endl;
+                    statLost += sz;
+                    ibuf->clear();
+                }
+            }
         }
+
+        if( sz >= bufSize )
+            ibufCond.notify_one();
     }
     catch( const uniset::Exception& ex )
     {
@@ -409,70 +489,323 @@ void BackendClickHouse::sensorInfo( const uniset::SensorMessage* sm )
     }
 }
 // -----------------------------------------------------------------------------
-void BackendClickHouse::timerInfo( const uniset::TimerMessage* tm )
+void BackendClickHouse::sysCommand(const SystemMessage* sm)
 {
-    if( tm->id == tmFlushBuffer )
+    switch( sm->command )
     {
-        if( flushBuffer() )
-            timerIsOn = false;
-        else if( !db->ping() )
+        case SystemMessage::StartUp:
+            startWriter();
+            break;
+
+        case SystemMessage::Finish:
+        case SystemMessage::FoldUp:
+            stopWriter();
+            break;
+
+        default:
+            break;
+    }
+}
+// -----------------------------------------------------------------------------
+void BackendClickHouse::startWriter()
+{
+    if( writer )
+        return;
+
+    writerActive = true;
+    writer = unisetstd::make_unique< ThreadCreator<BackendClickHouse> >(this, &BackendClickHouse::writerThread);
+    writer->start();
+}
+// -----------------------------------------------------------------------------
+void BackendClickHouse::stopWriter()
+{
+    if( !writer )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(ibufMutex);
+        writerActive = false;
+    }
+
+    ibufCond.notify_all();
+
+    if( writer->isRunning() )
+        writer->join();
+
+    writer = nullptr;
+}
+// -----------------------------------------------------------------------------
+void BackendClickHouse::writerThread()
+{
+    myinfo << myname << "(writerThread): run.." << endl;
+
+    // подключение и проверка связи тоже выполняются в этом потоке
+    auto lastReconnect = std::chrono::steady_clock::now() - std::chrono::milliseconds(reconnectTime);
+
+    while( writerActive )
+    {
+        if( !connect_ok && std::chrono::steady_clock::now() - lastReconnect >= std::chrono::milliseconds(reconnectTime) )
+        {
+            lastReconnect = std::chrono::steady_clock::now();
+            myinfo << myname << " try reconnect.." << endl;
+
+            if( reconnect() )
+                myinfo << myname << " reconnect [OK]" << endl;
+        }
+
+        if( connect_ok )
         {
-            askTimer(tmFlushBuffer, 0);
-            timerIsOn = false;
-            askTimer(tmReconnect, reconnectTime);
+            try
+            {
+                writeBuffer();
+            }
+            catch( const std::exception& ex )
+            {
+                mycrit << myname << "(writerThread): " << ex.what() << endl;
+            }
         }
+
+        // пока есть что досылать из журнала, просыпаемся чаще
+        timeout_t tout = bufSyncTime;
+
+        if( !connect_ok )
+            tout = std::min(reconnectTime, bufSyncTime);
+        else if( spill && !spill->empty() )
+            tout = std::min(spillReplayPause, bufSyncTime);
+
+        std::unique_lock<std::mutex> lk(ibufMutex);
+        ibufCond.wait_for(lk, std::chrono::milliseconds(tout), [&]()
+        {
+            return !writerActive || ( connect_ok && wbufSize == 0 && ibuf->size() >= bufSize );
+        });
     }
-    else if( tm->id == tmReconnect )
+
+    // при завершении пишем всё что накопилось,
+    // а что не удалось записать - сохраняем до следующего запуска
+    try
     {
-        myinfo << myname << " try reconnect.." << endl;
+        if( connect_ok )
+            writeBuffer();
 
-        if( reconnect() )
+        if( spill )
         {
-            myinfo << myname << " reconnect [OK]" << endl;
-            askTimer(tmReconnect, 0);
-            flushBuffer();
-            askTimer(tmFlushBuffer, bufSyncTime, 1);
-            timerIsOn = true;
+            spillBlock(*wbuf);
+
+            std::lock_guard<std::mutex> lk(ibufMutex);
+            spillBlock(*ibuf);
+            spill->sync();
         }
     }
+    catch( const std::exception& ex )
+    {
+        mycrit << myname << "(writerThread): " << ex.what() << endl;
+    }
+
+    myinfo << myname << "(writerThread): finished.." << endl;
 }
 // -----------------------------------------------------------------------------
-void BackendClickHouse::sysCommand(const SystemMessage* sm)
+bool BackendClickHouse::writeBuffer()
 {
-    if( sm->command == SystemMessage::StartUp )
     {
-        if( !reconnect() )
-            askTimer(tmReconnect, reconnectTime);
+        std::lock_guard<std::mutex> lk(ibufMutex);
+
+        // если прошлая запись не удалась, сначала повторяем её
+        if( wbuf->size() == 0 )
+            std::swap(ibuf, wbuf);
     }
+
+    if( wbuf->size() > 0 )
+    {
+        myinfo << myname << "(writeBuffer): write insert buffer[" << wbuf->size() << "] to DB.." << endl;
+
+        auto t_start = std::chrono::steady_clock::now();
+        bool ok = db->insert(fullTableName, wbuf->makeBlock());
+
+        size_t msec = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t_start).count();
+        statLastFlush_msec = msec;
+
+        if( msec > statMaxFlush_msec )
+            statMaxFlush_msec = msec;
+
+        statFlushCount++;
+
+        if( !ok )
+        {
+            {
+                std::lock_guard<std::mutex> l(errMutex);
+                lastError = db->error();
+            }
+
+            mycrit << myname << "(writeBuffer): error: " << db->error() << endl;
+
+            if( !db->ping() )
+                connect_ok = false;
+            else if( !db->isConnectionError() )
+            {
+                // сервер отверг сами данные: повтор ничего не даст,
+                // а всё следующее за блоком уйдёт в журнал и потеряется при его переполнении
+                mycrit << myname << "(writeBuffer): block rejected by DB, drop " << wbuf->size() << " records" << endl;
+                statRejected += wbuf->size();
+                wbuf->clear();
+                wbufSize = 0;
+                return false;
+            }
+
+            wbufSize = wbuf->size();
+            return false;
+        }
+
+        statWritten += wbuf->size();
+        wbuf->clear();
+    }
+
+    wbufSize = 0;
+
+    // текущее записали, досылаем сохранённое в журнале
+    if( spill && !spill->empty() )
+        replaySpill();
+
+    return true;
 }
 // -----------------------------------------------------------------------------
-bool BackendClickHouse::flushBuffer()
+void BackendClickHouse::spillBlock( DataBlock& blk )
 {
-    if( colTimeStamp->Size() == 0 )
-        return false;
+    const size_t num = blk.size();
 
-    if( !db || !connect_ok )
-        return false;
+    if( num == 0 )
+        return;
 
-    myinfo << myname << "(flushBuffer): write insert buffer[" << colTimeStamp->Size() << "] to DB.." << endl;
+    size_t saved = 0;
+    std::string rec;
+    char buf[64];
 
-    clickhouse::Block blk(8, colTimeStamp->Size());
-    blk.AppendColumn("timestamp", colTimeStamp);
-    blk.AppendColumn("value", colValue);
-    blk.AppendColumn("name", colName);
-    blk.AppendColumn("nodename", colNodeName);
-    blk.AppendColumn("producer", colProducer);
-    blk.AppendColumn("tags.name", arrTagKeys);
-    blk.AppendColumn("tags.value", arrTagValues);
+    // timestamp \t value \t name \t nodename \t producer [\t tag \t value]...
+    for( size_t i = 0; i < num; i++ )
+    {
+        rec = std::to_string(blk.colTimeStamp->At(i));
+        snprintf(buf, sizeof(buf), "%.17g", blk.colValue->At(i));
+        rec += '\t';
+        rec += buf;
+        rec += '\t';
+        rec += blk.colName->At(i);
+        rec += '\t';
+        rec += blk.colNodeName->At(i);
+        rec += '\t';
+        rec += blk.colProducer->At(i);
+
+        auto keys = blk.arrTagKeys->GetAsColumn(i)->As<clickhouse::ColumnString>();
+        auto vals = blk.arrTagValues->GetAsColumn(i)->As<clickhouse::ColumnString>();
+
+        for( size_t k = 0; k < keys->Size() && k < vals->Size(); k++ )
+        {
+            rec += '\t';
+            rec += keys->At(k);
+            rec += '\t';
+            rec += vals->At(k);
+        }
+
+        if( spill->write(rec) )
+            saved++;
+    }
+
+    statSpilled += saved;
+    statLost += num - saved;
 
-    if( !db->insert(fullTableName, blk) )
+    mywarn << myname << "(spillBlock): " << ( connect_ok ? "" : "DB not connected! " )
+           << "save " << saved << " records to journal '" << spill->getDir() << "'"
+           << " (pending " << spill->getPending() << ")" << endl;
+
+    blk.clear();
+}
+// -----------------------------------------------------------------------------
+// (explode_str() пропускает пустые поля)
+static std::vector<std::string> splitFields( const std::string& s )
+{
+    std::vector<std::string> f;
+    size_t pos = 0;
+
+    while( true )
     {
-        mycrit << myname << "(flushBuffer): error: " << db->error() << endl;
-        return false;
+        size_t next = s.find('\t', pos);
+        f.emplace_back( s.substr(pos, next - pos) );
+
+        if( next == std::string::npos )
+            break;
+
+        pos = next + 1;
     }
 
-    clearData();
-    return true;
+    return f;
+}
+// -----------------------------------------------------------------------------
+void BackendClickHouse::replaySpill()
+{
+    std::vector<std::string> recs;
+    recs.reserve(spillReplayBatch);
+
+    if( spill->read(recs, spillReplayBatch) == 0 )
+    {
+        spill->commit();
+        return;
+    }
+
+    DataBlock rblk;
+
+    for( const auto& s : recs )
+    {
+        auto f = splitFields(s);
+
+        if( f.size() < 5 || (f.size() - 5) % 2 != 0 )
+        {
+            mycrit << myname << "(replaySpill): bad record in journal: '" << s << "'" << endl;
+            continue;
+        }
+
+        auto keys = std::make_shared<clickhouse::ColumnString>();
+        auto vals = std::make_shared<clickhouse::ColumnString>();
+
+        for( size_t k = 5; k + 1 < f.size(); k += 2 )
+        {
+            keys->Append(f[k]);
+            vals->Append(f[k + 1]);
+        }
+
+        rblk.colTimeStamp->Append( std::stoll(f[0]) );
+        rblk.colValue->Append( std::strtod(f[1].c_str(), nullptr) );
+        rblk.colName->Append(f[2]);
+        rblk.colNodeName->Append(f[3]);
+        rblk.colProducer->Append(f[4]);
+        rblk.arrTagKeys->AppendAsColumn(keys);
+        rblk.arrTagValues->AppendAsColumn(vals);
+    }
+
+    // если записать не удалось, то в следующий раз читаем эти же записи
+    if( rblk.size() > 0 && !db->insert(fullTableName, rblk.makeBlock()) )
+    {
+        {
+            std::lock_guard<std::mutex> l(errMutex);
+            lastError = db->error();
+        }
+
+        mycrit << myname << "(replaySpill): error: " << db->error() << endl;
+
+        if( !db->ping() )
+            connect_ok = false;
+        else if( !db->isConnectionError() )
+        {
+            // отвергнутые записи из журнала выбрасываем, иначе досылка остановится на них навсегда
+            mycrit << myname << "(replaySpill): records rejected by DB, drop " << rblk.size() << " records" << endl;
+            statRejected += rblk.size();
+            spill->commit();
+        }
+
+        return;
+    }
+
+    spill->commit();
+    statReplayed += rblk.size();
+    myinfo << myname << "(replaySpill): replay " << rblk.size() << " records"
+           << " (pending " << spill->getPending() << ")" << endl;
 }
 //------------------------------------------------------------------------------
 bool BackendClickHouse::reconnect()
@@ -490,15 +823,50 @@ std::string BackendClickHouse::getMonitInfo() const
         << " reconnect=" << reconnectTime
         << " bufSyncTime=" << bufSyncTime
         << " bufSize=" << bufSize
+        << " bufMaxSize=" << bufMaxSize
+        << " compression=" << ( compression ? "lz4" : "none" )
         << " tags:";
 
     for( const auto& t : globalTags )
         inf << " " << t.first << "=" << t.second;
 
+    size_t isize = 0;
+    {
+        std::lock_guard<std::mutex> lk(ibufMutex);
+        isize = ibuf->size();
+    }
+
     inf << " ]" << endl
         << "  connection: " << ( connect_ok ? "OK" : "FAILED") << endl
-        << " buffer size: " << colTimeStamp->Size() << endl
-        << "   lastError: " << lastError << endl;
+        << "      writer: " << ( writer && writer->isRunning() ? "RUNNING" : "STOPPED" ) << endl
+        << " buffer size: " << (isize + wbufSize) << " (ibuf=" << isize << " wbuf=" << wbufSize << ")" << endl
+        << "     written: " << statWritten << endl
+        << "        lost: " << statLost << endl
+        << "    rejected: " << statRejected << endl
+        << "     flushes: " << statFlushCount
+        << " last=" << statLastFlush_msec << " msec"
+        << " max=" << statMaxFlush_msec << " msec" << endl;
+
+    {
+        std::lock_guard<std::mutex> l(errMutex);
+        inf << "   lastError: " << lastError << endl;
+    }
+
+    if( spill )
+    {
+        inf << "Spill journal: "
+            << "[ dir='" << spill->getDir() << "'"
+            << " segmentSize=" << spill->getSegmentSize()
+            << " maxSegments=" << spill->getMaxSegments()
+            << " replayBatch=" << spillReplayBatch
+            << " replayPause=" << spillReplayPause
+            << " ]" << endl
+            << "     pending: " << spill->getPending() << " (" << spill->getPendingBytes() << " bytes, "
+            << spill->getSegments() << " segments)" << endl
+            << "     spilled: " << statSpilled << endl
+            << "    replayed: " << statReplayed << endl
+            << "        lost: " << spill->getLost() << endl;
+    }
 
     return inf.str();
 }
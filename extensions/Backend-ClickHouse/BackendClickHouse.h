@@ -20,12 +20,18 @@
 #include <memory>
 #include <unordered_map>
 #include <chrono>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <clickhouse-cpp/columns/lowcardinality.h>
 #include "UObject_SK.h"
 #include "SMInterface.h"
 #include "SharedMemory.h"
 #include "extensions/Extensions.h"
 #include "ClickHouseInterface.h"
 #include "ClickHouseTagsConfig.h"
+#include "ThreadCreator.h"
+#include "SpillJournal.h"
 // --------------------------------------------------------------------------
 namespace uniset
 {
@@ -77,6 +83,24 @@ namespace uniset
     - \b reconnectTime - время на повторную попытку подключения к БД, миллисек.
     - \b sizeOfMessageQueue - Размер очереди сообщений для обработки изменений по датчикам.
          При большом количестве отслеживаемых датчиков, размер должен быть достаточным, чтобы не терять изменения.
+    - \b compression - сжатие данных при передаче (lz4 или none). По умолчанию: lz4.
+
+    Запись в БД (а также подключение и проверка связи) ведётся отдельным потоком. Обработка сообщений
+    только добавляет значения в колонки текущего блока, а поток записи забирает накопленный блок
+    (блоки меняются местами) и пишет его в БД. Имя датчика и его статические теги формируются
+    один раз при инициализации, колонки name, nodename, producer передаются как LowCardinality(String)
+    (в таблице они хранятся так же), поэтому на каждое сообщение приходится лишь несколько добавлений в колонки.
+
+    Если задан каталог \b spillDir (--prefix-spill-dir), то при переполнении буфера (нет связи с БД)
+    и при завершении работы с незаписанными данными, данные не удаляются, а сохраняются на диск
+    в журнал (см. SpillJournal). После восстановления связи поток записи досылает их в БД порциями
+    по \b spillReplayBatch записей не чаще чем раз в \b spillReplayPause мсек.
+    Журнал сохраняется при перезапуске процесса.
+
+    Повторяется (и сохраняется в журнал) только то, что не удалось записать из-за связи с БД.
+    Если сервер отверг блок при живом соединении (ошибка в данных или схеме таблицы),
+    блок выводится в лог (crit) и отбрасывается (счётчик rejected в getMonitInfo),
+    иначе он повторялся бы бесконечно, а всё следующее за ним уходило бы в журнал.
 
     \section sec_ClickHouse_Tags Настройка динамических тегов
     Значения тегов настраиваются в секции <clickhouse_tags>
@@ -189,12 +213,10 @@ namespace uniset
 
             virtual void askSensors( UniversalIO::UIOCommand cmd ) override;
             virtual void sensorInfo( const uniset::SensorMessage* sm ) override;
-            virtual void timerInfo( const uniset::TimerMessage* tm ) override;
             virtual void sysCommand( const uniset::SystemMessage* sm ) override;
             virtual std::string getMonitInfo() const override;
 
             void init( xmlNode* cnode );
-            bool flushBuffer();
             bool reconnect();
 
             std::shared_ptr<SMInterface> shm;
@@ -207,6 +229,11 @@ namespace uniset
                 const std::string name;
                 TagList tags;
 
+                // статические теги датчика вместе с глобальными (формируются при инициализации)
+                std::shared_ptr<clickhouse::ColumnString> tagKeys;
+                std::shared_ptr<clickhouse::ColumnString> tagValues;
+                bool dynTags = { false };
+
                 ParamInfo( const std::string& _name, const TagList& _tags ):
                     name(_name), tags(_tags) {}
             };
@@ -214,24 +241,44 @@ namespace uniset
             std::unordered_map<uniset::ObjectId, ParamInfo> clickhouseParams;
             TagList globalTags;
 
+            // кэш имён узлов и "поставщиков"
+            std::unordered_map<uniset::ObjectId, std::string> nameCache;
+            const std::string& objectName( uniset::ObjectId id );
+
             timeout_t bufSyncTime = { 5000 };
             size_t bufSize = { 5000 };
             size_t bufMaxSize = { 100000 }; // drop messages
-            bool timerIsOn = { false };
             timeout_t reconnectTime = { 5000 };
-            std::string lastError;
 
             // работа с ClickHouse
-            std::shared_ptr<clickhouse::ColumnDateTime64> colTimeStamp;
-            std::shared_ptr<clickhouse::ColumnFloat64> colValue;
-            std::shared_ptr<clickhouse::ColumnString> colName;
-            std::shared_ptr<clickhouse::ColumnString> colNodeName;
-            std::shared_ptr<clickhouse::ColumnString> colProducer;
-            std::shared_ptr<clickhouse::ColumnArray> arrTagKeys;
-            std::shared_ptr<clickhouse::ColumnArray> arrTagValues;
-
-            void createColumns();
-            void clearData();
+            using ColumnLCString = clickhouse::ColumnLowCardinalityT<clickhouse::ColumnString>;
+
+            struct DataBlock
+            {
+                DataBlock();
+
+                std::shared_ptr<clickhouse::ColumnDateTime64> colTimeStamp;
+                std::shared_ptr<clickhouse::ColumnFloat64> colValue;
+                std::shared_ptr<ColumnLCString> colName;
+                std::shared_ptr<ColumnLCString> colNodeName;
+                std::shared_ptr<ColumnLCString> colProducer;
+                std::shared_ptr<clickhouse::ColumnArray> arrTagKeys;
+                std::shared_ptr<clickhouse::ColumnArray> arrTagValues;
+
+                size_t size() const;
+                void clear();
+                clickhouse::Block makeBlock() const;
+            };
+
+            std::unique_ptr<DataBlock> ibuf; // заполняется при обработке сообщений
+            std::unique_ptr<DataBlock> wbuf; // записывается потоком записи
+            mutable std::mutex ibufMutex;
+            std::condition_variable ibufCond;
+
+            // временные колонки для тегов (если у датчика есть динамические теги)
+            std::shared_ptr<clickhouse::ColumnString> tmpTagKeys;
+            std::shared_ptr<clickhouse::ColumnString> tmpTagValues;
+
             static TagList parseTags( const std::string& tags );
 
             std::unique_ptr<uniset::ClickHouseTagsConfig> dyntags;
@@ -244,10 +291,42 @@ namespace uniset
             std::string dbuser;
             std::string dbpass;
             std::string dbname;
+            bool compression = { true };
+
+            // поток записи в БД
+            void writerThread();
+            void startWriter();
+            void stopWriter();
+            bool writeBuffer();
+
+            std::unique_ptr< ThreadCreator<BackendClickHouse> > writer;
+            std::atomic_bool writerActive = { false };
+
+            // дисковый журнал (при недоступности БД)
+            void spillBlock( DataBlock& blk );
+            void replaySpill();
+
+            std::unique_ptr<SpillJournal> spill; // nullptr - журнал не используется
+            size_t spillReplayBatch = { 5000 };
+            timeout_t spillReplayPause = { 1000 };
+
+            // статистика (для getMonitInfo)
+            std::atomic<size_t> wbufSize = { 0 };
+            std::atomic<size_t> statWritten = { 0 };
+            std::atomic<size_t> statLost = { 0 };
+            std::atomic<size_t> statRejected = { 0 }; // отвергнуто БД (ошибка в данных)
+            std::atomic<size_t> statSpilled = { 0 };
+            std::atomic<size_t> statReplayed = { 0 };
+            std::atomic<size_t> statFlushCount = { 0 };
+            std::atomic<size_t> statLastFlush_msec = { 0 };
+            std::atomic<size_t> statMaxFlush_msec = { 0 };
+
+            mutable std::mutex errMutex;
+            std::string lastError;
 
         private:
             std::string prefix;
-            bool connect_ok = { false };
+            std::atomic_bool connect_ok = { false };
     };
     // --------------------------------------------------------------------------
 } // end of namespace uniset
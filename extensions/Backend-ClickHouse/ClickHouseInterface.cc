@@ -70,6 +70,11 @@ void ClickHouseInterface::setOptions( int _sendRetries, bool _pingBeforeQuery )
     pingBeforeQuery = _pingBeforeQuery;
 }
 // -----------------------------------------------------------------------------------------
+void ClickHouseInterface::setCompression( bool lz4 )
+{
+    compression = lz4;
+}
+// -----------------------------------------------------------------------------------------
 bool ClickHouseInterface::reconnect(const string& host, const string& user, const string& pswd, const string& dbname, unsigned int port )
 {
     if( db )
@@ -106,6 +111,9 @@ bool ClickHouseInterface::nconnect(const string& host, const string& user, const
     opts.SetSendRetries(sendRetries);
     opts.SetPingBeforeQuery(pingBeforeQuery);
 
+    if( compression )
+        opts.SetCompressionMethod(clickhouse::CompressionMethod::LZ4);
+
     try
     {
         db = unisetstd::make_unique<clickhouse::Client>(opts);
@@ -133,6 +141,8 @@ bool ClickHouseInterface::close()
 // -----------------------------------------------------------------------------------------
 bool ClickHouseInterface::insert( const std::string& tblname, const clickhouse::Block& data )
 {
+    lastErrCode = 0;
+
     if( !db )
     {
         lastE = "no connection";
@@ -147,6 +157,7 @@ bool ClickHouseInterface::insert( const std::string& tblname, const clickhouse::
     catch( const clickhouse::ServerException& e )
     {
         lastE = string(e.what());
+        lastErrCode = e.GetCode();
     }
     catch( const std::exception& e )
     {
@@ -334,6 +345,38 @@ const string ClickHouseInterface::error()
     return lastE;
 }
 // -----------------------------------------------------------------------------------------
+bool ClickHouseInterface::isConnectionError() const
+{
+    // ошибка не от сервера (обрыв связи, таймаут и т.п.)
+    if( lastErrCode == 0 )
+        return true;
+
+    // коды ClickHouse (ErrorCodes.cpp), при которых сервер не смог выполнить запрос по временным причинам
+    switch( lastErrCode )
+    {
+        case 159: // TIMEOUT_EXCEEDED
+        case 164: // READONLY
+        case 202: // TOO_MANY_SIMULTANEOUS_QUERIES
+        case 203: // NO_FREE_CONNECTION
+        case 209: // SOCKET_TIMEOUT
+        case 210: // NETWORK_ERROR
+        case 241: // MEMORY_LIMIT_EXCEEDED
+        case 242: // TABLE_IS_READ_ONLY
+        case 243: // NOT_ENOUGH_SPACE
+        case 252: // TOO_MANY_PARTS
+        case 279: // ALL_CONNECTION_TRIES_FAILED
+        case 394: // QUERY_WAS_CANCELLED
+        case 425: // SYSTEM_ERROR
+        case 999: // KEEPER_EXCEPTION
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+// -----------------------------------------------------------------------------------------
 const string ClickHouseInterface::lastQuery()
 {
     return lastQ;
@@ -55,12 +55,20 @@ namespace uniset
 
             virtual const std::string error() override;
 
+            /*! последняя ошибка связана с доступом к БД (нет связи, перегрузка сервера и т.п.),
+             * т.е. запрос имеет смысл повторить. false - сервер отверг сами данные (ошибка в данных или схеме)
+             */
+            bool isConnectionError() const;
+
             bool reconnect(const std::string& host, const std::string& user,
                            const std::string& pswd, const std::string& dbname,
                            unsigned int port = 9000);
 
             void setOptions( int sendRetries, bool pingBeforeQuery );
 
+            // сжатие (lz4) данных при передаче (задаётся до подключения)
+            void setCompression( bool lz4 );
+
             // unsupported
             virtual bool insert( const std::string& q ) override
             {
@@ -80,9 +88,11 @@ namespace uniset
             std::unique_ptr<clickhouse::Client> db;
             std::string lastQ;
             std::string lastE;
+            int lastErrCode = { 0 }; // код ServerException (0 - ошибка на стороне клиента или связи)
 
             int sendRetries = { 2 };
             bool pingBeforeQuery = { true };
+            bool compression = { false };
     };
     // ----------------------------------------------------------------------------------
 } // end of namespace uniset
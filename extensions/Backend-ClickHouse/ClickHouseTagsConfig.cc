@@ -442,6 +442,11 @@ std::vector<ClickHouseTagsConfig::Tag> ClickHouseTagsConfig::getTags( uniset::Ob
     return makeTags( it->second );
 }
 //--------------------------------------------------------------------------------------------
+bool ClickHouseTagsConfig::hasTags( uniset::ObjectId id ) const
+{
+    return tags.find(id) != tags.end();
+}
+//--------------------------------------------------------------------------------------------
 std::vector<ClickHouseTagsConfig::Tag> ClickHouseTagsConfig::makeTags( ClickHouseTagsConfig::TagList& lst )
 {
     std::vector<Tag> tags;
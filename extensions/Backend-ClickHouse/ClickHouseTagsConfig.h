@@ -126,6 +126,9 @@ namespace uniset
 
             std::vector<Tag> getTags( uniset::ObjectId id );
 
+            // есть ли у датчика динамические теги
+            bool hasTags( uniset::ObjectId id ) const;
+
             bool updateTags( uniset::ObjectId id, long value );
 
             size_t getTagsCount() const;
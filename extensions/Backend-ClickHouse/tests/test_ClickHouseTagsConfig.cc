@@ -23,6 +23,9 @@ TEST_CASE("ClickHouseTagsConfig", "[tagsconfig]" )
     REQUIRE( tconf.getTags(100500).size() == 0 );
     REQUIRE( tconf.getTags(4).size() == 0 );
 
+    REQUIRE_FALSE( tconf.hasTags(100500) );
+    REQUIRE( tconf.hasTags(2) );
+
     // tags for sensor id="2"
 
     // update S3 values
@@ -16,7 +16,13 @@
 // -------------------------------------------------------------------------
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <sys/uio.h>
 #include "Exceptions.h"
+#include "unisetstd.h"
 #include <Poco/Net/NetException.h>
 #include "BackendOpenTSDB.h"
 // -----------------------------------------------------------------------------
@@ -48,6 +54,10 @@ BackendOpenTSDB::BackendOpenTSDB( uniset::ObjectId objId, xmlNode* cnode,
 // -----------------------------------------------------------------------------
 BackendOpenTSDB::~BackendOpenTSDB()
 {
+    stopWriter();
+
+    if( spill )
+        spill->close();
 }
 // -----------------------------------------------------------------------------
 void BackendOpenTSDB::init( xmlNode* cnode )
@@ -64,6 +74,22 @@ void BackendOpenTSDB::init( xmlNode* cnode )
     bufMaxSize = conf->getArgPInt("--" + prefix + "-buf-maxsize", it.getProp("bufMaxSize"), bufMaxSize);
     bufSize = conf->getArgPInt("--" + prefix + "-buf-size", it.getProp("bufMaxSize"), bufSize);
     bufSyncTime = conf->getArgPInt("--" + prefix + "-buf-sync-time", it.getProp("bufSyncTimeout"), bufSyncTime);
+    chunkSize = conf->getArgPInt("--" + prefix + "-chunk-size", it.getProp("chunkSize"), chunkSize);
+    sendTimeout = conf->getArgPInt("--" + prefix + "-send-timeout", it.getProp("sendTimeout"), sendTimeout);
+
+    const string sproto = conf->getArg2Param("--" + prefix + "-protocol", it.getProp("protocol"), "telnet");
+
+    if( sproto == "http" )
+        proto = protoHttp;
+    else if( sproto == "telnet" )
+        proto = protoTelnet;
+    else
+    {
+        ostringstream err;
+        err << myname << "(init): Unknown protocol '" << sproto << "'. Must be 'telnet' or 'http'";
+        mycrit << err.str() << endl;
+        throw SystemError(err.str());
+    }
 
     int sz = conf->getArgPInt("--" + prefix + "-uniset-object-size-message-queue", it.getProp("sizeOfMessageQueue"), 10000);
 
@@ -77,6 +103,7 @@ void BackendOpenTSDB::init( xmlNode* cnode )
            << " " << ff << "='" << fv << "'"
            << " prefix='" << tsdbPrefix << "'"
            << " tags='" << tsdbTags << "'"
+           << " protocol=" << sproto
            << endl;
 
     // try
@@ -138,8 +165,89 @@ void BackendOpenTSDB::init( xmlNode* cnode )
             mycrit << err.str() << endl;
             throw SystemError(err.str());
         }
+    }
+
+    // неизменяемые части записей формируем один раз
+    for( auto&& p : tsdbParams )
+        makeTemplate(p.second);
+
+    const string spillDir = conf->getArg2Param("--" + prefix + "-spill-dir", it.getProp("spillDir"), "");
+
+    if( !spillDir.empty() )
+    {
+        size_t segSize = conf->getArgPInt("--" + prefix + "-spill-segment-size", it.getProp("spillSegmentSize"), 4 * 1024 * 1024);
+        size_t maxSegments = conf->getArgPInt("--" + prefix + "-spill-max-segments", it.getProp("spillMaxSegments"), 64);
+        spillReplayBatch = conf->getArgPInt("--" + prefix + "-spill-replay-batch", it.getProp("spillReplayBatch"), spillReplayBatch);
+        spillReplayPause = conf->getArgPInt("--" + prefix + "-spill-replay-pause", it.getProp("spillReplayPause"), spillReplayPause);
+
+        try
+        {
+            auto j = unisetstd::make_unique<SpillJournal>(spillDir, segSize, maxSegments);
+            j->open();
+            spill = std::move(j);
+            myinfo << myname << "(init): spill journal '" << spillDir << "'"
+                   << " pending " << spill->getPending() << " records" << endl;
+        }
+        catch( const std::exception& ex )
+        {
+            mycrit << myname << "(init): spill journal '" << spillDir << "' open error: " << ex.what() << endl;
+        }
+    }
+}
+// -----------------------------------------------------------------------------
+static std::string jsonEscape( const std::string& s )
+{
+    std::string r;
+    r.reserve(s.size());
 
+    for( const auto& c : s )
+    {
+        if( c == '"' || c == '\\' )
+            r += '\\';
+
+        r += c;
     }
+
+    return r;
+}
+// -----------------------------------------------------------------------------
+void BackendOpenTSDB::makeTemplate( ParamInfo& inf ) const
+{
+    const string metric = ( tsdbPrefix.empty() ? "" : tsdbPrefix + "." ) + inf.name;
+
+    if( proto == protoTelnet )
+    {
+        inf.head = "put " + metric + " ";
+        inf.tail = ( tsdbTags.empty() ? "" : " " + tsdbTags ) + " " + inf.tags + "\n";
+        return;
+    }
+
+    inf.head = "{\"metric\":\"" + jsonEscape(metric) + "\",\"timestamp\":";
+
+    ostringstream t;
+    t << ",\"tags\":{";
+
+    bool first = true;
+
+    for( const auto& tags : { tsdbTags, inf.tags } )
+    {
+        for( const auto& kv : uniset::explode_str(tags, ' ') )
+        {
+            auto pos = kv.find('=');
+
+            if( pos == string::npos )
+                continue;
+
+            if( !first )
+                t << ",";
+
+            first = false;
+            t << "\"" << jsonEscape(kv.substr(0, pos)) << "\":\"" << jsonEscape(kv.substr(pos + 1)) << "\"";
+        }
+    }
+
+    t << "}},\n";
+    inf.tail = t.str();
 }
 //--------------------------------------------------------------------------------
 void BackendOpenTSDB::help_print( int argc, const char* const* argv )
@@ -154,10 +262,19 @@ void BackendOpenTSDB::help_print( int argc, const char* const* argv )
     cout << "--prefix-prefix name                      - OpenTSDB: prefix for data" << endl;
     cout << "--prefix-tags  'TAG1=VAL1 TAG2=VAL2...'   - OpenTSDB: tags for data" << endl;
     cout << "--prefix-reconnect-time msec              - Time for attempts to connect to DB. Default: 5 sec" << endl;
+    cout << "--prefix-protocol telnet|http             - OpenTSDB: 'put' lines or HTTP /api/put. Default: telnet" << endl;
+    cout << "--prefix-send-timeout msec                - Timeout for send (and HTTP reply). Default: 5 sec" << endl;
     cout << endl;
     cout << "--prefix-buf-size  sz        - Buffer before save to DB. Default: 500" << endl;
-    cout << "--prefix-buf-maxsize  sz     - Maximum size for buffer (drop messages). Default: 5000" << endl;
+    cout << "--prefix-buf-maxsize  sz     - Maximum size for buffer (spill or drop messages). Default: 5000" << endl;
     cout << "--prefix-buf-sync-time msec  - Time period for forced data writing to DB. Default: 5 sec" << endl;
+    cout << "--prefix-chunk-size bytes    - Size of buffer chunk (one HTTP request). Default: 65536" << endl;
+    cout << endl;
+    cout << "--prefix-spill-dir path             - Save data to disk journal when DB unavailable. Default: '' (disabled)" << endl;
+    cout << "--prefix-spill-segment-size bytes   - Journal segment size. Default: 4194304" << endl;
+    cout << "--prefix-spill-max-segments num     - Max segments (oldest are removed on overflow). Default: 64" << endl;
+    cout << "--prefix-spill-replay-batch num     - Records per replay step after reconnect. Default: 5000" << endl;
+    cout << "--prefix-spill-replay-pause msec    - Pause between replay steps. Default: 1000 msec" << endl;
     cout << endl;
     cout << "--prefix-heartbeat-id name   - ID for heartbeat sensor." << endl;
     cout << "--prefix-heartbeat-max val   - max value for heartbeat sensor." << endl;
@@ -242,152 +359,600 @@ void BackendOpenTSDB::askSensors( UniversalIO::UIOCommand cmd )
     }
 }
 // -----------------------------------------------------------------------------
+void BackendOpenTSDB::makeItem( const ParamInfo& inf, const uniset::SensorMessage* sm, std::string& out ) const
+{
+    // put <metric> <timestamp>.msec <value> <tagk1=tagv1[ tagk2=tagv2 ...tagkN=tagvN]>
+    // {"metric":"...","timestamp":<msec>,"value":<value>,"tags":{...}},
+    char buf[32];
+    const long long msec = (long long)sm->sm_tv.tv_sec * 1000 + sm->sm_tv.tv_nsec / 1000000;
+
+    out += inf.head;
+    auto r = std::to_chars(buf, buf + sizeof(buf), msec);
+    out.append(buf, r.ptr - buf);
+    out += ( proto == protoHttp ? ",\"value\":" : " " );
+    r = std::to_chars(buf, buf + sizeof(buf), sm->value);
+    out.append(buf, r.ptr - buf);
+    out += inf.tail;
+}
+// -----------------------------------------------------------------------------
 void BackendOpenTSDB::sensorInfo( const uniset::SensorMessage* sm )
 {
     auto it = tsdbParams.find(sm->id);
 
-    if( it != tsdbParams.end() )
+    if( it == tsdbParams.end() )
+        return;
+
+    item.clear();
+    makeItem(it->second, sm, item);
+
+    myinfo << myname << "(sensorInfo): " << item << endl;
+
+    size_t sz = 0;
+
     {
-        // если буфер заполнился, делаем попытку записи в БД
-        if( buf.size() >= bufSize )
+        std::lock_guard<std::mutex> lk(ibufMutex);
+
+        // поток отправки не успевает (или нет связи с БД)
+        if( ibufItems >= bufMaxSize )
         {
-            if ( !flushBuffer() )
+            if( spill && spill->write(item) )
+                statSpilled++;
+            else
             {
-                // если размер буфера стал максимальный (теряем сообщения)
-                if( buf.size() >= bufMaxSize && !flushBuffer() )
-                {
-                    mycrit << "buffer overflow. Lost data: sid=" << sm->id << " value=" << sm->value << endl;
-                    return;
-                }
+                statLost++;
+                mycrit << "buffer overflow. Lost data: sid=" << sm->id << " value=" << sm->value << endl;
             }
+
+            return;
+        }
+
+        if( ibuf.empty() || ibuf.back().data.size() + item.size() > chunkSize )
+        {
+            ibuf.emplace_back();
+            ibuf.back().data.reserve(chunkSize);
         }
 
-        // put <metric> <timestamp>.msec <value> <tagk1=tagv1[ tagk2=tagv2 ...tagkN=tagvN]>
+        ibuf.back().data += item;
+        ibuf.back().items++;
+        sz = ++ibufItems;
+    }
+
+    if( sz >= bufSize )
+        ibufCond.notify_one();
+}
+// -----------------------------------------------------------------------------
+void BackendOpenTSDB::sysCommand(const SystemMessage* sm)
+{
+    switch( sm->command )
+    {
+        case SystemMessage::StartUp:
+            startWriter();
+            break;
+
+        case SystemMessage::Finish:
+        case SystemMessage::FoldUp:
+            stopWriter();
+            break;
 
-        ostringstream s;
+        default:
+            break;
+    }
+}
+// -----------------------------------------------------------------------------
+void BackendOpenTSDB::startWriter()
+{
+    if( writer )
+        return;
 
-        s << "put ";
+    writerActive = true;
+    writer = unisetstd::make_unique< ThreadCreator<BackendOpenTSDB> >(this, &BackendOpenTSDB::writerThread);
+    writer->start();
+}
+// -----------------------------------------------------------------------------
+void BackendOpenTSDB::stopWriter()
+{
+    if( !writer )
+        return;
 
-        if( !tsdbPrefix.empty() )
-            s << tsdbPrefix << ".";
+    {
+        std::lock_guard<std::mutex> lk(ibufMutex);
+        writerActive = false;
+    }
 
-        s << it->second.name
-          << " " << setw(10) << setfill('0') << sm->sm_tv.tv_sec
-          << setw(3) << setfill('0') << std::round( sm->sm_tv.tv_nsec / 1e6 )
-          << " "
-          << sm->value;
+    ibufCond.notify_all();
 
-        if( !tsdbTags.empty() )
-            s << " " << tsdbTags;
+    if( writer->isRunning() )
+        writer->join();
 
-        s << " "
-          << it->second.tags
-          << endl;
+    writer = nullptr;
+}
+// -----------------------------------------------------------------------------
+void BackendOpenTSDB::writerThread()
+{
+    myinfo << myname << "(writerThread): run.." << endl;
 
-        buf.push_back(s.str());
+    auto lastReconnect = std::chrono::steady_clock::now() - std::chrono::milliseconds(reconnectTime);
 
-        myinfo << myname << "(sensorInfo): " << s.str() << endl;
+    while( writerActive )
+    {
+        if( !connect_ok && std::chrono::steady_clock::now() - lastReconnect >= std::chrono::milliseconds(reconnectTime) )
+        {
+            lastReconnect = std::chrono::steady_clock::now();
+            reconnect();
+        }
 
-        if( !timerIsOn )
+        if( connect_ok )
         {
-            timerIsOn = true;
-            askTimer(tmFlushBuffer, bufSyncTime, 1);
+            {
+                std::lock_guard<std::mutex> lk(ibufMutex);
+
+                // если прошлая отправка не удалась, сначала повторяем её
+                if( wbuf.empty() )
+                {
+                    std::swap(ibuf, wbuf);
+                    wbufItems = ibufItems;
+                    ibufItems = 0;
+                }
+            }
+
+            if( !wbuf.empty() )
+                sendBuffer(wbuf);
+
+            // текущее отправили, досылаем сохранённое в журнале
+            if( connect_ok && wbuf.empty() && spill && !spill->empty() )
+                replaySpill();
+
+            if( connect_ok && proto == protoTelnet )
+                readTelnetErrors();
         }
+
+        // пока есть что досылать из журнала, просыпаемся чаще
+        timeout_t tout = bufSyncTime;
+
+        if( !connect_ok )
+            tout = std::min(reconnectTime, bufSyncTime);
+        else if( spill && !spill->empty() )
+            tout = std::min(spillReplayPause, bufSyncTime);
+
+        std::unique_lock<std::mutex> lk(ibufMutex);
+        ibufCond.wait_for(lk, std::chrono::milliseconds(tout), [&]()
+        {
+            return !writerActive || ( connect_ok && wbuf.empty() && ibufItems >= bufSize );
+        });
     }
+
+    // при завершении отправляем всё что накопилось,
+    // а что не удалось отправить - сохраняем до следующего запуска
+    if( connect_ok )
+    {
+        {
+            std::lock_guard<std::mutex> lk(ibufMutex);
+            wbuf.insert(wbuf.end(), std::make_move_iterator(ibuf.begin()), std::make_move_iterator(ibuf.end()));
+            wbufItems += ibufItems;
+            ibuf.clear();
+            ibufItems = 0;
+        }
+
+        sendBuffer(wbuf);
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(ibufMutex);
+        wbuf.insert(wbuf.end(), std::make_move_iterator(ibuf.begin()), std::make_move_iterator(ibuf.end()));
+        ibuf.clear();
+        ibufItems = 0;
+    }
+
+    if( spill )
+    {
+        spillBuffer(wbuf);
+        spill->sync();
+    }
+    else if( !wbuf.empty() )
+    {
+        size_t lost = 0;
+
+        for( const auto& c : wbuf )
+            lost += c.items;
+
+        statLost += lost;
+        mycrit << myname << "(writerThread): no connection. Lost " << lost << " records" << endl;
+        wbuf.clear();
+    }
+
+    wbufItems = 0;
+    disconnect();
+
+    myinfo << myname << "(writerThread): finished.." << endl;
 }
 // -----------------------------------------------------------------------------
-void BackendOpenTSDB::timerInfo( const uniset::TimerMessage* tm )
+bool BackendOpenTSDB::sendBuffer( Buffer& b )
 {
-    if( tm->id == tmFlushBuffer )
-        flushBuffer();
-    else if( tm->id == tmReconnect )
+    if( proto == protoTelnet )
+        return sendTelnet(b);
+
+    while( !b.empty() )
     {
-        if( reconnect() )
-            askTimer(tmReconnect, 0);
+        if( !sendHttp(b.front()) )
+            return false;
+
+        wbufItems -= std::min((size_t)wbufItems, b.front().items);
+        b.erase(b.begin());
     }
+
+    return true;
 }
 // -----------------------------------------------------------------------------
-void BackendOpenTSDB::sysCommand(const SystemMessage* sm)
+size_t BackendOpenTSDB::writeAll( struct iovec* iov, size_t iovcnt, bool& ok )
 {
-    if( sm->command == SystemMessage::StartUp )
+    size_t total = 0;
+    ok = false;
+
+    if( !tcp )
+        return 0;
+
+    const int fd = tcp->getSocket();
+
+    while( iovcnt > 0 )
     {
-        if( !reconnect() )
-            askTimer(tmReconnect, reconnectTime);
+        ssize_t ret = ::writev(fd, iov, iovcnt);
+
+        if( ret < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            int errnum = errno;
+            ostringstream err;
+            err << "send error (" << errnum << "): " << strerror(errnum);
+            mywarn << myname << "(writeAll): " << err.str() << endl;
+            setError(err.str());
+            return total;
+        }
+
+        total += ret;
+
+        // пропускаем отправленное (при частичной записи)
+        size_t n = ret;
+
+        while( iovcnt > 0 && n >= iov->iov_len )
+        {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        if( iovcnt > 0 )
+        {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
     }
+
+    statSentBytes += total;
+    ok = true;
+    return total;
 }
 // -----------------------------------------------------------------------------
-bool BackendOpenTSDB::flushBuffer()
+bool BackendOpenTSDB::sendTelnet( Buffer& b )
 {
-    if( buf.empty() )
+    std::vector<struct iovec> iov;
+
+    while( !b.empty() )
     {
-        if( timerIsOn )
+        const size_t num = std::min(b.size(), (size_t)IOV_MAX);
+        iov.resize(num);
+
+        for( size_t i = 0; i < num; i++ )
+        {
+            iov[i].iov_base = (void*)b[i].data.data();
+            iov[i].iov_len = b[i].data.size();
+        }
+
+        bool ok = false;
+        size_t sent = writeAll(iov.data(), num, ok);
+
+        // удаляем полностью отправленные куски
+        size_t done = 0;
+
+        for( ; done < num && sent >= b[done].data.size(); done++ )
+        {
+            sent -= b[done].data.size();
+            statSent += b[done].items;
+            wbufItems -= std::min((size_t)wbufItems, b[done].items);
+        }
+
+        // из частично отправленного куска убираем полностью отправленные строки,
+        // оборванная строка будет отправлена заново (сервер отбрасывает её при разрыве соединения)
+        if( done < num && sent > 0 )
         {
-            askTimer(tmFlushBuffer, 0);
-            timerIsOn = false;
+            auto& c = b[done];
+            auto pos = c.data.rfind('\n', sent - 1);
+
+            if( pos != std::string::npos )
+            {
+                size_t n = std::count(c.data.begin(), c.data.begin() + pos + 1, '\n');
+                c.data.erase(0, pos + 1);
+                c.items -= std::min(c.items, n);
+                statSent += n;
+                wbufItems -= std::min((size_t)wbufItems, n);
+            }
         }
 
+        b.erase(b.begin(), b.begin() + done);
+
+        if( !ok )
+        {
+            disconnect();
+            return false;
+        }
+    }
+
+    return true;
+}
+// -----------------------------------------------------------------------------
+bool BackendOpenTSDB::sendHttp( Chunk& c )
+{
+    // каждый объект заканчивается на ",\n", у последнего запятую убираем
+    if( c.data.size() < 2 )
         return true;
+
+    const size_t len = c.data.size() - 2;
+
+    ostringstream h;
+    h << "POST /api/put HTTP/1.1\r\n"
+      << "Host: " << host << ":" << port << "\r\n"
+      << "Content-Type: application/json\r\n"
+      << "Content-Length: " << (len + 2) << "\r\n"
+      << "\r\n";
+
+    const std::string hdr = h.str();
+    static const char lbr[] = "[";
+    static const char rbr[] = "]";
+
+    struct iovec iov[4];
+    iov[0].iov_base = (void*)hdr.data();
+    iov[0].iov_len = hdr.size();
+    iov[1].iov_base = (void*)lbr;
+    iov[1].iov_len = 1;
+    iov[2].iov_base = (void*)c.data.data();
+    iov[2].iov_len = len;
+    iov[3].iov_base = (void*)rbr;
+    iov[3].iov_len = 1;
+
+    bool ok = false;
+    writeAll(iov, 4, ok);
+
+    if( !ok )
+    {
+        disconnect();
+        return false;
     }
 
-    if( !tcp || !tcp->isConnected() )
+    std::string body;
+    int code = readHttpResponse(body);
+
+    if( code < 0 )
+    {
+        disconnect();
         return false;
+    }
 
-    ostringstream q;
+    if( code >= 200 && code < 300 )
+    {
+        statSent += c.items;
+        return true;
+    }
 
-    for( const auto& s : buf )
-        q << s;
+    ostringstream err;
+    err << "HTTP " << code << ": " << body.substr(0, 300);
+    mycrit << myname << "(sendHttp): " << err.str() << endl;
+    setError(err.str());
+
+    // ошибка сервера, попробуем позже
+    if( code >= 500 )
+        return false;
+
+    // ошибка в данных, повторять бессмысленно
+    statRejected += c.items;
+    return true;
+}
+// -----------------------------------------------------------------------------
+int BackendOpenTSDB::readHttpResponse( std::string& body )
+{
+    std::string resp;
+    char buf[4096];
+    size_t hend = std::string::npos;
 
     try
     {
-        const string s(q.str());
-        ssize_t ret = tcp->sendBytes(s.data(), s.size());
+        while( (hend = resp.find("\r\n\r\n")) == std::string::npos )
+        {
+            int n = tcp->receiveBytes(buf, sizeof(buf));
 
-        if( ret < 0 )
+            if( n <= 0 )
+                return -1;
+
+            resp.append(buf, n);
+        }
+
+        if( resp.compare(0, 5, "HTTP/") != 0 )
+            return -1;
+
+        auto sp = resp.find(' ');
+
+        if( sp == std::string::npos )
+            return -1;
+
+        int code = std::atoi(resp.c_str() + sp + 1);
+
+        std::string hdr = resp.substr(0, hend);
+        std::transform(hdr.begin(), hdr.end(), hdr.begin(), ::tolower);
+
+        size_t clen = 0;
+        auto p = hdr.find("content-length:");
+
+        if( p != std::string::npos )
+            clen = std::strtoul(hdr.c_str() + p + 15, nullptr, 10);
+
+        body = resp.substr(hend + 4);
+
+        while( body.size() < clen )
         {
-            int errnum = errno;
+            int n = tcp->receiveBytes(buf, std::min(sizeof(buf), clen - body.size()));
 
-            if( errnum == EPIPE || errnum == EBADF )
-            {
-                mywarn << "(flushBuffer): send error (" << errnum << "): " << strerror(errnum) << endl;
-                reconnect();
-                return false;
-            }
+            if( n <= 0 )
+                return -1;
+
+            body.append(buf, n);
         }
 
+        if( hdr.find("connection: close") != std::string::npos )
+            disconnect();
 
-        buf.clear();
-        askTimer(tmFlushBuffer, 0);
-        timerIsOn = false;
+        return code;
+    }
+    catch( const Poco::Exception& ex )
+    {
+        mywarn << myname << "(readHttpResponse): " << ex.displayText() << endl;
+        setError(ex.displayText());
+    }
+    catch( const std::exception& ex )
+    {
+        mywarn << myname << "(readHttpResponse): " << ex.what() << endl;
+        setError(ex.what());
+    }
 
-        if( !lastError.empty() )
-            lastError = "";
+    return -1;
+}
+// -----------------------------------------------------------------------------
+void BackendOpenTSDB::readTelnetErrors()
+{
+    // в telnet-режиме сервер отвечает только в случае ошибки
+    try
+    {
+        while( tcp && tcp->available() > 0 )
+        {
+            char buf[4096];
+            int n = tcp->receiveBytes(buf, sizeof(buf));
 
-        return true;
+            if( n <= 0 )
+            {
+                disconnect();
+                return;
+            }
+
+            std::string err(buf, n);
+            mywarn << myname << "(readTelnetErrors): " << err << endl;
+            setError(err.substr(0, 300));
+        }
     }
-    catch( Poco::IOException& ex )
+    catch( const Poco::Exception& ex )
     {
-        mywarn << "(flushBuffer): (io): " << ex.displayText() << endl;
-        lastError = ex.displayText();
+        mywarn << myname << "(readTelnetErrors): " << ex.displayText() << endl;
+        disconnect();
+    }
+}
+// -----------------------------------------------------------------------------
+void BackendOpenTSDB::spillBuffer( Buffer& b )
+{
+    size_t saved = 0;
+    size_t lost = 0;
 
-        if( !reconnect() )
-            askTimer(tmReconnect, reconnectTime);
+    for( const auto& c : b )
+    {
+        if( spill->write(c.data) )
+            saved += c.items;
+        else
+            lost += c.items;
     }
-    catch( std::exception& ex )
+
+    b.clear();
+
+    if( saved == 0 && lost == 0 )
+        return;
+
+    statSpilled += saved;
+    statLost += lost;
+
+    mywarn << myname << "(spillBuffer): " << ( connect_ok ? "" : "DB not connected! " )
+           << "save " << saved << " records to journal '" << spill->getDir() << "'"
+           << " (pending " << spill->getPending() << ")" << endl;
+}
+// -----------------------------------------------------------------------------
+void BackendOpenTSDB::replaySpill()
+{
+    // прошлая порция отправлена не полностью: досылаем только остаток,
+    // журнал не перечитываем (иначе уже доставленное будет отправлено повторно)
+    if( rbuf.empty() )
     {
-        mywarn << "(flushBuffer): (std): " << ex.what() << endl;
-        lastError = ex.what();
+        std::vector<std::string> recs;
+        recs.reserve(spillReplayBatch);
+
+        if( spill->read(recs, spillReplayBatch) == 0 )
+        {
+            spill->commit();
+            return;
+        }
+
+        for( const auto& r : recs )
+        {
+            // записи сохранены в том формате, в котором отправлялись
+            if( r.empty() || ( proto == protoHttp ) != ( r[0] == '{' ) )
+            {
+                mycrit << myname << "(replaySpill): bad (or other protocol) record in journal: '" << r.substr(0, 100) << "'" << endl;
+                continue;
+            }
+
+            if( rbuf.empty() || rbuf.back().data.size() + r.size() > chunkSize )
+                rbuf.emplace_back();
+
+            rbuf.back().data += r;
+            rbuf.back().items += std::count(r.begin(), r.end(), '\n');
+        }
     }
 
-    return false;
+    // sendBuffer() убирает из rbuf всё доставленное, в т.ч. при ошибке
+    const size_t sent = statSent;
+    const bool ok = sendBuffer(rbuf);
+    const size_t items = statSent - sent;
+
+    statSent = sent; // досланное учитываем отдельно
+    statReplayed += items;
+
+    if( !ok )
+        return;
+
+    spill->commit();
+    myinfo << myname << "(replaySpill): replay " << items << " records"
+           << " (pending " << spill->getPending() << ")" << endl;
 }
 //------------------------------------------------------------------------------
-bool BackendOpenTSDB::reconnect()
+void BackendOpenTSDB::setError( const std::string& err )
+{
+    std::lock_guard<std::mutex> l(errMutex);
+    lastError = err;
+}
+//------------------------------------------------------------------------------
+void BackendOpenTSDB::disconnect()
 {
+    connect_ok = false;
+
     if( tcp )
     {
-        tcp->forceDisconnect();
+        try
+        {
+            tcp->forceDisconnect();
+        }
+        catch(...) {}
+
         tcp = nullptr;
     }
+}
+//------------------------------------------------------------------------------
+bool BackendOpenTSDB::reconnect()
+{
+    disconnect();
 
     try
     {
@@ -395,29 +960,30 @@ bool BackendOpenTSDB::reconnect()
 
         tcp = make_shared<UTCPStream>();
         tcp->create(host, port, 500);
-        //      tcp->setReceiveTimeout(UniSetTimer::millisecToPoco(replyTimeOut_ms));
-        tcp->setKeepAlive(true); // tcp->setKeepAliveParams((replyTimeOut_ms > 1000 ? replyTimeOut_ms / 1000 : 1));
+        tcp->setKeepAlive(true);
         tcp->setNoDelay(true);
+        tcp->setSendTimeout( UniSetTimer::millisecToPoco(sendTimeout) );
+        tcp->setReceiveTimeout( UniSetTimer::millisecToPoco(sendTimeout) );
 
-        if( !lastError.empty() )
-            lastError = "";
-
+        statReconnects++;
+        setError("");
+        connect_ok = true;
         return true;
     }
     catch( Poco::TimeoutException& ex)
     {
         mycrit << myname << "(connect): " << host << ":" << port << " timeout exception" << endl;
-        lastError = "connect timeout";
+        setError("connect timeout");
     }
     catch( Poco::Net::NetException& ex)
     {
         mycrit << myname << "(connect): " << host << ":" << port << " error: " << ex.displayText() << endl;
-        lastError = ex.displayText();
+        setError(ex.displayText());
     }
     catch( const std::exception& e )
     {
         mycrit << myname << "(connect): " << host << ":" << port << " error: " << e.what() << endl;
-        lastError = e.what();
+        setError(e.what());
     }
     catch( ... )
     {
@@ -432,17 +998,50 @@ std::string BackendOpenTSDB::getMonitInfo() const
 {
     ostringstream inf;
 
+    size_t isize = 0;
+    {
+        std::lock_guard<std::mutex> lk(ibufMutex);
+        isize = ibufItems;
+    }
+
     inf << "Database: " << host << ":" << port
         << " ["
+        << " protocol=" << ( proto == protoHttp ? "http" : "telnet" )
         << " reconnect=" << reconnectTime
         << " bufSyncTime=" << bufSyncTime
         << " bufSize=" << bufSize
+        << " bufMaxSize=" << bufMaxSize
+        << " chunkSize=" << chunkSize
         << " tsdbPrefix: '" << tsdbPrefix << "'"
         << " tsdbTags: '" << tsdbTags << "'"
         << " ]" << endl
-        << "  connection: " << ( tcp && tcp->isConnected() ? "OK" : "FAILED") << endl
-        << " buffer size: " << buf.size() << endl
-        << "   lastError: " << lastError << endl;
+        << "  connection: " << ( connect_ok ? "OK" : "FAILED") << " (reconnects: " << statReconnects << ")" << endl
+        << "      writer: " << ( writer && writer->isRunning() ? "RUNNING" : "STOPPED" ) << endl
+        << " buffer size: " << (isize + wbufItems) << " (ibuf=" << isize << " wbuf=" << wbufItems << ")" << endl
+        << "        sent: " << statSent << " (" << statSentBytes << " bytes)" << endl
+        << "    rejected: " << statRejected << endl
+        << "        lost: " << statLost << endl;
+
+    {
+        std::lock_guard<std::mutex> l(errMutex);
+        inf << "   lastError: " << lastError << endl;
+    }
+
+    if( spill )
+    {
+        inf << "Spill journal: "
+            << "[ dir='" << spill->getDir() << "'"
+            << " segmentSize=" << spill->getSegmentSize()
+            << " maxSegments=" << spill->getMaxSegments()
+            << " replayBatch=" << spillReplayBatch
+            << " replayPause=" << spillReplayPause
+            << " ]" << endl
+            << "     pending: " << spill->getPending() << " (" << spill->getPendingBytes() << " bytes, "
+            << spill->getSegments() << " segments)" << endl
+            << "     spilled: " << statSpilled << endl
+            << "    replayed: " << statReplayed << endl
+            << "        lost: " << spill->getLost() << endl;
+    }
 
     return inf.str();
 }
@@ -17,15 +17,21 @@
 #ifndef _BackendOpenTSDB_H_
 #define _BackendOpenTSDB_H_
 // -----------------------------------------------------------------------------
-#include <deque>
+#include <vector>
 #include <memory>
 #include <unordered_map>
 #include <chrono>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <sys/uio.h>
 #include "UObject_SK.h"
 #include "SMInterface.h"
 #include "SharedMemory.h"
 #include "extensions/Extensions.h"
 #include "UTCPStream.h"
+#include "ThreadCreator.h"
+#include "SpillJournal.h"
 // --------------------------------------------------------------------------
 namespace uniset
 {
@@ -37,6 +43,8 @@ namespace uniset
       - \ref sec_OpenTSDB_Conf
       - \ref sec_OpenTSDB_Name
       - \ref sec_OpenTSDB_Queue
+      - \ref sec_OpenTSDB_HTTP
+      - \ref sec_OpenTSDB_Fake
 
     \section sec_OpenTSDB_Comm Общее описание шлюза к OpenTSDB
 
@@ -95,8 +103,40 @@ namespace uniset
     - \b sizeOfMessageQueue - Размер очереди сообщений для обработки изменений по датчикам.
      При большом количестве отслеживаемых датчиков, размер должен быть достаточным, чтобы не терять изменения.
 
-    \todo Нужна ли поддержка авторизации для TSDB (возможно придётся перейти на HTTP REST API)
-    \todo Доделать возможность задать политику при переполнении буфера (удалять последние или первые, сколько чистить)
+    Данные формируются сразу в виде текста для отправки в буфере из нескольких "кусков" (chunkSize байт),
+    без создания строки на каждое сообщение. Имя метрики и теги для каждого датчика формируются один раз при инициализации.
+    Отправка ведётся отдельным потоком: он забирает накопленные куски (меняет буферы местами)
+    и отправляет их одним вызовом writev(). Подключение (и переподключение) к БД тоже выполняется
+    этим потоком, поэтому обработка сообщений от датчиков не блокируется при недоступности БД.
+    Если отправка не удалась, неотправленные данные посылаются после переподключения,
+    начиная с первой не полностью отправленной строки (оборванную строку сервер отбрасывает при разрыве соединения).
+
+    Если задан каталог \b spillDir (--prefix-spill-dir), то при переполнении буфера и при завершении
+    работы с неотправленными данными, данные сохраняются на диск в журнал (см. SpillJournal)
+    и досылаются после восстановления связи порциями по \b spillReplayBatch не чаще чем раз в \b spillReplayPause мсек.
+    Если порция отправлена не полностью, уже доставленное из неё повторно не посылается:
+    досылается только остаток (так же как при обычной отправке), а в журнале порция подтверждается
+    после отправки остатка.
+
+    \section sec_OpenTSDB_HTTP Отправка через HTTP API
+    При задании \b protocol="http" (--prefix-protocol http) данные отправляются запросами POST /api/put
+    (массив JSON-объектов), каждый кусок буфера - отдельный запрос. Соединение при этом сохраняется (keep-alive).
+    Ответ сервера проверяется: при ошибке в данных (4xx) кусок отбрасывается (см. lastError),
+    при ошибке связи - отправляется повторно.
+    \code
+    <BackendOpenTSDB name="BackendOpenTSDB1" host="localhost" port="4242" protocol="http" .../>
+    \endcode
+
+    \section sec_OpenTSDB_Fake Тестовый сервер
+    Для проверки пропускной способности в состав входит простой сервер \b opentsdb-fake-server,
+    который принимает данные (telnet или HTTP), отвечает на HTTP-запросы 204 и раз в секунду выводит
+    количество принятых точек.
+    \code
+    ./opentsdb-fake-server 4242 &
+    ./start_fg.sh --opentsdb-port 4242
+    \endcode
+
+    \todo Нужна ли поддержка авторизации для TSDB
     */
     // -----------------------------------------------------------------------------
     /*! Реализация DBServer для OpenTSDB */
@@ -142,13 +182,10 @@ namespace uniset
 
             virtual void askSensors( UniversalIO::UIOCommand cmd ) override;
             virtual void sensorInfo( const uniset::SensorMessage* sm ) override;
-            virtual void timerInfo( const uniset::TimerMessage* tm ) override;
             virtual void sysCommand( const uniset::SystemMessage* sm ) override;
             virtual std::string getMonitInfo() const override;
 
             void init( xmlNode* cnode );
-            bool flushBuffer();
-            bool reconnect();
 
             std::shared_ptr<SMInterface> shm;
 
@@ -157,6 +194,10 @@ namespace uniset
                 const std::string name;
                 const std::string tags;
 
+                // неизменяемые части записи (формируются при инициализации)
+                std::string head; // "put metric " или "{"metric":"...","timestamp":
+                std::string tail; // " tags\n" или ","tags":{...}},"
+
                 ParamInfo( const std::string& _name, const std::string& _tags ):
                     name(_name), tags(_tags) {}
             };
@@ -168,19 +209,81 @@ namespace uniset
             timeout_t bufSyncTime = { 5000 };
             size_t bufSize = { 500 };
             size_t bufMaxSize = { 5000 }; // drop messages
-            bool timerIsOn = { false };
             timeout_t reconnectTime = { 5000 };
-            std::string lastError;
+            timeout_t sendTimeout = { 5000 };
+
+            // буфер: накопленные данные в виде готового для отправки текста
+            struct Chunk
+            {
+                std::string data;
+                size_t items = { 0 };
+            };
 
-            // буфер mutex-ом можно не защищать
-            // т.к. к нему идёт обращение только из основного потока обработки
-            // (sensorInfo, timerInfo)
-            std::deque<std::string> buf;
+            using Buffer = std::vector<Chunk>;
+            size_t chunkSize = { 64 * 1024 };
 
-            // работа с OpenTSDB
+            Buffer ibuf; // заполняется при обработке сообщений
+            Buffer wbuf; // отправляется потоком записи
+            size_t ibufItems = { 0 };
+            mutable std::mutex ibufMutex;
+            std::condition_variable ibufCond;
+
+            void makeTemplate( ParamInfo& inf ) const;
+            void makeItem( const ParamInfo& inf, const uniset::SensorMessage* sm, std::string& out ) const;
+            std::string item; // формируемая запись (sensorInfo)
+
+            // поток отправки
+            void writerThread();
+            void startWriter();
+            void stopWriter();
+            bool reconnect();
+            void disconnect();
+            bool sendBuffer( Buffer& b );
+            bool sendTelnet( Buffer& b );
+            bool sendHttp( Chunk& c );
+            size_t writeAll( struct iovec* iov, size_t iovcnt, bool& ok );
+            int readHttpResponse( std::string& body );
+            void readTelnetErrors();
+            void setError( const std::string& err );
+
+            std::unique_ptr< ThreadCreator<BackendOpenTSDB> > writer;
+            std::atomic_bool writerActive = { false };
+
+            enum Protocol
+            {
+                protoTelnet,
+                protoHttp
+            };
+
+            Protocol proto = { protoTelnet };
+
+            // работа с OpenTSDB (только из потока отправки)
             std::shared_ptr<UTCPStream> tcp;
             std::string host = { "localhost" };
             int port = { 4242 };
+            std::atomic_bool connect_ok = { false };
+
+            // дисковый журнал (при недоступности БД)
+            void spillBuffer( Buffer& b );
+            void replaySpill();
+
+            std::unique_ptr<SpillJournal> spill; // nullptr - журнал не используется
+            Buffer rbuf; // прочитанное из журнала, но ещё не отправленное (журнал подтверждается после отправки всего)
+            size_t spillReplayBatch = { 5000 };
+            timeout_t spillReplayPause = { 1000 };
+
+            // статистика (для getMonitInfo)
+            std::atomic<size_t> wbufItems = { 0 };
+            std::atomic<size_t> statSent = { 0 };
+            std::atomic<size_t> statSentBytes = { 0 };
+            std::atomic<size_t> statLost = { 0 };
+            std::atomic<size_t> statRejected = { 0 };
+            std::atomic<size_t> statSpilled = { 0 };
+            std::atomic<size_t> statReplayed = { 0 };
+            std::atomic<size_t> statReconnects = { 0 };
+
+            mutable std::mutex errMutex;
+            std::string lastError;
 
         private:
 
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -----------------------------------------------------------------------------
+// Простой "сервер OpenTSDB" для проверки пропускной способности BackendOpenTSDB.
+// Принимает строки 'put ...' (telnet) или POST /api/put (HTTP),
+// считает принятые точки и раз в секунду выводит статистику.
+// -----------------------------------------------------------------------------
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+// -----------------------------------------------------------------------------
+using namespace std;
+// -----------------------------------------------------------------------------
+struct Client
+{
+    int fd = { -1 };
+    std::string buf;
+};
+// -----------------------------------------------------------------------------
+static size_t points = 0;
+static size_t requests = 0;
+static size_t bytes = 0;
+// -----------------------------------------------------------------------------
+// обработать накопленные данные, вернуть false если соединение нужно закрыть
+static bool processClient( Client& c )
+{
+    while( !c.buf.empty() )
+    {
+        if( c.buf.compare(0, 4, "POST") == 0 )
+        {
+            auto hend = c.buf.find("\r\n\r\n");
+
+            if( hend == string::npos )
+                return true;
+
+            string hdr = c.buf.substr(0, hend);
+            std::transform(hdr.begin(), hdr.end(), hdr.begin(), ::tolower);
+            auto p = hdr.find("content-length:");
+            size_t clen = ( p == string::npos ) ? 0 : std::strtoul(hdr.c_str() + p + 15, nullptr, 10);
+
+            if( c.buf.size() < hend + 4 + clen )
+                return true;
+
+            const char* body = c.buf.data() + hend + 4;
+            points += std::count(body, body + clen, '{') / 2; // {"metric":.. "tags":{..}}
+            requests++;
+            c.buf.erase(0, hend + 4 + clen);
+
+            static const char reply[] = "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n";
+
+            if( ::send(c.fd, reply, sizeof(reply) - 1, MSG_NOSIGNAL) < 0 )
+                return false;
+
+            continue;
+        }
+
+        // telnet: считаем полные строки
+        auto pos = c.buf.rfind('\n');
+
+        if( pos == string::npos )
+            return true;
+
+        points += std::count(c.buf.begin(), c.buf.begin() + pos + 1, '\n');
+        c.buf.erase(0, pos + 1);
+    }
+
+    return true;
+}
+// -----------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+    if( argc > 1 && ( !strcmp(argv[1], "--help") || !strcmp(argv[1], "-h") ) )
+    {
+        cout << "Usage: " << argv[0] << " [port]" << endl;
+        cout << "Fake OpenTSDB server (telnet 'put' and HTTP /api/put). Default port: 4242" << endl;
+        return 0;
+    }
+
+    int port = ( argc > 1 ) ? atoi(argv[1]) : 4242;
+
+    int lsock = ::socket(AF_INET, SOCK_STREAM, 0);
+
+    if( lsock < 0 )
+    {
+        perror("socket");
+        return 1;
+    }
+
+    int on = 1;
+    setsockopt(lsock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if( ::bind(lsock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(lsock, 16) < 0 )
+    {
+        perror("bind/listen");
+        return 1;
+    }
+
+    cout << "(fake-tsdb): listen port " << port << endl;
+
+    std::vector<Client> clients;
+    std::vector<struct pollfd> pfd;
+    std::vector<char> rbuf(256 * 1024);
+
+    auto tstart = std::chrono::steady_clock::now();
+    size_t lastPoints = 0;
+
+    while( true )
+    {
+        pfd.clear();
+        pfd.push_back({ lsock, POLLIN, 0 });
+
+        for( const auto& c : clients )
+            pfd.push_back({ c.fd, POLLIN, 0 });
+
+        int n = ::poll(pfd.data(), pfd.size(), 200);
+
+        if( n < 0 && errno != EINTR )
+        {
+            perror("poll");
+            break;
+        }
+
+        if( n > 0 )
+        {
+            if( pfd[0].revents & POLLIN )
+            {
+                int fd = ::accept(lsock, nullptr, nullptr);
+
+                if( fd >= 0 )
+                {
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                    Client c;
+                    c.fd = fd;
+                    clients.push_back(c);
+                    cout << "(fake-tsdb): new connection. Clients: " << clients.size() << endl;
+                }
+            }
+
+            for( size_t i = 1; i < pfd.size(); i++ )
+            {
+                if( !(pfd[i].revents & (POLLIN | POLLHUP | POLLERR)) )
+                    continue;
+
+                Client& c = clients[i - 1];
+                ssize_t r = ::recv(c.fd, rbuf.data(), rbuf.size(), 0);
+
+                if( r > 0 )
+                {
+                    bytes += r;
+                    c.buf.append(rbuf.data(), r);
+
+                    if( processClient(c) )
+                        continue;
+                }
+
+                ::close(c.fd);
+                c.fd = -1;
+            }
+
+            clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client & c )
+            {
+                return c.fd < 0;
+            }), clients.end());
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto msec = std::chrono::duration_cast<std::chrono::milliseconds>(now - tstart).count();
+
+        if( msec >= 1000 )
+        {
+            cout << "(fake-tsdb): " << ((points - lastPoints) * 1000 / msec) << " points/sec"
+                 << " [total points=" << points << " requests=" << requests << " bytes=" << bytes
+                 << " clients=" << clients.size() << "]" << endl;
+
+            lastPoints = points;
+            tstart = now;
+        }
+    }
+
+    ::close(lsock);
+    return 0;
+}
+// -----------------------------------------------------------------------------
@@ -0,0 +1,514 @@
+#include <catch.hpp>
+// -----------------------------------------------------------------------------
+#include <memory>
+#include <future>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "Configuration.h"
+#include "unisetstd.h"
+#include "BackendOpenTSDB.h"
+// -----------------------------------------------------------------------------
+using namespace std;
+using namespace uniset;
+// -----------------------------------------------------------------------------
+static const std::string confile = "opentsdb-test-configure.xml";
+// -----------------------------------------------------------------------------
+static void InitTest()
+{
+    if( uniset_conf() )
+        return;
+
+    int argc = 1;
+    std::string prog = "tests";
+    char* argv[] = { (char*)prog.c_str() };
+    auto conf = uniset_init(argc, argv, confile);
+    REQUIRE( conf != nullptr );
+}
+// -----------------------------------------------------------------------------
+// доступ к внутренностям BackendOpenTSDB (без SM и потока отправки)
+class TestOpenTSDB:
+    public BackendOpenTSDB
+{
+    public:
+        TestOpenTSDB( const std::string& name ):
+            BackendOpenTSDB(uniset_conf()->getObjectID(name), uniset_conf()->getNode(name),
+                            uniset_conf()->getControllerID("SharedMemory"))
+        {
+            bufMaxSize = 1000000;
+        }
+
+        void setServer( int p, size_t chunk, timeout_t tout = 5000 )
+        {
+            host = "127.0.0.1";
+            port = p;
+            chunkSize = chunk;
+            sendTimeout = tout;
+        }
+
+        void setSpill( const std::string& dir )
+        {
+            spill = unisetstd::make_unique<SpillJournal>(dir, 64 * 1024, 16);
+            spill->open();
+        }
+
+        void put( uniset::ObjectId sid, long value )
+        {
+            SensorMessage sm(sid, value);
+            sensorInfo(&sm);
+        }
+
+        // забрать накопленное для отправки
+        Buffer& takeBuffer()
+        {
+            std::lock_guard<std::mutex> lk(ibufMutex);
+            wbuf.insert(wbuf.end(), std::make_move_iterator(ibuf.begin()), std::make_move_iterator(ibuf.end()));
+            wbufItems += ibufItems;
+            ibuf.clear();
+            ibufItems = 0;
+            return wbuf;
+        }
+
+        using BackendOpenTSDB::Buffer;
+        using BackendOpenTSDB::reconnect;
+        using BackendOpenTSDB::disconnect;
+        using BackendOpenTSDB::sendBuffer;
+        using BackendOpenTSDB::spillBuffer;
+        using BackendOpenTSDB::replaySpill;
+        using BackendOpenTSDB::spill;
+        using BackendOpenTSDB::statSent;
+        using BackendOpenTSDB::statRejected;
+        using BackendOpenTSDB::statReplayed;
+        using BackendOpenTSDB::statSpilled;
+};
+// -----------------------------------------------------------------------------
+// простой OpenTSDB-сервер на локальном сокете
+class FakeTSDB
+{
+    public:
+        // rcvbuf - размер буфера приёма (маленький, чтобы быстро "забить" соединение)
+        FakeTSDB( int rcvbuf = 0 )
+        {
+            sock = ::socket(AF_INET, SOCK_STREAM, 0);
+            REQUIRE( sock >= 0 );
+
+            if( rcvbuf > 0 )
+                setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+            struct sockaddr_in sa = {};
+            sa.sin_family = AF_INET;
+            sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            sa.sin_port = 0;
+
+            REQUIRE( ::bind(sock, (struct sockaddr*)&sa, sizeof(sa)) == 0 );
+            REQUIRE( ::listen(sock, 5) == 0 );
+
+            socklen_t len = sizeof(sa);
+            REQUIRE( ::getsockname(sock, (struct sockaddr*)&sa, &len) == 0 );
+            port = ntohs(sa.sin_port);
+        }
+
+        ~FakeTSDB()
+        {
+            ::close(sock);
+        }
+
+        inline int getPort() const
+        {
+            return port;
+        }
+
+        // принять соединение и прочитать всё до его закрытия клиентом
+        std::string readConnection()
+        {
+            std::string ret;
+            int fd = acceptConnection();
+
+            if( fd < 0 )
+                return ret;
+
+            char buf[64 * 1024];
+
+            while( waitData(fd) )
+            {
+                ssize_t n = ::read(fd, buf, sizeof(buf));
+
+                if( n <= 0 )
+                    break;
+
+                ret.append(buf, n);
+            }
+
+            ::close(fd);
+            return ret;
+        }
+
+        // принять соединение и ответить на запросы POST /api/put кодами из списка
+        // возвращает тела принятых запросов
+        std::vector<std::string> serveHttp( const std::vector<int>& codes )
+        {
+            std::vector<std::string> ret;
+            int fd = acceptConnection();
+
+            if( fd < 0 )
+                return ret;
+
+            std::string in;
+            char buf[4096];
+
+            for( const auto& code : codes )
+            {
+                size_t hend = std::string::npos;
+                size_t clen = 0;
+
+                while( true )
+                {
+                    hend = in.find("\r\n\r\n");
+
+                    if( hend != std::string::npos )
+                    {
+                        std::string hdr = in.substr(0, hend);
+                        std::transform(hdr.begin(), hdr.end(), hdr.begin(), ::tolower);
+                        auto p = hdr.find("content-length:");
+
+                        if( p != std::string::npos )
+                            clen = std::strtoul(hdr.c_str() + p + 15, nullptr, 10);
+
+                        if( in.size() >= hend + 4 + clen )
+                            break;
+                    }
+
+                    if( !waitData(fd) )
+                    {
+                        ::close(fd);
+                        return ret;
+                    }
+
+                    ssize_t n = ::read(fd, buf, sizeof(buf));
+
+                    if( n <= 0 )
+                    {
+                        ::close(fd);
+                        return ret;
+                    }
+
+                    in.append(buf, n);
+                }
+
+                ret.push_back(in.substr(hend + 4, clen));
+                in.erase(0, hend + 4 + clen);
+
+                const std::string body = ( code == 204 ? "" : "{\"error\":{\"code\":" + std::to_string(code) + "}}" );
+                std::string resp = "HTTP/1.1 " + std::to_string(code) + " Test\r\n"
+                                   "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                                   "\r\n" + body;
+
+                if( ::write(fd, resp.data(), resp.size()) != (ssize_t)resp.size() )
+                    break;
+            }
+
+            ::close(fd);
+            return ret;
+        }
+
+    protected:
+
+        int acceptConnection()
+        {
+            if( !waitData(sock) )
+                return -1;
+
+            return ::accept(sock, nullptr, nullptr);
+        }
+
+        static bool waitData( int fd )
+        {
+            struct pollfd p = { fd, POLLIN, 0 };
+            return ::poll(&p, 1, 5000) > 0;
+        }
+
+        int sock = { -1 };
+        int port = { 0 };
+};
+// -----------------------------------------------------------------------------
+static std::string join( const TestOpenTSDB::Buffer& b, size_t& items )
+{
+    std::string ret;
+    items = 0;
+
+    for( const auto& c : b )
+    {
+        ret += c.data;
+        items += c.items;
+    }
+
+    return ret;
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[OpenTSDB]: telnet chunks", "[opentsdb][telnet]")
+{
+    InitTest();
+
+    FakeTSDB srv;
+    TestOpenTSDB t("BackendOpenTSDB1");
+    t.setServer(srv.getPort(), 1024);
+
+    const size_t num = 1000;
+
+    for( size_t i = 0; i < num; i++ )
+        t.put( (i % 2) ? 1 : 2, i );
+
+    // датчик без tsdb="1" не сохраняется
+    t.put(3, 100);
+
+    auto& b = t.takeBuffer();
+    REQUIRE( b.size() > 1 );
+
+    for( const auto& c : b )
+    {
+        // кусок не больше chunkSize и состоит из целых строк
+        REQUIRE( c.data.size() <= 1024 );
+        REQUIRE( c.data.back() == '\n' );
+        REQUIRE( (size_t)std::count(c.data.begin(), c.data.end(), '\n') == c.items );
+    }
+
+    size_t items = 0;
+    const std::string expected = join(b, items);
+    REQUIRE( items == num );
+    REQUIRE( expected.compare(0, 15, "put test.AI2_S ") == 0 );
+    REQUIRE( expected.find(" host=test tag2=2\n") != std::string::npos );
+
+    REQUIRE( t.reconnect() );
+    REQUIRE( t.sendBuffer(b) );
+    REQUIRE( b.empty() );
+    t.disconnect();
+
+    REQUIRE( srv.readConnection() == expected );
+    REQUIRE( t.statSent == num );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[OpenTSDB]: telnet resend after partial write", "[opentsdb][telnet]")
+{
+    InitTest();
+
+    // сервер не читает данные, поэтому отправка обрывается по sendTimeout посреди куска
+    FakeTSDB srv(4096);
+    TestOpenTSDB t("BackendOpenTSDB1");
+    t.setServer(srv.getPort(), 64 * 1024, 200);
+
+    const size_t num = 200000;
+
+    for( size_t i = 0; i < num; i++ )
+        t.put(1, i);
+
+    auto& b = t.takeBuffer();
+    size_t items = 0;
+    const std::string expected = join(b, items);
+    REQUIRE( items == num );
+
+    REQUIRE( t.reconnect() );
+    REQUIRE_FALSE( t.sendBuffer(b) );
+    REQUIRE_FALSE( b.empty() );
+
+    size_t left = 0;
+    join(b, left);
+    REQUIRE( t.statSent > 0 );
+    REQUIRE( t.statSent + left == num );
+
+    // первое соединение уже закрыто клиентом, забираем что успело дойти
+    const std::string d1 = srv.readConnection();
+
+    auto f = std::async(std::launch::async, [&srv]()
+    {
+        return srv.readConnection();
+    });
+
+    REQUIRE( t.reconnect() );
+    REQUIRE( t.sendBuffer(b) );
+    REQUIRE( b.empty() );
+    t.disconnect();
+
+    const std::string d2 = f.get();
+
+    // оборванная строка (если есть) отправляется заново,
+    // полностью отправленные строки повторно не посылаются
+    auto pos = d1.rfind('\n');
+    const std::string d1full = ( pos == std::string::npos ? "" : d1.substr(0, pos + 1) );
+    REQUIRE( d1full.size() + d2.size() == expected.size() );
+    REQUIRE( d1full + d2 == expected );
+    REQUIRE( t.statSent == num );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[OpenTSDB]: http 4xx/5xx", "[opentsdb][http]")
+{
+    InitTest();
+
+    FakeTSDB srv;
+    TestOpenTSDB t("BackendOpenTSDB2");
+    t.setServer(srv.getPort(), 512);
+
+    for( size_t i = 0; i < 30; i++ )
+        t.put(1, i);
+
+    auto& b = t.takeBuffer();
+    REQUIRE( b.size() >= 3 );
+
+    const TestOpenTSDB::Buffer orig = b;
+    size_t total = 0;
+    join(orig, total);
+    REQUIRE( total == 30 );
+
+    // 400 - данные отбрасываются, 500 - повтор того же куска
+    std::vector<int> codes = { 400, 500 };
+    codes.insert(codes.end(), orig.size() - 1, 204);
+
+    auto f = std::async(std::launch::async, [&srv, codes]()
+    {
+        return srv.serveHttp(codes);
+    });
+
+    REQUIRE( t.reconnect() );
+    REQUIRE_FALSE( t.sendBuffer(b) );
+    REQUIRE( b.size() == orig.size() - 1 );
+    REQUIRE( t.statRejected == orig[0].items );
+    REQUIRE( t.statSent == 0 );
+
+    REQUIRE( t.sendBuffer(b) );
+    REQUIRE( b.empty() );
+    REQUIRE( t.statRejected == orig[0].items );
+    REQUIRE( t.statSent == total - orig[0].items );
+    t.disconnect();
+
+    auto bodies = f.get();
+    REQUIRE( bodies.size() == orig.size() + 1 );
+
+    // каждый кусок - отдельный JSON-массив
+    REQUIRE( bodies[0] == "[" + orig[0].data.substr(0, orig[0].data.size() - 2) + "]" );
+    REQUIRE( bodies[1] == "[" + orig[1].data.substr(0, orig[1].data.size() - 2) + "]" );
+    REQUIRE( bodies[2] == bodies[1] );
+
+    for( size_t i = 2; i < orig.size(); i++ )
+        REQUIRE( bodies[i + 1] == "[" + orig[i].data.substr(0, orig[i].data.size() - 2) + "]" );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[OpenTSDB]: spill replay", "[opentsdb][spill]")
+{
+    InitTest();
+
+    char tmpl[] = "/tmp/uniset-opentsdb-XXXXXX";
+    REQUIRE( mkdtemp(tmpl) != nullptr );
+    const std::string tmpdir(tmpl);
+
+    FakeTSDB srv;
+
+    {
+        TestOpenTSDB t("BackendOpenTSDB1");
+        t.setServer(srv.getPort(), 1024);
+        t.setSpill(tmpdir + "/journal");
+
+        const size_t num = 500;
+
+        for( size_t i = 0; i < num; i++ )
+            t.put(1, i);
+
+        auto& b = t.takeBuffer();
+        size_t items = 0;
+        const std::string expected = join(b, items);
+        REQUIRE( items == num );
+
+        // нет связи: сохраняем в журнал
+        t.spillBuffer(b);
+        REQUIRE( b.empty() );
+        REQUIRE( t.statSpilled == num );
+        const size_t pending = t.spill->getPending();
+        REQUIRE( pending > 0 );
+
+        // неудачная досылка ничего не удаляет из журнала
+        t.replaySpill();
+        REQUIRE( t.spill->getPending() == pending );
+        REQUIRE( t.statReplayed == 0 );
+
+        REQUIRE( t.reconnect() );
+        t.replaySpill();
+        t.disconnect();
+
+        REQUIRE( srv.readConnection() == expected );
+        REQUIRE( t.spill->empty() );
+        REQUIRE( t.statReplayed == num );
+        REQUIRE( t.statSent == 0 );
+
+        t.spill->close();
+    }
+
+    std::string cmd = "rm -rf '" + tmpdir + "'";
+    REQUIRE( system(cmd.c_str()) == 0 );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[OpenTSDB]: spill replay resumes after partial send", "[opentsdb][spill][http]")
+{
+    InitTest();
+
+    char tmpl[] = "/tmp/uniset-opentsdb-XXXXXX";
+    REQUIRE( mkdtemp(tmpl) != nullptr );
+    const std::string tmpdir(tmpl);
+
+    FakeTSDB srv;
+
+    {
+        TestOpenTSDB t("BackendOpenTSDB2");
+        t.setServer(srv.getPort(), 512);
+        t.setSpill(tmpdir + "/journal");
+
+        for( size_t i = 0; i < 30; i++ )
+            t.put(1, i);
+
+        auto& b = t.takeBuffer();
+        const TestOpenTSDB::Buffer orig = b;
+        REQUIRE( orig.size() >= 3 );
+        size_t total = 0;
+        join(orig, total);
+
+        t.spillBuffer(b);
+        const size_t pending = t.spill->getPending();
+        REQUIRE( pending == orig.size() );
+
+        // первый кусок доставлен, на втором ошибка сервера
+        std::vector<int> codes = { 204, 500 };
+        codes.insert(codes.end(), orig.size() - 1, 204);
+
+        auto f = std::async(std::launch::async, [&srv, codes]()
+        {
+            return srv.serveHttp(codes);
+        });
+
+        REQUIRE( t.reconnect() );
+        t.replaySpill();
+        REQUIRE( t.spill->getPending() == pending );
+        REQUIRE( t.statReplayed == orig[0].items );
+
+        // досылается только остаток
+        t.replaySpill();
+        REQUIRE( t.spill->empty() );
+        REQUIRE( t.statReplayed == total );
+        REQUIRE( t.statSent == 0 );
+        t.disconnect();
+
+        auto bodies = f.get();
+        REQUIRE( bodies.size() == orig.size() + 1 );
+        REQUIRE( bodies[0] == "[" + orig[0].data.substr(0, orig[0].data.size() - 2) + "]" );
+        REQUIRE( bodies[1] == "[" + orig[1].data.substr(0, orig[1].data.size() - 2) + "]" );
+        REQUIRE( bodies[2] == bodies[1] );
+
+        for( size_t i = 2; i < orig.size(); i++ )
+            REQUIRE( bodies[i + 1] == "[" + orig[i].data.substr(0, orig[i].data.size() - 2) + "]" );
+
+        t.spill->close();
+    }
+
+    std::string cmd = "rm -rf '" + tmpdir + "'";
+    REQUIRE( system(cmd.c_str()) == 0 );
+}
+// -----------------------------------------------------------------------------
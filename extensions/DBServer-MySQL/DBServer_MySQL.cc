@@ -23,6 +23,7 @@
 #include <sstream>
 #include <iomanip>
 #include <cmath>
+#include <algorithm>
 
 #include "unisetstd.h"
 #include "ORepHelpers.h"
@@ -69,11 +70,13 @@ void DBServer_MySQL::sysCommand( const uniset::SystemMessage* sm )
     switch( sm->command )
     {
         case SystemMessage::StartUp:
+            askTimer(FlushInsertBuffer, ibufSyncTimeout);
             break;
 
         case SystemMessage::Finish:
         {
             activate = false;
+            flushInsertBuffer();
             db->close();
         }
         break;
@@ -81,6 +84,7 @@ void DBServer_MySQL::sysCommand( const uniset::SystemMessage* sm )
         case SystemMessage::FoldUp:
         {
             activate = false;
+            flushInsertBuffer();
             db->close();
         }
         break;
@@ -106,6 +110,9 @@ void DBServer_MySQL::confirmInfo( const uniset::ConfirmMessage* cem )
 
         dbinfo << myname << "(update_confirm): " << data.str() << endl;
 
+        // перед UPDATE обязательно скинуть insertBuffer
+        flushInsertBuffer();
+
         if( !writeToBase(data.str()) )
         {
             dbcrit << myname << "(update_confirm):  db error: " << db->error() << endl;
@@ -247,26 +254,13 @@ void DBServer_MySQL::sensorInfo( const uniset::SensorMessage* si )
                    << endl;
         }
 
-        float val = (float)si->value / (float)pow(10.0, si->ci.precision);
-
-        // см. DBTABLE AnalogSensors, DigitalSensors
-        ostringstream data;
-        data << "INSERT INTO " << tblName(si->type)
-             << "(date, time, time_usec, sensor_id, value, node) VALUES( '"
-             // Поля таблицы
-             << dateToString(si->sm_tv.tv_sec, "-") << "','"   //  date
-             << timeToString(si->sm_tv.tv_sec, ":") << "','"   //  time
-             << si->sm_tv.tv_nsec << "','"                //  time_usec
-             << si->id << "','"                    //  sensor_id
-             << val << "','"                //  value
-             << si->node << "')";                //  node
-
-        dbinfo << myname << "(insert_main_history): " << data.str() << endl;
+        HistoryRecord rec;
+        rec.tm = si->sm_tv;
+        rec.id = si->id;
+        rec.value = (float)si->value / (float)pow(10.0, si->ci.precision);
+        rec.node = si->node;
 
-        if( !writeToBase(data.str()) )
-        {
-            dbcrit << myname << "(insert) sensor msg error: " << db->error() << endl;
-        }
+        addRecord(rec);
     }
     catch( const uniset::Exception& ex )
     {
@@ -278,6 +272,157 @@ void DBServer_MySQL::sensorInfo( const uniset::SensorMessage* si )
     }
 }
 //--------------------------------------------------------------------------------------------
+void DBServer_MySQL::addRecord( const HistoryRecord& rec )
+{
+    ibuf.push_back(rec);
+
+    if( ibuf.size() >= ibufMaxSize )
+        flushInsertBuffer();
+}
+//--------------------------------------------------------------------------------------------
+void DBServer_MySQL::flushInsertBuffer()
+{
+    if( ibuf.size() > ibufMaxSize )
+    {
+        dbcrit << myname << "(flushInsertBuffer): "
+               << " buffer[" << ibuf.size() << "] overflow! LOST DATA..." << endl;
+
+        // Чистим заданное число
+        size_t delnum = std::min( ibuf.size(), (size_t)lroundf(ibuf.size() * ibufOverflowCleanFactor) );
+
+        // Удаляем последние (новые) или первые (старые)
+        if( lastRemove )
+            ibuf.erase( std::prev(ibuf.end(), delnum), ibuf.end() );
+        else
+            ibuf.erase( ibuf.begin(), std::next(ibuf.begin(), delnum) );
+
+        ibufLost += delnum;
+        dbwarn << myname << "(flushInsertBuffer): overflow: clear data " << delnum << " records." << endl;
+    }
+
+    if( ibuf.empty() )
+        return;
+
+    if( !db || !connect_ok )
+        return;
+
+    dbinfo << myname << "(flushInsertBuffer): write insert buffer[" << ibuf.size() << "] to DB.." << endl;
+
+    const size_t rejected = ibufRejected;
+
+    if( !writeInsertBufferToDB(ibuf) )
+    {
+        dbcrit << myname << "(flushInsertBuffer): error: " << db->error() << endl;
+        return;
+    }
+
+    ibufWritten += ibuf.size() - std::min(ibuf.size(), ibufRejected - rejected);
+    ibuf.clear();
+}
+//--------------------------------------------------------------------------------------------
+bool DBServer_MySQL::writeInsertBufferToDB( const InsertBuffer& wbuf )
+{
+    // всё пишем одной транзакцией, несколькими записями в запросе
+    if( !db->execute("START TRANSACTION") )
+        return false;
+
+    const std::string head = "INSERT INTO " + tblName(uniset::Message::SensorInfo)
+                             + "(date, time, time_usec, sensor_id, value, node) VALUES";
+
+    ostringstream q;
+    size_t n = 0;
+
+    for( auto it = wbuf.begin(); it != wbuf.end(); ++it )
+    {
+        if( n == 0 )
+            q << head;
+        else
+            q << ",";
+
+        // строковых значений (требующих экранирования) здесь нет
+        q << "('" << dateToString(it->tm.tv_sec, "-") << "','"
+          << timeToString(it->tm.tv_sec, ":") << "',"
+          << it->tm.tv_nsec << ","
+          << it->id << ","
+          << it->value << ","
+          << it->node << ")";
+
+        if( ++n < ibufMaxRowsPerQuery && std::next(it) != wbuf.end() )
+            continue;
+
+        if( !db->execute(q.str()) )
+        {
+            const std::string err = db->error();
+            const bool connError = db->isConnectionError();
+            db->execute("ROLLBACK");
+            dbcrit << myname << "(writeInsertBufferToDB): insert error: " << err << endl;
+
+            if( connError )
+                return false;
+
+            // запрос отвергнут из-за данных, пишем по одной записи (чтобы найти "плохие")
+            return writeInsertBufferByRecord(wbuf);
+        }
+
+        q.str("");
+        n = 0;
+    }
+
+    if( !db->execute("COMMIT") )
+    {
+        db->execute("ROLLBACK");
+        return false;
+    }
+
+    return true;
+}
+//--------------------------------------------------------------------------------------------
+bool DBServer_MySQL::writeInsertBufferByRecord( const InsertBuffer& wbuf )
+{
+    if( !db->execute("START TRANSACTION") )
+        return false;
+
+    const std::string head = "INSERT INTO " + tblName(uniset::Message::SensorInfo)
+                             + "(date, time, time_usec, sensor_id, value, node) VALUES";
+
+    for( const auto& r : wbuf )
+    {
+        ostringstream q;
+        q << head
+          << "('" << dateToString(r.tm.tv_sec, "-") << "','"
+          << timeToString(r.tm.tv_sec, ":") << "',"
+          << r.tm.tv_nsec << ","
+          << r.id << ","
+          << r.value << ","
+          << r.node << ")";
+
+        if( db->execute(q.str()) )
+            continue;
+
+        const std::string err = db->error();
+
+        if( db->isConnectionError() )
+        {
+            db->execute("ROLLBACK");
+            dbcrit << myname << "(writeInsertBufferByRecord): insert error: " << err << endl;
+            return false;
+        }
+
+        // повторять бессмысленно, запись отбрасываем
+        ibufRejected++;
+        dbcrit << myname << "(writeInsertBufferByRecord): rejected record: " << q.str()
+               << " error: " << err << endl;
+    }
+
+    if( !db->execute("COMMIT") )
+    {
+        db->execute("ROLLBACK");
+        return false;
+    }
+
+    return true;
+}
+//--------------------------------------------------------------------------------------------
 void DBServer_MySQL::initDBServer()
 {
     DBServer::initDBServer();
@@ -321,6 +466,14 @@ void DBServer_MySQL::initDBServer()
     ReconnectTime = conf->getPIntProp(node, "reconnectTime", ReconnectTime);
     qbufSize = conf->getArgPInt("--dbserver-buffer-size", it.getProp("bufferSize"), qbufSize);
 
+    ibufMaxSize = conf->getArgPInt("--" + prefix + "-ibuf-maxsize", it.getProp("ibufMaxSize"), ibufMaxSize);
+    ibuf.reserve(ibufMaxSize);
+
+    ibufSyncTimeout = conf->getArgPInt("--" + prefix + "-ibuf-sync-timeout", it.getProp("ibufSyncTimeout"), ibufSyncTimeout);
+    std::string sfactor = conf->getArg2Param("--" + prefix + "-ibuf-overflow-cleanfactor", it.getProp("ibufOverflowCleanFactor"), "0.5");
+    ibufOverflowCleanFactor = atof(sfactor.c_str());
+    ibufMaxRowsPerQuery = conf->getArgPInt("--" + prefix + "-ibuf-max-rows-per-query", it.getProp("ibufMaxRowsPerQuery"), ibufMaxRowsPerQuery);
+
     if( findArgParam("--dbserver-buffer-last-remove", conf->getArgc(), conf->getArgv()) != -1 )
         lastRemove = true;
     else if( it.getIntProp("bufferLastRemove" ) != 0 )
@@ -353,6 +506,7 @@ void DBServer_MySQL::initDBServer()
         askTimer(DBServer_MySQL::PingTimer, PingTime);
         onReconnect(db);
         flushBuffer();
+        flushInsertBuffer();
     }
 }
 //--------------------------------------------------------------------------------------------
@@ -402,6 +556,13 @@ void DBServer_MySQL::timerInfo( const uniset::TimerMessage* tm )
         }
         break;
 
+        case FlushInsertBuffer:
+        {
+            dbinfo << myname << "(timerInfo): insert flush timer.." << endl;
+            flushInsertBuffer();
+        }
+        break;
+
         default:
             dbwarn << myname << "(timerInfo): Unknown TimerID=" << tm->id << endl;
             break;
@@ -435,6 +596,11 @@ void DBServer_MySQL::help_print( int argc, const char* const* argv )
 {
     cout << "Default: prefix='mysql'" << endl;
     cout << "--prefix-name objectID     - ObjectID. Default: 'conf->getDBServer()'" << endl;
+    cout << "Insert buffer:" << endl;
+    cout << "--prefix-ibuf-maxsize sz                   - INSERT-buffer size (1 - write immediately). Default: 1" << endl;
+    cout << "--prefix-ibuf-sync-timeout msec            - INSERT-buffer sync timeout. Default: 15000 msec" << endl;
+    cout << "--prefix-ibuf-overflow-cleanfactor [0...1] - INSERT-buffer overflow clean factor. Default: 0.5" << endl;
+    cout << "--prefix-ibuf-max-rows-per-query num       - Max records in one INSERT query. Default: 500" << endl;
     cout << DBServer::help_print() << endl;
 }
 // -----------------------------------------------------------------------------
@@ -454,6 +620,15 @@ std::string DBServer_MySQL::getMonitInfo( const std::string& params )
     }
     inf << "   lastError: " << db->error() << endl;
 
+    inf << "Insert buffer: "
+        << "[ ibufMaxSize=" << ibufMaxSize
+        << " ibufSize=" << ibuf.size()
+        << " ibufSyncTimeout=" << ibufSyncTimeout
+        << " written=" << ibufWritten
+        << " lost=" << ibufLost
+        << " rejected=" << ibufRejected
+        << " ]" << endl;
+
     return inf.str();
 }
 // -----------------------------------------------------------------------------
@@ -23,6 +23,7 @@
 // --------------------------------------------------------------------------
 #include <unordered_map>
 #include <queue>
+#include <vector>
 #include "UniSetTypes.h"
 #include "MySQLInterface.h"
 #include "DBServer.h"
@@ -37,6 +38,7 @@ namespace uniset
       - \ref sec_DBS_Conf
       - \ref sec_DBS_Tables
       - \ref sec_DBS_Buffer
+      - \ref sec_DBS_InsertBuffer
 
 
     \section sec_DBS_Comm Общее описание работы DBServer_MySQL
@@ -82,6 +84,25 @@ namespace uniset
     более ранние сообщения. Эту логику можно сменить, если указать параметр "--dbserver-buffer-last-remove"
     или \b bufferLastRemove="1", то теряться будут сообщения добавляемые в конец.
 
+    \section sec_DBS_InsertBuffer Буферизация записи истории
+    По умолчанию записи в main_history пишутся сразу (ibufMaxSize=1). Если задать ibufMaxSize > 1,
+    записи накапливаются в буфере. Как только буфер заполняется или прошло ibufSyncTimeout мсек, он записывается в БД
+    одной транзакцией, запросами вида INSERT ... VALUES(..),(..),.. (не больше ibufMaxRowsPerQuery записей в запросе).
+    Перед UPDATE (confirm) буфер тоже сбрасывается.
+
+    Если записать не удалось (нет связи с БД), записи остаются в буфере. При переполнении
+    часть записей удаляется (см. ibufOverflowCleanFactor и bufferLastRemove).
+    Если запрос отвергнут сервером не из-за связи (ошибка в данных), буфер записывается
+    заново по одной записи, а отвергнутые записи выводятся в лог (crit) и отбрасываются
+    (счётчик rejected в getMonitInfo), чтобы одна "плохая" запись не блокировала запись всего буфера.
+    Параметры:
+    - \b --prefix-ibuf-maxsize или \b ibufMaxSize - размер буфера (1 - писать сразу). По умолчанию: 1
+    - \b --prefix-ibuf-sync-timeout или \b ibufSyncTimeout - период сброса буфера, мсек. По умолчанию: 15000
+    - \b --prefix-ibuf-overflow-cleanfactor или \b ibufOverflowCleanFactor - доля {0...1} удаляемых записей при переполнении. По умолчанию: 0.5
+    - \b --prefix-ibuf-max-rows-per-query или \b ibufMaxRowsPerQuery - максимальное количество записей в одном INSERT. По умолчанию: 500
+
+    \warning Записи находящиеся в буфере будут потеряны при аварийном завершении программы.
+
     \section sec_DBS_Tables Таблицы MySQL
       К основным таблицам относятся следующие:
     \code
@@ -187,6 +208,21 @@ namespace uniset
 
             bool writeToBase( const std::string& query );
 
+            // запись истории (main_history)
+            struct HistoryRecord
+            {
+                struct timespec tm; // время изменения (sm_tv)
+                uniset::ObjectId id;
+                double value;
+                uniset::ObjectId node;
+            };
+
+            typedef std::vector<HistoryRecord> InsertBuffer;
+            void flushInsertBuffer();
+            void addRecord( const HistoryRecord& rec );
+            virtual bool writeInsertBufferToDB( const InsertBuffer& ibuf );
+            bool writeInsertBufferByRecord( const InsertBuffer& ibuf );
+
             inline std::string tblName( int key )
             {
                 return tblMap[key].c_str();
@@ -196,6 +232,7 @@ namespace uniset
             {
                 PingTimer,        /*!< таймер на пере одическую проверку соединения  с сервером БД */
                 ReconnectTimer,   /*!< таймер на повторную попытку соединения с сервером БД (или восстановления связи) */
+                FlushInsertBuffer, /*!< таймер на сброс Insert-буфера */
                 lastNumberOfTimer
             };
 
@@ -215,6 +252,15 @@ namespace uniset
             void flushBuffer();
             uniset::uniset_rwmutex mqbuf;
 
+            InsertBuffer ibuf;
+            size_t ibufMaxSize = { 1 };
+            timeout_t ibufSyncTimeout = { 15000 };
+            float ibufOverflowCleanFactor = { 0.5 }; // коэффициент {0...1} чистки буфера при переполнении
+            size_t ibufMaxRowsPerQuery = { 500 }; // ограничение размера запроса (max_allowed_packet)
+            size_t ibufLost = { 0 }; // сколько записей удалено при переполнении
+            size_t ibufWritten = { 0 }; // сколько записей записано через буфер
+            size_t ibufRejected = { 0 }; // сколько записей отвергнуто БД (ошибка в данных)
+
         private:
             DBTableMap tblMap;
 
@@ -19,6 +19,8 @@
 */
 // --------------------------------------------------------------------------
 #include <sstream>
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
 #include "UniSetTypes.h"
 #include "MySQLInterface.h"
 using namespace std;
@@ -93,6 +95,14 @@ bool MySQLInterface::insert( const string& q )
     return true;
 }
 // -----------------------------------------------------------------------------------------
+bool MySQLInterface::execute( const string& q )
+{
+    if( !mysql )
+        return false;
+
+    return ( mysql_real_query(mysql, q.data(), q.size()) == 0 );
+}
+// -----------------------------------------------------------------------------------------
 DBResult MySQLInterface::query( const std::string& q )
 {
     if( !mysql )
@@ -154,6 +164,37 @@ const string MySQLInterface::error()
     return mysql_error(mysql);
 }
 // -----------------------------------------------------------------------------------------
+bool MySQLInterface::isConnectionError() const
+{
+    if( !mysql )
+        return true;
+
+    const unsigned int err = mysql_errno(mysql);
+
+    // ошибки клиентской библиотеки (CR_xxx): нет связи, соединение потеряно и т.п.
+    if( err >= CR_MIN_ERROR && err <= CR_MAX_ERROR )
+        return true;
+
+    switch( err )
+    {
+        case ER_CON_COUNT_ERROR:
+        case ER_SERVER_SHUTDOWN:
+        case ER_QUERY_INTERRUPTED:
+        case ER_LOCK_WAIT_TIMEOUT:
+        case ER_LOCK_DEADLOCK:
+        case ER_OPTION_PREVENTS_STATEMENT: // read-only
+        case ER_RECORD_FILE_FULL:
+        case ER_OUT_OF_RESOURCES:
+        case ER_OUTOFMEMORY:
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+// -----------------------------------------------------------------------------------------
 const string MySQLInterface::lastQuery()
 {
     return lastQ;
@@ -54,6 +54,13 @@ namespace uniset
             virtual const std::string lastQuery() override;
             virtual bool insert( const std::string& q ) override;
 
+            /*! Выполнить запрос "как есть": без экранирования и без копирования во внутренний буфер
+             * (т.е. без ограничения на размер запроса maxbuf). Используется для вставки
+             * нескольких записей одним запросом (INSERT ... VALUES(..),(..),..).
+             * Строковые значения в запросе должны быть экранированы заранее.
+             */
+            bool execute( const std::string& q );
+
             /*!
                 проверка связи с БД.
                 в случае отсутствия попытка восстановить...
@@ -67,6 +74,13 @@ namespace uniset
 
             virtual const std::string error() override;
 
+            /*! последняя ошибка - ошибка связи или временная ошибка сервера
+             * (нет соединения, блокировка, сервер завершает работу, нет места и т.п.),
+             * т.е. повтор запроса позже может быть успешным.
+             * Иначе - ошибка в самом запросе (данных), повторять его бессмысленно.
+             */
+            bool isConnectionError() const;
+
             // *******************
             const char* gethostinfo() const;
         protected:
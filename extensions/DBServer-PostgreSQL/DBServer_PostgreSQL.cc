@@ -16,6 +16,9 @@
 // --------------------------------------------------------------------------
 #include <sstream>
 #include <cmath>
+#include <chrono>
+#include <iterator>
+#include <algorithm>
 #include "unisetstd.h"
 #include "ORepHelpers.h"
 #include "DBServer_PostgreSQL.h"
@@ -53,8 +56,13 @@ DBServer_PostgreSQL::DBServer_PostgreSQL():
 //--------------------------------------------------------------------------------------------
 DBServer_PostgreSQL::~DBServer_PostgreSQL()
 {
+    stopWriter();
+
     if( db )
         db->close();
+
+    if( spill )
+        spill->close();
 }
 //--------------------------------------------------------------------------------------------
 void DBServer_PostgreSQL::sysCommand( const uniset::SystemMessage* sm )
@@ -64,16 +72,18 @@ void DBServer_PostgreSQL::sysCommand( const uniset::SystemMessage* sm )
     switch( sm->command )
     {
         case SystemMessage::StartUp:
+            startWriter();
             askTimer(FlushInsertBuffer, ibufSyncTimeout);
             break;
 
         case SystemMessage::Finish:
-            db->close();
-            break;
-
         case SystemMessage::FoldUp:
+        {
+            stopWriter();
+            std::lock_guard<std::mutex> l(dbMutex);
             db->close();
-            break;
+        }
+        break;
 
         default:
             break;
@@ -98,8 +108,8 @@ void DBServer_PostgreSQL::confirmInfo( const uniset::ConfirmMessage* cem )
 
         dbinfo << myname << "(update_confirm): " << data.str() << endl;
 
-        // перед UPDATE обязательно скинуть insertBuffer
-        flushInsertBuffer();
+        // UPDATE выполняется потоком записи после вставки записей пришедших до него
+        // (см. writeBuffers)
 
         if( !writeToBase( std::move(data.str())) )
         {
@@ -151,7 +161,7 @@ bool DBServer_PostgreSQL::writeToBase( const string& query )
 {
     dbinfo << myname << "(writeToBase): " << query << endl;
 
-    if( !db || !connect_ok )
+    // запрос выполняется потоком записи
     {
         std::lock_guard<std::mutex> l(mqbuf);
         qbuf.push(query);
@@ -166,109 +176,393 @@ bool DBServer_PostgreSQL::writeToBase( const string& query )
                 qlost = qbuf.front();
 
             qbuf.pop();
-            dbcrit << myname << "(writeToBase): DB not connected! buffer(" << qbufSize
-                   << ") overflow! lost query: " << qlost << endl;
+            dbcrit << myname << "(writeToBase): " << ( connect_ok ? "" : "DB not connected! " )
+                   << "buffer(" << qbufSize << ") overflow! lost query: " << qlost << endl;
         }
+    }
 
-        // Надо подумать, что тут лучше возвращать true или false
-        // вроде бы фактически запись не сделали, но запрос поместили в буфер
-        // А вызывающая сторона может посчитать, что раз вернули false, значит
-        // можно/нужно потом запрос повторить..
+    flushInsertBuffer();
 
-        return false;
+    // Надо подумать, что тут лучше возвращать true или false
+    // вроде бы фактически запись не сделали, но запрос поместили в буфер
+    // А вызывающая сторона может посчитать, что раз вернули false, значит
+    // можно/нужно потом запрос повторить..
+    return connect_ok;
+}
+//--------------------------------------------------------------------------------------------
+void DBServer_PostgreSQL::flushBuffer()
+{
+    QueryBuffer q;
+
+    {
+        std::lock_guard<std::mutex> l(mqbuf);
+        std::swap(q, qbuf);
     }
 
-    // На всякий скидываем очередь
-    flushBuffer();
+    std::lock_guard<std::mutex> l(dbMutex);
 
-    // А теперь собственно запрос..
-    if( db->insert(query) )
-        return true;
+    while( !q.empty() )
+    {
+        if( !db->insert(q.front()) )
+        {
+            dbcrit << myname << "(writeToBase): error: " << db->error() << " lost query: " << q.front() << endl;
+        }
 
-    return false;
+        q.pop();
+    }
 }
 //--------------------------------------------------------------------------------------------
-void DBServer_PostgreSQL::flushBuffer()
+void DBServer_PostgreSQL::flushInsertBuffer()
+{
+    {
+        std::lock_guard<std::mutex> lk(ibufMutex);
+        flushRequest = true;
+    }
+
+    ibufCond.notify_one();
+}
+//--------------------------------------------------------------------------------------------
+void DBServer_PostgreSQL::addRecord( const PostgreSQLInterface::Record&& rec )
 {
-    std::lock_guard<std::mutex> l(mqbuf);
+    bool flush = false;
 
-    // Сперва пробуем очистить всё что накопилось в очереди до этого...
-    while( !qbuf.empty() )
     {
-        if( !db->insert(qbuf.front()) )
+        std::lock_guard<std::mutex> lk(ibufMutex);
+
+        // поток записи не успевает (или нет связи с БД)
+        if( ibuf.size() >= ibufMaxBacklog )
         {
-            dbcrit << myname << "(writeToBase): error: " << db->error() << " lost query: " << qbuf.front() << endl;
+            if( spill && spill->write(spillEncode(rec)) )
+                statSpilled++;
+            else
+                statLost++;
+
+            return;
         }
 
-        qbuf.pop();
+        ibuf.emplace_back( std::move(rec) );
+        flush = ( ibuf.size() >= ibufMaxSize );
     }
+
+    if( flush )
+        ibufCond.notify_one();
 }
 //--------------------------------------------------------------------------------------------
-void DBServer_PostgreSQL::flushInsertBuffer()
+bool DBServer_PostgreSQL::writeInsertBufferToDB( const std::string& tableName
+        , std::string_view colNames
+        , const InsertBuffer& wbuf )
 {
-    if( ibufSize > ibufMaxSize )
+    return db->copy(tableName, colNames, wbuf);
+}
+//--------------------------------------------------------------------------------------------
+void DBServer_PostgreSQL::startWriter()
+{
+    if( writer )
+        return;
+
+    writerActive = true;
+    writer = unisetstd::make_unique< ThreadCreator<DBServer_PostgreSQL> >(this, &DBServer_PostgreSQL::writerThread);
+    writer->start();
+}
+//--------------------------------------------------------------------------------------------
+void DBServer_PostgreSQL::stopWriter()
+{
+    if( !writer )
+        return;
+
     {
-        dbcrit << myname << "(flushWriteBuffer): "
-               << " buffer[" << ibufSize << "] overflow! LOST DATA..." << endl;
+        std::lock_guard<std::mutex> lk(ibufMutex);
+        writerActive = false;
+    }
+
+    ibufCond.notify_all();
 
-        // Чистим заданное число
-        size_t delnum = lroundf(ibufSize * ibufOverflowCleanFactor);
-        auto end = ibuf.end();
-        auto beg = ibuf.begin();
+    if( writer->isRunning() )
+        writer->join();
 
-        // Удаляем последние (новые)
-        if( lastRemove )
+    writer = nullptr;
+}
+//--------------------------------------------------------------------------------------------
+void DBServer_PostgreSQL::writerThread()
+{
+    dbinfo << myname << "(writerThread): run.." << endl;
+
+    while( writerActive )
+    {
+        {
+            // пока есть что досылать из журнала, просыпаемся чаще
+            timeout_t tout = ( connect_ok && spill && !spill->empty() ) ? std::min(spillReplayPause, ibufSyncTimeout) : ibufSyncTimeout;
+
+            std::unique_lock<std::mutex> lk(ibufMutex);
+            ibufCond.wait_for(lk, std::chrono::milliseconds(tout), [&]()
+            {
+                return !writerActive || flushRequest || ibuf.size() >= ibufMaxSize;
+            });
+
+            flushRequest = false;
+        }
+
+        try
         {
-            end = std::prev(end, delnum);
+            writeBuffers();
         }
+        catch( const std::exception& ex )
+        {
+            dbcrit << myname << "(writerThread): " << ex.what() << endl;
+        }
+    }
+
+    // при завершении пишем всё что накопилось
+    try
+    {
+        writeBuffers();
+
+        // а что не удалось записать - сохраняем до следующего запуска
+        if( spill )
+        {
+            spillBuffer(wbuf);
+            spill->sync();
+        }
+    }
+    catch( const std::exception& ex )
+    {
+        dbcrit << myname << "(writerThread): " << ex.what() << endl;
+    }
+
+    dbinfo << myname << "(writerThread): finished.." << endl;
+}
+//--------------------------------------------------------------------------------------------
+void DBServer_PostgreSQL::writeBuffers()
+{
+    QueryBuffer qwork;
+
+    {
+        std::lock_guard<std::mutex> lk(ibufMutex);
+
+        if( wbuf.empty() )
+            std::swap(ibuf, wbuf);
         else
         {
-            // Удаляем первые (старые)
-            beg = std::next(beg, delnum);
+            // прошлая запись не удалась, новые записи добавляем в конец
+            wbuf.insert(wbuf.end(), std::make_move_iterator(ibuf.begin()), std::make_move_iterator(ibuf.end()));
+            ibuf.clear();
+        }
+
+        // запросы забираем вместе с записями, чтобы UPDATE (confirm)
+        // выполнялся после вставки записей, пришедших до него
+        if( connect_ok )
+        {
+            std::lock_guard<std::mutex> l(mqbuf);
+            std::swap(qwork, qbuf);
+        }
+    }
+
+    bool insertFailed = false;
+
+    if( !wbuf.empty() && connect_ok )
+    {
+        dbinfo << myname << "(writeBuffers): write insert buffer[" << wbuf.size() << "] to DB.." << endl;
+
+        auto t_start = std::chrono::steady_clock::now();
+        bool ok = false;
+
+        {
+            std::lock_guard<std::mutex> l(dbMutex);
+            ok = writeInsertBufferToDB("main_history", tblcols, wbuf);
+
+            if( !ok )
+                dbcrit << myname << "(writeBuffers): error: " << db->error() << endl;
         }
 
-        if( beg != ibuf.end() )
-            ibuf.erase(beg, end);
+        size_t msec = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t_start).count();
+        statLastFlush_msec = msec;
 
-        // ibufSize - беззнаковое, так что надо аккуратно
-        ibufSize = (delnum < ibufSize) ? (ibufSize - delnum) : 0;
+        if( msec > statMaxFlush_msec )
+            statMaxFlush_msec = msec;
 
-        dbwarn << myname << "(flushInsertBuffer): overflow: clear data " << delnum << " records." << endl;
+        statFlushCount++;
+
+        if( ok )
+        {
+            statWritten += wbuf.size();
+            wbuf.clear();
+        }
+        else
+            insertFailed = true;
     }
 
-    if( ibufSize == 0 )
+    // нет связи или запись не удалась (например из-за ошибки в данных),
+    // в любом случае буфер не должен расти бесконечно
+    if( wbuf.size() > ibufMaxSize )
+    {
+        if( spill )
+            spillBuffer(wbuf);
+        else
+        {
+            dbcrit << myname << "(writeBuffers): " << ( connect_ok ? "" : "DB not connected! " )
+                   << " buffer[" << wbuf.size() << "] overflow! LOST DATA..." << endl;
+
+            // Чистим заданное число
+            size_t delnum = std::min( wbuf.size(), (size_t)lroundf(wbuf.size() * ibufOverflowCleanFactor) );
+
+            // Удаляем последние (новые) или первые (старые)
+            if( lastRemove )
+                wbuf.erase( std::prev(wbuf.end(), delnum), wbuf.end() );
+            else
+                wbuf.erase( wbuf.begin(), std::next(wbuf.begin(), delnum) );
+
+            statLost += delnum;
+            dbwarn << myname << "(writeBuffers): overflow: clear data " << delnum << " records." << endl;
+        }
+    }
+
+    // текущее записали, досылаем сохранённое в журнале
+    if( wbuf.empty() && connect_ok && spill && !spill->empty() )
+        replaySpill();
+
+    wbufSize = wbuf.size();
+
+    if( qwork.empty() )
         return;
 
-    if( !db || !connect_ok )
+    // записи до этих запросов не вставлены, поэтому UPDATE (confirm) сейчас делать бессмысленно,
+    // возвращаем их в очередь (выполнятся после успешной записи)
+    if( insertFailed )
+    {
+        std::lock_guard<std::mutex> l(mqbuf);
+
+        while( !qbuf.empty() )
+        {
+            qwork.push( std::move(qbuf.front()) );
+            qbuf.pop();
+        }
+
+        while( qwork.size() > qbufSize )
+        {
+            dbcrit << myname << "(writeBuffers): buffer(" << qbufSize << ") overflow! lost query: " << qwork.front() << endl;
+            qwork.pop();
+        }
+
+        std::swap(qwork, qbuf);
         return;
+    }
 
-    dbinfo << myname << "(flushInsertBuffer): write insert buffer[" << ibufSize << "] to DB.." << endl;
+    std::lock_guard<std::mutex> l(dbMutex);
 
-    if( !writeInsertBufferToDB("main_history", tblcols, ibuf) )
+    while( !qwork.empty() )
     {
-        dbcrit << myname << "(flushInsertBuffer): error: " << db->error() << endl;
+        if( !db->insert(qwork.front()) )
+        {
+            dbcrit << myname << "(writeBuffers): error: " << db->error() << " lost query: " << qwork.front() << endl;
+        }
+
+        qwork.pop();
     }
-    else
+}
+//--------------------------------------------------------------------------------------------
+std::string DBServer_PostgreSQL::spillEncode( const PostgreSQLInterface::Record& rec )
+{
+    std::string s;
+
+    for( auto it = rec.begin(); it != rec.end(); ++it )
     {
-        ibuf.clear();
-        ibufSize = 0;
+        if( it != rec.begin() )
+            s += '\t';
+
+        s += *it;
     }
+
+    return s;
 }
 //--------------------------------------------------------------------------------------------
-void DBServer_PostgreSQL::addRecord( const PostgreSQLInterface::Record&& rec )
+bool DBServer_PostgreSQL::spillDecode( const std::string& s, PostgreSQLInterface::Record& rec )
 {
-    ibuf.emplace_back( std::move(rec) );
-    ibufSize++;
+    rec.clear();
+    size_t pos = 0;
 
-    if( ibufSize >= ibufMaxSize )
-        flushInsertBuffer();
+    while( true )
+    {
+        size_t next = s.find('\t', pos);
+        rec.emplace_back( s.substr(pos, next - pos) );
+
+        if( next == std::string::npos )
+            break;
+
+        pos = next + 1;
+    }
+
+    // (date, time, time_usec, sensor_id, value, node)
+    return rec.size() == 6;
 }
 //--------------------------------------------------------------------------------------------
-bool DBServer_PostgreSQL::writeInsertBufferToDB( const std::string& tableName
-        , std::string_view colNames
-        , const InsertBuffer& wbuf )
+void DBServer_PostgreSQL::spillBuffer( InsertBuffer& buf )
 {
-    return db->copy(tableName, colNames, wbuf);
+    if( buf.empty() )
+        return;
+
+    size_t num = 0;
+
+    for( const auto& rec : buf )
+    {
+        if( spill->write(spillEncode(rec)) )
+            num++;
+    }
+
+    statSpilled += num;
+    statLost += buf.size() - num;
+
+    dbwarn << myname << "(spillBuffer): " << ( connect_ok ? "" : "DB not connected! " )
+           << "save " << num << " records to journal '" << spill->getDir() << "'"
+           << " (pending " << spill->getPending() << ")" << endl;
+
+    buf.clear();
+}
+//--------------------------------------------------------------------------------------------
+void DBServer_PostgreSQL::replaySpill()
+{
+    std::vector<std::string> recs;
+    recs.reserve(spillReplayBatch);
+
+    size_t num = spill->read(recs, spillReplayBatch);
+
+    if( num == 0 )
+    {
+        spill->commit();
+        return;
+    }
+
+    InsertBuffer rbuf;
+    rbuf.reserve(num);
+
+    for( const auto& s : recs )
+    {
+        PostgreSQLInterface::Record rec;
+
+        if( spillDecode(s, rec) )
+            rbuf.emplace_back( std::move(rec) );
+        else
+            dbcrit << myname << "(replaySpill): bad record in journal: '" << s << "'" << endl;
+    }
+
+    bool ok = rbuf.empty();
+
+    if( !ok )
+    {
+        std::lock_guard<std::mutex> l(dbMutex);
+        ok = writeInsertBufferToDB("main_history", tblcols, rbuf);
+
+        if( !ok )
+            dbcrit << myname << "(replaySpill): error: " << db->error() << endl;
+    }
+
+    // если записать не удалось, то в следующий раз читаем эти же записи
+    if( ok )
+    {
+        spill->commit();
+        statReplayed += rbuf.size();
+        dbinfo << myname << "(replaySpill): replay " << rbuf.size() << " records"
+               << " (pending " << spill->getPending() << ")" << endl;
+    }
 }
 //--------------------------------------------------------------------------------------------
 void DBServer_PostgreSQL::sensorInfo( const uniset::SensorMessage* si )
@@ -315,6 +609,7 @@ void DBServer_PostgreSQL::initDBServer()
 
     if( connect_ok )
     {
+        std::lock_guard<std::mutex> l(dbMutex);
         onReconnect(db);
         return;
     }
@@ -345,13 +640,51 @@ void DBServer_PostgreSQL::initDBServer()
     string dbpass( conf->getArgParam("--" + prefix + "-dbpass", it.getProp("dbpass")));
     unsigned int dbport = conf->getArgPInt("--" + prefix + "-dbport", it.getProp("dbport"), 5432);
 
-    ibufMaxSize = conf->getArgPInt("--" + prefix + "-ibuf-maxsize", it.getProp("ibufMaxSize"), 2000);
-    ibuf.reserve(ibufMaxSize);
+    size_t maxSize = conf->getArgPInt("--" + prefix + "-ibuf-maxsize", it.getProp("ibufMaxSize"), 2000);
+    size_t maxBacklog = conf->getArgPInt("--" + prefix + "-ibuf-max-backlog", it.getProp("ibufMaxBacklog"), 10 * maxSize);
+
+    {
+        // (при переподключении поток записи уже работает)
+        std::lock_guard<std::mutex> lk(ibufMutex);
+        ibufMaxSize = maxSize;
+        ibufMaxBacklog = maxBacklog;
+        ibuf.reserve(ibufMaxSize);
+        wbuf.reserve(ibufMaxSize);
+    }
 
     ibufSyncTimeout = conf->getArgPInt("--" + prefix + "-ibuf-sync-timeout", it.getProp("ibufSyncTimeout"), 15000);
     std::string sfactor = conf->getArg2Param("--" + prefix + "-ibuf-overflow-cleanfactor", it.getProp("ibufOverflowCleanFactor"), "0.5");
     ibufOverflowCleanFactor = atof(sfactor.c_str());
 
+    // журнал открываем один раз (при переподключении поток записи уже работает)
+    if( !spillInitOK )
+    {
+        spillInitOK = true;
+        string spillDir( conf->getArgParam("--" + prefix + "-spill-dir", it.getProp("spillDir")) );
+
+        if( !spillDir.empty() )
+        {
+            size_t segSize = conf->getArgPInt("--" + prefix + "-spill-segment-size", it.getProp("spillSegmentSize"), 4 * 1024 * 1024);
+            size_t maxSegments = conf->getArgPInt("--" + prefix + "-spill-max-segments", it.getProp("spillMaxSegments"), 64);
+            spillReplayBatch = conf->getArgPInt("--" + prefix + "-spill-replay-batch", it.getProp("spillReplayBatch"), spillReplayBatch);
+            spillReplayPause = conf->getArgPInt("--" + prefix + "-spill-replay-pause", it.getProp("spillReplayPause"), spillReplayPause);
+
+            try
+            {
+                auto j = unisetstd::make_unique<SpillJournal>(spillDir, segSize, maxSegments);
+                j->open();
+                spill = std::move(j);
+
+                dbinfo << myname << "(init): spill journal '" << spillDir << "'"
+                       << " pending " << spill->getPending() << " records" << endl;
+            }
+            catch( const std::exception& ex )
+            {
+                dbcrit << myname << "(init): spill journal '" << spillDir << "' open error: " << ex.what() << endl;
+            }
+        }
+    }
+
     tblMap[uniset::Message::SensorInfo] = "main_history";
     tblMap[uniset::Message::Confirm] = "main_history";
     tblMap[uniset::Message::TextMessage] = "main_messages";
@@ -376,19 +709,25 @@ void DBServer_PostgreSQL::initDBServer()
            << " pingTime=" << PingTime
            << " ReconnectTime=" << ReconnectTime << endl;
 
+    std::unique_lock<std::mutex> l(dbMutex);
+
     if( !db->reconnect(dbnode, dbuser, dbpass, dbname, dbport) )
     {
         dbwarn << myname << "(init): DB connection error: " << db->error() << endl;
+        l.unlock();
         askTimer(DBServer_PostgreSQL::ReconnectTimer, ReconnectTime);
     }
     else
     {
         dbinfo <<  myname << "(init): connect [OK]" << endl;
+        onReconnect(db);
+        l.unlock();
         connect_ok = true;
         askTimer(DBServer_PostgreSQL::ReconnectTimer, 0);
         askTimer(DBServer_PostgreSQL::PingTimer, PingTime);
-        onReconnect(db);
-        flushBuffer();
+
+        // накопленное запишет поток записи
+        flushInsertBuffer();
     }
 }
 //--------------------------------------------------------------------------------------------
@@ -400,6 +739,12 @@ void DBServer_PostgreSQL::timerInfo( const uniset::TimerMessage* tm )
     {
         case DBServer_PostgreSQL::PingTimer:
         {
+            std::unique_lock<std::mutex> l(dbMutex, std::try_to_lock);
+
+            // соединение занято потоком записи (т.е. связь есть)
+            if( !l.owns_lock() )
+                break;
+
             if( !db->ping() )
             {
                 dbwarn << myname << "(timerInfo): DB lost connection.." << endl;
@@ -419,6 +764,8 @@ void DBServer_PostgreSQL::timerInfo( const uniset::TimerMessage* tm )
         {
             dbinfo <<  myname << "(timerInfo): reconnect timer" << endl;
 
+            std::unique_lock<std::mutex> l(dbMutex);
+
             if( db->isConnection() )
             {
                 if( db->ping() )
@@ -434,7 +781,10 @@ void DBServer_PostgreSQL::timerInfo( const uniset::TimerMessage* tm )
                 }
             }
             else
+            {
+                l.unlock();
                 initDBServer();
+            }
         }
         break;
 
@@ -453,14 +803,12 @@ void DBServer_PostgreSQL::timerInfo( const uniset::TimerMessage* tm )
 //--------------------------------------------------------------------------------------------
 bool DBServer_PostgreSQL::deactivateObject()
 {
-    if( db && connect_ok )
+    // поток записи при завершении пишет всё накопленное
+    try
     {
-        try
-        {
-            flushBuffer();
-        }
-        catch(...) {}
+        stopWriter();
     }
+    catch(...) {}
 
     return DBServer::deactivateObject();
 }
@@ -479,13 +827,45 @@ string DBServer_PostgreSQL::getMonitInfo( const string& params )
         std::lock_guard<std::mutex> lock(mqbuf);
         inf << " buffer size: " << qbuf.size() << endl;
     }
-    inf << "   lastError: " << db->error() << endl;
+    {
+        std::unique_lock<std::mutex> l(dbMutex, std::try_to_lock);
+        inf << "   lastError: " << ( l.owns_lock() ? db->error() : "(db busy)" ) << endl;
+    }
+
+    size_t isize = 0;
+    {
+        std::lock_guard<std::mutex> lk(ibufMutex);
+        isize = ibuf.size();
+    }
 
     inf << "Insert buffer: "
         << "[ ibufMaxSize=" << ibufMaxSize
-        << " ibufSize=" << ibufSize
+        << " ibufMaxBacklog=" << ibufMaxBacklog
         << " ibufSyncTimeout=" << ibufSyncTimeout
-        << " ]" << endl;
+        << " ]" << endl
+        << "      writer: " << ( writer && writer->isRunning() ? "RUNNING" : "STOPPED" ) << endl
+        << "     backlog: " << (isize + wbufSize) << " (ibuf=" << isize << " wbuf=" << wbufSize << ")" << endl
+        << "     written: " << statWritten << endl
+        << "        lost: " << statLost << endl
+        << "     flushes: " << statFlushCount
+        << " last=" << statLastFlush_msec << " msec"
+        << " max=" << statMaxFlush_msec << " msec" << endl;
+
+    if( spill )
+    {
+        inf << "Spill journal: "
+            << "[ dir='" << spill->getDir() << "'"
+            << " segmentSize=" << spill->getSegmentSize()
+            << " maxSegments=" << spill->getMaxSegments()
+            << " replayBatch=" << spillReplayBatch
+            << " replayPause=" << spillReplayPause
+            << " ]" << endl
+            << "     pending: " << spill->getPending() << " (" << spill->getPendingBytes() << " bytes, "
+            << spill->getSegments() << " segments)" << endl
+            << "     spilled: " << statSpilled << endl
+            << "    replayed: " << statReplayed << endl
+            << "        lost: " << spill->getLost() << endl;
+    }
 
     return inf.str();
 }
@@ -539,6 +919,14 @@ void DBServer_PostgreSQL::help_print( int argc, const char* const* argv )
     cout << "--prefix-ibuf-maxsize sz                   - INSERT-buffer size. Default: 2000" << endl;
     cout << "--prefix-ibuf-sync-timeout msec            - INSERT-buffer sync timeout. Default: 15000 msec" << endl;
     cout << "--prefix-ibuf-overflow-cleanfactor [0...1] - INSERT-buffer overflow clean factor. Default: 0.5" << endl;
+    cout << "--prefix-ibuf-max-backlog sz               - Max records waiting for the writer thread. Default: 10*ibuf-maxsize" << endl;
+
+    cout << "Spill journal:" << endl;
+    cout << "--prefix-spill-dir path               - Save records to disk journal when DB unavailable. Default: '' (disabled)" << endl;
+    cout << "--prefix-spill-segment-size bytes     - Journal segment size. Default: 4194304" << endl;
+    cout << "--prefix-spill-max-segments num       - Max segments (oldest are removed on overflow). Default: 64" << endl;
+    cout << "--prefix-spill-replay-batch num       - Records per replay step after reconnect. Default: 5000" << endl;
+    cout << "--prefix-spill-replay-pause msec      - Pause between replay steps. Default: 1000 msec" << endl;
 
     cout << "Query buffer:" << endl;
     cout << "--prefix-buffer-size sz      - The buffer in case the database is unavailable. Default: 200" << endl;
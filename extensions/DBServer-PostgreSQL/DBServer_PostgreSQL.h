@@ -20,10 +20,15 @@
 #include <string_view>
 #include <unordered_map>
 #include <queue>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include "UniSetTypes.h"
 #include "PostgreSQLInterface.h"
 #include "DBServer.h"
 #include "SharedMemory.h"
+#include "ThreadCreator.h"
+#include "SpillJournal.h"
 // -------------------------------------------------------------------------
 namespace uniset
 {
@@ -49,6 +54,20 @@ namespace uniset
      * быть проблемы найти "большой непрерывный кусок".
      * Тем не менее реализация сделана на vector-е чтобы избежать лишних "перевыделений" (и сегментации) памяти во время работы.
      *
+     * Запись в БД ведётся отдельным потоком (writerThread), поэтому медленная работа БД (checkpoint, autovacuum и т.п.)
+     * не задерживает обработку сообщений. Для этого используется два буфера: поток обработки сообщений только добавляет
+     * записи в один буфер (ibuf), а поток записи забирает накопленное (меняет буферы местами) и пишет в БД.
+     * Туда же (через поток записи) идут и остальные запросы (UPDATE для confirm, текстовые сообщения).
+     * Если поток записи не успевает и накопленных записей становится больше ibufMaxBacklog,
+     * новые записи отбрасываются (учитываются в статистике). Время записи и размер очереди см. getMonitInfo().
+     *
+     * Если задан каталог spillDir (--prefix-spill-dir), то вместо удаления записи сохраняются на диск
+     * в журнал (см. SpillJournal): при переполнении буфера во время отсутствия связи (или ошибок записи),
+     * при отставании потока записи, а также при завершении работы, если записать накопленное не удалось.
+     * После восстановления связи поток записи "досылает" записи из журнала порциями по spillReplayBatch
+     * не чаще чем раз в spillReplayPause мсек, чтобы не создавать большую нагрузку на БД.
+     * Журнал сохраняется при перезапуске процесса.
+     *
      * \warning Временно, для обратной совместимости поле 'time_usec' в таблицах оставлено с таким названием,
      * хотя фактически туда сейчас сохраняется значение в наносекундах!
      */
@@ -116,30 +135,69 @@ namespace uniset
             // writeBuffer
 
             typedef std::vector<PostgreSQLInterface::Record> InsertBuffer;
+
+            // запросить запись накопленного (выполняется потоком записи)
             void flushInsertBuffer();
             virtual void addRecord( const PostgreSQLInterface::Record&& rec );
             virtual bool writeInsertBufferToDB( const std::string& table
                                                 , std::string_view colname
                                                 , const InsertBuffer& ibuf );
 
+            // поток записи в БД
+            void writerThread();
+            void startWriter();
+            void stopWriter();
+            void writeBuffers();
+
+            // дисковый журнал (при недоступности БД)
+            void spillBuffer( InsertBuffer& buf );
+            void replaySpill();
+            static std::string spillEncode( const PostgreSQLInterface::Record& rec );
+            static bool spillDecode( const std::string& s, PostgreSQLInterface::Record& rec );
+
+            // соединение используется из потока записи и потока обработки сообщений
+            std::mutex dbMutex;
+
         private:
             DBTableMap tblMap;
 
             int PingTime = { 15000 };
             int ReconnectTime = { 30000 };
 
-            bool connect_ok = { false }; /*! признак наличия соединения с сервером БД */
+            std::atomic_bool connect_ok = { false }; /*! признак наличия соединения с сервером БД */
 
             QueryBuffer qbuf;
             size_t qbufSize = { 200 }; // размер буфера сообщений.
             bool lastRemove = { false };
             std::mutex mqbuf;
 
-            InsertBuffer ibuf;
-            size_t ibufSize = { 0 };
+            InsertBuffer ibuf; // заполняется потоком обработки сообщений
+            InsertBuffer wbuf; // записывается потоком записи
+            std::mutex ibufMutex;
+            std::condition_variable ibufCond;
+            bool flushRequest = { false };
             size_t ibufMaxSize = { 2000 };
+            size_t ibufMaxBacklog = { 0 }; // предел для ibuf (по умолчанию 10*ibufMaxSize)
             timeout_t ibufSyncTimeout = { 15000 };
             float ibufOverflowCleanFactor = { 0.5 }; // коэффициент {0...1} чистки буфера при переполнении
+
+            std::unique_ptr< ThreadCreator<DBServer_PostgreSQL> > writer;
+            std::atomic_bool writerActive = { false };
+
+            std::unique_ptr<SpillJournal> spill; // nullptr - журнал не используется
+            bool spillInitOK = { false };
+            size_t spillReplayBatch = { 5000 };
+            timeout_t spillReplayPause = { 1000 };
+
+            // статистика (для getMonitInfo)
+            std::atomic<size_t> wbufSize = { 0 };
+            std::atomic<size_t> statWritten = { 0 };
+            std::atomic<size_t> statLost = { 0 };
+            std::atomic<size_t> statFlushCount = { 0 };
+            std::atomic<size_t> statLastFlush_msec = { 0 };
+            std::atomic<size_t> statMaxFlush_msec = { 0 };
+            std::atomic<size_t> statSpilled = { 0 };
+            std::atomic<size_t> statReplayed = { 0 };
     };
     // ----------------------------------------------------------------------------------
 } // end of namespace uniset
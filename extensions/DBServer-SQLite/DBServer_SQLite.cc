@@ -23,6 +23,7 @@
 #include <sstream>
 #include <iomanip>
 #include <cmath>
+#include <algorithm>
 
 #include "unisetstd.h"
 #include "ORepHelpers.h"
@@ -55,6 +56,9 @@ DBServer_SQLite::DBServer_SQLite( const std::string& prefix ):
 //--------------------------------------------------------------------------------------------
 DBServer_SQLite::~DBServer_SQLite()
 {
+    // подготовленные запросы должны быть удалены до закрытия БД
+    insHistory.reset();
+
     if( db )
         db->close();
 }
@@ -66,11 +70,14 @@ void DBServer_SQLite::sysCommand( const uniset::SystemMessage* sm )
     switch( sm->command )
     {
         case SystemMessage::StartUp:
+            askTimer(FlushInsertBuffer, ibufSyncTimeout);
             break;
 
         case SystemMessage::Finish:
         {
             activate = false;
+            flushInsertBuffer();
+            insHistory.reset();
 
             if(db)
                 db->close();
@@ -80,6 +87,8 @@ void DBServer_SQLite::sysCommand( const uniset::SystemMessage* sm )
         case SystemMessage::FoldUp:
         {
             activate = false;
+            flushInsertBuffer();
+            insHistory.reset();
 
             if(db)
                 db->close();
@@ -106,6 +115,9 @@ void DBServer_SQLite::confirmInfo( const uniset::ConfirmMessage* cem )
 
         dbinfo <<  myname << "(update_confirm): " << data.str() << endl;
 
+        // перед UPDATE обязательно скинуть insertBuffer
+        flushInsertBuffer();
+
         if( !writeToBase(data.str()) )
         {
             dbcrit << myname << "(update_confirm):  db error: " << db->error() << endl;
@@ -225,26 +237,13 @@ void DBServer_SQLite::sensorInfo( const uniset::SensorMessage* si )
                    << endl;
         }
 
-        float val = (float)si->value / (float)pow(10.0, si->ci.precision);
-
-        // см. DBTABLE AnalogSensors, DigitalSensors
-        ostringstream data;
-        data << "INSERT INTO " << tblName(si->type)
-             << "(date, time, time_usec, sensor_id, value, node) VALUES( '"
-             // Поля таблицы
-             << dateToString(si->sm_tv.tv_sec, "-") << "','"   //  date
-             << timeToString(si->sm_tv.tv_sec, ":") << "','"   //  time
-             << si->sm_tv.tv_nsec << "',"                //  time_usec
-             << si->id << "','"                    //  sensor_id
-             << val << "','"                //  value
-             << si->node << "')";                //  node
-
-        dbinfo <<  myname << "(insert_main_history): " << data.str() << endl;
+        HistoryRecord rec;
+        rec.tm = si->sm_tv;
+        rec.id = si->id;
+        rec.value = (float)si->value / (float)pow(10.0, si->ci.precision);
+        rec.node = si->node;
 
-        if( !writeToBase(data.str()) )
-        {
-            dbcrit << myname <<  "(insert) sensor msg error: " << db->error() << endl;
-        }
+        addRecord(rec);
     }
     catch( const uniset::Exception& ex )
     {
@@ -256,6 +255,115 @@ void DBServer_SQLite::sensorInfo( const uniset::SensorMessage* si )
     }
 }
 //--------------------------------------------------------------------------------------------
+void DBServer_SQLite::addRecord( const HistoryRecord& rec )
+{
+    ibuf.push_back(rec);
+
+    if( ibuf.size() >= ibufMaxSize )
+        flushInsertBuffer();
+}
+//--------------------------------------------------------------------------------------------
+void DBServer_SQLite::flushInsertBuffer()
+{
+    if( ibuf.size() > ibufMaxSize )
+    {
+        dbcrit << myname << "(flushInsertBuffer): "
+               << " buffer[" << ibuf.size() << "] overflow! LOST DATA..." << endl;
+
+        // Чистим заданное число
+        size_t delnum = std::min( ibuf.size(), (size_t)lroundf(ibuf.size() * ibufOverflowCleanFactor) );
+
+        // Удаляем последние (новые) или первые (старые)
+        if( lastRemove )
+            ibuf.erase( std::prev(ibuf.end(), delnum), ibuf.end() );
+        else
+            ibuf.erase( ibuf.begin(), std::next(ibuf.begin(), delnum) );
+
+        ibufLost += delnum;
+        dbwarn << myname << "(flushInsertBuffer): overflow: clear data " << delnum << " records." << endl;
+    }
+
+    if( ibuf.empty() )
+        return;
+
+    if( !db || !connect_ok )
+        return;
+
+    dbinfo << myname << "(flushInsertBuffer): write insert buffer[" << ibuf.size() << "] to DB.." << endl;
+
+    const size_t rejected = ibufRejected;
+
+    if( !writeInsertBufferToDB(ibuf) )
+    {
+        dbcrit << myname << "(flushInsertBuffer): error: " << db->error() << endl;
+        return;
+    }
+
+    ibufWritten += ibuf.size() - std::min(ibuf.size(), ibufRejected - rejected);
+    ibuf.clear();
+}
+//--------------------------------------------------------------------------------------------
+bool DBServer_SQLite::writeInsertBufferToDB( const InsertBuffer& wbuf )
+{
+    if( !insHistory )
+    {
+        ostringstream q;
+        q << "INSERT INTO " << tblName(uniset::Message::SensorInfo)
+          << "(date, time, time_usec, sensor_id, value, node) VALUES(?,?,?,?,?,?)";
+
+        insHistory = db->prepare(q.str());
+
+        if( !insHistory )
+            return false;
+    }
+
+    // всё пишем одной транзакцией
+    if( !db->exec("BEGIN;") )
+        return false;
+
+    for( const auto& r : wbuf )
+    {
+        // строки должны существовать до exec() (см. SQLiteInterface::Statement)
+        const std::string sdate = dateToString(r.tm.tv_sec, "-");
+        const std::string stime = timeToString(r.tm.tv_sec, ":");
+
+        insHistory->bind(1, sdate);
+        insHistory->bind(2, stime);
+        insHistory->bind(3, (long long)r.tm.tv_nsec);
+        insHistory->bind(4, (long long)r.id);
+        insHistory->bind(5, r.value);
+        insHistory->bind(6, (long long)r.node);
+
+        if( !insHistory->exec() )
+        {
+            const std::string err = db->error();
+
+            // ошибка в данных: откатывается только этот INSERT, транзакция продолжается
+            if( !db->isConnectionError() )
+            {
+                ibufRejected++;
+                dbcrit << myname << "(writeInsertBufferToDB): rejected record:"
+                       << " date=" << sdate << " time=" << stime
+                       << " sensor_id=" << r.id << " value=" << r.value << " node=" << r.node
+                       << " error: " << err << endl;
+                continue;
+            }
+
+            db->exec("ROLLBACK;");
+            dbcrit << myname << "(writeInsertBufferToDB): insert error: " << err << endl;
+            return false;
+        }
+    }
+
+    if( !db->exec("COMMIT;") )
+    {
+        db->exec("ROLLBACK;");
+        return false;
+    }
+
+    return true;
+}
+//--------------------------------------------------------------------------------------------
 void DBServer_SQLite::initDBServer()
 {
     DBServer::initDBServer();
@@ -297,6 +405,13 @@ void DBServer_SQLite::initDBServer()
     ReconnectTime = conf->getPIntProp(node, "reconnectTime", ReconnectTime);
     qbufSize = conf->getArgPInt("--dbserver-buffer-size", it.getProp("bufferSize"), qbufSize);
 
+    ibufMaxSize = conf->getArgPInt("--" + prefix + "-ibuf-maxsize", it.getProp("ibufMaxSize"), ibufMaxSize);
+    ibuf.reserve(ibufMaxSize);
+
+    ibufSyncTimeout = conf->getArgPInt("--" + prefix + "-ibuf-sync-timeout", it.getProp("ibufSyncTimeout"), ibufSyncTimeout);
+    std::string sfactor = conf->getArg2Param("--" + prefix + "-ibuf-overflow-cleanfactor", it.getProp("ibufOverflowCleanFactor"), "0.5");
+    ibufOverflowCleanFactor = atof(sfactor.c_str());
+
     if( findArgParam("--dbserver-buffer-last-remove", conf->getArgc(), conf->getArgv()) != -1 )
         lastRemove = true;
     else if( it.getIntProp("bufferLastRemove" ) != 0 )
@@ -308,6 +423,9 @@ void DBServer_SQLite::initDBServer()
            << " pingTime=" << PingTime
            << " ReconnectTime=" << ReconnectTime << endl;
 
+    // при новом соединении запрос надо подготовить заново
+    insHistory.reset();
+
     if( !db->connect(dbfile, false) )
     {
         //        ostringstream err;
@@ -327,6 +445,7 @@ void DBServer_SQLite::initDBServer()
         initDB(db);
         initDBTableMap(tblMap);
         flushBuffer();
+        flushInsertBuffer();
     }
 }
 //--------------------------------------------------------------------------------------------
@@ -404,6 +523,13 @@ void DBServer_SQLite::timerInfo( const uniset::TimerMessage* tm )
         }
         break;
 
+        case FlushInsertBuffer:
+        {
+            dbinfo <<  myname << "(timerInfo): insert flush timer.." << endl;
+            flushInsertBuffer();
+        }
+        break;
+
         default:
             dbwarn << myname << "(timerInfo): Unknown TimerID=" << tm->id << endl;
             break;
@@ -438,6 +564,11 @@ void DBServer_SQLite::help_print( int argc, const char* const* argv )
     cout << "Default: prefix='sqlite'" << endl;
     cout << "--prefix-name objectID     - ObjectID. Default: 'conf->getDBServer()'" << endl;
     cout << endl;
+    cout << "Insert buffer:" << endl;
+    cout << "--prefix-ibuf-maxsize sz                   - INSERT-buffer size (1 - write immediately). Default: 1" << endl;
+    cout << "--prefix-ibuf-sync-timeout msec            - INSERT-buffer sync timeout. Default: 15000 msec" << endl;
+    cout << "--prefix-ibuf-overflow-cleanfactor [0...1] - INSERT-buffer overflow clean factor. Default: 0.5" << endl;
+    cout << endl;
     cout << DBServer::help_print() << endl;
 }
 // -----------------------------------------------------------------------------
@@ -457,6 +588,15 @@ std::string DBServer_SQLite::getMonitInfo( const std::string& params )
     }
     inf << "   lastError: " << db->error() << endl;
 
+    inf << "Insert buffer: "
+        << "[ ibufMaxSize=" << ibufMaxSize
+        << " ibufSize=" << ibuf.size()
+        << " ibufSyncTimeout=" << ibufSyncTimeout
+        << " written=" << ibufWritten
+        << " lost=" << ibufLost
+        << " rejected=" << ibufRejected
+        << " ]" << endl;
+
     return inf.str();
 }
 // -----------------------------------------------------------------------------
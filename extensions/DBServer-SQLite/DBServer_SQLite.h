@@ -23,6 +23,7 @@
 // --------------------------------------------------------------------------
 #include <unordered_map>
 #include <queue>
+#include <vector>
 #include "UniSetTypes.h"
 #include "SQLiteInterface.h"
 #include "DBServer.h"
@@ -37,6 +38,7 @@ namespace uniset
     - \ref sec_DBS_Conf
     - \ref sec_DBS_Tables
     - \ref sec_DBS_Buffer
+    - \ref sec_DBS_InsertBuffer
 
 
     \section sec_DBS_Comm Общее описание работы DBServer_SQLite
@@ -82,6 +84,25 @@ namespace uniset
     более ранние сообщения. Эту логику можно сменить, если указать параметр "--dbserver-buffer-last-remove"
     или \b bufferLastRemove="1", то теряться будут сообщения добавляемые в конец.
 
+    \section sec_DBS_InsertBuffer Буферизация записи истории
+    По умолчанию записи в main_history пишутся сразу (ibufMaxSize=1). Т.к. основная работа сервера -
+    это частая запись изменений датчиков, то при большом потоке имеет смысл задать ibufMaxSize > 1,
+    тогда записи накапливаются в буфере. Как только буфер заполняется или
+    прошло ibufSyncTimeout мсек, он записывается в БД одной транзакцией при помощи подготовленного
+    запроса (разбор SQL делается один раз). Перед UPDATE (confirm) буфер тоже сбрасывается.
+
+    Если записать не удалось (нет связи с БД), записи остаются в буфере. При переполнении
+    часть записей удаляется (см. ibufOverflowCleanFactor и bufferLastRemove).
+    Запись, которую БД отвергла не из-за доступа к ней (ошибка в данных, например нарушение ограничений),
+    выводится в лог (crit) и отбрасывается (счётчик rejected в getMonitInfo), остальные записи буфера
+    записываются в той же транзакции. Иначе одна "плохая" запись блокировала бы запись всего буфера.
+    Параметры:
+    - \b --prefix-ibuf-maxsize или \b ibufMaxSize - размер буфера (1 - писать сразу). По умолчанию: 1
+    - \b --prefix-ibuf-sync-timeout или \b ibufSyncTimeout - период сброса буфера, мсек. По умолчанию: 15000
+    - \b --prefix-ibuf-overflow-cleanfactor или \b ibufOverflowCleanFactor - доля {0...1} удаляемых записей при переполнении. По умолчанию: 0.5
+
+    \warning Записи находящиеся в буфере будут потеряны при аварийном завершении программы.
+
     \section sec_DBS_Tables Таблицы SQLite
     К основным таблицам относятся следующие (описание в формате MySQL!):
     \code
@@ -189,6 +210,20 @@ namespace uniset
             bool writeToBase( const std::string& query );
             void createTables( SQLiteInterface* db );
 
+            // запись истории (main_history)
+            struct HistoryRecord
+            {
+                struct timespec tm; // время изменения (sm_tv)
+                uniset::ObjectId id;
+                double value;
+                uniset::ObjectId node;
+            };
+
+            typedef std::vector<HistoryRecord> InsertBuffer;
+            void flushInsertBuffer();
+            void addRecord( const HistoryRecord& rec );
+            virtual bool writeInsertBufferToDB( const InsertBuffer& ibuf );
+
             inline std::string tblName(int key)
             {
                 return tblMap[key];
@@ -198,6 +233,7 @@ namespace uniset
             {
                 PingTimer,        /*!< таймер на пере одическую проверку соединения  с сервером БД */
                 ReconnectTimer,   /*!< таймер на повторную попытку соединения с сервером БД (или восстановления связи) */
+                FlushInsertBuffer, /*!< таймер на сброс Insert-буфера */
                 lastNumberOfTimer
             };
 
@@ -217,6 +253,17 @@ namespace uniset
             void flushBuffer();
             uniset::uniset_rwmutex mqbuf;
 
+            InsertBuffer ibuf;
+            size_t ibufMaxSize = { 1 };
+            timeout_t ibufSyncTimeout = { 15000 };
+            float ibufOverflowCleanFactor = { 0.5 }; // коэффициент {0...1} чистки буфера при переполнении
+            size_t ibufLost = { 0 }; // сколько записей удалено при переполнении
+            size_t ibufWritten = { 0 }; // сколько записей записано через буфер
+            size_t ibufRejected = { 0 }; // сколько записей отвергнуто БД (ошибка в данных)
+
+            // подготовленный запрос для записи истории (создаётся после соединения с БД)
+            std::unique_ptr<SQLiteInterface::Statement> insHistory;
+
         private:
             DBTableMap tblMap;
 
@@ -242,6 +242,34 @@ bool SQLiteInterface::isConnection() const
     return connected;
 }
 // -----------------------------------------------------------------------------------------
+bool SQLiteInterface::isConnectionError() const
+{
+    if( !db )
+        return true;
+
+    switch( sqlite3_errcode(db) & 0xff )
+    {
+        case SQLITE_BUSY:
+        case SQLITE_LOCKED:
+        case SQLITE_INTERRUPT:
+        case SQLITE_IOERR:
+        case SQLITE_NOMEM:
+        case SQLITE_FULL:
+        case SQLITE_CANTOPEN:
+        case SQLITE_READONLY:
+        case SQLITE_CORRUPT:
+        case SQLITE_NOTADB:
+        case SQLITE_PROTOCOL:
+        case SQLITE_SCHEMA:
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+// -----------------------------------------------------------------------------------------
 DBResult SQLiteInterface::makeResult( sqlite3_stmt* s, bool finalize )
 {
     DBResult result;
@@ -295,6 +323,171 @@ DBResult SQLiteInterface::makeResult( sqlite3_stmt* s, bool finalize )
     return result;
 }
 // -----------------------------------------------------------------------------------------
+bool SQLiteInterface::exec( const std::string& q )
+{
+    if( !db )
+        return false;
+
+    char* errmsg = nullptr;
+
+    if( sqlite3_exec(db, q.c_str(), NULL, NULL, &errmsg) != SQLITE_OK )
+    {
+        lastE = "'" + q + "' error: " + string(errmsg ? errmsg : "");
+        sqlite3_free(errmsg);
+        queryok = false;
+        return false;
+    }
+
+    lastQ = q;
+    queryok = true;
+    return true;
+}
+// -----------------------------------------------------------------------------------------
+bool SQLiteInterface::pragma( const std::string& name, const std::string& value )
+{
+    return exec("PRAGMA " + name + "=" + value + ";");
+}
+// -----------------------------------------------------------------------------------------
+bool SQLiteInterface::setJournalMode( const std::string& mode )
+{
+    return pragma("journal_mode", mode);
+}
+// -----------------------------------------------------------------------------------------
+bool SQLiteInterface::setSynchronous( const std::string& mode )
+{
+    return pragma("synchronous", mode);
+}
+// -----------------------------------------------------------------------------------------
+std::unique_ptr<SQLiteInterface::Statement> SQLiteInterface::prepare( const std::string& q )
+{
+    if( !db )
+        return nullptr;
+
+    sqlite3_stmt* pStmt = nullptr;
+
+    if( sqlite3_prepare_v2(db, q.c_str(), -1, &pStmt, NULL) != SQLITE_OK )
+    {
+        lastE = "prepare '" + q + "' error: " + string(sqlite3_errmsg(db));
+        sqlite3_finalize(pStmt);
+        return nullptr;
+    }
+
+    lastQ = q;
+    return std::unique_ptr<Statement>(new Statement(this, pStmt));
+}
+// -----------------------------------------------------------------------------------------
+SQLiteInterface::Statement::Statement( SQLiteInterface* _db, sqlite3_stmt* s ):
+    db(_db),
+    stmt(s)
+{
+}
+// -----------------------------------------------------------------------------------------
+SQLiteInterface::Statement::~Statement()
+{
+    sqlite3_finalize(stmt);
+}
+// -----------------------------------------------------------------------------------------
+bool SQLiteInterface::Statement::bind( int idx, long long v )
+{
+    return ( sqlite3_bind_int64(stmt, idx, v) == SQLITE_OK );
+}
+// -----------------------------------------------------------------------------------------
+bool SQLiteInterface::Statement::bind( int idx, double v )
+{
+    return ( sqlite3_bind_double(stmt, idx, v) == SQLITE_OK );
+}
+// -----------------------------------------------------------------------------------------
+bool SQLiteInterface::Statement::bind( int idx, const std::string& v )
+{
+    return bind(idx, v.data(), v.size());
+}
+// -----------------------------------------------------------------------------------------
+bool SQLiteInterface::Statement::bind( int idx, const char* v, size_t len )
+{
+    return ( sqlite3_bind_text(stmt, idx, v, len, SQLITE_STATIC) == SQLITE_OK );
+}
+// -----------------------------------------------------------------------------------------
+bool SQLiteInterface::Statement::bindNull( int idx )
+{
+    return ( sqlite3_bind_null(stmt, idx) == SQLITE_OK );
+}
+// -----------------------------------------------------------------------------------------
+bool SQLiteInterface::Statement::exec()
+{
+    int rc = sqlite3_step(stmt);
+
+    bool ok = ( rc == SQLITE_DONE || rc == SQLITE_ROW );
+
+    if( !ok && !checkResult(rc) )
+        ok = db->wait(stmt, SQLITE_DONE);
+
+    db->queryok = ok;
+    reset();
+    return ok;
+}
+// -----------------------------------------------------------------------------------------
+bool SQLiteInterface::Statement::fetch()
+{
+    int rc = sqlite3_step(stmt);
+
+    if( !checkResult(rc) )
+    {
+        // для чтения (вне явной транзакции) шаг можно просто повторить
+        PassiveTimer ptTimeout(db->opTimeout);
+
+        while( !checkResult(rc) && !ptTimeout.checkTime() )
+        {
+            msleep(db->opCheckPause);
+            rc = sqlite3_step(stmt);
+        }
+    }
+
+    if( rc == SQLITE_ROW )
+    {
+        db->queryok = true;
+        return true;
+    }
+
+    db->queryok = ( rc == SQLITE_DONE );
+
+    if( !db->queryok )
+        db->lastE = string(sqlite3_errmsg(db->db));
+
+    reset();
+    return false;
+}
+// -----------------------------------------------------------------------------------------
+int SQLiteInterface::Statement::columns() const
+{
+    return sqlite3_data_count(stmt);
+}
+// -----------------------------------------------------------------------------------------
+long long SQLiteInterface::Statement::as_int64( int col ) const
+{
+    return sqlite3_column_int64(stmt, col);
+}
+// -----------------------------------------------------------------------------------------
+double SQLiteInterface::Statement::as_double( int col ) const
+{
+    return sqlite3_column_double(stmt, col);
+}
+// -----------------------------------------------------------------------------------------
+std::string SQLiteInterface::Statement::as_string( int col ) const
+{
+    const char* p = (const char*)sqlite3_column_text(stmt, col);
+
+    if( !p )
+        return "";
+
+    return std::string(p, sqlite3_column_bytes(stmt, col));
+}
+// -----------------------------------------------------------------------------------------
+void SQLiteInterface::Statement::reset()
+{
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+// -----------------------------------------------------------------------------------------
 extern "C" std::shared_ptr<DBInterface> create_sqliteinterface()
 {
     return std::shared_ptr<DBInterface>(new SQLiteInterface(), DBInterfaceDeleter());
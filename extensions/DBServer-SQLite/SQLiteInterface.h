@@ -24,6 +24,7 @@
 #include <string>
 #include <deque>
 #include <vector>
+#include <memory>
 #include <iostream>
 #include <sqlite3.h>
 #include "PassiveTimer.h"
@@ -75,12 +76,43 @@ namespace uniset
             cerr << "(test): catch ..." << endl;
         }
     \endcode
+
+       Для многократной вставки однотипных записей лучше использовать подготовленный запрос (prepare),
+       т.к. в этом случае разбор SQL делается только один раз:
+    \code
+        auto st = db.prepare("INSERT INTO logs(tms,usec,name,text) VALUES(datetime(?,'unixepoch'),?,?,?)");
+        db.query("BEGIN;");
+        for( ... )
+        {
+            st->bind(1, sec);
+            st->bind(2, usec);
+            st->bind(3, name);
+            st->bind(4, text);
+            if( !st->exec() )
+                cerr << "insert error: " << db.error() << endl;
+        }
+        db.query("COMMIT;");
+    \endcode
+
+       Для больших выборок результат можно читать построчно (fetch),
+       не формируя DBResult целиком:
+    \code
+        auto st = db.prepare("SELECT id,text FROM logs WHERE id>? ORDER BY id");
+        st->bind(1, lastId);
+        while( st->fetch() )
+            cout << st->as_int64(0) << ": " << st->as_string(1) << endl;
+    \endcode
     */
     // ----------------------------------------------------------------------------
     // Памятка:
     // Включение режима для журнала - "вести в памяти" (чтобы поберечь CompactFlash)
     // PRAGMA journal_mode = MEMORY
     // При этом конечно есть риск потерять данные при выключении..
+    //
+    // Для интенсивной записи (при параллельном чтении) лучше подходит
+    // PRAGMA journal_mode = WAL
+    // PRAGMA synchronous = NORMAL
+    // см. setJournalMode(), setSynchronous()
     // ----------------------------------------------------------------------------
     class SQLiteInterface:
         public DBInterface
@@ -120,6 +152,69 @@ namespace uniset
 
             virtual const std::string error() override;
 
+            /*! последняя ошибка - ошибка доступа к БД (занята, нет места, ошибка ввода-вывода и т.п.),
+             * т.е. повтор запроса позже может быть успешным.
+             * Иначе - ошибка в самом запросе (данных), повторять его бессмысленно.
+             */
+            bool isConnectionError() const;
+
+            /*! выполнить запрос (или несколько запросов разделённых ';') не возвращающий данных */
+            bool exec( const std::string& q );
+
+            /*! выполнить PRAGMA name=value */
+            bool pragma( const std::string& name, const std::string& value );
+
+            /*! режим журнала: DELETE, TRUNCATE, PERSIST, MEMORY, WAL, OFF */
+            bool setJournalMode( const std::string& mode );
+
+            /*! режим синхронизации с диском: OFF, NORMAL, FULL, EXTRA */
+            bool setSynchronous( const std::string& mode );
+
+            /*! Подготовленный запрос.
+             * Индексы параметров начинаются с 1 (как в sqlite3_bind_xxx).
+             * Строковые параметры не копируются, поэтому они должны существовать до вызова exec().
+             * После exec() запрос готов к повторному использованию (привязки сбрасываются).
+             */
+            class Statement
+            {
+                public:
+                    ~Statement();
+
+                    bool bind( int idx, long long v );
+                    bool bind( int idx, double v );
+                    bool bind( int idx, const std::string& v );
+                    bool bind( int idx, const char* v, size_t len );
+                    bool bindNull( int idx );
+
+                    /*! выполнить запрос (для запросов не возвращающих данных) */
+                    bool exec();
+
+                    /*! Построчное чтение результата (без загрузки всего результата в память).
+                     * \return true - получена очередная строка, false - строк больше нет (или ошибка)
+                     * После получения false запрос сбрасывается (reset) и готов к повторному использованию.
+                     */
+                    bool fetch();
+
+                    // значения столбцов текущей строки (после fetch), индексы начинаются с 0
+                    int columns() const;
+                    long long as_int64( int col ) const;
+                    double as_double( int col ) const;
+                    std::string as_string( int col ) const;
+
+                    void reset();
+
+                protected:
+                    friend class SQLiteInterface;
+                    Statement( SQLiteInterface* db, sqlite3_stmt* s );
+
+                private:
+                    SQLiteInterface* db;
+                    sqlite3_stmt* stmt;
+            };
+
+            /*! \return nullptr в случае ошибки (см. error()) */
+            std::unique_ptr<Statement> prepare( const std::string& q );
+
         protected:
 
             bool wait( sqlite3_stmt* stmt, int result );
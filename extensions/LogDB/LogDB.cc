@@ -105,6 +105,17 @@ LogDB::LogDB( const string& name, int argc, const char* const* argv, const strin
     if( tformat == "localtime" || tformat == "utc" )
         tmsFormat = tformat;
 
+    qmaxSize = uniset::getArgPInt("--" + prefix + "db-max-queue", argc, argv, it.getProp("dbMaxQueue"), qbufSize * 10);
+
+    if( qmaxSize < qbufSize )
+        qmaxSize = qbufSize;
+
+    tmFlushBuffer_msec = uniset::getArgPInt("--" + prefix + "db-flush-time", argc, argv, it.getProp("dbFlushTime"), tmFlushBuffer_msec);
+    dbJournalMode = uniset::getArg2Param("--" + prefix + "db-journal-mode", argc, argv, it.getProp("dbJournalMode"), dbJournalMode);
+    dbSynchronous = uniset::getArg2Param("--" + prefix + "db-synchronous", argc, argv, it.getProp("dbSynchronous"), dbSynchronous);
+    dbPartitionHours = uniset::getArgPInt("--" + prefix + "db-partition-hours", argc, argv, it.getProp("dbPartitionHours"), dbPartitionHours);
+    dbFTS = ( uniset::findArgParam("--" + prefix + "db-fts-disable", argc, argv) == -1 );
+
     double checkConnection_sec = atof( uniset::getArg2Param("--" + prefix + "ls-check-connection-sec", argc, argv, it.getProp("lsCheckConnectionSec"), "5").c_str());
 
     int bufSize = uniset::getArgPInt("--" + prefix + "ls-read-buffer-size", argc, argv, it.getProp("lsReadBufferSize"), 10001);
@@ -119,7 +130,6 @@ LogDB::LogDB( const string& name, int argc, const char* const* argv, const strin
 
     dbinfo << myname << "(init) maxdbRecords=" << maxdbRecords << " numOverflow=" << numOverflow << endl;
 
-    flushBufferTimer.set<LogDB, &LogDB::onCheckBuffer>(this);
     wsactivate.set<LogDB, &LogDB::onActivate>(this);
     sigTERM.set<LogDB, &LogDB::onTerminate>(this);
     sigQUIT.set<LogDB, &LogDB::onTerminate>(this);
@@ -149,6 +159,14 @@ LogDB::LogDB( const string& name, int argc, const char* const* argv, const strin
         l->port = sit.getIntProp("port");
         l->cmd = sit.getProp("cmd");
         l->description = sit.getProp("description");
+        l->binary = sit.getIntProp("binary");
+        l->compress = sit.getIntProp("compress");
+
+        if( l->compress && !LogServerTypes::isCompressSupported(LogServerTypes::ctLZ4) )
+        {
+            dbwarn << myname << "(init): compression is not supported (build without lz4). Ignore 'compress' for " << l->name << endl;
+            l->compress = false;
+        }
 
         l->setReadBufSize(bufSize);
 
@@ -234,6 +252,46 @@ LogDB::LogDB( const string& name, int argc, const char* const* argv, const strin
             dbcrit << err.str() << endl;
             throw uniset::SystemError(err.str());
         }
+
+        // отдельное соединение для записи (чтение через REST API не должно блокировать запись)
+        wdb = unisetstd::make_unique<SQLiteInterface>();
+
+        if( !wdb->connect(dbfile, false, SQLITE_OPEN_NOMUTEX) )
+        {
+            ostringstream err;
+            err << myname
+                << "(init): DB connection (for write) error: "
+                << wdb->error();
+            dbcrit << err.str() << endl;
+            throw uniset::SystemError(err.str());
+        }
+
+        if( !dbJournalMode.empty() && !wdb->setJournalMode(dbJournalMode) )
+            dbwarn << myname << "(init): set journal mode error: " << wdb->error() << endl;
+
+        if( !dbSynchronous.empty() && !wdb->setSynchronous(dbSynchronous) )
+            dbwarn << myname << "(init): set synchronous mode error: " << wdb->error() << endl;
+
+        storage = unisetstd::make_unique<LogDBStorage>(wdb.get(), dbPartitionHours * 60 * 60, dbFTS);
+
+        if( !storage->init() )
+        {
+            ostringstream err;
+            err << myname << "(init): DB init error: " << storage->error();
+            dbcrit << err.str() << endl;
+            throw uniset::SystemError(err.str());
+        }
+
+        if( dbFTS && !storage->isFTS() )
+            dbwarn << myname << "(init): sqlite without FTS5 support. Full-text index disabled.." << endl;
+
+        dbinfo << myname << "(init): journal_mode=" << dbJournalMode
+               << " synchronous=" << dbSynchronous
+               << " maxQueue=" << qmaxSize
+               << " flushTime=" << tmFlushBuffer_msec << " msec"
+               << " partition=" << dbPartitionHours << " hours"
+               << " fts=" << storage->isFTS()
+               << endl;
     }
 
 #ifndef DISABLE_REST_API
@@ -245,6 +303,7 @@ LogDB::LogDB( const string& name, int argc, const char* const* argv, const strin
     httpPort = uniset::getArgInt("--" + prefix + "httpserver-port", argc, argv, "8080");
     httpCORS_allow = uniset::getArgParam("--" + prefix + "httpserver-cors-allow", argc, argv, httpCORS_allow);
     httpReplyAddr = uniset::getArgParam("--" + prefix + "httpserver-reply-addr", argc, argv, "");
+    httpPageSize = uniset::getArgPInt("--" + prefix + "httpserver-page-size", argc, argv, it.getProp("httpPageSize"), httpPageSize);
 
     dblog1 << myname << "(init): http server parameters " << httpHost << ":" << httpPort << endl;
     Poco::Net::SocketAddress sa(httpHost, httpPort);
@@ -289,6 +348,13 @@ LogDB::~LogDB()
 
 #endif
 
+    stopDBThread();
+
+    storage = nullptr;
+
+    if( wdb )
+        wdb->close();
+
     if( db )
         db->close();
 }
@@ -305,7 +371,8 @@ void LogDB::onTerminate( ev::sig& evsig, int revents )
 
     try
     {
-        flushBuffer();
+        // поток записи перед завершением скидывает в БД всё что накопилось
+        stopDBThread();
     }
     catch( std::exception& ex )
     {
@@ -340,122 +407,169 @@ void LogDB::onTerminate( ev::sig& evsig, int revents )
     }
 }
 //--------------------------------------------------------------------------------------------
-void LogDB::flushBuffer()
+void LogDB::startDBThread()
 {
-    if( !db || qbuf.empty() || !db->isConnection() )
+    if( !wdb || dbThread )
         return;
 
-    // без BEGIN и COMMIT вставка большого количества данных будет тормозить!
-    db->query("BEGIN;");
+    dbActive = true;
+    dbThread = unisetstd::make_unique< ThreadCreator<LogDB> >(this, &LogDB::dbThreadLoop);
+    dbThread->start();
+}
+//--------------------------------------------------------------------------------------------
+void LogDB::stopDBThread()
+{
+    if( !dbThread )
+        return;
 
-    while( !qbuf.empty() )
     {
-        if( !db->insert(qbuf.front()) )
-        {
-            dbcrit << myname << "(flushBuffer): error: " << db->error()
-                   << " lost query: " << qbuf.front() << endl;
-        }
-
-        qbuf.pop();
+        std::unique_lock<std::mutex> lk(qmut);
+        dbActive = false;
     }
 
-    db->query("COMMIT;");
+    qcond.notify_all();
 
-    if( !db->lastQueryOK() )
-    {
-        dbcrit << myname << "(flushBuffer): error: " << db->error() << endl;
-    }
+    if( dbThread->isRunning() )
+        dbThread->join();
 
-    // вызываем каждый раз, для отслеживания переполнения..
-    rotateDB();
+    dbThread = nullptr;
 }
 //--------------------------------------------------------------------------------------------
-void LogDB::rotateDB()
+void LogDB::dbThreadLoop()
 {
-    if( !db )
-        return;
+    dbinfo << myname << "(dbThreadLoop): run.." << endl;
 
-    // ротация отключена
-    if( maxdbRecords == 0 )
-        return;
+    // "двойная буферизация": пока пишем recs, eventloop заполняет qbuf
+    QueryBuffer recs;
+    recs.reserve(qbufSize);
 
-    size_t num = getCountOfRecords();
+    const std::chrono::milliseconds tmFlush(tmFlushBuffer_msec);
 
-    if( num <= numOverflow )
-        return;
+    while( dbActive )
+    {
+        {
+            std::unique_lock<std::mutex> lk(qmut);
+            qcond.wait_for(lk, tmFlush, [&]()
+            {
+                return ( !dbActive || qbuf.size() >= qbufSize );
+            });
 
-    dblog2 << myname << "(rotateDB): num=" << num << " > " << numOverflow << endl;
+            recs.swap(qbuf);
+        }
 
-    size_t firstOldID = getFirstOfOldRecord(numOverflow);
+        try
+        {
+            writeRecords(recs);
+        }
+        catch( std::exception& ex )
+        {
+            dbcrit << myname << "(dbThreadLoop): " << ex.what() << endl;
+        }
 
-    DBResult ret = db->query("DELETE FROM logs WHERE id <= " + std::to_string(firstOldID) + ";");
+        recs.clear();
+    }
 
-    if( !db->lastQueryOK() )
+    // скидываем остатки
     {
-        dbwarn << myname << "(rotateDB): delete error: " << db->error() << endl;
+        std::unique_lock<std::mutex> lk(qmut);
+        recs.swap(qbuf);
     }
 
-    ret = db->query("VACUUM;");
-
-    if( !db->lastQueryOK() )
+    try
     {
-        dbwarn << myname << "(rotateDB): vacuum error: " << db->error() << endl;
+        writeRecords(recs);
+    }
+    catch( std::exception& ex )
+    {
+        dbcrit << myname << "(dbThreadLoop): " << ex.what() << endl;
     }
 
-    //  dblog3 <<  myname << "(rotateDB): after rotate: " << getCountOfRecords() << " records" << endl;
+    dbinfo << myname << "(dbThreadLoop): terminated.." << endl;
 }
 //--------------------------------------------------------------------------------------------
-void LogDB::addLog( LogDB::Log* log, const string& txt )
+void LogDB::writeRecords( QueryBuffer& recs )
 {
-    auto tm = uniset::now_to_timespec();
+    if( !storage || recs.empty() || !wdb->isConnection() )
+        return;
 
-    ostringstream q;
+    // без BEGIN и COMMIT вставка большого количества данных будет тормозить!
+    if( !storage->begin() )
+    {
+        dbcrit << myname << "(writeRecords): begin error: " << storage->error() << endl;
+        return;
+    }
+
+    for( const auto& r : recs )
+    {
+        if( !storage->add(r.tm.tv_sec, r.tm.tv_nsec, r.log->name, r.text) )
+        {
+            dbcrit << myname << "(writeRecords): error: " << storage->error()
+                   << " lost record: " << r.log->name << ": " << r.text << endl;
+        }
+    }
 
-    q << "INSERT INTO logs(tms,usec,name,text) VALUES("
-      << "datetime(" << tm.tv_sec << ",'unixepoch'),'"   //  timestamp
-      << tm.tv_nsec << "','"  //  usec
-      << log->name << "','"
-      << qEscapeString(txt) << "');";
+    if( !storage->commit() )
+    {
+        dbcrit << myname << "(writeRecords): error: " << storage->error() << endl;
+    }
 
-    qbuf.emplace(q.str());
+    // вызываем каждый раз, для отслеживания переполнения..
+    rotateDB();
 }
 //--------------------------------------------------------------------------------------------
-void LogDB::log2File( LogDB::Log* log, const string& txt )
+void LogDB::rotateDB()
 {
-    if( !log->logfile || !log->logfile->isOnLogFile() )
+    if( !storage )
         return;
 
-    log->logfile->any() << txt << endl;
+    // ротация отключена
+    if( maxdbRecords == 0 )
+        return;
+
+    // удаляются старые партиции целиком (см. LogDBStorage::rotate)
+    size_t num = storage->rotate(maxdbRecords, numOverflow);
+
+    if( num > 0 )
+        dblog2 << myname << "(rotateDB): removed " << num << " records" << endl;
 }
 //--------------------------------------------------------------------------------------------
-size_t LogDB::getCountOfRecords( const std::string& logname )
+void LogDB::addLog( LogDB::Log* log, const string& txt )
 {
-    ostringstream q;
+    // запись в БД делает отдельный поток (см. dbThreadLoop)
+    std::unique_lock<std::mutex> lk(qmut);
 
-    q << "SELECT count(*) FROM logs";
+    if( qbuf.size() >= qmaxSize )
+    {
+        numLostRecords++;
 
-    if( !logname.empty() )
-        q << " WHERE name='" << logname << "'";
+        if( !qOverflow )
+        {
+            qOverflow = true;
+            dbwarn << myname << "(addLog): the db queue is full (" << qmaxSize << "). Records are lost.." << endl;
+        }
 
-    DBResult ret = db->query(q.str());
+        return;
+    }
 
-    if( !ret )
-        return 0;
+    qOverflow = false;
+    qbuf.emplace_back(log->tm, log, txt);
 
-    return (size_t) ret.begin().as_int(0);
+    if( qbuf.size() == qbufSize )
+        qcond.notify_one();
 }
 //--------------------------------------------------------------------------------------------
-size_t LogDB::getFirstOfOldRecord( size_t maxnum )
+void LogDB::log2File( LogDB::Log* log, const string& txt )
 {
-    ostringstream q;
-
-    q << "SELECT id FROM logs order by id DESC limit " << maxnum << ",1";
-    DBResult ret = db->query(q.str());
-
-    if( !ret )
-        return 0;
+    if( !log->logfile || !log->logfile->isOnLogFile() )
+        return;
 
-    return (size_t) ret.begin().as_int(0);
+    log->logfile->any() << txt << endl;
+}
+//--------------------------------------------------------------------------------------------
+size_t LogDB::getCountOfRecords( const std::string& logname )
+{
+    // счётчики записей поддерживаются при вставке (см. LogDBStorage)
+    return LogDBStorage::getCount(db.get(), logname);
 }
 //--------------------------------------------------------------------------------------------
 std::shared_ptr<LogDB> LogDB::init_logdb( int argc, const char* const* argv, const std::string& prefix )
@@ -478,6 +592,12 @@ void LogDB::help_print()
     cout << "--prefix-name name                   - Имя. Для поиска настроечной секции в configure.xml" << endl;
     cout << "database: " << endl;
     cout << "--prefix-db-buffer-size sz                  - Размер буфера (до скидывания в БД)." << endl;
+    cout << "--prefix-db-flush-time msec                 - Период скидывания буфера в БД (даже если он не заполнен). По умолчанию: 1000 мсек" << endl;
+    cout << "--prefix-db-max-queue sz                    - Максимальное количество записей ожидающих записи в БД. По умолчанию: 10*buffer-size" << endl;
+    cout << "--prefix-db-journal-mode mode               - PRAGMA journal_mode. По умолчанию: WAL" << endl;
+    cout << "--prefix-db-synchronous mode                - PRAGMA synchronous. По умолчанию: NORMAL" << endl;
+    cout << "--prefix-db-partition-hours num             - Период времени хранимый в одной таблице (партиции). По умолчанию: 24 часа" << endl;
+    cout << "--prefix-db-fts-disable                     - Не создавать полнотекстовый индекс (FTS5)" << endl;
     cout << "--prefix-db-max-records sz                  - Максимальное количество записей в БД. При превышении, старые удаляются. 0 - не удалять" << endl;
     cout << "--prefix-db-overflow-factor float           - Коэффициент переполнения, после которого запускается удаление старых записей. По умолчанию: 1.3" << endl;
     cout << "--prefix-db-disable                         - Отключить запись в БД" << endl;
@@ -504,6 +624,7 @@ void LogDB::help_print()
     cout << "--prefix-httpserver-max-threads num         - Разрешённое количество потоков для http-сервера. По умолчанию: 3" << endl;
     cout << "--prefix-httpserver-cors-allow addr         - (CORS): Access-Control-Allow-Origin. Default: *" << endl;
     cout << "--prefix-httpserver-reply-addr host[:port]  - Адрес отдаваемый клиенту для подключения. По умолчанию адрес узла где запущен logdb" << endl;
+    cout << "--prefix-httpserver-page-size num           - Количество записей в ответе при чтении по курсору (если не задан limit). По умолчанию: 1000" << endl;
 }
 // -----------------------------------------------------------------------------
 void LogDB::run( bool async )
@@ -515,6 +636,8 @@ void LogDB::run( bool async )
 
 #endif
 
+    startDBThread();
+
     if( async )
         async_evrun();
     else
@@ -523,18 +646,11 @@ void LogDB::run( bool async )
 // -----------------------------------------------------------------------------
 void LogDB::evfinish()
 {
-    flushBufferTimer.stop();
     wsactivate.stop();
 }
 // -----------------------------------------------------------------------------
 void LogDB::evprepare()
 {
-    if( db )
-    {
-        flushBufferTimer.set(loop);
-        flushBufferTimer.start(0, tmFlushBuffer_sec);
-    }
-
     wsactivate.set(loop);
     wsactivate.start();
 
@@ -549,18 +665,6 @@ void LogDB::evprepare()
     sigINT.start(SIGINT);
 }
 // -----------------------------------------------------------------------------
-void LogDB::onCheckBuffer(ev::timer& t, int revents)
-{
-    if (EV_ERROR & revents)
-    {
-        dbcrit << myname << "(LogDB::onCheckBuffer): invalid event" << endl;
-        return;
-    }
-
-    if( qbuf.size() >= qbufSize )
-        flushBuffer();
-}
-// -----------------------------------------------------------------------------
 void LogDB::onActivate( ev::async& watcher, int revents )
 {
     if (EV_ERROR & revents)
@@ -662,6 +766,22 @@ void LogDB::Log::ioprepare()
     text.reserve(reservsize);
 
     // первый раз при подключении надо послать команды
+    // (сжатие и бинарный режим включаем первыми, т.к. сессия начинает выдачу сразу после первой команды)
+    if( compress )
+    {
+        unzip.reset();
+        LogServerTypes::lsMessage msg(LogServerTypes::cmdCompressMode, LogServerTypes::ctLZ4, "");
+        wbuf.emplace(new UTCPCore::Buffer((unsigned char*)&msg, sizeof(msg)));
+        io.set(ev::WRITE);
+    }
+
+    if( binary )
+    {
+        rreader.reset();
+        LogServerTypes::lsMessage msg(LogServerTypes::cmdBinaryMode, 0, "");
+        wbuf.emplace(new UTCPCore::Buffer((unsigned char*)&msg, sizeof(msg)));
+        io.set(ev::WRITE);
+    }
 
     //! \todo Пока закрываем глаза на не оптимальность, того, что парсим строку каждый раз
     auto cmdlist = LogServerTypes::getCommands(cmd);
@@ -719,19 +839,22 @@ void LogDB::Log::read( ev::io& watcher )
     {
         tcp->receiveBytes(buf.data(), n);
 
-        // нарезаем на строки
-        for( int i = 0; i < n; i++ )
+        if( !compress )
         {
-            if( buf[i] != '\n' )
-                text += buf[i];
-            else
-            {
-                sigRead.emit(this, text);
-                text = "";
+            readText(buf.data(), n);
+            return;
+        }
 
-                if( text.capacity() < reservsize )
-                    text.reserve(reservsize);
-            }
+        unzip.add(buf.data(), n);
+        zbuf.clear();
+
+        if( unzip.read(zbuf) > 0 )
+            readText(zbuf.data(), zbuf.size());
+
+        if( unzip.isError() )
+        {
+            dbcrit << name << ": " << ip << ":" << port << " bad compressed data. Reconnect.." << endl;
+            close();
         }
     }
     else if( n == 0 )
@@ -740,6 +863,7 @@ void LogDB::Log::read( ev::io& watcher )
 
         if( !text.empty() )
         {
+            tm = uniset::now_to_timespec();
             sigRead.emit(this, text);
             text = "";
 
@@ -751,6 +875,67 @@ void LogDB::Log::read( ev::io& watcher )
     }
 }
 // -----------------------------------------------------------------------------
+void LogDB::Log::readText( const char* b, size_t len )
+{
+    if( binary )
+    {
+        readRecords(b, len);
+        return;
+    }
+
+    tm = uniset::now_to_timespec();
+
+    // нарезаем на строки
+    for( size_t i = 0; i < len; i++ )
+    {
+        if( b[i] != '\n' )
+            text += b[i];
+        else
+        {
+            sigRead.emit(this, text);
+            text = "";
+
+            if( text.capacity() < reservsize )
+                text.reserve(reservsize);
+        }
+    }
+}
+// -----------------------------------------------------------------------------
+void LogDB::Log::readRecords( const char* b, size_t len )
+{
+    rreader.add(b, len);
+
+    LogServerTypes::RecordReader::Data d;
+
+    while( rreader.next(d) )
+    {
+        if( d.type == LogServerTypes::rtRecord )
+        {
+            // запись содержит целую строку (вместе с '\n')
+            if( !d.text.empty() && d.text.back() == '\n' )
+                d.text.pop_back();
+
+            tm = d.tm;
+            sigRead.emit(this, rfmt.formatRecord( DebugStream::Record(d.logname, d.text, d.tm, d.level) ));
+            continue;
+        }
+
+        // обычный текст (сервер не поддерживает бинарный режим), нарезаем на строки
+        tm = uniset::now_to_timespec();
+
+        for( const auto& c : d.text )
+        {
+            if( c != '\n' )
+                text += c;
+            else
+            {
+                sigRead.emit(this, text);
+                text = "";
+            }
+        }
+    }
+}
+// -----------------------------------------------------------------------------
 void LogDB::Log::write( ev::io& io )
 {
     UTCPCore::Buffer* buffer = 0;
@@ -811,7 +996,8 @@ std::string LogDB::qEscapeString( const string& txt )
     {
         ret << c;
 
-        if( c == '\'' || c == '"' )
+        // внутри строки '...' удваивать надо только одинарную кавычку
+        if( c == '\'' )
             ret << c;
     }
 
@@ -866,9 +1052,26 @@ void LogDB::handleRequest( Poco::Net::HTTPServerRequest& req, Poco::Net::HTTPSer
 {
     using Poco::Net::HTTPResponse;
 
+    // при потоковой выдаче заголовки надо выставить до send()
+    bool ndjson = false;
+
+    try
+    {
+        Poco::URI uri(req.getURI());
+        ndjson = uniset::UHttp::isNDJSON(uri.getQueryParameters());
+    }
+    catch( std::exception& ex ) {}
+
+    if( ndjson )
+    {
+        resp.setContentType("application/x-ndjson");
+        resp.setChunkedTransferEncoding(true);
+    }
+    else
+        resp.setContentType("text/json");
+
     std::ostream& out = resp.send();
 
-    resp.setContentType("text/json");
     resp.set("Access-Control-Allow-Methods", "GET");
     resp.set("Access-Control-Allow-Request-Method", "*");
     resp.set("Access-Control-Allow-Origin", httpCORS_allow /* req.get("Origin") */);
@@ -953,21 +1156,33 @@ void LogDB::handleRequest( Poco::Net::HTTPServerRequest& req, Poco::Net::HTTPSer
             l.param("last=XX[m|h|d|M]", "Last records (m - minute, h - hour, d - day, M - month)");
             l.param("offset=N", "offset");
             l.param("limit=M", "limit records for response");
+            l.param("search=words", "full-text search (records containing all words)");
+            l.param("cursor=xxx", "read after cursor (empty - from begin), see 'next' in response");
+            l.param("format=ndjson", "stream records (one json object per line)");
             myhelp.add(l);
 
             myhelp.emplace(item("apidocs", "https://github.com/Etersoft/uniset2"));
             myhelp.get()->stringify(out);
         }
+        else if( cmd == "logs" && ndjson )
+            httpStreamLogs(out, qp);
         else
         {
             auto json = httpGetRequest(cmd, qp);
             json->stringify(out);
+
+            if( ndjson )
+                out << endl;
         }
     }
     catch( std::exception& ex )
     {
         auto jdata = respError(resp, HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, ex.what());
         jdata->stringify(out);
+
+        // при потоковой выдаче ошибка передаётся последней строкой
+        if( ndjson )
+            out << endl;
     }
 
     out.flush();
@@ -1061,10 +1276,8 @@ Poco::JSON::Object::Ptr LogDB::httpGetList( const Poco::URI::QueryParameters& p
     return jdata;
 }
 // -----------------------------------------------------------------------------
-Poco::JSON::Object::Ptr LogDB::httpGetLogs( const Poco::URI::QueryParameters& params )
+LogDB::LogsQuery LogDB::parseLogsQuery( const Poco::URI::QueryParameters& params )
 {
-    Poco::JSON::Object::Ptr jdata = new Poco::JSON::Object();
-
     if( params.empty() || params[0].first.empty() )
     {
         ostringstream err;
@@ -1072,27 +1285,47 @@ Poco::JSON::Object::Ptr LogDB::httpGetLogs( const Poco::URI::QueryParameters& pa
         throw uniset::SystemError(err.str());
     }
 
-    std::string logname = params[0].first;
-
-    size_t offset = 0;
-    size_t limit = 0;
-
-    vector<std::string> q_where;
+    LogsQuery q;
+    q.logname = params[0].first;
 
     for( const auto& p : params )
     {
         if( p.first == "offset" )
-            offset = uni_atoi(p.second);
+            q.offset = uni_atoi(p.second);
         else if( p.first == "limit" )
-            limit = uni_atoi(p.second);
+            q.limit = uni_atoi(p.second);
         else if( p.first == "from" )
-            q_where.push_back("tms>='" + qDate(p.second) + " 00:00:00'");
+            q.where.push_back("tms>='" + qDate(p.second) + " 00:00:00'");
         else if( p.first == "to" )
-            q_where.push_back("tms<='" + qDate(p.second) + " 23:59:59'");
+            q.where.push_back("tms<='" + qDate(p.second) + " 23:59:59'");
         else if( p.first == "last" )
-            q_where.push_back(qLast(p.second));
+            q.where.push_back(qLast(p.second));
+        else if( p.first == "search" )
+            q.search = p.second;
+        else if( p.first == "cursor" )
+        {
+            q.byCursor = true;
+            q.cursor = p.second;
+        }
     }
 
+    return q;
+}
+// -----------------------------------------------------------------------------
+Poco::JSON::Object::Ptr LogDB::httpGetLogs( const Poco::URI::QueryParameters& params )
+{
+    auto lq = parseLogsQuery(params);
+
+    if( lq.byCursor )
+        return httpGetLogsByCursor(lq);
+
+    Poco::JSON::Object::Ptr jdata = new Poco::JSON::Object();
+    const std::string& logname = lq.logname;
+    const std::string& search = lq.search;
+    const size_t offset = lq.offset;
+    const size_t limit = lq.limit;
+    const vector<std::string>& q_where = lq.where;
+
     Poco::JSON::Array::Ptr jlist = uniset::json::make_child_array(jdata, "logs");
 
     ostringstream q;
@@ -1100,7 +1333,40 @@ Poco::JSON::Object::Ptr LogDB::httpGetLogs( const Poco::URI::QueryParameters& pa
     q << "SELECT tms,"
       << " strftime('%d-%m-%Y',datetime(tms,'" << tmsFormat << "')) as date,"
       << " strftime('%H:%M:%S',datetime(tms,'" << tmsFormat << "')) as time,"
-      << " usec, text FROM logs WHERE name='" << logname << "'";
+      << " usec, text FROM ";
+
+    if( search.empty() )
+        q << "logs";
+    else
+    {
+        // поиск по полнотекстовому индексу каждой партиции
+        const std::string match = qMatch(search);
+        auto parts = LogDBStorage::getPartitions(db.get());
+
+        if( parts.empty() || match.empty() )
+            return jdata;
+
+        q << "(";
+
+        for( size_t i = 0; i < parts.size(); i++ )
+        {
+            const auto& t = parts[i].tname;
+
+            if( i > 0 )
+                q << " UNION ALL ";
+
+            q << "SELECT tms,usec,name,text FROM " << t << " WHERE ";
+
+            if( parts[i].fts )
+                q << "id IN (SELECT rowid FROM " << t << "_fts WHERE " << t << "_fts MATCH '" << qEscapeString(match) << "')";
+            else
+                q << "text LIKE '%" << qEscapeString(search) << "%'";
+        }
+
+        q << ")";
+    }
+
+    q << " WHERE name='" << qEscapeString(logname) << "'";
 
     if( !q_where.empty() )
     {
@@ -1130,6 +1396,135 @@ Poco::JSON::Object::Ptr LogDB::httpGetLogs( const Poco::URI::QueryParameters& pa
     return jdata;
 }
 // -----------------------------------------------------------------------------
+Poco::JSON::Object::Ptr LogDB::httpGetLogsByCursor( const LogsQuery& q )
+{
+    Poco::JSON::Object::Ptr jdata = new Poco::JSON::Object();
+    Poco::JSON::Array::Ptr jlist = uniset::json::make_child_array(jdata, "logs");
+
+    LogsQuery lq(q);
+
+    if( lq.limit == 0 )
+        lq.limit = httpPageSize;
+
+    auto next = readLogs(lq, [&jlist]( const SQLiteInterface::Statement & st, const std::string & cursor )
+    {
+        jlist->add( makeLogRecord(st, cursor) );
+    });
+
+    if( !next.empty() )
+        jdata->set("next", next);
+
+    return jdata;
+}
+// -----------------------------------------------------------------------------
+void LogDB::httpStreamLogs( std::ostream& out, const Poco::URI::QueryParameters& params )
+{
+    auto lq = parseLogsQuery(params);
+
+    readLogs(lq, [&out]( const SQLiteInterface::Statement & st, const std::string & cursor )
+    {
+        makeLogRecord(st, cursor)->stringify(out);
+        out << '\n';
+    });
+}
+// -----------------------------------------------------------------------------
+Poco::JSON::Object::Ptr LogDB::makeLogRecord( const SQLiteInterface::Statement& st, const std::string& cursor )
+{
+    Poco::JSON::Object::Ptr j = new Poco::JSON::Object();
+    j->set("cursor", cursor);
+    j->set("tms", st.as_string(1));
+    j->set("date", st.as_string(2));
+    j->set("time", st.as_string(3));
+    j->set("usec", st.as_string(4));
+    j->set("text", st.as_string(5));
+    return j;
+}
+// -----------------------------------------------------------------------------
+std::string LogDB::readLogs( const LogsQuery& lq, const ReadLogsFunc& fn )
+{
+    // курсор: 'partition:id' - партиция и id последней полученной записи
+    long long cpart = -1;
+    long long cid = 0;
+
+    if( !lq.cursor.empty() )
+    {
+        char* end = nullptr;
+        cpart = std::strtoll(lq.cursor.c_str(), &end, 10);
+
+        if( !end || *end != ':' )
+        {
+            ostringstream err;
+            err << "BAD REQUEST: bad cursor '" << lq.cursor << "'";
+            throw uniset::SystemError(err.str());
+        }
+
+        cid = std::strtoll(end + 1, nullptr, 10);
+    }
+
+    const std::string match = lq.search.empty() ? "" : qMatch(lq.search);
+
+    if( !lq.search.empty() && match.empty() )
+        return "";
+
+    size_t count = 0;
+    std::string last;
+
+    // партиции упорядочены по времени, внутри партиции записи идут по id,
+    // поэтому продолжение с курсора - это поиск по первичному ключу (без пропуска offset записей)
+    for( const auto& part : LogDBStorage::getPartitions(db.get()) )
+    {
+        if( part.id < cpart )
+            continue;
+
+        ostringstream q;
+        q << "SELECT id, tms,"
+          << " strftime('%d-%m-%Y',datetime(tms,'" << tmsFormat << "')) as date,"
+          << " strftime('%H:%M:%S',datetime(tms,'" << tmsFormat << "')) as time,"
+          << " usec, text FROM " << part.tname
+          << " WHERE name='" << qEscapeString(lq.logname) << "'";
+
+        if( part.id == cpart )
+            q << " AND id>" << cid;
+
+        for( const auto& w : lq.where )
+            q << " AND " << w;
+
+        if( !lq.search.empty() )
+        {
+            if( part.fts )
+                q << " AND id IN (SELECT rowid FROM " << part.tname << "_fts WHERE " << part.tname << "_fts MATCH '" << qEscapeString(match) << "')";
+            else
+                q << " AND text LIKE '%" << qEscapeString(lq.search) << "%'";
+        }
+
+        q << " ORDER BY id";
+
+        if( lq.limit > 0 )
+            q << " LIMIT " << (lq.limit - count);
+
+        auto st = db->prepare(q.str());
+
+        if( !st )
+            throw uniset::SystemError(db->error());
+
+        while( st->fetch() )
+        {
+            last = std::to_string(part.id) + ":" + std::to_string(st->as_int64(0));
+            fn(*st, last);
+            count++;
+        }
+
+        if( !db->lastQueryOK() )
+            throw uniset::SystemError(db->error());
+
+        // страница заполнена, возможно есть ещё записи
+        if( lq.limit > 0 && count >= lq.limit )
+            return last;
+    }
+
+    return "";
+}
+// -----------------------------------------------------------------------------
 Poco::JSON::Object::Ptr LogDB::httpGetCount( const Poco::URI::QueryParameters& params )
 {
     Poco::JSON::Object::Ptr jdata = new Poco::JSON::Object();
@@ -1153,38 +1548,69 @@ string LogDB::qLast( const string& p )
     char unit =  p[p.size() - 1];
     std::string sval = p.substr(0, p.size() - 1);
 
+    // tms хранится как 'YYYY-MM-DD HH:MM:SS' (utc), поэтому сравниваем со строкой
+    // (так же используется индекс по (name,tms))
     if( unit == 'h' || unit == 'H' )
     {
         size_t h = uni_atoi(sval);
         ostringstream q;
-        q << "tms >= strftime('%s',datetime('now')) - " << h << "*60*60";
+        q << "tms >= datetime('now','-" << h << " hours')";
         return q.str();
     }
     else if( unit == 'd' || unit == 'D' )
     {
         size_t d = uni_atoi(sval);
         ostringstream q;
-        q << "tms >= strftime('%s',datetime('now')) - " << d << "*24*60*60";
+        q << "tms >= datetime('now','-" << d << " days')";
         return q.str();
     }
     else if( unit == 'M' )
     {
         size_t m = uni_atoi(sval);
         ostringstream q;
-        q << "tms >= strftime('%s',datetime('now')) - " << m << "*30*24*60*60";
+        q << "tms >= datetime('now','-" << m << " months')";
         return q.str();
     }
     else // по умолчанию минут
     {
         size_t m = (unit == 'm') ? uni_atoi(sval) : uni_atoi(p);
         ostringstream q;
-        q << "tms >= strftime('%s',datetime('now')) - " << m << "*60";
+        q << "tms >= datetime('now','-" << m << " minutes')";
         return q.str();
     }
 
     return "";
 }
 // -----------------------------------------------------------------------------
+string LogDB::qMatch( const string& s )
+{
+    // каждое слово берём в кавычки (чтобы спецсимволы не воспринимались как синтаксис FTS5),
+    // слова через пробел - это "И"
+    ostringstream q;
+    std::istringstream in(s);
+    std::string w;
+
+    while( in >> w )
+    {
+        if( q.tellp() > 0 )
+            q << " ";
+
+        q << '"';
+
+        for( const auto& c : w )
+        {
+            if( c == '"' )
+                q << c;
+
+            q << c;
+        }
+
+        q << '"';
+    }
+
+    return q.str();
+}
+// -----------------------------------------------------------------------------
 string LogDB::qDate( const string& p, const char sep )
 {
     if( p.size() < 8 || p.size() > 10 )
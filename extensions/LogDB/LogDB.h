@@ -26,6 +26,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <functional>
 #include <ev++.h>
 #include <sigc++/sigc++.h>
 #include <Poco/JSON/Object.h>
@@ -37,9 +38,12 @@
 #include "EventLoopServer.h"
 #include "UTCPStream.h"
 #include "LogReader.h"
+#include "LogServerTypes.h"
 #include "UHttpRequestHandler.h"
 #include "UHttpServer.h"
 #include "UTCPCore.h"
+#include "ThreadCreator.h"
+#include "LogDBStorage.h"
 // -------------------------------------------------------------------------
 namespace uniset
 {
@@ -74,9 +78,19 @@ namespace uniset
       <logserver name="" ip=".." port=".." cmd=".." description=".."/>
       <logserver name="" ip=".." port=".." cmd=".." description=".."/>
       <logserver name="" ip=".." port=".." cmd=".." logfile=".."/>
+      <logserver name="" ip=".." port=".." binary="1"/>
+      <logserver name="" ip=".." port=".." binary="1" compress="1"/>
     </LogDB>
     \endcode
 
+    Если указано \b binary="1", то логи от лог-сервера получаются в виде бинарных записей (LogServerTypes::cmdBinaryMode).
+    В этом случае время записи в БД берётся из самой записи (а не время получения), а текст формируется на стороне LogDB.
+    Если лог-сервер не поддерживает этот режим, то логи принимаются как обычный текст.
+
+    Если указано \b compress="1", то у лог-сервера запрашивается сжатие потока (LogServerTypes::cmdCompressMode).
+    Это имеет смысл для удалённых лог-серверов (медленный канал). Если LogDB собрана без поддержки lz4
+    или лог-сервер не поддерживает сжатие, то данные принимаются без сжатия.
+
     При этом доступно два способа:
     * Первый - это использование секции в общем файле проекта (configure.xml).
     * Второй способ - позволяет создать отдельный xml-файл с одной настроечной секцией и указать его в аргументах командной строки
@@ -87,12 +101,31 @@ namespace uniset
 
     \section sec_LogDB_DB LogDB: Работа с БД
     Для оптимизации, запись в БД сделана не по каждому сообщению, а через промежуточный буфер.
-    Т.е. только после того как в буфере скапливается \a qbufSize сообщений (строк) буфер скидывается в базу.
+    Запись в БД ведётся отдельным потоком (через отдельное соединение с БД), поэтому медленная запись
+    не блокирует чтение логов. Буфер скидывается в базу (одной транзакцией, подготовленным запросом)
+    как только в нём скапливается \a qbufSize сообщений (строк) (--prefix-db-buffer-size),
+    но не реже чем раз в \a dbFlushTime (--prefix-db-flush-time).
+    Если поток записи не успевает, то накапливается не более \a dbMaxQueue (--prefix-db-max-queue) сообщений,
+    остальные отбрасываются.
+
+    По умолчанию БД переводится в режим журнала WAL (PRAGMA journal_mode), что позволяет читать логи (REST API)
+    не блокируя запись. Режим журнала и режим синхронизации с диском можно задать параметрами
+    --prefix-db-journal-mode и --prefix-db-synchronous (см. документацию по sqlite).
+
     Помимо этого, встроен механизм "ротации БД". Если задан параметр maxRecords (--prefix-db-max-records),
     то в БД будет поддерживаться ограниченное количество записей. При этом введён "гистерезис",
     т.е. фактически удаление старых записей начинается при переполнении БД определяемом коэффициентом
     переполнения overflowFactor (--prefix-db-overflow-factor). По умолчанию 1.3.
 
+    Логи хранятся в таблицах разбитых по времени ("партициях"), см. LogDBStorage.
+    Период времени хранимый в одной таблице задаётся параметром --prefix-db-partition-hours (по умолчанию 24 часа).
+    Ротация удаляет самые старые партиции целиком, поэтому фактическое количество записей в БД
+    может быть меньше maxRecords (на размер удалённой партиции). Каждая партиция имеет индекс по (name,tms)
+    и полнотекстовый индекс FTS5 (если sqlite собрана с его поддержкой; отключается --prefix-db-fts-disable).
+    Количество записей не вычисляется каждый раз, а поддерживается при записи (таблица counters).
+    Для совместимости доступно представление (view) \b logs объединяющее все партиции.
+    БД созданная в прежнем формате (одна таблица logs) переводится в новый формат при запуске.
+
     \section sec_LogDB_REST LogDB: REST API
     LogDB предоставляет возможность получения логов через REST API. Для этого запускается
     http-сервер. Параметры запуска можно указать при помощи:
@@ -113,10 +146,27 @@ namespace uniset
       to='YYYY-MM-DD'        - 'по' указанную дату
       last=XX[m|h|d|M]       - за последние XX m-минут, h-часов, d-дней, M-месяцев
        По умолчанию: минут
+      search=word1 word2..   - полнотекстовый поиск (записи содержащие все указанные слова)
+      cursor=xxx             - постраничное чтение по курсору (см. ниже)
+      format=ndjson          - потоковая выдача (см. ниже)
 
     /count?logname                   - Получить текущее количество записей
     \endcode
 
+    При чтении по смещению (offset) БД каждый раз "пропускает" offset записей, поэтому для
+    больших выборок лучше использовать курсор (keyset pagination): первый запрос делается
+    с пустым курсором (\b cursor=), в ответе возвращается поле \b next, которое надо передать
+    в следующем запросе (cursor=next). Отсутствие \b next в ответе означает, что записей больше нет.
+    Если limit не задан, в ответе возвращается не больше --prefix-httpserver-page-size записей (по умолчанию 1000).
+    При чтении по курсору записи выдаются в порядке их записи в БД.
+
+    При \b format=ndjson ответ передаётся частями (chunked), по одной записи (json-объекту) в строке,
+    в памяти держится только текущая запись. У каждой записи есть поле \b cursor,
+    по которому можно продолжить чтение (cursor=...), например после разрыва соединения.
+    \code
+    curl 'http://localhost:8080/api/v01/logdb/logs?logname&format=ndjson&last=1d'
+    \endcode
+
 
     \section sec_LogDB_WEBSOCK LogDB: Поддержка web socket
 
@@ -140,7 +190,8 @@ namespace uniset
 
     \section sec_LogDB_DETAIL LogDB: Технические детали
        Вся реализация построена на "однопоточном" eventloop. В нём происходит,
-     чтение данных от логсерверов, посылка сообщений в websockets, запись в БД.
+     чтение данных от логсерверов, посылка сообщений в websockets, помещение записей в буфер для БД.
+     Запись в БД идёт в отдельном потоке (см. \ref sec_LogDB_DB).
      При этом обработка запросов REST API реализуется отдельными потоками контролируемыми libpoco.
 
 
@@ -208,15 +259,13 @@ namespace uniset
 
             virtual void evfinish() override;
             virtual void evprepare() override;
-            void onCheckBuffer( ev::timer& t, int revents );
             void onActivate( ev::async& watcher, int revents ) ;
             void addLog( Log* log, const std::string& txt );
             void log2File( Log* log, const std::string& txt );
 
             size_t getCountOfRecords( const std::string& logname = "" );
-            size_t getFirstOfOldRecord( size_t maxnum );
 
-            // экранирование кавычек (удваивание для sqlite)
+            // экранирование кавычек для строки '...' (удваивание для sqlite)
             static std::string qEscapeString( const std::string& s );
 
 #ifndef DISABLE_REST_API
@@ -225,6 +274,34 @@ namespace uniset
             Poco::JSON::Object::Ptr httpGetList( const Poco::URI::QueryParameters& p );
             Poco::JSON::Object::Ptr httpGetLogs( const Poco::URI::QueryParameters& p );
             Poco::JSON::Object::Ptr httpGetCount( const Poco::URI::QueryParameters& p );
+
+            // параметры запроса /logs
+            struct LogsQuery
+            {
+                std::string logname;
+                size_t offset = { 0 };
+                size_t limit = { 0 };
+                std::string search;
+                bool byCursor = { false };
+                std::string cursor; // 'partition:id' (пустой - с начала)
+                std::vector<std::string> where;
+            };
+
+            LogsQuery parseLogsQuery( const Poco::URI::QueryParameters& p );
+
+            // вызывается для каждой прочитанной записи
+            // (id, tms, date, time, usec, text; cursor - курсор для продолжения "после этой записи")
+            typedef std::function<void( const SQLiteInterface::Statement& st, const std::string& cursor )> ReadLogsFunc;
+
+            /*! Чтение записей по курсору (keyset). Записи читаются по партициям в порядке (партиция, id),
+             * без формирования всего результата в памяти.
+             * \return курсор для продолжения или "" если записей больше нет
+             */
+            std::string readLogs( const LogsQuery& q, const ReadLogsFunc& fn );
+
+            Poco::JSON::Object::Ptr httpGetLogsByCursor( const LogsQuery& q );
+            void httpStreamLogs( std::ostream& out, const Poco::URI::QueryParameters& p );
+            static Poco::JSON::Object::Ptr makeLogRecord( const SQLiteInterface::Statement& st, const std::string& cursor );
             void httpWebSocketPage( std::ostream& out, Poco::Net::HTTPServerRequest& req, Poco::Net::HTTPServerResponse& resp );
             void httpWebSocketConnectPage( std::ostream& out, Poco::Net::HTTPServerRequest& req, Poco::Net::HTTPServerResponse& resp, const std::string& logname );
 
@@ -235,23 +312,51 @@ namespace uniset
             // преобразование в дату 'YYYY-MM-DD' из строки 'YYYYMMDD' или 'YYYY/MM/DD'
             static std::string qDate(const std::string& p, const char sep = '-');
 
+            // преобразование строки поиска в запрос для FTS5 (MATCH)
+            static std::string qMatch( const std::string& s );
+
             std::shared_ptr<LogWebSocket> newWebSocket(Poco::Net::HTTPServerRequest* req, Poco::Net::HTTPServerResponse* resp, const std::string& logname );
             void delWebSocket( std::shared_ptr<LogWebSocket>& ws );
 #endif
             std::string myname;
-            std::unique_ptr<SQLiteInterface> db;
+            std::unique_ptr<SQLiteInterface> db; // соединение для чтения (REST API)
+            std::unique_ptr<SQLiteInterface> wdb; // соединение для записи (используется только в потоке записи)
+            std::unique_ptr<LogDBStorage> storage; // запись (через wdb)
+            std::string dbJournalMode = { "WAL" };
+            std::string dbSynchronous = { "NORMAL" };
+            size_t dbPartitionHours = { 24 };
+            bool dbFTS = { true };
 
             std::string tmsFormat = { "localtime" }; /*!< формат возвращаемого времени */
 
             bool activate = { false };
 
-            typedef std::queue<std::string> QueryBuffer;
-            QueryBuffer qbuf;
-            size_t qbufSize = { 1000 }; // размер буфера сообщений.
+            struct DBRecord
+            {
+                struct timespec tm;
+                Log* log; // логи существуют всё время работы LogDB
+                std::string text;
 
-            ev::timer flushBufferTimer;
-            double tmFlushBuffer_sec = { 1.0 };
-            void flushBuffer();
+                DBRecord( const struct timespec& t, Log* l, const std::string& txt ):
+                    tm(t), log(l), text(txt) {}
+            };
+
+            typedef std::vector<DBRecord> QueryBuffer;
+            QueryBuffer qbuf; // заполняется в eventloop, забирается потоком записи
+            std::mutex qmut;
+            std::condition_variable qcond;
+            size_t qbufSize = { 1000 }; // размер буфера сообщений.
+            size_t qmaxSize = { 0 }; // максимальное количество сообщений ожидающих записи
+            bool qOverflow = { false };
+            std::atomic<size_t> numLostRecords = { 0 };
+
+            timeout_t tmFlushBuffer_msec = { 1000 };
+            std::unique_ptr< ThreadCreator<LogDB> > dbThread;
+            std::atomic_bool dbActive = { false };
+            void dbThreadLoop();
+            void startDBThread();
+            void stopDBThread();
+            void writeRecords( QueryBuffer& recs );
             void rotateDB();
 
             size_t maxdbRecords = { 200 * 1000 };
@@ -273,6 +378,12 @@ namespace uniset
                     std::string cmd;
                     std::string peername;
                     std::string description;
+                    bool binary = { false }; // режим получения бинарных записей (cmdBinaryMode)
+                    bool compress = { false }; // запрашивать сжатие потока (cmdCompressMode)
+
+                    // время текущей (прочитанной) записи
+                    // для бинарного режима - время из записи, иначе время получения
+                    struct timespec tm = { 0, 0 };
 
                     std::shared_ptr<DebugStream> dblog;
                     std::shared_ptr<DebugStream> logfile;
@@ -310,6 +421,14 @@ namespace uniset
                     static const size_t reservsize = { 1000 };
                     std::string text;
 
+                    LogServerTypes::RecordReader rreader; // разбор бинарных записей
+                    DebugStream rfmt; // форматирование бинарных записей в текст
+                    void readRecords( const char* buf, size_t len );
+                    void readText( const char* buf, size_t len );
+
+                    LogServerTypes::Decompressor unzip; // распаковка сжатого потока
+                    std::string zbuf; // распакованные данные
+
                     // буфер для посылаемых данных (write buffer)
                     std::queue<UTCPCore::Buffer*> wbuf;
             };
@@ -323,6 +442,7 @@ namespace uniset
             int httpPort = { 0 };
             std::string httpCORS_allow = { "*" };
             std::string httpReplyAddr = { "" };
+            size_t httpPageSize = { 1000 }; // размер страницы по умолчанию (при чтении по курсору)
 
             double wsHeartbeatTime_sec = { 3.0 };
             double wsSendTime_sec = { 0.5 };
@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// --------------------------------------------------------------------------
+/*! \file
+ *  \author Pavel Vainerman
+*/
+// --------------------------------------------------------------------------
+#include <sstream>
+#include <cstdlib>
+#include "LogDBStorage.h"
+// --------------------------------------------------------------------------
+using namespace uniset;
+using namespace std;
+// --------------------------------------------------------------------------
+static std::string qEscape( const std::string& txt )
+{
+    std::string ret;
+    ret.reserve(txt.size());
+
+    for( const auto& c : txt )
+    {
+        ret += c;
+
+        if( c == '\'' )
+            ret += c;
+    }
+
+    return ret;
+}
+// --------------------------------------------------------------------------
+LogDBStorage::LogDBStorage( SQLiteInterface* _db, time_t _partitionSec, bool _fts ):
+    db(_db),
+    partitionSec(_partitionSec > 0 ? _partitionSec : 24 * 60 * 60),
+    fts(_fts)
+{
+    lastCount = counts.end();
+}
+// --------------------------------------------------------------------------
+LogDBStorage::~LogDBStorage()
+{
+}
+// --------------------------------------------------------------------------
+std::string LogDBStorage::error()
+{
+    return db->error();
+}
+// --------------------------------------------------------------------------
+bool LogDBStorage::checkFTS( SQLiteInterface* db )
+{
+    if( !db->exec("CREATE VIRTUAL TABLE IF NOT EXISTS temp.fts_check USING fts5(text);") )
+        return false;
+
+    db->exec("DROP TABLE IF EXISTS temp.fts_check;");
+    return true;
+}
+// --------------------------------------------------------------------------
+bool LogDBStorage::init()
+{
+    if( fts && !checkFTS(db) )
+        fts = false;
+
+    const std::string q = "CREATE TABLE IF NOT EXISTS partitions("
+                          " id INTEGER PRIMARY KEY,"
+                          " tname TEXT NOT NULL,"
+                          " fts INTEGER NOT NULL DEFAULT 0"
+                          ");"
+                          "CREATE TABLE IF NOT EXISTS counters("
+                          " part INTEGER NOT NULL,"
+                          " name TEXT NOT NULL,"
+                          " num INTEGER NOT NULL DEFAULT 0,"
+                          " PRIMARY KEY(part,name)"
+                          ");";
+
+    if( !db->exec(q) )
+        return false;
+
+    // прежняя схема (без партиций)
+    DBResult ret = db->query("SELECT type FROM sqlite_master WHERE name='logs';");
+
+    if( ret && ret.begin().as_string(0) == "table" )
+    {
+        if( !adoptOldTable() )
+            return false;
+    }
+
+    cntInit = db->prepare("INSERT OR IGNORE INTO counters(part,name,num) VALUES(?,?,0);");
+    cntUpdate = db->prepare("UPDATE counters SET num=num+? WHERE part=? AND name=?;");
+
+    if( !cntInit || !cntUpdate )
+        return false;
+
+    return updateView();
+}
+// --------------------------------------------------------------------------
+bool LogDBStorage::adoptOldTable()
+{
+    ostringstream q;
+    q << "BEGIN;"
+      << "ALTER TABLE logs RENAME TO logs_0;"
+      << "CREATE INDEX IF NOT EXISTS logs_0_name_tms ON logs_0(name,tms);";
+
+    if( fts )
+    {
+        q << "CREATE VIRTUAL TABLE IF NOT EXISTS logs_0_fts USING fts5(text, content='logs_0', content_rowid='id');"
+          << "INSERT INTO logs_0_fts(logs_0_fts) VALUES('rebuild');"
+          << "CREATE TRIGGER IF NOT EXISTS logs_0_ai AFTER INSERT ON logs_0 BEGIN"
+          << " INSERT INTO logs_0_fts(rowid,text) VALUES(new.id,new.text); END;"
+          << "CREATE TRIGGER IF NOT EXISTS logs_0_ad AFTER DELETE ON logs_0 BEGIN"
+          << " INSERT INTO logs_0_fts(logs_0_fts,rowid,text) VALUES('delete',old.id,old.text); END;";
+    }
+
+    q << "INSERT OR IGNORE INTO partitions(id,tname,fts) VALUES(0,'logs_0'," << (fts ? 1 : 0) << ");"
+      << "DELETE FROM counters WHERE part=0;"
+      << "INSERT INTO counters(part,name,num) SELECT 0,name,count(*) FROM logs_0 GROUP BY name;"
+      << "COMMIT;";
+
+    if( !db->exec(q.str()) )
+    {
+        db->exec("ROLLBACK;");
+        return false;
+    }
+
+    viewChanged = true;
+    return true;
+}
+// --------------------------------------------------------------------------
+bool LogDBStorage::createPartition( long long id )
+{
+    const std::string tname = "logs_" + std::to_string(id);
+
+    ostringstream q;
+    q << "CREATE TABLE IF NOT EXISTS " << tname << "("
+      << " id INTEGER PRIMARY KEY,"
+      << " tms timestamp,"
+      << " usec INTEGER NOT NULL,"
+      << " name TEXT NOT NULL,"
+      << " text TEXT"
+      << ");"
+      << "CREATE INDEX IF NOT EXISTS " << tname << "_name_tms ON " << tname << "(name,tms);";
+
+    if( fts )
+    {
+        q << "CREATE VIRTUAL TABLE IF NOT EXISTS " << tname << "_fts USING fts5(text, content='" << tname << "', content_rowid='id');"
+          << "CREATE TRIGGER IF NOT EXISTS " << tname << "_ai AFTER INSERT ON " << tname << " BEGIN"
+          << " INSERT INTO " << tname << "_fts(rowid,text) VALUES(new.id,new.text); END;"
+          << "CREATE TRIGGER IF NOT EXISTS " << tname << "_ad AFTER DELETE ON " << tname << " BEGIN"
+          << " INSERT INTO " << tname << "_fts(" << tname << "_fts,rowid,text) VALUES('delete',old.id,old.text); END;";
+    }
+
+    q << "INSERT OR IGNORE INTO partitions(id,tname,fts) VALUES(" << id << ",'" << tname << "'," << (fts ? 1 : 0) << ");";
+
+    if( !db->exec(q.str()) )
+        return false;
+
+    auto st = db->prepare("INSERT INTO " + tname + "(tms,usec,name,text) VALUES(datetime(?,'unixepoch'),?,?,?);");
+
+    if( !st )
+        return false;
+
+    insStmt[id] = std::move(st);
+    viewChanged = true;
+    return true;
+}
+// --------------------------------------------------------------------------
+bool LogDBStorage::updateView()
+{
+    auto parts = getPartitions(db);
+
+    ostringstream q;
+    q << "DROP VIEW IF EXISTS logs;";
+
+    if( !parts.empty() )
+    {
+        q << "CREATE VIEW logs AS ";
+
+        for( size_t i = 0; i < parts.size(); i++ )
+        {
+            if( i > 0 )
+                q << " UNION ALL ";
+
+            q << "SELECT id,tms,usec,name,text FROM " << parts[i].tname;
+        }
+
+        q << ";";
+    }
+
+    if( !db->exec(q.str()) )
+        return false;
+
+    viewChanged = false;
+    return true;
+}
+// --------------------------------------------------------------------------
+bool LogDBStorage::begin()
+{
+    return db->exec("BEGIN;");
+}
+// --------------------------------------------------------------------------
+bool LogDBStorage::add( time_t sec, long nsec, const std::string& name, const std::string& text )
+{
+    const long long part = (long long)sec - ( (long long)sec % partitionSec );
+
+    if( part != curPart || !curStmt )
+    {
+        auto it = insStmt.find(part);
+
+        if( it == insStmt.end() )
+        {
+            if( !createPartition(part) )
+                return false;
+
+            it = insStmt.find(part);
+        }
+
+        curPart = part;
+        curStmt = it->second.get();
+    }
+
+    curStmt->bind(1, (long long)sec);
+    curStmt->bind(2, (long long)nsec);
+    curStmt->bind(3, name);
+    curStmt->bind(4, text);
+
+    if( !curStmt->exec() )
+        return false;
+
+    // счётчики обновляем один раз при commit
+    if( lastCount == counts.end() || lastCount->first.first != part || lastCount->first.second != name )
+        lastCount = counts.emplace(CountKey(part, name), 0).first;
+
+    lastCount->second++;
+    return true;
+}
+// --------------------------------------------------------------------------
+bool LogDBStorage::commit()
+{
+    bool ok = true;
+
+    for( const auto& c : counts )
+    {
+        cntInit->bind(1, c.first.first);
+        cntInit->bind(2, c.first.second);
+        cntUpdate->bind(1, (long long)c.second);
+        cntUpdate->bind(2, c.first.first);
+        cntUpdate->bind(3, c.first.second);
+
+        if( !cntInit->exec() || !cntUpdate->exec() )
+            ok = false;
+    }
+
+    counts.clear();
+    lastCount = counts.end();
+
+    if( viewChanged && !updateView() )
+        ok = false;
+
+    if( !db->exec("COMMIT;") )
+        return false;
+
+    return ok;
+}
+// --------------------------------------------------------------------------
+bool LogDBStorage::dropPartition( const Partition& p )
+{
+    // подготовленные запросы надо удалить до удаления таблицы
+    insStmt.erase(p.id);
+
+    if( curPart == p.id )
+    {
+        curPart = -1;
+        curStmt = nullptr;
+    }
+
+    ostringstream q;
+    q << "BEGIN;"
+      << "DROP VIEW IF EXISTS logs;"
+      << "DROP TABLE IF EXISTS " << p.tname << "_fts;"
+      << "DROP TABLE IF EXISTS " << p.tname << ";"
+      << "DELETE FROM counters WHERE part=" << p.id << ";"
+      << "DELETE FROM partitions WHERE id=" << p.id << ";";
+
+    if( !db->exec(q.str()) )
+    {
+        db->exec("ROLLBACK;");
+        return false;
+    }
+
+    viewChanged = true;
+    return commit();
+}
+// --------------------------------------------------------------------------
+bool LogDBStorage::cutPartition( const Partition& p, size_t maxRecords )
+{
+    ostringstream q;
+    q << "BEGIN;"
+      << "DELETE FROM " << p.tname << " WHERE id <= (SELECT id FROM " << p.tname
+      << " ORDER BY id DESC LIMIT " << maxRecords << ",1);"
+      << "DELETE FROM counters WHERE part=" << p.id << ";"
+      << "INSERT INTO counters(part,name,num) SELECT " << p.id << ",name,count(*) FROM " << p.tname << " GROUP BY name;"
+      << "COMMIT;";
+
+    if( !db->exec(q.str()) )
+    {
+        db->exec("ROLLBACK;");
+        return false;
+    }
+
+    return true;
+}
+// --------------------------------------------------------------------------
+size_t LogDBStorage::rotate( size_t maxRecords, size_t overflow )
+{
+    if( maxRecords == 0 )
+        return 0;
+
+    const size_t total = getCount(db);
+
+    if( total <= overflow )
+        return 0;
+
+    auto parts = getPartitions(db);
+    size_t removed = 0;
+
+    for( size_t i = 0; i + 1 < parts.size() && removed < total && total - removed > maxRecords; i++ )
+    {
+        DBResult ret = db->query("SELECT SUM(num) FROM counters WHERE part=" + std::to_string(parts[i].id) + ";");
+        const size_t num = ret ? std::strtoull(ret.begin().as_string(0).c_str(), nullptr, 10) : 0;
+
+        if( !dropPartition(parts[i]) )
+            return removed;
+
+        removed += num;
+    }
+
+    // осталась только текущая партиция, но записей всё равно слишком много
+    // (период партиции слишком большой для заданного ограничения)
+    if( removed < total && total - removed > overflow && !parts.empty() )
+    {
+        if( cutPartition(parts.back(), maxRecords) )
+            removed = total - getCount(db);
+    }
+
+    return removed;
+}
+// --------------------------------------------------------------------------
+std::vector<LogDBStorage::Partition> LogDBStorage::getPartitions( SQLiteInterface* db )
+{
+    std::vector<Partition> ret;
+
+    DBResult r = db->query("SELECT id,tname,fts FROM partitions ORDER BY id;");
+
+    if( !r )
+        return ret;
+
+    for( auto it = r.begin(); it != r.end(); ++it )
+    {
+        Partition p;
+        p.id = std::strtoll(it.as_string(0).c_str(), nullptr, 10);
+        p.tname = it.as_string(1);
+        p.fts = it.as_int(2);
+        ret.push_back(p);
+    }
+
+    return ret;
+}
+// --------------------------------------------------------------------------
+size_t LogDBStorage::getCount( SQLiteInterface* db, const std::string& name )
+{
+    ostringstream q;
+
+    q << "SELECT SUM(num) FROM counters";
+
+    if( !name.empty() )
+        q << " WHERE name='" << qEscape(name) << "'";
+
+    DBResult ret = db->query(q.str());
+
+    if( !ret )
+        return 0;
+
+    return std::strtoull(ret.begin().as_string(0).c_str(), nullptr, 10);
+}
+// --------------------------------------------------------------------------
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// --------------------------------------------------------------------------
+/*! \file
+ *  \author Pavel Vainerman
+*/
+// --------------------------------------------------------------------------
+#ifndef LogDBStorage_H_
+#define LogDBStorage_H_
+// --------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <ctime>
+#include "SQLiteInterface.h"
+// -------------------------------------------------------------------------
+namespace uniset
+{
+    /*! \class LogDBStorage
+     * Хранение логов в БД (sqlite) с разбиением на таблицы по времени ("партиции").
+     *
+     * Каждая партиция - это отдельная таблица logs_N (N - время начала партиции, сек),
+     * с индексом (name,tms) и (если sqlite собрана с поддержкой FTS5) полнотекстовым индексом logs_N_fts.
+     * Полнотекстовый индекс заполняется триггером при вставке записи.
+     *
+     * Список партиций хранится в таблице \b partitions, количество записей (по партициям и логам)
+     * хранится в таблице \b counters и обновляется в той же транзакции, что и вставка записей.
+     * Поэтому для получения количества записей не требуется "SELECT count(*)".
+     *
+     * Для совместимости поддерживается представление (view) \b logs объединяющее все партиции.
+     * Таблица logs от прежней схемы (без партиций) при init() переименовывается в партицию logs_0.
+     *
+     * Ротация - это удаление самых старых партиций целиком (DROP TABLE), без DELETE и VACUUM.
+     *
+     * Запись ведётся через один объект (соединение), функции для чтения (getCount, getPartitions)
+     * можно использовать с любым соединением.
+     */
+    class LogDBStorage
+    {
+        public:
+            LogDBStorage( SQLiteInterface* db, time_t partitionSec = 24 * 60 * 60, bool fts = true );
+            ~LogDBStorage();
+
+            /*! создание служебных таблиц и перевод прежней схемы
+             * \return false в случае ошибки (см. error())
+             */
+            bool init();
+
+            bool begin();
+            bool add( time_t sec, long nsec, const std::string& name, const std::string& text );
+            bool commit();
+
+            /*! Если записей больше чем overflow, то удаляются самые старые партиции
+             * (пока записей больше чем maxRecords). Текущая партиция не удаляется,
+             * если переполнение в ней, то из неё удаляются старые записи.
+             * \return количество удалённых записей
+             */
+            size_t rotate( size_t maxRecords, size_t overflow );
+
+            std::string error();
+
+            inline bool isFTS() const noexcept
+            {
+                return fts;
+            }
+
+            inline time_t getPartitionTime() const noexcept
+            {
+                return partitionSec;
+            }
+
+            struct Partition
+            {
+                long long id = { 0 }; // время начала партиции (сек)
+                std::string tname;
+                bool fts = { false }; // есть полнотекстовый индекс (tname_fts)
+            };
+
+            static std::vector<Partition> getPartitions( SQLiteInterface* db );
+            static size_t getCount( SQLiteInterface* db, const std::string& name = "" );
+
+            /*! проверка поддержки FTS5 */
+            static bool checkFTS( SQLiteInterface* db );
+
+        protected:
+            bool createPartition( long long id );
+            bool dropPartition( const Partition& p );
+            bool updateView();
+            bool adoptOldTable();
+            bool cutPartition( const Partition& p, size_t maxRecords );
+
+        private:
+            SQLiteInterface* db;
+            time_t partitionSec;
+            bool fts;
+
+            typedef std::unique_ptr<SQLiteInterface::Statement> StatementPtr;
+            std::map<long long, StatementPtr> insStmt; // вставка (по партициям)
+            long long curPart = { -1 };
+            SQLiteInterface::Statement* curStmt = { nullptr };
+            bool viewChanged = { false };
+
+            StatementPtr cntInit;
+            StatementPtr cntUpdate;
+
+            // количество добавленных в текущей транзакции записей
+            typedef std::pair<long long, std::string> CountKey;
+            std::map<CountKey, size_t> counts;
+            std::map<CountKey, size_t>::iterator lastCount;
+    };
+    // ----------------------------------------------------------------------------------
+} // end of namespace uniset
+//------------------------------------------------------------------------------------------
+#endif
@@ -2,18 +2,29 @@
 #include <vector>
 #include <fstream>
 #include <regex>
+#include <ctime>
 #include "SQLiteInterface.h"
+#include "LogDBStorage.h"
 // --------------------------------------------------------------------------
 using namespace uniset;
 using namespace std;
 // --------------------------------------------------------------------------
 typedef std::pair<std::string, std::string> LogInfo;
 const size_t maxRead = 5000; // сколько читать прежде чем записать в БД
-static std::vector<std::string> qbuf;
+
+struct LogLine
+{
+    time_t tms;
+    std::string text;
+
+    LogLine( time_t t, const std::string& s ): tms(t), text(s) {}
+};
+
+static std::vector<LogLine> qbuf;
 // --------------------------------------------------------------------------
-void saveToDB( SQLiteInterface* db );
-void parseLine( SQLiteInterface* db, const LogInfo& loginfo, const std::string& line );
-void parseFile( SQLiteInterface* db, const LogInfo& loginfo );
+void saveToDB( LogDBStorage* db, const LogInfo& loginfo );
+void parseLine( LogDBStorage* db, const LogInfo& loginfo, const std::string& line );
+void parseFile( LogDBStorage* db, const LogInfo& loginfo );
 LogInfo makeLogInfo( const std::string& name );
 
 // --------------------------------------------------------------------------
@@ -51,11 +62,18 @@ int main(int argc, char** argv)
             return 1;
         }
 
+        LogDBStorage storage(&db);
+
+        if( !storage.init() )
+        {
+            cerr << "(logdb-conv): DB init error: " << storage.error() << endl;
+            return 1;
+        }
 
         qbuf.reserve(maxRead);
 
         for( const auto& f : files )
-            parseFile(&db, f);
+            parseFile(&storage, f);
 
         db.close();
         return 0;
@@ -103,7 +121,7 @@ LogInfo makeLogInfo( const std::string& name )
 
 // --------------------------------------------------------------------------
 
-void parseLine( SQLiteInterface* db, const LogInfo& loginfo, const std::string& line )
+void parseLine( LogDBStorage* db, const LogInfo& loginfo, const std::string& line )
 {
     // 28/07/2017 10:55:19(  info):  text...text...more text
 
@@ -128,20 +146,23 @@ void parseLine( SQLiteInterface* db, const LogInfo& loginfo, const std::string&
         return;
     }
 
-    ostringstream q;
-    q << "INSERT INTO logs(tms,usec,name,text) VALUES("
-      << "CAST( strftime('%s','" << match[3] << "-" << match[2] << "-" << match[1] << " " << match[4] << "') AS INT)"
-      << ",0,'"  //  usec
-      << loginfo.first << "','" // name
-      << line << "');"; // text
+    const std::string tms = match[3].str() + "-" + match[2].str() + "-" + match[1].str() + " " + match[4].str();
 
-    qbuf.push_back(q.str());
+    struct tm t = {};
+
+    if( !strptime(tms.c_str(), "%Y-%m-%d %H:%M:%S", &t) )
+    {
+        cerr << "error: parse date: " << line << endl;
+        return;
+    }
+
+    qbuf.emplace_back(timegm(&t), line);
 
     if( qbuf.size() >= maxRead )
-        saveToDB(db);
+        saveToDB(db, loginfo);
 }
 // --------------------------------------------------------------------------
-void parseFile( SQLiteInterface* db, const LogInfo& loginfo )
+void parseFile( LogDBStorage* db, const LogInfo& loginfo )
 {
     ifstream f(loginfo.second);
 
@@ -160,25 +181,26 @@ void parseFile( SQLiteInterface* db, const LogInfo& loginfo )
 
     f.close();
 
-    saveToDB(db);
+    saveToDB(db, loginfo);
 }
 // --------------------------------------------------------------------------
-void saveToDB( SQLiteInterface* db )
+void saveToDB( LogDBStorage* db, const LogInfo& loginfo )
 {
-    db->query("BEGIN;");
+    if( qbuf.empty() )
+        return;
 
-    for( const auto& q : qbuf )
+    db->begin();
+
+    for( const auto& l : qbuf )
     {
-        if( !db->insert(q) )
+        if( !db->add(l.tms, 0, loginfo.first, l.text) )
         {
             cerr << "(saveToDB): error: " << db->error()
-                 << " lost log: " << q << endl;
+                 << " lost log: " << l.text << endl;
         }
     }
 
-    db->query("COMMIT;");
-
-    if( !db->lastQueryOK() )
+    if( !db->commit() )
         cerr << "(saveToDB): error: " << db->error() << endl;
 
     qbuf.clear();
@@ -78,6 +78,37 @@ function logdb_test_http_count()
 	return 1
 }
 
+function logdb_test_http_search()
+{
+	REQ=$( curl -s --request GET "http://$http_host:$http_port/api/v01/logdb/logs?logserver1&search=Test%20message&limit=10" )
+	echo $REQ | grep -q 'Test message' && return 0
+
+	logdb_error "test_http_search" "search 'Test message' must return records"
+	return 1
+}
+
+function logdb_test_http_cursor()
+{
+	REQ=$( curl -s --request GET "http://$http_host:$http_port/api/v01/logdb/logs?logserver1&cursor=&limit=1" )
+	echo $REQ | grep -q '"next"' || { logdb_error "test_http_cursor" "response must contain 'next'"; return 1; }
+
+	NEXT=$( echo $REQ | sed -e 's/.*"next":"\([0-9:]*\)".*/\1/' )
+	REQ=$( curl -s --request GET "http://$http_host:$http_port/api/v01/logdb/logs?logserver1&cursor=$NEXT&limit=1" )
+	echo $REQ | grep -q '"cursor"' && return 0
+
+	logdb_error "test_http_cursor" "read after cursor '$NEXT' must return records"
+	return 1
+}
+
+function logdb_test_http_ndjson()
+{
+	NUM=$( curl -s --request GET "http://$http_host:$http_port/api/v01/logdb/logs?logserver1&format=ndjson&limit=3" | grep -c '"text"' )
+	[ "$NUM" = "3" ] && return 0
+
+	logdb_error "test_http_ndjson" "ndjson must return 3 lines (one record per line). Got: $NUM"
+	return 1
+}
+
 function logdb_test_http_list()
 {
 	REQ=$( curl -s --request GET "http://$http_host:$http_port/api/v01/logdb/list" )
@@ -109,6 +140,9 @@ function logdb_run_all_tests()
    # =========== ТЕСТЫ ============
    logdb_test_count || RET=1
    logdb_test_http_count || RET=1
+   logdb_test_http_search || RET=1
+   logdb_test_http_cursor || RET=1
+   logdb_test_http_ndjson || RET=1
    logdb_test_http_list || RET=1
    logdb_test_logfile || RET 1
    
@@ -15,13 +15,49 @@
  */
 // -------------------------------------------------------------------------
 #include <sstream>
+#include <charconv>
+#include <algorithm>
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <string_view>
 #include "Exceptions.h"
+#include "unisetstd.h"
 #include "MQTTPublisher.h"
 // -----------------------------------------------------------------------------
 using namespace std;
 using namespace uniset;
 using namespace uniset::extensions;
 // -----------------------------------------------------------------------------
+static void appendNum( std::string& s, long v )
+{
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    s.append(buf, r.ptr - buf);
+}
+// -----------------------------------------------------------------------------
+static std::string jsonEscape( const std::string& s )
+{
+    std::string r;
+    r.reserve(s.size());
+
+    for( const auto& c : s )
+    {
+        if( c == '"' || c == '\\' )
+            r += '\\';
+
+        r += c;
+    }
+
+    return r;
+}
+// -----------------------------------------------------------------------------
+static int checkQoS( int qos )
+{
+    return std::max(0, std::min(qos, 2));
+}
+// -----------------------------------------------------------------------------
 MQTTPublisher::MQTTPublisher(uniset::ObjectId objId, xmlNode* cnode, uniset::ObjectId shmId, const std::shared_ptr<SharedMemory>& ic,
                              const string& prefix ):
     mosquittopp(NULL),
@@ -55,6 +91,28 @@ MQTTPublisher::MQTTPublisher(uniset::ObjectId objId, xmlNode* cnode, uniset::Obj
 
     myinfo << myname << "(init): filter-field=" << ff << " filter-value=" << fv << endl;
 
+    int defQos = checkQoS(conf->getArgPInt("--" + argprefix + "mqtt-qos", it.getProp("mqttQoS"), 1));
+    coalesceTime = conf->getArgPInt("--" + argprefix + "mqtt-coalesce-time", it.getProp("coalesceTime"), 0);
+
+    bulkTopic = conf->getArg2Param("--" + argprefix + "mqtt-bulk-topic", it.getProp("bulkTopic"), "");
+    bulkQos = checkQoS(conf->getArgPInt("--" + argprefix + "mqtt-bulk-qos", it.getProp("bulkQoS"), defQos));
+    bulkMax = conf->getArgPInt("--" + argprefix + "mqtt-bulk-max", it.getProp("bulkMax"), bulkMax);
+    bulkOnly = conf->getArgPInt("--" + argprefix + "mqtt-bulk-only", it.getProp("bulkOnly"), 0);
+
+    if( bulkMax == 0 )
+        bulkMax = 1;
+
+    if( bulkTopic.empty() )
+        bulkOnly = false;
+    else if( coalesceTime == 0 )
+        coalesceTime = 200;
+
+    myinfo << myname << "(init): qos=" << defQos
+           << " coalesceTime=" << coalesceTime
+           << " bulkTopic='" << bulkTopic << "'"
+           << " bulkOnly=" << bulkOnly
+           << endl;
+
     xmlNode* senssec = conf->getXMLSensorsSection();
 
     if( !senssec )
@@ -97,6 +155,9 @@ MQTTPublisher::MQTTPublisher(uniset::ObjectId objId, xmlNode* cnode, uniset::Obj
         pubname << topic << "/" << sname;
 
         MQTTInfo m(sid, pubname.str());
+        m.qos = checkQoS(sit.getPIntProp("mqtt_qos", defQos));
+        m.coalesce = ( coalesceTime > 0 && sit.getPIntProp("mqtt_coalesce", 1) );
+        m.bulkHead = "{\"id\":" + std::to_string(sid) + ",\"name\":\"" + jsonEscape(sname) + "\",\"value\":";
         publist.emplace(sid, std::move(m) );
 
         if( smTestID == DefaultObjectId )
@@ -110,18 +171,22 @@ MQTTPublisher::MQTTPublisher(uniset::ObjectId objId, xmlNode* cnode, uniset::Obj
         if( !i.find("mqtt") )
             continue;
 
-        MQTTTextInfo mi(topic, sit, i);
+        MQTTTextInfo mi(topic, sit, i, defQos);
         textpublist.emplace(sid, std::move(mi) );
     }
 
-    if( publist.empty() )
+    initSubscribe(it, senssec);
+
+    if( publist.empty() && subtrie.size() == 0 )
     {
         ostringstream err;
-        err << myname << "(init): FAIL! Empty publish list...";
+        err << myname << "(init): FAIL! Empty publish (and subscribe) list...";
         mycrit << err.str() << endl;
         throw SystemError(err.str());
     }
 
+    dirtyList.reserve(publist.size());
+
     // Работа с MQTT
     mosqpp::lib_init();
     host = conf->getArg2Param("--" + argprefix + "mqtt-host", it.getProp("mqttHost"), "localhost");
@@ -135,6 +200,7 @@ MQTTPublisher::MQTTPublisher(uniset::ObjectId objId, xmlNode* cnode, uniset::Obj
 // -----------------------------------------------------------------------------
 MQTTPublisher::~MQTTPublisher()
 {
+    stopIngest();
     loop_stop();            // Kill the thread
     mosqpp::lib_cleanup();  // Mosquitto library cleanup
 }
@@ -144,6 +210,7 @@ bool MQTTPublisher::deactivateObject()
     myinfo << myname << "(deactivateObject): ...disconnect.." << endl;
     disconnect();
     connectOK = false;
+    stopIngest();
     return UObject_SK::deactivateObject();
 }
 //--------------------------------------------------------------------------------
@@ -158,9 +225,26 @@ void MQTTPublisher::sysCommand(const SystemMessage* sm)
             connect_async(host.c_str(), port, keepalive);
             loop_start();
         }
+
+        if( subtrie.size() > 0 )
+            startIngest();
+
+        if( coalesceTime > 0 )
+            askTimer(tmPublish, coalesceTime);
+    }
+    else if( sm->command == SystemMessage::Finish || sm->command == SystemMessage::FoldUp )
+    {
+        // публикуем накопленное
+        flushChanges();
     }
 }
 //--------------------------------------------------------------------------------
+void MQTTPublisher::timerInfo( const uniset::TimerMessage* tm )
+{
+    if( tm->id == tmPublish )
+        flushChanges();
+}
+//--------------------------------------------------------------------------------
 void MQTTPublisher::help_print( int argc, const char* const* argv )
 {
     cout << " Default prefix='mqtt'" << endl;
@@ -176,6 +260,22 @@ void MQTTPublisher::help_print( int argc, const char* const* argv )
     cout << "--prefix-mqtt-host host           - host(ip) MQTT Broker (server). Default: localhost" << endl;
     cout << "--prefix-mqtt-port port           - port for MQTT Broker (server). Default: 1883" << endl;
     cout << "--prefix-mqtt-keepalive val       - keepalive for connection to MQTT Broker (server). Default: 60" << endl;
+    cout << "--prefix-mqtt-qos [0,1,2]         - QoS for publish. Default: 1" << endl;
+    cout << "--prefix-mqtt-coalesce-time msec  - Publish only last change per topic in this window. Default: 0 (publish every change)" << endl;
+    cout << "--prefix-mqtt-bulk-topic name     - Topic for JSON message with all changes per window. Default: '' (disabled)" << endl;
+    cout << "--prefix-mqtt-bulk-qos [0,1,2]    - QoS for bulk topic. Default: --prefix-mqtt-qos" << endl;
+    cout << "--prefix-mqtt-bulk-max num        - Max sensors in one bulk message. Default: 1000" << endl;
+    cout << "--prefix-mqtt-bulk-only [0,1]     - Publish only to bulk topic. Default: 0" << endl;
+    cout << endl;
+    cout << " MQTT -> SM: " << endl;
+    cout << "--prefix-mqtt-sub-pattern 'p1,p2..'  - Topic patterns with sensor name level (%n). Example: 'plant/%n/value'" << endl;
+    cout << "--prefix-mqtt-sub-filter-field name  - Filter for sensors used with %n patterns. Default: all sensors" << endl;
+    cout << "--prefix-mqtt-sub-filter-value val   - Filter value for sensors used with %n patterns." << endl;
+    cout << "--prefix-mqtt-sub-topics 't1,t2..'   - Topics for subscribe. Default: all patterns (and mqtt_subscribe topics)" << endl;
+    cout << "--prefix-mqtt-sub-qos [0,1,2]        - QoS for subscribe. Default: 0" << endl;
+    cout << "--prefix-mqtt-sub-flush-time msec    - Period for saving received values to SM. Default: 50" << endl;
+    cout << "--prefix-mqtt-sub-batch num          - Save to SM when this number of values received. Default: 1000" << endl;
+    cout << "--prefix-mqtt-sub-cache-max num      - Max number of topics remembered for fast lookup. Default: 100000" << endl;
     cout << endl;
     cout << " Logs: " << endl;
     cout << "--prefix-log-...            - log control" << endl;
@@ -197,8 +297,20 @@ void MQTTPublisher::on_connect(int rc)
     myinfo << myname << "(on_connect): connect to " << host << ":" <<  port << " " << ( connectOK ? "OK" : "FAIL" ) << endl;
 
     if( connectOK )
+    {
         askSensors(UniversalIO::UIONotify);
 
+        for( const auto& t : subTopics )
+        {
+            int ret = subscribe(NULL, t.c_str(), subQos);
+
+            if( ret != MOSQ_ERR_SUCCESS )
+                mycrit << myname << "(on_connect): SUBSCRIBE '" << t << "' FAILED: err(" << ret << "): " << mosqpp::strerror(ret) << endl;
+            else
+                myinfo << myname << "(on_connect): subscribe '" << t << "' qos=" << subQos << endl;
+        }
+    }
+
     //  else
     //  {
     //      askTimer(reconnectTimer,reconnectTime);
@@ -207,7 +319,312 @@ void MQTTPublisher::on_connect(int rc)
 // -----------------------------------------------------------------------------
 void MQTTPublisher::on_message( const mosquitto_message* message )
 {
+    // вызывается в потоке mosquitto
+    if( !message || !message->topic )
+        return;
+
+    statRecv++;
+
+    auto inf = subtrie.find(message->topic);
+
+    if( !inf )
+    {
+        statUnknown++;
+        return;
+    }
+
+    long value = 0;
+
+    if( !parseValue((const char*)message->payload, message->payloadlen, inf->precision, value) )
+    {
+        statParseErrors++;
+        myinfo << myname << "(on_message): bad value in topic '" << message->topic << "'" << endl;
+        return;
+    }
+
+    size_t sz = 0;
+
+    {
+        std::lock_guard<std::mutex> lk(ingMutex);
+        auto i = ingIndex.find(inf->sid);
+
+        if( i != ingIndex.end() )
+        {
+            // ещё не записано в SM, оставляем только последнее значение
+            ingbuf[i->second].value = value;
+            statIngCoalesced++;
+            return;
+        }
+
+        ingIndex.emplace(inf->sid, ingbuf.size());
+        ingbuf.push_back({inf->sid, value, std::chrono::steady_clock::now()});
+        sz = ingbuf.size();
+    }
+
+    if( sz >= subBatch )
+        ingCond.notify_one();
+}
+// -----------------------------------------------------------------------------
+bool MQTTPublisher::parseValue( const char* data, size_t len, int precision, long& value )
+{
+    if( !data )
+        return false;
+
+    while( len > 0 && std::isspace((unsigned char)data[0]) )
+    {
+        data++;
+        len--;
+    }
+
+    while( len > 0 && std::isspace((unsigned char)data[len - 1]) )
+        len--;
+
+    if( len == 0 || len >= 64 )
+        return false;
+
+    if( precision == 0 )
+    {
+        auto r = std::from_chars(data, data + len, value);
+
+        if( r.ec == std::errc() && r.ptr == data + len )
+            return true;
+    }
+
+    const std::string_view v(data, len);
+
+    if( v == "true" || v == "on" )
+    {
+        value = 1;
+        return true;
+    }
+
+    if( v == "false" || v == "off" )
+    {
+        value = 0;
+        return true;
+    }
+
+    char buf[64];
+    memcpy(buf, data, len);
+    buf[len] = '\0';
+
+    char* end = nullptr;
+    double d = strtod(buf, &end);
+
+    if( end != buf + len || !std::isfinite(d) )
+        return false;
+
+    if( precision != 0 )
+        d *= std::pow(10.0, precision);
+
+    if( d >= (double)std::numeric_limits<long>::max() || d <= (double)std::numeric_limits<long>::min() )
+        return false;
+
+    value = std::lround(d);
+    return true;
+}
+// -----------------------------------------------------------------------------
+void MQTTPublisher::initSubscribe( UniXML::iterator& it, xmlNode* senssec )
+{
+    auto conf = uniset_conf();
+
+    subQos = checkQoS(conf->getArgPInt("--" + argprefix + "mqtt-sub-qos", it.getProp("subQoS"), subQos));
+    subFlushTime = conf->getArgPInt("--" + argprefix + "mqtt-sub-flush-time", it.getProp("subFlushTime"), subFlushTime);
+    subBatch = conf->getArgPInt("--" + argprefix + "mqtt-sub-batch", it.getProp("subBatch"), subBatch);
+    subtrie.setCacheMax( conf->getArgPInt("--" + argprefix + "mqtt-sub-cache-max", it.getProp("subCacheMax"), 100000) );
+
+    if( subFlushTime <= 0 )
+        subFlushTime = 50;
+
+    if( subBatch == 0 )
+        subBatch = 1;
+
+    const auto patterns = uniset::explode_str(conf->getArg2Param("--" + argprefix + "mqtt-sub-pattern", it.getProp("subPatterns"), ""), ',');
+    const string ff = conf->getArg2Param("--" + argprefix + "mqtt-sub-filter-field", it.getProp("subFilterField"), "");
+    const string fv = conf->getArg2Param("--" + argprefix + "mqtt-sub-filter-value", it.getProp("subFilterValue"), "");
+
+    try
+    {
+        for( const auto& p : patterns )
+            subtrie.addNamePattern(p);
 
+        UniXML::iterator sit(senssec);
+
+        if( !sit.goChildren() )
+            return;
+
+        for( ; sit.getCurrent(); sit++ )
+        {
+            const string stopic = sit.getProp("mqtt_subscribe");
+            const bool byName = !patterns.empty() && uniset::check_filter(sit, ff, fv);
+
+            if( stopic.empty() && !byName )
+                continue;
+
+            const string sname = sit.getProp("name");
+            ObjectId sid = conf->getSensorID(sname);
+
+            if( sid == DefaultObjectId )
+            {
+                ostringstream err;
+                err << myname << "(initSubscribe): Unknown ID for sensor '" << sname << "'";
+                mycrit << err.str() << endl;
+                throw SystemError(err.str());
+            }
+
+            MQTTTopicTrie::Item inf(sid, sit.getIntProp("mqtt_precision"));
+
+            if( !stopic.empty() )
+                subtrie.add(stopic, inf);
+
+            if( byName )
+                subtrie.addName(sname, inf);
+
+            if( smTestID == DefaultObjectId )
+                smTestID = sid;
+        }
+    }
+    catch( const uniset::Exception& ex )
+    {
+        ostringstream err;
+        err << myname << "(initSubscribe): " << ex;
+        mycrit << err.str() << endl;
+        throw SystemError(err.str());
+    }
+
+    if( subtrie.size() == 0 )
+        return;
+
+    subTopics = uniset::explode_str(conf->getArg2Param("--" + argprefix + "mqtt-sub-topics", it.getProp("subTopics"), ""), ',');
+
+    if( subTopics.empty() )
+        subTopics = subtrie.getSubscriptions();
+
+    ingbuf.reserve(subBatch);
+
+    myinfo << myname << "(initSubscribe): patterns=" << subtrie.size()
+           << " topics=" << subTopics.size()
+           << " qos=" << subQos
+           << " flushTime=" << subFlushTime
+           << " batch=" << subBatch
+           << endl;
+}
+// -----------------------------------------------------------------------------
+void MQTTPublisher::startIngest()
+{
+    if( ingest )
+        return;
+
+    ingestActive = true;
+    ingest = unisetstd::make_unique< ThreadCreator<MQTTPublisher> >(this, &MQTTPublisher::ingestThread);
+    ingest->start();
+}
+// -----------------------------------------------------------------------------
+void MQTTPublisher::stopIngest()
+{
+    if( !ingest )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(ingMutex);
+        ingestActive = false;
+    }
+
+    ingCond.notify_all();
+
+    if( ingest->isRunning() )
+        ingest->join();
+
+    ingest = nullptr;
+}
+// -----------------------------------------------------------------------------
+void MQTTPublisher::ingestThread()
+{
+    myinfo << myname << "(ingestThread): run.." << endl;
+
+    std::vector<IngestItem> buf;
+    buf.reserve(subBatch);
+
+    IOController_i::OutSeq seq;
+
+    auto tRate = std::chrono::steady_clock::now();
+    size_t lastRecv = statRecv;
+
+    while( ingestActive )
+    {
+        {
+            std::unique_lock<std::mutex> lk(ingMutex);
+            ingCond.wait_for(lk, std::chrono::milliseconds(subFlushTime), [&]()
+            {
+                return !ingestActive || ingbuf.size() >= subBatch;
+            });
+
+            std::swap(buf, ingbuf);
+            ingIndex.clear();
+        }
+
+        if( !buf.empty() )
+            applyValues(buf, seq);
+
+        auto now = std::chrono::steady_clock::now();
+        auto msec = std::chrono::duration_cast<std::chrono::milliseconds>(now - tRate).count();
+
+        if( msec >= 1000 )
+        {
+            size_t recv = statRecv;
+            statRecvRate = (recv - lastRecv) * 1000 / msec;
+            lastRecv = recv;
+            tRate = now;
+        }
+    }
+
+    myinfo << myname << "(ingestThread): finished.." << endl;
+}
+// -----------------------------------------------------------------------------
+void MQTTPublisher::applyValues( std::vector<IngestItem>& buf, IOController_i::OutSeq& seq )
+{
+    const ObjectId node = uniset_conf()->getLocalNode();
+
+    seq.length(buf.size());
+
+    for( size_t i = 0; i < buf.size(); i++ )
+    {
+        seq[i].si.id = buf[i].sid;
+        seq[i].si.node = node;
+        seq[i].value = buf[i].value;
+    }
+
+    try
+    {
+        size_t bad = shm->setValueSeq(seq);
+        statApplied += buf.size() - bad;
+        statSetErrors += bad;
+
+        if( bad > 0 )
+            mywarn << myname << "(applyValues): failed to set " << bad << " sensors" << endl;
+    }
+    catch( const std::exception& ex )
+    {
+        statSetErrors += buf.size();
+        mycrit << myname << "(applyValues): " << ex.what() << endl;
+    }
+
+    // задержка от приёма сообщения до записи в SM
+    const auto now = std::chrono::steady_clock::now();
+    long lagMax = 0;
+    long lagSum = 0;
+
+    for( const auto& v : buf )
+    {
+        long lag = std::chrono::duration_cast<std::chrono::milliseconds>(now - v.t).count();
+        lagSum += lag;
+        lagMax = std::max(lagMax, lag);
+    }
+
+    statLagAvg = lagSum / (long)buf.size();
+    statLagMax = lagMax;
+
+    buf.clear();
 }
 // -----------------------------------------------------------------------------
 void MQTTPublisher::on_subscribe( int mid, int qos_count, const int* granted_qos )
@@ -274,29 +691,158 @@ void MQTTPublisher::sensorInfo( const uniset::SensorMessage* sm )
 
     if( i != publist.end() )
     {
-        ostringstream m;
-        m << sm->value;
-
-        string tmsg(m.str());
+        auto& inf = i->second;
 
-        //subscribe(NULL, i.second.pubname.c_str());
-        myinfo << "(sensorInfo): publish: topic='" << i->second.pubname << "' msg='" << tmsg.c_str() << "'" << endl;
-
-        int ret = publish(NULL, i->second.pubname.c_str(), tmsg.size(), tmsg.c_str(), 1, false);
+        if( inf.coalesce || bulkOnly )
+        {
+            // публикуем по таймеру (см. flushChanges)
+            if( inf.dirty )
+                statCoalesced++;
+            else
+            {
+                inf.dirty = true;
+                dirtyList.push_back(&inf);
+            }
 
-        if( ret != MOSQ_ERR_SUCCESS )
+            inf.value = sm->value;
+            inf.tv = sm->sm_tv;
+        }
+        else
         {
-            mycrit << myname << "(sensorInfo): PUBLISH FAILED: err(" << ret << "): " << mosqpp::strerror(ret) << endl;
+            publishValue(inf, sm->value);
+
+            if( !bulkTopic.empty() )
+            {
+                inf.value = sm->value;
+                inf.tv = sm->sm_tv;
+
+                if( !inf.dirty )
+                {
+                    inf.dirty = true;
+                    dirtyList.push_back(&inf);
+                }
+            }
         }
     }
 
     auto t = textpublist.find(sm->id);
 
     if( t != textpublist.end() )
-        t->second.check(this, sm->value, mylog, myname);
+        statPublished += t->second.check(this, sm->value, mylog, myname);
 }
 // -----------------------------------------------------------------------------
-MQTTPublisher::MQTTTextInfo::MQTTTextInfo( const string& rootsec, UniXML::iterator s, UniXML::iterator i ):
+bool MQTTPublisher::publishValue( MQTTInfo& inf, long value )
+{
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof(buf), value);
+    const int len = r.ptr - buf;
+
+    myinfo << "(sensorInfo): publish: topic='" << inf.pubname << "' msg='" << std::string(buf, len) << "'" << endl;
+
+    int ret = publish(NULL, inf.pubname.c_str(), len, buf, inf.qos, false);
+
+    if( ret != MOSQ_ERR_SUCCESS )
+    {
+        statFailed++;
+        mycrit << myname << "(sensorInfo): PUBLISH FAILED: err(" << ret << "): " << mosqpp::strerror(ret) << endl;
+        return false;
+    }
+
+    statPublished++;
+    return true;
+}
+// -----------------------------------------------------------------------------
+void MQTTPublisher::flushChanges()
+{
+    if( dirtyList.empty() )
+        return;
+
+    bulkMsg.clear();
+    size_t count = 0;
+
+    for( auto&& inf : dirtyList )
+    {
+        inf->dirty = false;
+
+        // изменения "без объединения" уже опубликованы в sensorInfo
+        if( !bulkOnly && inf->coalesce )
+            publishValue(*inf, inf->value);
+
+        if( bulkTopic.empty() )
+            continue;
+
+        bulkMsg += ( count == 0 ? "{\"sensors\":[" : "," );
+        bulkMsg += inf->bulkHead;
+        appendNum(bulkMsg, inf->value);
+        bulkMsg += ",\"time\":";
+        appendNum(bulkMsg, inf->tv.tv_sec);
+
+        char msec[5];
+        snprintf(msec, sizeof(msec), ".%03ld", (long)(inf->tv.tv_nsec / 1000000));
+        bulkMsg += msec;
+        bulkMsg += "}";
+
+        if( ++count >= bulkMax )
+        {
+            publishBulk(bulkMsg, count);
+            bulkMsg.clear();
+            count = 0;
+        }
+    }
+
+    dirtyList.clear();
+
+    if( count > 0 )
+        publishBulk(bulkMsg, count);
+}
+// -----------------------------------------------------------------------------
+void MQTTPublisher::publishBulk( std::string& msg, size_t count )
+{
+    msg += "]}";
+
+    myinfo << "(publishBulk): publish: topic='" << bulkTopic << "' sensors=" << count << " size=" << msg.size() << endl;
+
+    int ret = publish(NULL, bulkTopic.c_str(), msg.size(), msg.data(), bulkQos, false);
+
+    if( ret != MOSQ_ERR_SUCCESS )
+    {
+        statFailed++;
+        mycrit << myname << "(publishBulk): PUBLISH FAILED: err(" << ret << "): " << mosqpp::strerror(ret) << endl;
+        return;
+    }
+
+    statBulk++;
+}
+// -----------------------------------------------------------------------------
+std::string MQTTPublisher::getMonitInfo() const
+{
+    ostringstream inf;
+
+    inf << "MQTT: " << host << ":" << port << " " << ( connectOK ? "CONNECTED" : "NOT CONNECTED" ) << endl
+        << "   topic: " << topic << " sensors: " << publist.size() << " text: " << textpublist.size() << endl
+        << "   coalesceTime=" << coalesceTime
+        << " bulkTopic='" << bulkTopic << "' bulkOnly=" << bulkOnly << " bulkMax=" << bulkMax << endl
+        << "   published: " << statPublished << endl
+        << "   coalesced: " << statCoalesced << endl
+        << "   bulk messages: " << statBulk << endl
+        << "   failed: " << statFailed << endl;
+
+    if( subtrie.size() > 0 )
+    {
+        inf << "MQTT -> SM: patterns=" << subtrie.size() << " topics=" << subTopics.size()
+            << " qos=" << subQos << " flushTime=" << subFlushTime << " batch=" << subBatch << endl
+            << "   received: " << statRecv << " (" << statRecvRate << " msg/sec)" << endl
+            << "   applied: " << statApplied << " coalesced: " << statIngCoalesced << endl
+            << "   parse errors: " << statParseErrors << endl
+            << "   unknown topics: " << statUnknown << endl
+            << "   SM errors: " << statSetErrors << endl
+            << "   lag: avg=" << statLagAvg << " max=" << statLagMax << " msec" << endl;
+    }
+
+    return inf.str();
+}
+// -----------------------------------------------------------------------------
+MQTTPublisher::MQTTTextInfo::MQTTTextInfo( const string& rootsec, UniXML::iterator s, UniXML::iterator i, int defqos ):
     xmlnode(s)
 {
     auto conf = uniset_conf();
@@ -313,6 +859,7 @@ MQTTPublisher::MQTTTextInfo::MQTTTextInfo( const string& rootsec, UniXML::iterat
     }
 
     std::string subtopic(i.getProp("subtopic"));
+    qos = checkQoS(i.getPIntProp("qos", defqos));
 
     if( !subtopic.empty() )
         pubname = rootsec + "/" + subtopic;
@@ -345,6 +892,7 @@ MQTTPublisher::MQTTTextInfo::MQTTTextInfo( const string& rootsec, UniXML::iterat
         }
 
         RangeInfo r(min, max, i.getProp("text"));
+        r.compile(sname, s.getProp("textname"), sid);
         rlist.push_back( std::move(r) );
     }
 }
@@ -354,8 +902,41 @@ bool MQTTPublisher::RangeInfo::check( long val ) const
     return ( val >= rmin && val <= rmax );
 }
 //--------------------------------------------------------------------------------
-void MQTTPublisher::MQTTTextInfo::check( mosqpp::mosquittopp* serv, long value, std::shared_ptr<DebugStream>& log, const string& myname )
+void MQTTPublisher::RangeInfo::compile( const std::string& name, const std::string& textname, uniset::ObjectId id )
 {
+    ostringstream r;
+    r << "[" << rmin << ":" << rmax << "]";
+
+    // на время подстановок %v заменяем символом '\0' (в тексте из xml его быть не может),
+    // по нему потом и разбиваем текст
+    const std::string mark(1, '\0');
+    std::string txt = replace_all(text, "%v", mark);
+    txt = replace_all(txt, "%n", name);
+    txt = replace_all(txt, "%t", textname);
+    txt = replace_all(txt, "%i", std::to_string(id));
+    txt = replace_all(txt, "%rmin", std::to_string(rmin));
+    txt = replace_all(txt, "%rmax", std::to_string(rmax));
+    txt = replace_all(txt, "%r", r.str());
+
+    tpl.clear();
+    size_t pos = 0;
+
+    while( true )
+    {
+        auto n = txt.find('\0', pos);
+        tpl.push_back(txt.substr(pos, n == std::string::npos ? std::string::npos : n - pos));
+
+        if( n == std::string::npos )
+            break;
+
+        pos = n + 1;
+    }
+}
+//--------------------------------------------------------------------------------
+size_t MQTTPublisher::MQTTTextInfo::check( mosqpp::mosquittopp* serv, long value, std::shared_ptr<DebugStream>& log, const string& myname )
+{
+    size_t num = 0;
+
     for( auto&& r : rlist )
     {
         if( r.check(value) )
@@ -366,43 +947,40 @@ void MQTTPublisher::MQTTTextInfo::check( mosqpp::mosquittopp* serv, long value,
             if( log->is_info() )
                 log->info() << myname << "(check): publish: topic='" << pubname << "' msg='" << tmsg << "'" << endl;
 
-            int ret = serv->publish(NULL, pubname.c_str(), tmsg.size(), tmsg.c_str(), 1, false);
+            int ret = serv->publish(NULL, pubname.c_str(), tmsg.size(), tmsg.c_str(), qos, false);
 
             if( ret != MOSQ_ERR_SUCCESS )
             {
                 if( log->is_crit() )
                     log->crit() << myname << "(check): PUBLISH FAILED: err(" << ret << "): " << mosqpp::strerror(ret) << endl;
             }
+            else
+                num++;
         }
     }
+
+    return num;
 }
 //--------------------------------------------------------------------------------
 std::string MQTTPublisher::MQTTTextInfo::replace( RangeInfo* ri, long value )
 {
-    std::string txt(ri->text);
+    // подстановки кроме %v выполнены при загрузке (см. RangeInfo::compile)
+    if( ri->tpl.size() == 1 )
+        return ri->tpl[0];
 
-    ostringstream v;
-    v << value;
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof(buf), value);
+    const size_t vlen = r.ptr - buf;
 
-    ostringstream id;
-    id << sid;
+    std::string txt;
+    txt.reserve(ri->text.size() + ri->tpl.size() * vlen);
+    txt += ri->tpl[0];
 
-    ostringstream r;
-    r << "[" << ri->rmin << ":" << ri->rmax << "]";
-
-    ostringstream smin;
-    smin << ri->rmin;
-
-    ostringstream smax;
-    smax << ri->rmax;
-
-    txt = replace_all(txt, "%v", v.str());
-    txt = replace_all(txt, "%n", xmlnode.getProp("name"));
-    txt = replace_all(txt, "%t", xmlnode.getProp("textname"));
-    txt = replace_all(txt, "%i", id.str());
-    txt = replace_all(txt, "%rmin", smin.str());
-    txt = replace_all(txt, "%rmax", smax.str());
-    txt = replace_all(txt, "%r", r.str());
+    for( size_t k = 1; k < ri->tpl.size(); k++ )
+    {
+        txt.append(buf, vlen);
+        txt += ri->tpl[k];
+    }
 
     return txt;
 }
@@ -19,12 +19,19 @@
 // -----------------------------------------------------------------------------
 #include <unordered_map>
 #include <list>
+#include <vector>
 #include <memory>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <mosquittopp.h>
 #include "UObject_SK.h"
 #include "SMInterface.h"
 #include "SharedMemory.h"
+#include "ThreadCreator.h"
 #include "extensions/Extensions.h"
+#include "MQTTTopicTrie.h"
 // -------------------------------------------------------------------------
 namespace uniset
 {
@@ -35,6 +42,9 @@ namespace uniset
       - \ref sec_MQTT_Comm
       - \ref sec_MQTT_Conf
       - \ref sec_MQTT_Text
+      - \ref sec_MQTT_Coalesce
+      - \ref sec_MQTT_Bulk
+      - \ref sec_MQTT_Subscribe
 
     \section sec_MQTT_Comm Общее описание MQTTPublisher
 
@@ -71,6 +81,10 @@ namespace uniset
 
     Для запуска издателя, неоходимо наличие в configure.xml секции: <ObjectName name="ObjectName" ...параметры">.
 
+    Уровень QoS для публикации задаётся параметром --prefix-mqtt-qos [0,1,2] (или mqttQoS="..").
+    По умолчанию: 1. Для отдельного датчика можно задать свой уровень свойством \b mqtt_qos="..",
+    а для текстовых сообщений свойством \b qos=".." в подсекции <mqtt>.
+
     \todo Доделать контрольный таймер (контроль наличия соединения с сервером)
 
     \section sec_MQTT_Text Генерирование текстовых сообщений
@@ -103,6 +117,50 @@ namespace uniset
 
     \note Если заданные "одиночные" значения совпадают с диапазоном, то будет сгенерировано несколько сообщений. Т.е. диапазоны могут пересекаться.
 
+    Тексты разбираются один раз при загрузке: все подстановки кроме \b %v выполняются сразу,
+    при публикации остаётся только вставить значение.
+
+    \section sec_MQTT_Coalesce Объединение изменений
+    По умолчанию каждое изменение датчика публикуется сразу. При частых изменениях можно задать
+    окно объединения --prefix-mqtt-coalesce-time msec (или coalesceTime=".."). В этом случае
+    изменения накапливаются и раз в окно по каждому топику публикуется только последнее значение.
+    Для отдельных датчиков объединение можно отключить свойством \b mqtt_coalesce="0"
+    (изменения публикуются сразу). Текстовые сообщения (события) всегда публикуются сразу.
+
+    \section sec_MQTT_Bulk Групповой топик
+    При задании --prefix-mqtt-bulk-topic name (или bulkTopic="..") изменения за окно (см. \ref sec_MQTT_Coalesce,
+    если окно не задано используется 200 мсек) дополнительно публикуются одним сообщением в формате JSON:
+    \code
+    {"sensors":[{"id":10,"name":"MySensor1","value":12,"time":1571237418.354},...]}
+    \endcode
+    В одно сообщение попадает не более --prefix-mqtt-bulk-max датчиков (по умолчанию 1000).
+    Параметр --prefix-mqtt-bulk-only 1 отключает публикацию в отдельные топики датчиков.
+
+    \section sec_MQTT_Subscribe Приём данных (MQTT -> SM)
+    Помимо публикации, процесс может принимать значения датчиков из MQTT и сохранять их в SM.
+    Соответствие топиков датчикам задаётся:
+    - свойством \b mqtt_subscribe="topic" у датчика. В топике можно использовать '+' и '#'.
+    Для значений с плавающей точкой можно задать \b mqtt_precision="N" (сохраняется value*10^N);
+    - шаблонами --prefix-mqtt-sub-pattern "plant/%n/value,..." (или subPatterns=".."), где уровень \b %n
+    это имя датчика. Имена берутся из секции <sensors> (с учётом --prefix-mqtt-sub-filter-field
+    и --prefix-mqtt-sub-filter-value, если заданы).
+    \code
+    <MQTTPublisher1 name="MQTTPublisher1" subPatterns="devices/+/%n" subQoS="0" subFlushTime="50"/>
+    ...
+    <item id="10" name="Temp1_AS" ... mqtt_subscribe="plant/boiler1/temp" mqtt_precision="1"/>
+    \endcode
+    По умолчанию подписка выполняется на все заданные шаблоны (%n заменяется на '+'),
+    но можно задать свой список --prefix-mqtt-sub-topics "plant/#,devices/#".
+
+    Разбор сообщений выполняется в потоке mosquitto: топик ищется по дереву шаблонов (результат запоминается),
+    значение разбирается без создания промежуточных строк. Принятые значения накапливаются
+    (для каждого датчика хранится только последнее) и отдельным потоком сохраняются в SM
+    одним вызовом (SMInterface::setValueSeq) раз в --prefix-mqtt-sub-flush-time мсек
+    или при накоплении --prefix-mqtt-sub-batch значений.
+
+    В getInfo() выводится статистика: скорость приёма (сообщений в секунду), количество ошибок разбора,
+    сообщений с неизвестными топиками и задержка (lag) от приёма сообщения до записи в SM.
+    \warning Не стоит одновременно публиковать и принимать один и тот же датчик (будет "петля").
     */
     // -----------------------------------------------------------------------------
     /*! Реализация публикатора на основе MQTT */
@@ -134,13 +192,29 @@ namespace uniset
             virtual void sensorInfo( const uniset::SensorMessage* sm ) override;
             virtual bool deactivateObject() override;
             virtual void sysCommand( const uniset::SystemMessage* sm ) override;
+            virtual void timerInfo( const uniset::TimerMessage* tm ) override;
+            virtual std::string getMonitInfo() const override;
 
             std::shared_ptr<SMInterface> shm;
 
+            enum Timers
+            {
+                tmPublish
+            };
+
             struct MQTTInfo
             {
                 uniset::ObjectId sid;
                 std::string pubname;
+                int qos = { 1 };
+                bool coalesce = { true };
+
+                // последнее изменение (ещё не опубликованное)
+                long value = { 0 };
+                struct timespec tv = { 0, 0 };
+                bool dirty = { false };
+
+                std::string bulkHead; // {"id":..,"name":"..","value":
 
                 MQTTInfo( uniset::ObjectId id, const std::string& name ):
                     sid(id), pubname(name) {}
@@ -156,6 +230,10 @@ namespace uniset
                 long rmax;
                 std::string text;
                 bool check( long val ) const;
+
+                // текст с выполненными подстановками, разбитый по местам вставки значения (%v)
+                std::vector<std::string> tpl;
+                void compile( const std::string& name, const std::string& textname, uniset::ObjectId id );
             };
 
             struct MQTTTextInfo
@@ -163,13 +241,14 @@ namespace uniset
                 uniset::ObjectId sid;
                 std::string pubname;
                 UniXML::iterator xmlnode;
+                int qos = { 1 };
 
-                MQTTTextInfo( const std::string& rootsec, UniXML::iterator s, UniXML::iterator i );
+                MQTTTextInfo( const std::string& rootsec, UniXML::iterator s, UniXML::iterator i, int defqos );
 
                 // одиночные сообщения просто имитируются min=max=val
                 std::list<RangeInfo> rlist; // список сообщений..
 
-                void check( mosqpp::mosquittopp* serv, long value, std::shared_ptr<DebugStream>& log, const std::string& myname );
+                size_t check( mosqpp::mosquittopp* serv, long value, std::shared_ptr<DebugStream>& log, const std::string& myname );
 
                 std::string replace( RangeInfo* ri, long value );
             };
@@ -179,6 +258,65 @@ namespace uniset
             MQTTMap publist;
             MQTTTextMap textpublist;
 
+            bool publishValue( MQTTInfo& inf, long value );
+            void flushChanges();
+            void publishBulk( std::string& msg, size_t count );
+
+            timeout_t coalesceTime = { 0 }; // 0 - публиковать сразу
+            std::vector<MQTTInfo*> dirtyList;
+
+            std::string bulkTopic; // пустой - не используется
+            int bulkQos = { 1 };
+            bool bulkOnly = { false };
+            size_t bulkMax = { 1000 };
+            std::string bulkMsg;
+
+            // статистика (для getMonitInfo)
+            size_t statPublished = { 0 };
+            size_t statCoalesced = { 0 }; // изменения заменённые более новыми в пределах окна
+            size_t statBulk = { 0 };
+            size_t statFailed = { 0 };
+
+            // приём данных (MQTT -> SM)
+            void initSubscribe( UniXML::iterator& it, xmlNode* senssec );
+            void startIngest();
+            void stopIngest();
+            void ingestThread();
+
+            struct IngestItem
+            {
+                uniset::ObjectId sid;
+                long value;
+                std::chrono::steady_clock::time_point t; // время приёма (для расчёта задержки)
+            };
+
+            void applyValues( std::vector<IngestItem>& buf, IOController_i::OutSeq& seq );
+
+            static bool parseValue( const char* data, size_t len, int precision, long& value );
+
+            MQTTTopicTrie subtrie; // используется только в потоке mosquitto (после инициализации)
+            std::vector<std::string> subTopics;
+            int subQos = { 0 };
+            timeout_t subFlushTime = { 50 };
+            size_t subBatch = { 1000 };
+
+            std::vector<IngestItem> ingbuf;
+            std::unordered_map<uniset::ObjectId, size_t> ingIndex; // позиция датчика в ingbuf
+            std::mutex ingMutex;
+            std::condition_variable ingCond;
+            std::unique_ptr< ThreadCreator<MQTTPublisher> > ingest;
+            std::atomic_bool ingestActive = { false };
+
+            std::atomic<size_t> statRecv = { 0 };
+            std::atomic<size_t> statRecvRate = { 0 }; // сообщений в секунду
+            std::atomic<size_t> statParseErrors = { 0 };
+            std::atomic<size_t> statUnknown = { 0 };
+            std::atomic<size_t> statIngCoalesced = { 0 };
+            std::atomic<size_t> statApplied = { 0 };
+            std::atomic<size_t> statSetErrors = { 0 };
+            std::atomic<long> statLagAvg = { 0 }; // мсек (по последней записи в SM)
+            std::atomic<long> statLagMax = { 0 };
+
         private:
 
             std::string prefix;
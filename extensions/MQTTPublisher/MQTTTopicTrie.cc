@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -------------------------------------------------------------------------
+#include "Exceptions.h"
+#include "MQTTTopicTrie.h"
+// -----------------------------------------------------------------------------
+using namespace std;
+using namespace uniset;
+// -----------------------------------------------------------------------------
+MQTTTopicTrie::MQTTTopicTrie():
+    root(new Node())
+{
+}
+// -----------------------------------------------------------------------------
+MQTTTopicTrie::~MQTTTopicTrie()
+{
+}
+// -----------------------------------------------------------------------------
+std::vector<std::string> MQTTTopicTrie::splitLevels( const std::string& topic )
+{
+    // пустые уровни допустимы ("a//b"), поэтому explode_str() не подходит
+    std::vector<std::string> levels;
+    size_t pos = 0;
+
+    while( true )
+    {
+        auto n = topic.find('/', pos);
+
+        if( n == string::npos )
+        {
+            levels.emplace_back(topic, pos);
+            break;
+        }
+
+        levels.emplace_back(topic, pos, n - pos);
+        pos = n + 1;
+    }
+
+    return levels;
+}
+// -----------------------------------------------------------------------------
+MQTTTopicTrie::Node* MQTTTopicTrie::insert( const std::string& pattern, bool& isHash )
+{
+    if( pattern.empty() )
+        throw SystemError("(MQTTTopicTrie): empty topic pattern");
+
+    auto levels = splitLevels(pattern);
+    Node* node = root.get();
+    isHash = false;
+
+    for( size_t i = 0; i < levels.size(); i++ )
+    {
+        const auto& l = levels[i];
+
+        if( l == "#" )
+        {
+            if( i != levels.size() - 1 )
+                throw SystemError("(MQTTTopicTrie): '#' must be last in pattern '" + pattern + "'");
+
+            isHash = true;
+            return node;
+        }
+
+        std::unique_ptr<Node>* next = nullptr;
+
+        if( l == "+" )
+            next = &node->plus;
+        else if( l == "%n" )
+            next = &node->name;
+        else
+            next = &node->children[l];
+
+        if( !(*next) )
+            next->reset(new Node());
+
+        node = next->get();
+    }
+
+    return node;
+}
+// -----------------------------------------------------------------------------
+void MQTTTopicTrie::add( const std::string& pattern, const Item& item )
+{
+    if( pattern.find("%n") != string::npos )
+        throw SystemError("(MQTTTopicTrie): '%n' is not allowed for sensor pattern '" + pattern + "'");
+
+    bool isHash = false;
+    Node* node = insert(pattern, isHash);
+
+    if( isHash )
+        node->hash.reset(new Item(item));
+    else
+    {
+        node->terminal = true;
+        node->byName = false;
+        node->item = item;
+    }
+
+    patterns.push_back(pattern);
+    cache.clear();
+}
+// -----------------------------------------------------------------------------
+void MQTTTopicTrie::addNamePattern( const std::string& pattern )
+{
+    if( pattern.find("%n") == string::npos )
+        throw SystemError("(MQTTTopicTrie): not found '%n' in pattern '" + pattern + "'");
+
+    if( pattern.find('#') != string::npos )
+        throw SystemError("(MQTTTopicTrie): '#' is not allowed in name pattern '" + pattern + "'");
+
+    bool isHash = false;
+    Node* node = insert(pattern, isHash);
+    node->terminal = true;
+    node->byName = true;
+
+    patterns.push_back(pattern);
+    cache.clear();
+}
+// -----------------------------------------------------------------------------
+void MQTTTopicTrie::addName( const std::string& name, const Item& item )
+{
+    names[name] = item;
+    cache.clear();
+}
+// -----------------------------------------------------------------------------
+const MQTTTopicTrie::Item* MQTTTopicTrie::match( const Node* node, const std::vector<std::string>& levels, size_t idx, const std::string* captured ) const
+{
+    if( idx == levels.size() )
+    {
+        if( node->terminal )
+        {
+            if( !node->byName )
+                return &node->item;
+
+            if( captured )
+            {
+                auto it = names.find(*captured);
+
+                if( it != names.end() )
+                    return &it->second;
+            }
+        }
+
+        // "a/#" совпадает и с "a"
+        return node->hash.get();
+    }
+
+    const auto& l = levels[idx];
+
+    auto c = node->children.find(l);
+
+    if( c != node->children.end() )
+    {
+        auto ret = match(c->second.get(), levels, idx + 1, captured);
+
+        if( ret )
+            return ret;
+    }
+
+    if( node->name )
+    {
+        auto ret = match(node->name.get(), levels, idx + 1, &l);
+
+        if( ret )
+            return ret;
+    }
+
+    if( node->plus )
+    {
+        auto ret = match(node->plus.get(), levels, idx + 1, captured);
+
+        if( ret )
+            return ret;
+    }
+
+    return node->hash.get();
+}
+// -----------------------------------------------------------------------------
+const MQTTTopicTrie::Item* MQTTTopicTrie::find( const std::string& topic )
+{
+    auto it = cache.find(topic);
+
+    if( it != cache.end() )
+        return it->second;
+
+    const Item* ret = match(root.get(), splitLevels(topic), 0, nullptr);
+
+    if( cache.size() >= cacheMax )
+        cache.clear();
+
+    cache.emplace(topic, ret);
+    return ret;
+}
+// -----------------------------------------------------------------------------
+std::vector<std::string> MQTTTopicTrie::getSubscriptions() const
+{
+    std::vector<std::string> ret;
+    ret.reserve(patterns.size());
+
+    for( const auto& p : patterns )
+        ret.push_back( replace_all(p, "%n", "+") );
+
+    return ret;
+}
+// -----------------------------------------------------------------------------
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -----------------------------------------------------------------------------
+#ifndef _MQTTTopicTrie_H_
+#define _MQTTTopicTrie_H_
+// -----------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "UniSetTypes.h"
+// -------------------------------------------------------------------------
+namespace uniset
+{
+    // -----------------------------------------------------------------------------
+    /*! Сопоставление MQTT-топиков датчикам.
+     *
+     * Шаблоны хранятся в виде дерева по уровням топика ("a/b/c" -> "a" -> "b" -> "c").
+     * В шаблоне можно использовать:
+     * - \b + - любой один уровень
+     * - \b # - любое количество уровней (только в конце шаблона)
+     * - \b %n - любой один уровень, который является именем датчика (см. addName())
+     *
+     * При совпадении приоритет у точного совпадения уровня, затем %n, затем +, затем #.
+     * Результат поиска (в том числе отрицательный) запоминается для каждого топика,
+     * поэтому дерево обходится только при первом появлении топика.
+     *
+     * Класс не потокобезопасный: заполнение при инициализации, поиск из одного потока.
+     */
+    class MQTTTopicTrie
+    {
+        public:
+            MQTTTopicTrie();
+            ~MQTTTopicTrie();
+
+            struct Item
+            {
+                uniset::ObjectId sid = { uniset::DefaultObjectId };
+                int precision = { 0 }; // для значений с плавающей точкой: value * 10^precision
+
+                Item() {}
+                Item( uniset::ObjectId id, int prec ): sid(id), precision(prec) {}
+            };
+
+            /*! добавить шаблон для конкретного датчика
+             * \throw SystemError при ошибке в шаблоне
+             */
+            void add( const std::string& pattern, const Item& item );
+
+            /*! добавить шаблон в котором датчик определяется по имени (уровень %n) */
+            void addNamePattern( const std::string& pattern );
+
+            /*! добавить имя датчика для шаблонов с %n */
+            void addName( const std::string& name, const Item& item );
+
+            /*! найти датчик по топику
+             * \return nullptr если топик не соответствует ни одному шаблону
+             */
+            const Item* find( const std::string& topic );
+
+            /*! список топиков для подписки (шаблоны, %n заменено на +) */
+            std::vector<std::string> getSubscriptions() const;
+
+            inline size_t size() const noexcept
+            {
+                return patterns.size();
+            }
+
+            inline size_t getCacheSize() const noexcept
+            {
+                return cache.size();
+            }
+
+            // максимальное количество запоминаемых топиков (при превышении кэш очищается)
+            inline void setCacheMax( size_t sz ) noexcept
+            {
+                cacheMax = sz;
+            }
+
+            static std::vector<std::string> splitLevels( const std::string& topic );
+
+        protected:
+
+            struct Node
+            {
+                std::unordered_map<std::string, std::unique_ptr<Node>> children;
+                std::unique_ptr<Node> plus;  // +
+                std::unique_ptr<Node> name;  // %n
+                std::unique_ptr<Item> hash;  // #
+
+                bool terminal = { false };
+                bool byName = { false }; // датчик определяется по имени (%n)
+                Item item;
+            };
+
+            Node* insert( const std::string& pattern, bool& isHash );
+            const Item* match( const Node* node, const std::vector<std::string>& levels, size_t idx, const std::string* captured ) const;
+
+        private:
+            std::unique_ptr<Node> root;
+            std::vector<std::string> patterns;
+            std::unordered_map<std::string, Item> names;
+            std::unordered_map<std::string, const Item*> cache;
+            size_t cacheMax = { 100000 };
+    };
+    // ----------------------------------------------------------------------------------
+} // end of namespace uniset
+// -----------------------------------------------------------------------------
+#endif // _MQTTTopicTrie_H_
+// -----------------------------------------------------------------------------
@@ -0,0 +1,197 @@
+#include <catch.hpp>
+// -----------------------------------------------------------------------------
+#include "Exceptions.h"
+#include "MQTTTopicTrie.h"
+// -----------------------------------------------------------------------------
+using namespace std;
+using namespace uniset;
+// -----------------------------------------------------------------------------
+static ObjectId sidOf( MQTTTopicTrie& t, const std::string& topic )
+{
+    auto i = t.find(topic);
+    return i ? i->sid : DefaultObjectId;
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[MQTTTopicTrie]: splitLevels", "[mqtt][trie]")
+{
+    REQUIRE( MQTTTopicTrie::splitLevels("a") == vector<string>({"a"}) );
+    REQUIRE( MQTTTopicTrie::splitLevels("a/b/c") == vector<string>({"a", "b", "c"}) );
+    REQUIRE( MQTTTopicTrie::splitLevels("a//b") == vector<string>({"a", "", "b"}) );
+    REQUIRE( MQTTTopicTrie::splitLevels("/a/") == vector<string>({"", "a", ""}) );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[MQTTTopicTrie]: exact", "[mqtt][trie]")
+{
+    MQTTTopicTrie t;
+    t.add("a/b/c", MQTTTopicTrie::Item(1, 2));
+
+    auto i = t.find("a/b/c");
+    REQUIRE( i != nullptr );
+    REQUIRE( i->sid == 1 );
+    REQUIRE( i->precision == 2 );
+
+    REQUIRE( t.find("a/b") == nullptr );
+    REQUIRE( t.find("a/b/c/d") == nullptr );
+    REQUIRE( t.find("a/b/x") == nullptr );
+    REQUIRE( t.find("a//b/c") == nullptr );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[MQTTTopicTrie]: + (single level)", "[mqtt][trie]")
+{
+    MQTTTopicTrie t;
+    t.add("a/+/c", MQTTTopicTrie::Item(1, 0));
+    t.add("+", MQTTTopicTrie::Item(2, 0));
+
+    REQUIRE( sidOf(t, "a/b/c") == 1 );
+    REQUIRE( sidOf(t, "a/xxx/c") == 1 );
+    REQUIRE( sidOf(t, "a//c") == 1 );
+    REQUIRE( sidOf(t, "a/b/b/c") == DefaultObjectId );
+    REQUIRE( sidOf(t, "a/c") == DefaultObjectId );
+
+    REQUIRE( sidOf(t, "x") == 2 );
+    REQUIRE( sidOf(t, "x/y") == DefaultObjectId );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[MQTTTopicTrie]: # (multi level)", "[mqtt][trie]")
+{
+    SECTION("mid-path")
+    {
+        MQTTTopicTrie t;
+        t.add("a/b/#", MQTTTopicTrie::Item(1, 0));
+
+        REQUIRE( sidOf(t, "a/b/c") == 1 );
+        REQUIRE( sidOf(t, "a/b/c/d/e") == 1 );
+        // "a/b/#" совпадает и с "a/b"
+        REQUIRE( sidOf(t, "a/b") == 1 );
+        REQUIRE( sidOf(t, "a") == DefaultObjectId );
+        REQUIRE( sidOf(t, "a/x/c") == DefaultObjectId );
+    }
+
+    SECTION("root")
+    {
+        MQTTTopicTrie t;
+        t.add("#", MQTTTopicTrie::Item(1, 0));
+
+        REQUIRE( sidOf(t, "a") == 1 );
+        REQUIRE( sidOf(t, "a/b/c") == 1 );
+        REQUIRE( sidOf(t, "/a") == 1 );
+    }
+
+    SECTION("not last")
+    {
+        MQTTTopicTrie t;
+        REQUIRE_THROWS_AS( t.add("a/#/c", MQTTTopicTrie::Item(1, 0)), uniset::SystemError );
+        REQUIRE_THROWS_AS( t.add("#/a", MQTTTopicTrie::Item(1, 0)), uniset::SystemError );
+        REQUIRE_THROWS_AS( t.add("", MQTTTopicTrie::Item(1, 0)), uniset::SystemError );
+        REQUIRE( t.size() == 0 );
+    }
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[MQTTTopicTrie]: %n (sensor name)", "[mqtt][trie]")
+{
+    MQTTTopicTrie t;
+    t.addNamePattern("dev/%n/value");
+    t.addName("Sensor1_S", MQTTTopicTrie::Item(10, 1));
+    t.addName("Sensor2_S", MQTTTopicTrie::Item(20, 0));
+
+    auto i = t.find("dev/Sensor1_S/value");
+    REQUIRE( i != nullptr );
+    REQUIRE( i->sid == 10 );
+    REQUIRE( i->precision == 1 );
+
+    REQUIRE( sidOf(t, "dev/Sensor2_S/value") == 20 );
+    REQUIRE( sidOf(t, "dev/Unknown_S/value") == DefaultObjectId );
+    REQUIRE( sidOf(t, "dev/Sensor1_S") == DefaultObjectId );
+
+    REQUIRE_THROWS_AS( t.addNamePattern("dev/value"), uniset::SystemError );
+    REQUIRE_THROWS_AS( t.addNamePattern("dev/%n/#"), uniset::SystemError );
+    REQUIRE_THROWS_AS( t.add("dev/%n", MQTTTopicTrie::Item(1, 0)), uniset::SystemError );
+
+    auto subs = t.getSubscriptions();
+    REQUIRE( subs == vector<string>({"dev/+/value"}) );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[MQTTTopicTrie]: priority", "[mqtt][trie]")
+{
+    // приоритет: точное совпадение > %n > + > #
+    MQTTTopicTrie t;
+    t.add("a/#", MQTTTopicTrie::Item(4, 0));
+    t.add("a/+/c", MQTTTopicTrie::Item(3, 0));
+    t.addNamePattern("a/%n/c");
+    t.addName("n", MQTTTopicTrie::Item(2, 0));
+    t.add("a/b/c", MQTTTopicTrie::Item(1, 0));
+
+    REQUIRE( sidOf(t, "a/b/c") == 1 );
+    REQUIRE( sidOf(t, "a/n/c") == 2 );
+    REQUIRE( sidOf(t, "a/x/c") == 3 );
+    REQUIRE( sidOf(t, "a/x/d") == 4 );
+    REQUIRE( sidOf(t, "a/b/c/d") == 4 );
+    REQUIRE( sidOf(t, "b/x/c") == DefaultObjectId );
+
+    SECTION("fallback to less specific branch")
+    {
+        // точная ветка "a/b/..." есть, но не совпадает до конца
+        MQTTTopicTrie t2;
+        t2.add("a/b/c", MQTTTopicTrie::Item(1, 0));
+        t2.add("a/+/d", MQTTTopicTrie::Item(2, 0));
+        t2.add("#", MQTTTopicTrie::Item(3, 0));
+
+        REQUIRE( sidOf(t2, "a/b/c") == 1 );
+        REQUIRE( sidOf(t2, "a/b/d") == 2 );
+        REQUIRE( sidOf(t2, "a/b/e") == 3 );
+    }
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[MQTTTopicTrie]: cache", "[mqtt][trie]")
+{
+    MQTTTopicTrie t;
+    t.add("a/+", MQTTTopicTrie::Item(1, 0));
+    REQUIRE( t.getCacheSize() == 0 );
+
+    auto i1 = t.find("a/b");
+    REQUIRE( i1 != nullptr );
+    REQUIRE( t.getCacheSize() == 1 );
+
+    // повторный поиск берётся из кэша
+    auto i2 = t.find("a/b");
+    REQUIRE( i2 == i1 );
+    REQUIRE( t.getCacheSize() == 1 );
+
+    // отрицательный результат тоже запоминается
+    REQUIRE( t.find("x/y") == nullptr );
+    REQUIRE( t.getCacheSize() == 2 );
+
+    SECTION("invalidation after add")
+    {
+        t.add("a/b", MQTTTopicTrie::Item(2, 0));
+        t.add("x/#", MQTTTopicTrie::Item(3, 0));
+        REQUIRE( t.getCacheSize() == 0 );
+
+        REQUIRE( sidOf(t, "a/b") == 2 );
+        REQUIRE( sidOf(t, "x/y") == 3 );
+    }
+
+    SECTION("invalidation after addName")
+    {
+        t.addNamePattern("n/%n");
+        REQUIRE( t.getCacheSize() == 0 );
+        REQUIRE( t.find("n/Sensor1_S") == nullptr );
+        REQUIRE( t.getCacheSize() == 1 );
+
+        t.addName("Sensor1_S", MQTTTopicTrie::Item(5, 0));
+        REQUIRE( t.getCacheSize() == 0 );
+        REQUIRE( sidOf(t, "n/Sensor1_S") == 5 );
+    }
+
+    SECTION("cache max")
+    {
+        t.setCacheMax(2);
+        t.find("a/c");
+        REQUIRE( t.getCacheSize() == 1 );
+        REQUIRE( sidOf(t, "a/d") == 1 );
+        REQUIRE( t.getCacheSize() == 2 );
+        REQUIRE( sidOf(t, "a/e") == 1 );
+        REQUIRE( t.getCacheSize() == 1 );
+    }
+}
+// -----------------------------------------------------------------------------
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -------------------------------------------------------------------------
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "Exceptions.h"
+#include "RRDCachedClient.h"
+// -----------------------------------------------------------------------------
+using namespace std;
+using namespace uniset;
+// -----------------------------------------------------------------------------
+RRDCachedClient::RRDCachedClient( const std::string& _addr, int timeout_msec ):
+    addr(_addr),
+    tout(timeout_msec)
+{
+    unixSocket = ( addr.compare(0, 5, "unix:") == 0 || ( !addr.empty() && addr[0] == '/' ) );
+}
+// -----------------------------------------------------------------------------
+RRDCachedClient::~RRDCachedClient()
+{
+    disconnect();
+}
+// -----------------------------------------------------------------------------
+void RRDCachedClient::disconnect() noexcept
+{
+    if( fd >= 0 )
+        ::close(fd);
+
+    fd = -1;
+    rbuf.clear();
+}
+// -----------------------------------------------------------------------------
+void RRDCachedClient::throwError( const std::string& err )
+{
+    disconnect();
+    throw SystemError("(RRDCachedClient): " + addr + ": " + err);
+}
+// -----------------------------------------------------------------------------
+std::string RRDCachedClient::connectSocket( int sock, const struct sockaddr* sa, socklen_t salen )
+{
+    // сокет неблокирующий, поэтому недоступный адрес не задерживает вызывающий поток дольше tout
+    if( ::connect(sock, sa, salen) == 0 )
+        return "";
+
+    if( errno != EINPROGRESS && errno != EINTR )
+        return strerror(errno);
+
+    struct pollfd pfd = { sock, POLLOUT, 0 };
+    int ret = 0;
+
+    do
+    {
+        ret = ::poll(&pfd, 1, tout);
+    }
+    while( ret < 0 && errno == EINTR );
+
+    if( ret == 0 )
+        return "connect timeout";
+
+    if( ret < 0 )
+        return string("poll: ") + strerror(errno);
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+
+    if( ::getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len) < 0 )
+        return string("getsockopt: ") + strerror(errno);
+
+    return ( err == 0 ) ? "" : strerror(err);
+}
+// -----------------------------------------------------------------------------
+void RRDCachedClient::connect()
+{
+    disconnect();
+
+    if( unixSocket )
+    {
+        const string path = ( addr.compare(0, 5, "unix:") == 0 ) ? addr.substr(5) : addr;
+
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+
+        if( path.size() >= sizeof(sa.sun_path) )
+            throwError("socket path too long");
+
+        strncpy(sa.sun_path, path.c_str(), sizeof(sa.sun_path) - 1);
+
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+
+        if( fd < 0 )
+            throwError(string("socket: ") + strerror(errno));
+
+        const string err = connectSocket(fd, (struct sockaddr*)&sa, sizeof(sa));
+
+        if( !err.empty() )
+            throwError("connect: " + err);
+
+        return;
+    }
+
+    // host[:port], IPv6 в виде [addr]:port
+    string host = addr;
+    string port = std::to_string(DefaultPort);
+
+    if( !host.empty() && host[0] == '[' )
+    {
+        auto pos = host.find(']');
+
+        if( pos == string::npos )
+            throwError("bad address");
+
+        if( pos + 1 < host.size() && host[pos + 1] == ':' )
+            port = host.substr(pos + 2);
+
+        host = host.substr(1, pos - 1);
+    }
+    else
+    {
+        auto pos = host.rfind(':');
+
+        if( pos != string::npos )
+        {
+            port = host.substr(pos + 1);
+            host = host.substr(0, pos);
+        }
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* res = nullptr;
+    int ret = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+
+    if( ret != 0 )
+        throwError(string("getaddrinfo: ") + gai_strerror(ret));
+
+    string err;
+
+    for( auto ai = res; ai; ai = ai->ai_next )
+    {
+        fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, ai->ai_protocol);
+
+        if( fd < 0 )
+        {
+            err = strerror(errno);
+            continue;
+        }
+
+        err = connectSocket(fd, ai->ai_addr, ai->ai_addrlen);
+
+        if( err.empty() )
+            break;
+
+        ::close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(res);
+
+    if( fd < 0 )
+        throwError("connect: " + err);
+}
+// -----------------------------------------------------------------------------
+void RRDCachedClient::sendAll( const std::string& data )
+{
+    size_t pos = 0;
+
+    while( pos < data.size() )
+    {
+        struct pollfd pfd = { fd, POLLOUT, 0 };
+        int ret = ::poll(&pfd, 1, tout);
+
+        if( ret < 0 && errno == EINTR )
+            continue;
+
+        if( ret <= 0 )
+            throwError( ret == 0 ? "send timeout" : string("poll: ") + strerror(errno) );
+
+        ssize_t n = ::send(fd, data.data() + pos, data.size() - pos, MSG_NOSIGNAL);
+
+        if( n < 0 )
+        {
+            if( errno == EINTR || errno == EAGAIN )
+                continue;
+
+            throwError(string("send: ") + strerror(errno));
+        }
+
+        pos += n;
+    }
+}
+// -----------------------------------------------------------------------------
+std::string RRDCachedClient::readLine()
+{
+    while( true )
+    {
+        auto pos = rbuf.find('\n');
+
+        if( pos != string::npos )
+        {
+            string line = rbuf.substr(0, pos);
+            rbuf.erase(0, pos + 1);
+            return line;
+        }
+
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ret = ::poll(&pfd, 1, tout);
+
+        if( ret < 0 && errno == EINTR )
+            continue;
+
+        if( ret <= 0 )
+            throwError( ret == 0 ? "reply timeout" : string("poll: ") + strerror(errno) );
+
+        char buf[4096];
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+
+        if( n < 0 && ( errno == EINTR || errno == EAGAIN ) )
+            continue;
+
+        if( n <= 0 )
+            throwError( n == 0 ? "connection closed" : string("recv: ") + strerror(errno) );
+
+        rbuf.append(buf, n);
+    }
+}
+// -----------------------------------------------------------------------------
+int RRDCachedClient::readStatus( std::string& msg )
+{
+    // ответ: "<status> <message>", status < 0 - ошибка, иначе количество последующих строк
+    const string line = readLine();
+    char* end = nullptr;
+    long status = std::strtol(line.c_str(), &end, 10);
+
+    if( end == line.c_str() )
+        throwError("bad reply '" + line + "'");
+
+    msg = ( *end == ' ' ) ? string(end + 1) : string(end);
+    return status;
+}
+// -----------------------------------------------------------------------------
+size_t RRDCachedClient::batch( const std::vector<Update>& upd, std::vector<std::string>& errors )
+{
+    if( upd.empty() )
+        return 0;
+
+    if( fd < 0 )
+        connect();
+
+    // команды внутри BATCH не подтверждаются по отдельности,
+    // поэтому отправляем всё сразу и читаем только итог
+    ostringstream q;
+    q << "BATCH\n";
+
+    for( const auto& u : upd )
+    {
+        q << "UPDATE " << u.filename;
+
+        for( const auto& v : u.values )
+            q << " " << v;
+
+        q << "\n";
+    }
+
+    q << ".\n";
+
+    sendAll(q.str());
+
+    string msg;
+
+    if( readStatus(msg) < 0 )
+        throwError("BATCH: " + msg);
+
+    int nerr = readStatus(msg);
+
+    if( nerr < 0 )
+        throwError("BATCH: " + msg);
+
+    for( int i = 0; i < nerr; i++ )
+        errors.push_back(readLine());
+
+    return nerr;
+}
+// -----------------------------------------------------------------------------
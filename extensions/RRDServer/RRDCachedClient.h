@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -----------------------------------------------------------------------------
+#ifndef _RRDCachedClient_H_
+#define _RRDCachedClient_H_
+// -----------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+// --------------------------------------------------------------------------
+namespace uniset
+{
+    // -----------------------------------------------------------------------------
+    /*! Клиент для rrdcached (см. rrdcached(1), раздел PROTOCOL).
+     * Все обновления отправляются одной командой BATCH (один обмен на всю пачку файлов).
+     *
+     * Адрес задаётся так же как для rrdtool (--daemon):
+     * - "unix:/path/to/socket" или "/path/to/socket" - unix-сокет
+     * - "host" или "host:port" (по умолчанию порт 42217) - TCP
+     *
+     * Все операции (в том числе подключение) ограничены по времени (timeout_msec),
+     * т.к. вызываются из потока обработки сообщений.
+     */
+    class RRDCachedClient
+    {
+        public:
+            explicit RRDCachedClient( const std::string& addr, int timeout_msec = 5000 );
+            ~RRDCachedClient();
+
+            /*! \throw SystemError при ошибке подключения */
+            void connect();
+            void disconnect() noexcept;
+
+            inline bool isConnected() const noexcept
+            {
+                return ( fd >= 0 );
+            }
+
+            inline std::string getAddress() const noexcept
+            {
+                return addr;
+            }
+
+            inline bool isUnixSocket() const noexcept
+            {
+                return unixSocket;
+            }
+
+            struct Update
+            {
+                std::string filename;
+                std::vector<std::string> values; // "timestamp:v1:v2:..." в порядке возрастания времени
+            };
+
+            /*! отправить обновления одной командой BATCH (при необходимости выполняется подключение)
+             * \param errors - ошибки по отдельным командам в виде "номер_команды сообщение" (нумерация с 1)
+             * \return количество ошибок
+             * \throw SystemError при ошибке связи (соединение при этом закрывается)
+             */
+            size_t batch( const std::vector<Update>& upd, std::vector<std::string>& errors );
+
+            static const int DefaultPort = 42217;
+
+        protected:
+            // \return пустая строка или текст ошибки
+            std::string connectSocket( int sock, const struct sockaddr* sa, socklen_t salen );
+            void sendAll( const std::string& data );
+            std::string readLine();
+            int readStatus( std::string& msg );
+            void throwError( const std::string& err );
+
+        private:
+            std::string addr;
+            int tout;
+            bool unixSocket = { false };
+            int fd = { -1 };
+            std::string rbuf;
+    };
+    // --------------------------------------------------------------------------
+} // end of namespace uniset
+// -----------------------------------------------------------------------------
+#endif // _RRDCachedClient_H_
+// -----------------------------------------------------------------------------
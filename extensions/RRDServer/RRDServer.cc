@@ -19,7 +19,11 @@ extern "C" {
 }
 #include <cmath>
 #include <sstream>
+#include <climits>
+#include <algorithm>
+#include <unistd.h>
 #include "Exceptions.h"
+#include "unisetstd.h"
 #include "RRDServer.h"
 // -----------------------------------------------------------------------------
 using namespace std;
@@ -40,6 +44,27 @@ RRDServer::RRDServer(uniset::ObjectId objId, xmlNode* cnode, uniset::ObjectId sh
 
     UniXML::iterator it(cnode);
 
+    cacheSamples = conf->getArgPInt("--" + prefix + "-cache-samples", it.getProp("cacheSamples"), cacheSamples);
+    cacheMax = conf->getArgPInt("--" + prefix + "-cache-max", it.getProp("cacheMax"), cacheMax);
+    flushTime = conf->getArgPInt("--" + prefix + "-flush-time", it.getProp("flushTime"), flushTime);
+
+    const string rrdcachedAddr = conf->getArg2Param("--" + prefix + "-rrdcached", it.getProp("rrdcached"), "");
+
+    if( !rrdcachedAddr.empty() )
+    {
+        int tout = conf->getArgPInt("--" + prefix + "-rrdcached-timeout", it.getProp("rrdcachedTimeout"), 5000);
+        rrdcached = unisetstd::make_unique<RRDCachedClient>(rrdcachedAddr, tout);
+    }
+
+    if( cacheMax < cacheSamples )
+        cacheMax = cacheSamples;
+
+    myinfo << myname << "(init): cacheSamples=" << cacheSamples
+           << " cacheMax=" << cacheMax
+           << " flushTime=" << flushTime
+           << " rrdcached='" << rrdcachedAddr << "'"
+           << endl;
+
     UniXML::iterator it1(cnode);
 
     if( !it1.goChildren() )
@@ -92,6 +117,7 @@ void RRDServer::initRRD( xmlNode* cnode, int tmID )
     int rrdstep = it.getPIntProp("step", 5);
     int lastup =  it.getPIntProp("lastup", 0);
     bool overwrite = it.getPIntProp("overwrite", 0);
+    size_t csamples = it.getPIntProp("cache_samples", cacheSamples);
 
     myinfo << myname << "(init): add rrd: file='" << fname
            << " " << ff << "='" << fv
@@ -257,7 +283,18 @@ void RRDServer::initRRD( xmlNode* cnode, int tmID )
 
         delete[] argv;
 
+        // rrdcached (через unix-сокет) работает в своём текущем каталоге
+        if( rrdcached && rrdcached->isUnixSocket() && !fname.empty() && fname[0] != '/' )
+        {
+            char cwd[PATH_MAX];
+
+            if( getcwd(cwd, sizeof(cwd)) )
+                fname = string(cwd) + "/" + fname;
+        }
+
         rrdlist.emplace_back(fname, tmID, rrdstep, dslist);
+        rrdlist.back().cacheSamples = std::min(std::max(csamples, (size_t)1), cacheMax);
+        rrdlist.back().cache.reserve(rrdlist.back().cacheSamples);
     }
 }
 //--------------------------------------------------------------------------------
@@ -266,6 +303,11 @@ void RRDServer::help_print( int argc, const char* const* argv )
     cout << " Default prefix='rrd'" << endl;
     cout << "--prefix-name        - ID for rrdstorage. Default: RRDServer1. " << endl;
     cout << "--prefix-confnode    - configuration section name. Default: <NAME name='NAME'...> " << endl;
+    cout << "--prefix-cache-samples num   - Number of samples collected before writing to file. Default: 1" << endl;
+    cout << "--prefix-cache-max num       - Max samples kept per file while rrdcached unavailable. Default: 1000" << endl;
+    cout << "--prefix-flush-time msec     - Period for writing collected samples. Default: 0 - at each step" << endl;
+    cout << "--prefix-rrdcached addr      - Send updates to rrdcached: unix:/path | /path | host[:port]. Default: '' (direct write)" << endl;
+    cout << "--prefix-rrdcached-timeout msec - Timeout for rrdcached reply. Default: 5000" << endl;
     cout << "--prefix-heartbeat-id name   - ID for heartbeat sensor." << endl;
     cout << "--prefix-heartbeat-max val   - max value for heartbeat sensor." << endl;
     cout << endl;
@@ -365,6 +407,23 @@ void RRDServer::sysCommand( const uniset::SystemMessage* sm )
                 mycrit << myname << "(askTimer): " << ex.what() << endl;
             }
         }
+
+        if( flushTime > 0 )
+        {
+            try
+            {
+                askTimer(tmFlushCache, flushTime);
+            }
+            catch( const std::exception& ex )
+            {
+                mycrit << myname << "(askTimer): " << ex.what() << endl;
+            }
+        }
+    }
+    else if( sm->command == SystemMessage::Finish || sm->command == SystemMessage::FoldUp )
+    {
+        // записываем всё что накопили
+        flushCache(true);
     }
 }
 // -----------------------------------------------------------------------------
@@ -383,35 +442,160 @@ void RRDServer::sensorInfo( const uniset::SensorMessage* sm )
 // -----------------------------------------------------------------------------
 void RRDServer::timerInfo( const uniset::TimerMessage* tm )
 {
-    for( const auto& it : rrdlist )
+    if( tm->id == tmFlushCache )
+    {
+        flushCache(false);
+        return;
+    }
+
+    for( auto&& it : rrdlist )
     {
         if( it.tid == tm->id )
         {
-            ostringstream v;
-            v << time(0);
+            it.cache.push_back( makeSample(it) );
 
-            // здесь идём по списку (а не dsmap)
-            // т.к. важна последовательность
-            for( const auto& s : it.dslist )
-                v << ":" << s->value;
+            myinfo << myname << "(update): '" << it.filename << "' " << it.cache.back()
+                   << " (cache " << it.cache.size() << "/" << it.cacheSamples << ")" << endl;
 
-            myinfo << myname << "(update): '" << it.filename << "' " << v.str() << endl;
-
-            rrd_clear_error();
-
-            const std::string tmp(v.str()); // надежда на RVO оптимизацию
-            const char* argv = tmp.c_str();
-
-            if( rrd_update_r(it.filename.c_str(), NULL, 1, &argv) < 0 )
+            // если rrdcached недоступен, храним не больше cacheMax значений
+            if( it.cache.size() > cacheMax )
             {
-                ostringstream err;
-                err << myname << "(update): Can`t update RRD ('" << it.filename << "'): err: " << string(rrd_get_error());
-                mycrit << err.str() << endl;
+                size_t n = it.cache.size() - cacheMax;
+                it.cache.erase(it.cache.begin(), it.cache.begin() + n);
+                statLost += n;
             }
 
             break;
         }
     }
+
+    if( flushTime == 0 )
+        flushCache(false);
+}
+// -----------------------------------------------------------------------------
+std::string RRDServer::makeSample( const RRDInfo& rrd ) const
+{
+    ostringstream v;
+    v << time(0);
+
+    // здесь идём по списку (а не dsmap)
+    // т.к. важна последовательность
+    for( const auto& s : rrd.dslist )
+        v << ":" << s->value;
+
+    return v.str();
+}
+// -----------------------------------------------------------------------------
+void RRDServer::flushCache( bool force )
+{
+    if( rrdcached )
+    {
+        writeRRDCached(force);
+        return;
+    }
+
+    for( auto&& it : rrdlist )
+    {
+        if( !it.cache.empty() && ( force || it.cache.size() >= it.cacheSamples ) )
+            writeDirect(it);
+    }
+}
+// -----------------------------------------------------------------------------
+void RRDServer::writeDirect( RRDInfo& rrd )
+{
+    // все накопленные значения записываем одним вызовом (за одно открытие файла)
+    std::vector<const char*> argv;
+    argv.reserve(rrd.cache.size());
+
+    for( const auto& v : rrd.cache )
+        argv.push_back(v.c_str());
+
+    rrd_clear_error();
+
+    if( rrd_update_r(rrd.filename.c_str(), NULL, argv.size(), argv.data()) < 0 )
+    {
+        ostringstream err;
+        err << myname << "(update): Can`t update RRD ('" << rrd.filename << "'): err: " << string(rrd_get_error());
+        mycrit << err.str() << endl;
+        statErrors++;
+    }
+    else
+    {
+        statUpdates++;
+        statSamples += rrd.cache.size();
+    }
+
+    rrd.cache.clear();
+}
+// -----------------------------------------------------------------------------
+void RRDServer::writeRRDCached( bool force )
+{
+    std::vector<RRDCachedClient::Update> upd;
+    std::vector<RRDInfo*> wlist;
+
+    for( auto&& it : rrdlist )
+    {
+        if( !it.cache.empty() && ( force || it.cache.size() >= it.cacheSamples ) )
+        {
+            upd.emplace_back();
+            upd.back().filename = it.filename;
+            upd.back().values = std::move(it.cache);
+            it.cache.clear();
+            wlist.push_back(&it);
+        }
+    }
+
+    if( upd.empty() )
+        return;
+
+    try
+    {
+        std::vector<std::string> errors;
+        size_t nerr = rrdcached->batch(upd, errors);
+
+        statBatches++;
+        statUpdates += upd.size();
+        statErrors += nerr;
+
+        for( const auto& u : upd )
+            statSamples += u.values.size();
+
+        // ошибки в виде "номер_команды сообщение"
+        for( const auto& e : errors )
+            mycrit << myname << "(update): rrdcached error: " << e << endl;
+
+        myinfo << myname << "(update): rrdcached: " << upd.size() << " files" << endl;
+    }
+    catch( const std::exception& ex )
+    {
+        mycrit << myname << "(update): " << ex.what() << endl;
+
+        // возвращаем значения обратно в кэш (до следующей попытки)
+        for( size_t i = 0; i < wlist.size(); i++ )
+            wlist[i]->cache = std::move(upd[i].values);
+    }
+}
+// -----------------------------------------------------------------------------
+std::string RRDServer::getMonitInfo() const
+{
+    ostringstream inf;
+
+    inf << "RRD files: " << rrdlist.size()
+        << " [ cacheSamples=" << cacheSamples
+        << " cacheMax=" << cacheMax
+        << " flushTime=" << flushTime
+        << " ]" << endl;
+
+    if( rrdcached )
+        inf << "  rrdcached: " << rrdcached->getAddress() << " " << ( rrdcached->isConnected() ? "CONNECTED" : "NOT CONNECTED" )
+            << " batches=" << statBatches << endl;
+
+    inf << "    updates: " << statUpdates << endl
+        << "    samples: " << statSamples << endl
+        << "     errors: " << statErrors << endl
+        << "       lost: " << statLost << endl;
+
+    return inf.str();
 }
 // -----------------------------------------------------------------------------
 RRDServer::RRDInfo::RRDInfo(const string& fname, long tmID, long sec, const RRDServer::DSList& lst):
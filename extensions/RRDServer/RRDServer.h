@@ -24,6 +24,7 @@
 #include "SMInterface.h"
 #include "SharedMemory.h"
 #include "extensions/Extensions.h"
+#include "RRDCachedClient.h"
 // --------------------------------------------------------------------------
 namespace uniset
 {
@@ -34,6 +35,7 @@ namespace uniset
       - \ref sec_RRD_Comm
       - \ref sec_RRD_Conf
       - \ref sec_RRD_DSName
+      - \ref sec_RRD_Cache
 
     \section sec_RRD_Comm Общее описание RRDServer
 
@@ -79,6 +81,32 @@ namespace uniset
     \section sec_RRD_DSName Именование параметров
        По умолчанию в качестве имени параметра берётся поле \b 'ds_field'_dsname='', если это поле не указано, то берётся \b name датчика.
     \warning Имя не может превышать RRDServer::RRD_MAX_DSNAME_LEN.
+
+    \section sec_RRD_Cache Накопление и пакетная запись
+       По умолчанию на каждом шаге (step) файл обновляется сразу (rrd_update_r), т.е. при большом
+    количестве rrd-файлов каждую секунду происходит много операций открытия и перезаписи файлов.
+    Для снижения нагрузки на диск предусмотрены:
+    - \b cacheSamples (--prefix-cache-samples) - количество значений, накапливаемых в памяти перед записью в файл.
+    Накопленные значения записываются одним вызовом rrd_update_r (с несколькими временными метками).
+    Можно задать для отдельного файла свойством \b cache_samples="..." в секции <rrd>.
+    - \b rrdcached (--prefix-rrdcached) - адрес rrdcached ("unix:/path", "/path", "host[:port]").
+    В этом случае обновления отправляются в rrdcached, а накопленные значения всех файлов
+    передаются одной командой BATCH. Относительные имена файлов для unix-сокета
+    дополняются текущим каталогом процесса.
+    - \b flushTime (--prefix-flush-time) - период (мсек) проверки и записи накопленных значений.
+    По умолчанию 0 - запись сразу на шаге файла. Для rrdcached имеет смысл задавать период
+    (например 1000), чтобы обновления разных файлов попадали в одну команду BATCH.
+
+    Если rrdcached недоступен, значения остаются в памяти (не более \b cacheMax для каждого файла,
+    более старые отбрасываются) и отправляются после восстановления связи.
+    При завершении работы накопленные значения записываются принудительно.
+
+    \code
+    <RRDServer1 name="RRDServer1" rrdcached="unix:/var/run/rrdcached.sock" cacheSamples="5" flushTime="1000">
+      <rrd filename="rrdtest.rrd" ... cache_samples="10">
+      ...
+    </RRDServer1>
+    \endcode
     */
     // -----------------------------------------------------------------------------
     /*! Реализация хранения на основе RRD */
@@ -116,6 +144,7 @@ namespace uniset
             virtual void sensorInfo( const uniset::SensorMessage* sm ) override;
             virtual void timerInfo( const uniset::TimerMessage* tm ) override;
             virtual void sysCommand( const uniset::SystemMessage* sm ) override;
+            virtual std::string getMonitInfo() const override;
 
             void initRRD( xmlNode* cnode, int tmID );
 
@@ -147,6 +176,9 @@ namespace uniset
                 DSMap dsmap;
                 DSList dslist;
 
+                std::vector<std::string> cache; // накопленные значения "time:v1:v2:..."
+                size_t cacheSamples = { 1 };
+
                 RRDInfo( const std::string& fname, long tmID, long sec, const DSList& lst );
             };
 
@@ -154,6 +186,28 @@ namespace uniset
 
             RRDList rrdlist;
 
+            enum Timers
+            {
+                tmFlushCache = 0 // таймеры rrd-файлов нумеруются с 1
+            };
+
+            std::string makeSample( const RRDInfo& rrd ) const;
+            void flushCache( bool force );
+            void writeDirect( RRDInfo& rrd );
+            void writeRRDCached( bool force );
+
+            size_t cacheSamples = { 1 };
+            size_t cacheMax = { 1000 };
+            timeout_t flushTime = { 0 };
+            std::unique_ptr<RRDCachedClient> rrdcached;
+
+            // статистика (для getMonitInfo)
+            size_t statUpdates = { 0 }; // количество записей (вызовов rrd_update_r или команд UPDATE)
+            size_t statSamples = { 0 }; // записано значений
+            size_t statBatches = { 0 };
+            size_t statErrors = { 0 };
+            size_t statLost = { 0 };
+
         private:
 
             std::string prefix;
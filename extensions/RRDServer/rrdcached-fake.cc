@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -----------------------------------------------------------------------------
+// Простая замена rrdcached для проверки RRDServer (--rrd-rrdcached).
+// Понимает команды PING, UPDATE, BATCH, QUIT. Файлы не изменяет, а только
+// проверяет их наличие и формат значений, считает обновления и
+// раз в секунду выводит статистику.
+// -----------------------------------------------------------------------------
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+// -----------------------------------------------------------------------------
+using namespace std;
+// -----------------------------------------------------------------------------
+struct Client
+{
+    int fd = { -1 };
+    std::string buf;
+    bool batch = { false };
+    size_t cmdnum = { 0 };
+    std::vector<std::string> errors;
+};
+// -----------------------------------------------------------------------------
+static size_t batches = 0;
+static size_t updates = 0;
+static size_t values = 0;
+static size_t errors = 0;
+// -----------------------------------------------------------------------------
+// выполнить UPDATE, вернуть текст ошибки (или пустую строку)
+static std::string doUpdate( std::istringstream& args )
+{
+    string fname;
+    args >> fname;
+
+    if( fname.empty() )
+        return "Usage: UPDATE <filename> <values> [<values> ...]";
+
+    if( access(fname.c_str(), F_OK) != 0 )
+        return "No such file: " + fname;
+
+    size_t n = 0;
+    string v;
+
+    while( args >> v )
+    {
+        if( v.find(':') == string::npos )
+            return "Illegal value: " + v;
+
+        n++;
+    }
+
+    if( n == 0 )
+        return "Usage: UPDATE <filename> <values> [<values> ...]";
+
+    updates++;
+    values += n;
+    return "";
+}
+// -----------------------------------------------------------------------------
+static bool reply( Client& c, const std::string& s )
+{
+    return ::send(c.fd, s.data(), s.size(), MSG_NOSIGNAL) == (ssize_t)s.size();
+}
+// -----------------------------------------------------------------------------
+// обработать принятые строки, вернуть false если соединение нужно закрыть
+static bool processClient( Client& c )
+{
+    size_t pos = 0;
+
+    while( (pos = c.buf.find('\n')) != string::npos )
+    {
+        const string line = c.buf.substr(0, pos);
+        c.buf.erase(0, pos + 1);
+
+        if( c.batch )
+        {
+            if( line == "." )
+            {
+                ostringstream r;
+                r << c.errors.size() << " errors\n";
+
+                for( const auto& e : c.errors )
+                    r << e << "\n";
+
+                c.batch = false;
+                c.errors.clear();
+                batches++;
+
+                if( !reply(c, r.str()) )
+                    return false;
+
+                continue;
+            }
+
+            c.cmdnum++;
+            istringstream args(line);
+            string cmd;
+            args >> cmd;
+
+            string err = ( cmd == "UPDATE" ) ? doUpdate(args) : "Unknown command: " + cmd;
+
+            if( !err.empty() )
+            {
+                errors++;
+                c.errors.push_back(std::to_string(c.cmdnum) + " " + err);
+            }
+
+            continue;
+        }
+
+        istringstream args(line);
+        string cmd;
+        args >> cmd;
+
+        if( cmd == "BATCH" )
+        {
+            c.batch = true;
+            c.cmdnum = 0;
+
+            if( !reply(c, "0 Go ahead.  End with dot '.' on its own line.\n") )
+                return false;
+        }
+        else if( cmd == "UPDATE" )
+        {
+            string err = doUpdate(args);
+
+            if( !err.empty() )
+                errors++;
+
+            if( !reply(c, err.empty() ? "0 errors, enqueued\n" : "-1 " + err + "\n") )
+                return false;
+        }
+        else if( cmd == "PING" )
+        {
+            if( !reply(c, "0 PONG\n") )
+                return false;
+        }
+        else if( cmd == "QUIT" )
+            return false;
+        else if( !reply(c, "-1 Unknown command: " + cmd + "\n") )
+            return false;
+    }
+
+    return true;
+}
+// -----------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+    if( argc > 1 && ( !strcmp(argv[1], "--help") || !strcmp(argv[1], "-h") ) )
+    {
+        cout << "Usage: " << argv[0] << " [socket]" << endl;
+        cout << "Fake rrdcached (PING, UPDATE, BATCH). Default socket: /tmp/rrdcached-fake.sock" << endl;
+        return 0;
+    }
+
+    const string path = ( argc > 1 ) ? argv[1] : "/tmp/rrdcached-fake.sock";
+
+    int lsock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if( lsock < 0 )
+    {
+        perror("socket");
+        return 1;
+    }
+
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strncpy(sa.sun_path, path.c_str(), sizeof(sa.sun_path) - 1);
+    unlink(path.c_str());
+
+    if( ::bind(lsock, (struct sockaddr*)&sa, sizeof(sa)) < 0 || ::listen(lsock, 16) < 0 )
+    {
+        perror("bind/listen");
+        return 1;
+    }
+
+    cout << "(rrdcached-fake): listen " << path << endl;
+
+    std::vector<Client> clients;
+    std::vector<struct pollfd> pfd;
+    char rbuf[64 * 1024];
+
+    auto tstart = std::chrono::steady_clock::now();
+    size_t lastValues = 0;
+
+    while( true )
+    {
+        pfd.clear();
+        pfd.push_back({ lsock, POLLIN, 0 });
+
+        for( const auto& c : clients )
+            pfd.push_back({ c.fd, POLLIN, 0 });
+
+        int n = ::poll(pfd.data(), pfd.size(), 200);
+
+        if( n < 0 && errno != EINTR )
+        {
+            perror("poll");
+            break;
+        }
+
+        if( n > 0 )
+        {
+            if( pfd[0].revents & POLLIN )
+            {
+                int fd = ::accept(lsock, nullptr, nullptr);
+
+                if( fd >= 0 )
+                {
+                    Client c;
+                    c.fd = fd;
+                    clients.push_back(c);
+                }
+            }
+
+            for( size_t i = 1; i < pfd.size(); i++ )
+            {
+                if( !(pfd[i].revents & (POLLIN | POLLHUP | POLLERR)) )
+                    continue;
+
+                Client& c = clients[i - 1];
+                ssize_t r = ::recv(c.fd, rbuf, sizeof(rbuf), 0);
+
+                if( r > 0 )
+                {
+                    c.buf.append(rbuf, r);
+
+                    if( processClient(c) )
+                        continue;
+                }
+
+                ::close(c.fd);
+                c.fd = -1;
+            }
+
+            clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client & c )
+            {
+                return c.fd < 0;
+            }), clients.end());
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto msec = std::chrono::duration_cast<std::chrono::milliseconds>(now - tstart).count();
+
+        if( msec >= 1000 )
+        {
+            if( values != lastValues )
+            {
+                cout << "(rrdcached-fake): " << ((values - lastValues) * 1000 / msec) << " values/sec"
+                     << " [batches=" << batches << " updates=" << updates << " values=" << values
+                     << " errors=" << errors << " clients=" << clients.size() << "]" << endl;
+            }
+
+            lastValues = values;
+            tstart = now;
+        }
+    }
+
+    ::close(lsock);
+    unlink(path.c_str());
+    return 0;
+}
+// -----------------------------------------------------------------------------
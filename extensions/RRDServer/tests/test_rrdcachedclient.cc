@@ -0,0 +1,119 @@
+#include <catch.hpp>
+// -----------------------------------------------------------------------------
+#include <chrono>
+#include <fstream>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "Exceptions.h"
+#include "RRDCachedClient.h"
+// -----------------------------------------------------------------------------
+using namespace std;
+using namespace uniset;
+// -----------------------------------------------------------------------------
+static const std::string sockPath = "/tmp/uniset-rrdcached-fake-test.sock";
+static const std::string rrdFile = "rrdcached-test.rrd";
+// -----------------------------------------------------------------------------
+// rrdcached-fake (собирается в каталоге RRDServer) в отдельном процессе
+class FakeRRDCached
+{
+    public:
+        FakeRRDCached()
+        {
+            unlink(sockPath.c_str());
+            pid = fork();
+
+            if( pid == 0 )
+            {
+                execl("../rrdcached-fake", "rrdcached-fake", sockPath.c_str(), (char*)nullptr);
+                _exit(1);
+            }
+
+            for( int i = 0; i < 50 && access(sockPath.c_str(), F_OK) != 0; i++ )
+                usleep(100000);
+        }
+
+        ~FakeRRDCached()
+        {
+            stop();
+        }
+
+        void stop()
+        {
+            if( pid > 0 )
+            {
+                kill(pid, SIGTERM);
+                waitpid(pid, nullptr, 0);
+                pid = -1;
+            }
+
+            unlink(sockPath.c_str());
+        }
+
+    private:
+        pid_t pid = { -1 };
+};
+// -----------------------------------------------------------------------------
+TEST_CASE("[RRDCachedClient]: batch", "[rrdcached]")
+{
+    FakeRRDCached fake;
+    REQUIRE( access(sockPath.c_str(), F_OK) == 0 );
+
+    // fake проверяет только наличие файла
+    std::ofstream(rrdFile).close();
+
+    RRDCachedClient c("unix:" + sockPath, 2000);
+    REQUIRE( c.isUnixSocket() );
+    REQUIRE_FALSE( c.isConnected() );
+
+    std::vector<RRDCachedClient::Update> upd =
+    {
+        { rrdFile, { "1000:1", "1001:2" } },
+        { "nofile.rrd", { "1000:1" } },
+        { rrdFile, { "badvalue" } },
+        { rrdFile, { "1002:3" } }
+    };
+
+    std::vector<std::string> errors;
+    REQUIRE( c.batch(upd, errors) == 2 );
+    REQUIRE( c.isConnected() );
+    REQUIRE( errors.size() == 2 );
+    REQUIRE( errors[0].find("2 No such file") == 0 );
+    REQUIRE( errors[1].find("3 Illegal value") == 0 );
+
+    // соединение используется повторно
+    errors.clear();
+    upd.resize(1);
+    REQUIRE( c.batch(upd, errors) == 0 );
+    REQUIRE( errors.empty() );
+
+    // пустая пачка ничего не посылает
+    REQUIRE( c.batch({}, errors) == 0 );
+
+    // rrdcached "упал"
+    fake.stop();
+    REQUIRE_THROWS_AS( c.batch(upd, errors), uniset::SystemError );
+    REQUIRE_FALSE( c.isConnected() );
+
+    unlink(rrdFile.c_str());
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[RRDCachedClient]: connect timeout", "[rrdcached][timeout]")
+{
+    // нет процесса на сокете
+    unlink(sockPath.c_str());
+    RRDCachedClient c1(sockPath, 500);
+    REQUIRE_THROWS_AS( c1.connect(), uniset::SystemError );
+
+    // недоступный адрес: подключение не должно ждать дольше таймаута
+    // (в зависимости от сети ошибка может быть и сразу)
+    RRDCachedClient c2("10.255.255.1:42217", 300);
+    REQUIRE_FALSE( c2.isUnixSocket() );
+
+    auto t_start = std::chrono::steady_clock::now();
+    REQUIRE_THROWS_AS( c2.connect(), uniset::SystemError );
+    auto msec = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t_start).count();
+    REQUIRE( msec < 2000 );
+    REQUIRE_FALSE( c2.isConnected() );
+}
+// -----------------------------------------------------------------------------
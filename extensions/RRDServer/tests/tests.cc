@@ -0,0 +1,4 @@
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+// тут нет main().. она спрятана в catch.hpp
@@ -234,6 +234,7 @@ bool MulticastReceiveTransport::createConnection( bool throwEx, timeout_t readTi
 
         udp = unisetstd::make_unique<MulticastSocketU>(host, port);
         udp->setBlocking(!noblock);
+        kernelDropsOn = UNetBatchIO::enableKernelDrops(udp->getSocket());
 
         for( const auto& s : groups )
             udp->joinGroup(s, iface);
@@ -283,6 +284,16 @@ ssize_t MulticastReceiveTransport::receive( void* r_buf, size_t sz )
     return udp->receiveBytes(r_buf, sz);
 }
 // -------------------------------------------------------------------------
+ssize_t MulticastReceiveTransport::receiveBatch( UNetBuffer* bufs, size_t num )
+{
+    return UNetBatchIO::recv(udp->getSocket(), bufs, num, &kernelDrops);
+}
+// -------------------------------------------------------------------------
+long MulticastReceiveTransport::getKernelDrops() const noexcept
+{
+    return kernelDropsOn ? (long)kernelDrops.load() : -1;
+}
+// -------------------------------------------------------------------------
 bool MulticastReceiveTransport::isReadyForReceive( timeout_t tout ) noexcept
 {
     try
@@ -520,6 +531,18 @@ ssize_t MulticastSendTransport::send( const void* buf, size_t sz )
     return udp->sendTo(buf, sz, toAddr);
 }
 // -------------------------------------------------------------------------
+ssize_t MulticastSendTransport::sendBatch( const UNetBuffer* bufs, size_t num )
+{
+    return UNetBatchIO::send(udp->getSocket(), toAddr.addr(), toAddr.length(), bufs, num);
+}
+// -------------------------------------------------------------------------
+bool MulticastSendTransport::getDestination( const struct sockaddr*& addr, socklen_t& len ) const noexcept
+{
+    addr = toAddr.addr();
+    len = toAddr.length();
+    return true;
+}
+// -------------------------------------------------------------------------
 Poco::Net::SocketAddress MulticastSendTransport::getGroupAddress()
 {
     return toAddr;
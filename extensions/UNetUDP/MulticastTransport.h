@@ -49,6 +49,8 @@ namespace uniset
 
             bool isReadyForReceive( timeout_t tout ) noexcept override;
             virtual ssize_t receive(void* r_buf, size_t sz) override;
+            virtual ssize_t receiveBatch( UNetBuffer* bufs, size_t num ) override;
+            virtual long getKernelDrops() const noexcept override;
             virtual int available() override;
             std::string iface() const;
 
@@ -56,6 +58,8 @@ namespace uniset
             std::unique_ptr <MulticastSocketU> udp;
             const std::string host;
             const int port;
+            std::atomic<uint32_t> kernelDrops = { 0 }; // SO_RXQ_OVFL
+            bool kernelDropsOn = { false };
             const std::vector<Poco::Net::IPAddress> groups;
             const std::string ifaceaddr;
     };
@@ -80,6 +84,8 @@ namespace uniset
             // write
             virtual bool isReadyForSend(timeout_t tout) noexcept override;
             virtual ssize_t send(const void* buf, size_t sz) override;
+            virtual ssize_t sendBatch( const UNetBuffer* bufs, size_t num ) override;
+            virtual bool getDestination( const struct sockaddr*& addr, socklen_t& len ) const noexcept override;
 
             void setTimeToLive( int ttl );
             void setLoopBack( bool state );
@@ -15,8 +15,13 @@
  */
 // -------------------------------------------------------------------------
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <endian.h>
 #include "UDPPacket.h"
+#ifndef DISABLE_LZ4
+#include <lz4.h>
+#endif
 // -------------------------------------------------------------------------
 // сделано так, чтобы макросы раскрывались в "пустоту" если не требуется преобразование
 // поэтому использование выглядит как LE_TO_H( myvar ), а не
@@ -132,7 +137,70 @@ namespace uniset
         return crc;
     }
     // -------------------------------------------------------------------------
-    uint16_t UniSetUDP::makeCRC( unsigned char* buf, size_t len ) noexcept
+    // Таблицы для расчёта crc по 8 байт за шаг ("slice-by-8").
+    // tab[0] - обычная таблица (crc_16_tab), tab[k][i] - вклад байта i,
+    // за которым следует k нулевых байт. Результат совпадает с get_crc_16().
+    struct CRC16Tables
+    {
+        uint16_t tab[8][256];
+    };
+
+    static constexpr CRC16Tables makeCRC16Tables() noexcept
+    {
+        CRC16Tables t{};
+
+        for( size_t i = 0; i < 256; i++ )
+        {
+            uint16_t crc = i;
+
+            for( size_t b = 0; b < 8; b++ )
+                crc = (crc & 1) ? ((crc >> 1) ^ 0xa001) : (crc >> 1);
+
+            t.tab[0][i] = crc;
+        }
+
+        for( size_t k = 1; k < 8; k++ )
+        {
+            for( size_t i = 0; i < 256; i++ )
+                t.tab[k][i] = (t.tab[k - 1][i] >> 8) ^ t.tab[0][ t.tab[k - 1][i] & 0xff ];
+        }
+
+        return t;
+    }
+
+    static constexpr CRC16Tables crc16 = makeCRC16Tables();
+    // -------------------------------------------------------------------------
+    static uint16_t get_crc_16_slice8( uint16_t crc, const unsigned char* buf, size_t size ) noexcept
+    {
+        const auto& t = crc16.tab;
+
+        while( size >= 8 )
+        {
+            crc = t[7][ (buf[0] ^ crc) & 0xff ]
+                  ^ t[6][ (buf[1] ^ (crc >> 8)) & 0xff ]
+                  ^ t[5][ buf[2] ]
+                  ^ t[4][ buf[3] ]
+                  ^ t[3][ buf[4] ]
+                  ^ t[2][ buf[5] ]
+                  ^ t[1][ buf[6] ]
+                  ^ t[0][ buf[7] ];
+
+            buf += 8;
+            size -= 8;
+        }
+
+        while( size-- )
+            crc = (crc >> 8) ^ t[0][ (crc ^ * (buf++)) & 0xff ];
+
+        return crc;
+    }
+    // -------------------------------------------------------------------------
+    uint16_t UniSetUDP::makeCRC( const unsigned char* buf, size_t len ) noexcept
+    {
+        return get_crc_16_slice8(0xffff, buf, len);
+    }
+    // -------------------------------------------------------------------------
+    uint16_t UniSetUDP::makeCRC_bytewise( const unsigned char* buf, size_t len ) noexcept
     {
         uint16_t crc = 0xffff;
         crc = get_crc_16(crc, (unsigned char*)(buf), len);
@@ -276,36 +344,45 @@ namespace uniset
     // -----------------------------------------------------------------------------
     bool UDPMessage::isOk() noexcept
     {
-        return ( header.magic == UniSetUDP::UNETUDP_MAGICNUM );
+        return ( header.magic == UniSetUDP::UNETUDP_MAGICNUM || header.magic == UniSetUDP::UNETUDP_DELTA_MAGICNUM );
     }
     // -----------------------------------------------------------------------------
-    void UDPMessage::ntoh() noexcept
+    // перевод полей заголовка в порядок байт узла (без изменения _be_order)
+    static void header_ntoh( UDPHeader& h ) noexcept
     {
         // byte order from packet
-        uint8_t be_order = header._be_order;
+        uint8_t be_order = h._be_order;
 
         if( be_order && !HostIsBigEndian )
         {
-            BE32_TO_H(header.magic);
-            BE_TO_H(header.num);
-            BE_TO_H(header.procID);
-            BE_TO_H(header.nodeID);
-            BE_TO_H(header.dcount);
-            BE_TO_H(header.acount);
-            BE16_TO_H(header.dcrc);
-            BE16_TO_H(header.acrc);
+            BE32_TO_H(h.magic);
+            BE_TO_H(h.num);
+            BE_TO_H(h.procID);
+            BE_TO_H(h.nodeID);
+            BE_TO_H(h.dcount);
+            BE_TO_H(h.acount);
+            BE16_TO_H(h.dcrc);
+            BE16_TO_H(h.acrc);
         }
         else if( !be_order && HostIsBigEndian )
         {
-            LE32_TO_H(header.magic);
-            LE_TO_H(header.num);
-            LE_TO_H(header.procID);
-            LE_TO_H(header.nodeID);
-            LE_TO_H(header.dcount);
-            LE_TO_H(header.acount);
-            LE16_TO_H(header.dcrc);
-            LE16_TO_H(header.acrc);
+            LE32_TO_H(h.magic);
+            LE_TO_H(h.num);
+            LE_TO_H(h.procID);
+            LE_TO_H(h.nodeID);
+            LE_TO_H(h.dcount);
+            LE_TO_H(h.acount);
+            LE16_TO_H(h.dcrc);
+            LE16_TO_H(h.acrc);
         }
+    }
+    // -----------------------------------------------------------------------------
+    void UDPMessage::ntoh() noexcept
+    {
+        // byte order from packet
+        uint8_t be_order = header._be_order;
+
+        header_ntoh(header);
 
         // set host byte order
 #if __BYTE_ORDER == __LITTLE_ENDIAN
@@ -348,6 +425,95 @@ namespace uniset
         }
     }
     // -----------------------------------------------------------------------------
+    static inline size_t dDataBytes( size_t dcount ) noexcept
+    {
+        return (dcount + 7) / 8;
+    }
+    // -----------------------------------------------------------------------------
+    size_t UDPMessage::compactSize() const noexcept
+    {
+        return sizeof(UDPHeader)
+               + header.acount * sizeof(UDPAData)
+               + header.dcount * sizeof(int32_t)
+               + dDataBytes(header.dcount);
+    }
+    // -----------------------------------------------------------------------------
+    size_t UDPMessage::serialize( uint8_t* buf, size_t bufsize, bool delta ) const noexcept
+    {
+        const size_t sz = compactSize();
+
+        if( bufsize < sz )
+            return 0;
+
+        uint8_t* p = buf;
+        memcpy(p, &header, sizeof(UDPHeader));
+
+        // заголовок передаётся в порядке байт узла, поэтому и magic тоже
+        const uint32_t magic = delta ? UNETUDP_DELTA_MAGICNUM : UNETUDP_COMPACT_MAGICNUM;
+        memcpy(p, &magic, sizeof(magic));
+        p += sizeof(UDPHeader);
+
+        memcpy(p, a_dat, header.acount * sizeof(UDPAData));
+        p += header.acount * sizeof(UDPAData);
+
+        memcpy(p, d_id, header.dcount * sizeof(int32_t));
+        p += header.dcount * sizeof(int32_t);
+
+        memcpy(p, d_dat, dDataBytes(header.dcount));
+        return sz;
+    }
+    // -----------------------------------------------------------------------------
+    bool UDPMessage::deserialize( const uint8_t* buf, size_t sz ) noexcept
+    {
+        if( sz < sizeof(UDPHeader) )
+            return false;
+
+        // сперва разбираем заголовок, чтобы определить формат и количество данных
+        UDPHeader h;
+        memcpy(&h, buf, sizeof(UDPHeader));
+        header_ntoh(h);
+
+        if( h.acount > MaxACount || h.dcount > MaxDCount )
+            return false;
+
+        if( h.magic == UNETUDP_MAGICNUM )
+        {
+            if( sz != sizeof(UDPMessage) )
+                return false;
+
+            memcpy(this, buf, sz);
+        }
+        else if( h.magic == UNETUDP_COMPACT_MAGICNUM || h.magic == UNETUDP_DELTA_MAGICNUM )
+        {
+            const size_t asz = h.acount * sizeof(UDPAData);
+            const size_t isz = h.dcount * sizeof(int32_t);
+            const size_t bsz = dDataBytes(h.dcount);
+
+            if( sz < sizeof(UDPHeader) + asz + isz + bsz )
+                return false;
+
+            const uint8_t* p = buf;
+            memcpy(&header, p, sizeof(UDPHeader));
+            p += sizeof(UDPHeader);
+
+            memcpy(a_dat, p, asz);
+            p += asz;
+
+            memcpy(d_id, p, isz);
+            p += isz;
+
+            memcpy(d_dat, p, bsz);
+        }
+        else
+            return false;
+
+        ntoh();
+
+        // дальше сообщение обрабатывается одинаково, независимо от формата
+        header.magic = ( h.magic == UNETUDP_DELTA_MAGICNUM ) ? UNETUDP_DELTA_MAGICNUM : UNETUDP_MAGICNUM;
+        return true;
+    }
+    // -----------------------------------------------------------------------------
     void UDPMessage::updatePacketCrc() noexcept
     {
         header.dcrc = calcDcrc();
@@ -356,15 +522,171 @@ namespace uniset
     // -----------------------------------------------------------------------------
     uint16_t UDPMessage::calcDcrc() const noexcept
     {
+        // считаем только по заполненной части
         uint16_t crc[2];
-        crc[0] = makeCRC( (unsigned char*)(d_id), sizeof(d_id) );
-        crc[1] = makeCRC( (unsigned char*)(d_dat), sizeof(d_dat) );
-        return makeCRC( (unsigned char*)(&crc), sizeof(crc) );
+        crc[0] = makeCRC( (const unsigned char*)(d_id), header.dcount * sizeof(int32_t) );
+        crc[1] = makeCRC( (const unsigned char*)(d_dat), dDataBytes(header.dcount) );
+        return makeCRC( (const unsigned char*)(&crc), sizeof(crc) );
     }
     // -----------------------------------------------------------------------------
     uint16_t UDPMessage::calcAcrc() const noexcept
     {
-        return makeCRC( (unsigned char*)(&a_dat), sizeof(a_dat) );
+        return makeCRC( (const unsigned char*)(&a_dat), header.acount * sizeof(UDPAData) );
+    }
+    // -----------------------------------------------------------------------------
+    // слишком маленькие пакеты не сжимаем (накладные расходы больше выигрыша)
+    static const size_t minCompressSize = 64;
+    // -----------------------------------------------------------------------------
+    bool UniSetUDP::isCompressSupported() noexcept
+    {
+#ifndef DISABLE_LZ4
+        return true;
+#else
+        return false;
+#endif
+    }
+    // -----------------------------------------------------------------------------
+    size_t UniSetUDP::compressBound( size_t sz ) noexcept
+    {
+#ifndef DISABLE_LZ4
+        return sizeof(UDPHeader) + sizeof(uint32_t) + LZ4_compressBound(sz);
+#else
+        return sz;
+#endif
+    }
+    // -----------------------------------------------------------------------------
+    size_t UniSetUDP::compress( const uint8_t* src, size_t sz, uint8_t* dst, size_t dstsize, int accel ) noexcept
+    {
+#ifndef DISABLE_LZ4
+        const size_t hsz = sizeof(UDPHeader) + sizeof(uint32_t);
+
+        if( sz < sizeof(UDPHeader) + minCompressSize || dstsize <= hsz )
+            return 0;
+
+        const size_t rawlen = sz - sizeof(UDPHeader);
+
+        // сжатые данные должны быть меньше исходных, иначе смысла нет
+        // (LZ4 сам прекращает сжатие, если результат не помещается в буфер)
+        const size_t maxlen = std::min(dstsize - hsz, rawlen - sizeof(uint32_t) - 1);
+
+        const int n = LZ4_compress_fast((const char*)src + sizeof(UDPHeader), (char*)dst + hsz, rawlen, maxlen, accel);
+
+        if( n <= 0 )
+            return 0;
+
+        // пакет сформирован узлом-отправителем, т.е. заголовок в порядке байт узла
+        memcpy(dst, src, sizeof(UDPHeader));
+        memcpy(dst, &UNETUDP_LZ4_MAGICNUM, sizeof(UNETUDP_LZ4_MAGICNUM));
+        memcpy(dst + sizeof(UDPHeader), src, sizeof(uint32_t));
+        return hsz + n;
+#else
+        return 0;
+#endif
+    }
+    // -----------------------------------------------------------------------------
+    bool UniSetUDP::isCompressed( const uint8_t* buf, size_t sz ) noexcept
+    {
+        if( sz < sizeof(UDPHeader) + sizeof(uint32_t) )
+            return false;
+
+        UDPHeader h;
+        memcpy(&h, buf, sizeof(UDPHeader));
+        header_ntoh(h);
+        return ( h.magic == UNETUDP_LZ4_MAGICNUM );
+    }
+    // -----------------------------------------------------------------------------
+    size_t UniSetUDP::decompress( const uint8_t* src, size_t sz, uint8_t* dst, size_t dstsize ) noexcept
+    {
+#ifndef DISABLE_LZ4
+        const size_t hsz = sizeof(UDPHeader) + sizeof(uint32_t);
+
+        if( sz <= hsz )
+            return 0;
+
+        UDPHeader h;
+        memcpy(&h, src, sizeof(UDPHeader));
+        header_ntoh(h);
+
+        if( h.magic != UNETUDP_LZ4_MAGICNUM || h.acount > MaxACount || h.dcount > MaxDCount )
+            return 0;
+
+        const size_t rawlen = h.acount * sizeof(UDPAData) + h.dcount * sizeof(int32_t) + dDataBytes(h.dcount);
+
+        if( dstsize <= sizeof(UDPHeader) )
+            return 0;
+
+        // за данными может следовать метка времени (см. addTimestamp()),
+        // поэтому распакованных данных может быть больше чем rawlen
+        const int n = LZ4_decompress_safe((const char*)src + hsz, (char*)dst + sizeof(UDPHeader), sz - hsz, dstsize - sizeof(UDPHeader));
+
+        if( n < 0 || (size_t)n < rawlen )
+            return 0;
+
+        // возвращаем исходный magic (он в порядке байт отправителя, как и весь заголовок)
+        memcpy(dst, src, sizeof(UDPHeader));
+        memcpy(dst, src + sizeof(UDPHeader), sizeof(uint32_t));
+        return sizeof(UDPHeader) + n;
+#else
+        return 0;
+#endif
+    }
+    // -----------------------------------------------------------------------------
+    size_t UniSetUDP::addTimestamp( uint8_t* buf, size_t sz, size_t bufsize, const struct timespec& ts ) noexcept
+    {
+        if( bufsize < sz + sizeof(UDPTimestamp) )
+            return 0;
+
+        // пакет сформирован узлом-отправителем, т.е. в порядке байт узла
+        UDPTimestamp t;
+        t.magic = UNETUDP_TIMESTAMP_MAGICNUM;
+        t.sec = ts.tv_sec;
+        t.nsec = ts.tv_nsec;
+        memcpy(buf + sz, &t, sizeof(t));
+        return sz + sizeof(t);
+    }
+    // -----------------------------------------------------------------------------
+    bool UniSetUDP::getTimestamp( const uint8_t* buf, size_t sz, struct timespec& ts ) noexcept
+    {
+        if( sz < sizeof(UDPHeader) + sizeof(UDPTimestamp) )
+            return false;
+
+        UDPHeader h;
+        memcpy(&h, buf, sizeof(UDPHeader));
+        header_ntoh(h);
+
+        if( h.magic != UNETUDP_COMPACT_MAGICNUM && h.magic != UNETUDP_DELTA_MAGICNUM )
+            return false;
+
+        if( h.acount > MaxACount || h.dcount > MaxDCount )
+            return false;
+
+        const size_t pos = sizeof(UDPHeader) + h.acount * sizeof(UDPAData) + h.dcount * sizeof(int32_t) + dDataBytes(h.dcount);
+
+        if( sz < pos + sizeof(UDPTimestamp) )
+            return false;
+
+        UDPTimestamp t;
+        memcpy(&t, buf + pos, sizeof(t));
+
+        if( h._be_order && !HostIsBigEndian )
+        {
+            t.magic = be32toh(t.magic);
+            t.sec = be64toh(t.sec);
+            t.nsec = be32toh(t.nsec);
+        }
+        else if( !h._be_order && HostIsBigEndian )
+        {
+            t.magic = le32toh(t.magic);
+            t.sec = le64toh(t.sec);
+            t.nsec = le32toh(t.nsec);
+        }
+
+        if( t.magic != UNETUDP_TIMESTAMP_MAGICNUM )
+            return false;
+
+        ts.tv_sec = t.sec;
+        ts.tv_nsec = t.nsec;
+        return true;
     }
     // -----------------------------------------------------------------------------
     UDPHeader::UDPHeader() noexcept
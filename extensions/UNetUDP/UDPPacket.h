@@ -20,6 +20,7 @@
 #include <list>
 #include <limits>
 #include <ostream>
+#include <ctime>
 #include "UniSetTypes.h"
 // --------------------------------------------------------------------------
 namespace uniset
@@ -41,9 +42,46 @@ namespace uniset
             (информация о порядке байт, если специально не выставить, будет выставлена при компиляции, см. конструктор)
             - Узел который принимает данные, декодирует их, если на его узле порядок байт не совпадает.
             Т.е. если все узлы будут иметь одинаковый порядок байт, фактического перекодирования не будет.
+
+            Компактный формат
+            ==================
+            Чтобы не передавать по сети "пустые" данные (и не фрагментировать пакеты), сообщение может
+            передаваться в компактном виде (см. UDPMessage::serialize()). В этом случае в заголовке
+            указывается UNETUDP_COMPACT_MAGICNUM, а за ним подряд следуют только заполненные данные:
+            - UDPAData[acount]
+            - int32_t[dcount] (ID булевых)
+            - uint8_t[(dcount + 7) / 8] (битовые значения)
+
+            Приём (UDPMessage::deserialize()) понимает оба формата, поэтому узлы со старой версией
+            можно обновлять постепенно, включив на время обновления посылку в полном формате.
+
+            Дельта-пакеты
+            ==============
+            Пакет с UNETUDP_DELTA_MAGICNUM имеет компактный формат, но содержит только изменившиеся
+            (с момента предыдущей посылки) данные одного пакета. Между дельта-пакетами периодически
+            посылается пакет с полным состоянием ("ключевой"). См. UNetSender::setKeyFrameCycles().
+
+            Сжатие
+            =======
+            Компактный (или дельта) пакет может передаваться сжатым (LZ4, см. compress()). Тогда в заголовке
+            указывается UNETUDP_LZ4_MAGICNUM (остальные поля заголовка не меняются), а за ним следуют:
+            - uint32_t - исходный magic (в порядке байт отправителя)
+            - сжатые данные пакета (всё что шло после заголовка)
+            Размер исходных данных определяется по acount/dcount из заголовка.
+            Приёмник распаковывает пакет (decompress()) до вызова UDPMessage::deserialize().
+
+            Метка времени
+            ==============
+            В конец пакета в компактном формате может быть добавлена метка времени отправки (UDPTimestamp,
+            см. addTimestamp()). Приёмник без её поддержки лишние данные в конце пакета просто игнорирует.
+            При сжатии метка сжимается вместе с данными.
         */
 
         const uint32_t UNETUDP_MAGICNUM = 0x1348A5F; // идентификатор протокола
+        const uint32_t UNETUDP_COMPACT_MAGICNUM = 0x1348A60; // идентификатор протокола (компактный формат)
+        const uint32_t UNETUDP_DELTA_MAGICNUM = 0x1348A61; // идентификатор протокола (дельта-пакет)
+        const uint32_t UNETUDP_LZ4_MAGICNUM = 0x1348A62; // идентификатор протокола (сжатый пакет)
+        const uint32_t UNETUDP_TIMESTAMP_MAGICNUM = 0x1348A63; // идентификатор метки времени (UDPTimestamp)
 
         struct UDPHeader
         {
@@ -76,6 +114,14 @@ namespace uniset
 
         std::ostream& operator<<( std::ostream& os, UDPAData& p );
 
+        /*! метка времени отправки (CLOCK_REALTIME), передаётся в порядке байт отправителя (см. UDPHeader::_be_order) */
+        struct UDPTimestamp
+        {
+            uint32_t magic; /*!< UNETUDP_TIMESTAMP_MAGICNUM */
+            int64_t sec;
+            int32_t nsec;
+        } __attribute__((packed));
+
         // Теоретический размер данных в UDP пакете (исключая заголовки) 65507
         // Фактически желательно не вылезать за размер MTU (обычно 1500) - заголовки = 1432 байта
         // т.е. надо чтобы sizeof(UDPPacket) < 1432
@@ -90,6 +136,27 @@ namespace uniset
             void ntoh() noexcept;
             bool isOk() noexcept;
 
+            /*! размер сообщения в компактном формате */
+            size_t compactSize() const noexcept;
+
+            /*! записать сообщение в буфер в компактном формате (только заполненные данные)
+             * \param delta - пометить сообщение как дельта-пакет
+             * \return размер записанных данных или 0 если буфер мал (достаточно sizeof(UDPMessage))
+             */
+            size_t serialize( uint8_t* buf, size_t bufsize, bool delta = false ) const noexcept;
+
+            /*! инициализировать сообщение из принятых данных (полный или компактный формат).
+             * Данные сразу переводятся в порядок байт узла (ntoh()), magic выставляется в UNETUDP_MAGICNUM
+             * (или UNETUDP_DELTA_MAGICNUM для дельта-пакетов).
+             * \return false - если данные не являются сообщением или повреждены
+             */
+            bool deserialize( const uint8_t* buf, size_t sz ) noexcept;
+
+            inline bool isDelta() const noexcept
+            {
+                return ( header.magic == UNETUDP_DELTA_MAGICNUM );
+            }
+
             // \warning в случае переполнения возвращается MaxDCount
             size_t addDData( int32_t id, bool val ) noexcept;
 
@@ -136,6 +203,7 @@ namespace uniset
                 return header.acount;
             }
 
+            // crc считается только по заполненным данным (dcount/acount)
             uint16_t calcDcrc() const noexcept;
             uint16_t calcAcrc() const noexcept;
             void updatePacketCrc() noexcept;
@@ -148,7 +216,42 @@ namespace uniset
 
         std::ostream& operator<<( std::ostream& os, UDPMessage& p );
 
-        uint16_t makeCRC( unsigned char* buf, size_t len ) noexcept;
+        // crc16 (x^16 + x^15 + x^2 + 1), расчёт по 8 байт за шаг
+        uint16_t makeCRC( const unsigned char* buf, size_t len ) noexcept;
+
+        // то же самое, но побайтовый расчёт (для проверки и сравнения)
+        uint16_t makeCRC_bytewise( const unsigned char* buf, size_t len ) noexcept;
+
+        /*! поддерживается ли сжатие (библиотека собрана с lz4) */
+        bool isCompressSupported() noexcept;
+
+        /*! размер буфера, достаточный для сжатого пакета */
+        size_t compressBound( size_t sz ) noexcept;
+
+        /*! сжать пакет в компактном формате (см. UDPMessage::serialize())
+         * \param accel - ускорение LZ4 ("fast" режим): 1 - лучшее сжатие, чем больше, тем быстрее и хуже сжатие
+         * \return размер сжатого пакета или 0 если сжатие не уменьшает размер (или не поддерживается)
+         */
+        size_t compress( const uint8_t* src, size_t sz, uint8_t* dst, size_t dstsize, int accel = 1 ) noexcept;
+
+        /*! является ли пакет сжатым */
+        bool isCompressed( const uint8_t* buf, size_t sz ) noexcept;
+
+        /*! распаковать сжатый пакет (размер буфера достаточно sizeof(UDPMessage))
+         * \return размер пакета в компактном формате (вместе с меткой времени, если она есть) или 0 при ошибке
+         */
+        size_t decompress( const uint8_t* src, size_t sz, uint8_t* dst, size_t dstsize ) noexcept;
+
+        /*! добавить в конец пакета в компактном формате метку времени
+         * \param sz - размер пакета (см. UDPMessage::serialize())
+         * \return новый размер пакета или 0 если буфер мал
+         */
+        size_t addTimestamp( uint8_t* buf, size_t sz, size_t bufsize, const struct timespec& ts ) noexcept;
+
+        /*! получить метку времени из пакета в компактном формате (сжатый пакет надо сперва распаковать)
+         * \return false - если метки нет
+         */
+        bool getTimestamp( const uint8_t* buf, size_t sz, struct timespec& ts ) noexcept;
     }
     // --------------------------------------------------------------------------
 } // end of namespace uniset
@@ -91,6 +91,7 @@ bool UDPReceiveTransport::createConnection( bool throwEx, timeout_t readTimeout,
     {
         udp = unisetstd::make_unique<UDPReceiveU>(host, port);
         udp->setBlocking(!noblock);
+        kernelDropsOn = UNetBatchIO::enableKernelDrops(udp->getSocket());
     }
     catch( const std::exception& e )
     {
@@ -128,6 +129,16 @@ ssize_t UDPReceiveTransport::receive( void* r_buf, size_t sz )
     return udp->receiveBytes(r_buf, sz);
 }
 // -------------------------------------------------------------------------
+ssize_t UDPReceiveTransport::receiveBatch( UNetBuffer* bufs, size_t num )
+{
+    return UNetBatchIO::recv(udp->getSocket(), bufs, num, &kernelDrops);
+}
+// -------------------------------------------------------------------------
+long UDPReceiveTransport::getKernelDrops() const noexcept
+{
+    return kernelDropsOn ? (long)kernelDrops.load() : -1;
+}
+// -------------------------------------------------------------------------
 bool UDPReceiveTransport::isReadyForReceive( timeout_t tout ) noexcept
 {
     try
@@ -248,3 +259,15 @@ ssize_t UDPSendTransport::send( const void* buf, size_t sz )
     return udp->sendTo(buf, sz, saddr);
 }
 // -------------------------------------------------------------------------
+ssize_t UDPSendTransport::sendBatch( const UNetBuffer* bufs, size_t num )
+{
+    return UNetBatchIO::send(udp->getSocket(), saddr.addr(), saddr.length(), bufs, num);
+}
+// -------------------------------------------------------------------------
+bool UDPSendTransport::getDestination( const struct sockaddr*& addr, socklen_t& len ) const noexcept
+{
+    addr = saddr.addr();
+    len = saddr.length();
+    return true;
+}
+// -------------------------------------------------------------------------
@@ -43,6 +43,8 @@ namespace uniset
             virtual void disconnect() override;
             virtual int getSocket() const override;
             virtual ssize_t receive( void* r_buf, size_t sz ) override;
+            virtual ssize_t receiveBatch( UNetBuffer* bufs, size_t num ) override;
+            virtual long getKernelDrops() const noexcept override;
             virtual bool isReadyForReceive(timeout_t tout) noexcept override;
             virtual int available() override;
 
@@ -50,6 +52,8 @@ namespace uniset
             std::unique_ptr<UDPReceiveU> udp;
             const std::string host;
             const int port;
+            std::atomic<uint32_t> kernelDrops = { 0 }; // SO_RXQ_OVFL
+            bool kernelDropsOn = { false };
     };
 
     class UDPSendTransport:
@@ -71,6 +75,8 @@ namespace uniset
             // write
             virtual bool isReadyForSend( timeout_t tout ) noexcept override;
             virtual ssize_t send( const void* buf, size_t sz ) override;
+            virtual ssize_t sendBatch( const UNetBuffer* bufs, size_t num ) override;
+            virtual bool getDestination( const struct sockaddr*& addr, socklen_t& len ) const noexcept override;
 
         protected:
             std::unique_ptr<UDPSocketU> udp;
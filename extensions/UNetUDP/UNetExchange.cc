@@ -16,6 +16,7 @@
 // -------------------------------------------------------------------------
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 #include "unisetstd.h"
 #include "Exceptions.h"
 #include "Extensions.h"
@@ -81,6 +82,32 @@ UNetExchange::UNetExchange(uniset::ObjectId objId, uniset::ObjectId shmId, const
     int recvBufferSize = conf->getArgPInt("--" + prefix + "-recv-buffer-size", it.getProp("recvBufferSize"), 100);
     bool recvIgnoreCrc = conf->getArgPInt("--" + prefix + "-recv-ignore-crc", it.getProp("recvIgnoreCRC"), 0);
     int recvMaxReceiveCount = conf->getArgPInt("--" + prefix + "-recv-max-at-time", it.getProp("recvMaxAtTime"), 5);
+    bool recvThreads = conf->getArgPInt("--" + prefix + "-recv-threads", it.getProp("recvThreads"), 0);
+    int recvRingSize = conf->getArgPInt("--" + prefix + "-recv-ring-size", it.getProp("recvRingSize"), 100);
+    int recvLoopsNum = conf->getArgPInt("--" + prefix + "-recv-loops", it.getProp("recvLoops"), 0);
+    const string recvLoopsCPU = conf->getArg2Param("--" + prefix + "-recv-loops-cpu", it.getProp("recvLoopsCPU"), "");
+    bool recvIncomingCPU = conf->getArgPInt("--" + prefix + "-recv-incoming-cpu", it.getProp("recvIncomingCPU"), 0);
+    int keyFrameCycles = conf->getArgPInt("--" + prefix + "-keyframe-cycles", it.getProp("keyFrameCycles"), 0);
+    bool compress = conf->getArgPInt("--" + prefix + "-compress", it.getProp("compress"), 0);
+    bool compress2 = conf->getArgPInt("--" + prefix + "-compress2", it.getProp("compress2"), compress);
+    int compressAccel = conf->getArgPInt("--" + prefix + "-compress-acceleration", it.getProp("compressAcceleration"), 1);
+    int sendBatch = conf->getArgPInt("--" + prefix + "-send-batch", it.getProp("sendBatch"), 16);
+    sendEventMode = conf->getArgPInt("--" + prefix + "-send-event-mode", it.getProp("sendEventMode"), 0);
+    int sendMinGap = conf->getArgPInt("--" + prefix + "-send-min-gap", it.getProp("sendMinGap"), 0);
+    bool sendTimestamp = conf->getArgPInt("--" + prefix + "-send-timestamp", it.getProp("sendTimestamp"), 0);
+    bool latencySyncClock = conf->getArgPInt("--" + prefix + "-latency-sync-clock", it.getProp("latencySyncClock"), 0);
+
+    // компактный формат не понимают узлы старых версий, поэтому по умолчанию он выключен
+    // (кроме случаев, когда включено то, что без него не работает). См. \ref pgUNetUDP_Format
+    const bool needCompact = ( keyFrameCycles > 0 || compress || compress2 || sendTimestamp );
+    bool compactFormat = conf->getArgPInt("--" + prefix + "-compact-format", it.getProp("compactFormat"), needCompact ? 1 : 0);
+
+    if( compactFormat )
+        unetwarn << myname << "(init): compact format is ON. Nodes of old versions (full format only) "
+                 << "can not receive data from this node. Update all receivers first!" << endl;
+    else if( needCompact )
+        unetwarn << myname << "(init): keyframe-cycles, compress and send-timestamp need compact format. "
+                 << "Use --" << prefix << "-compact-format 1 (compactFormat=\"1\")" << endl;
     const string unet_transport = conf->getArg2Param("--" + prefix + "-transport", it.getProp("transport"), "broadcast");
 
     no_sender = conf->getArgInt("--" + prefix + "-nosender", it.getProp("nosender"));
@@ -115,6 +142,18 @@ UNetExchange::UNetExchange(uniset::ObjectId objId, uniset::ObjectId shmId, const
     unetinfo << myname << "(init): read nodes-filter-field='" << n_field
              << "' nodes-filter-value='" << n_fvalue << "'" << endl;
 
+    if( conf->getArgPInt("--" + prefix + "-io-uring", it.getProp("ioUring"), 0) )
+    {
+        int ioUringBufs = conf->getArgPInt("--" + prefix + "-io-uring-bufs", it.getProp("ioUringBufs"), 256);
+        std::string err;
+        uring = UNetIOUring::create(ioUringBufs, sizeof(UniSetUDP::UDPMessage), err);
+
+        if( uring )
+            unetinfo << myname << "(init): use io_uring: " << uring->getInfo() << endl;
+        else
+            unetwarn << myname << "(init): io_uring is not available (" << err << "). Use default transport.." << endl;
+    }
+
     if( unet_transport == "multicast" )
         initMulticastTransport(n_it, n_field, n_fvalue, prefix);
     else
@@ -135,6 +174,8 @@ UNetExchange::UNetExchange(uniset::ObjectId objId, uniset::ObjectId shmId, const
             r.r1->setBufferSize(recvBufferSize);
             r.r1->setMaxReceiveAtTime(recvMaxReceiveCount);
             r.r1->setIgnoreCRC(recvIgnoreCrc);
+            r.r1->setThreadedMode(recvThreads, recvRingSize);
+            r.r1->setLatencySyncClock(latencySyncClock);
         }
 
         if( r.r2 )
@@ -150,15 +191,28 @@ UNetExchange::UNetExchange(uniset::ObjectId objId, uniset::ObjectId shmId, const
             r.r2->setBufferSize(recvBufferSize);
             r.r2->setMaxReceiveAtTime(recvMaxReceiveCount);
             r.r2->setIgnoreCRC(recvIgnoreCrc);
+            r.r2->setThreadedMode(recvThreads, recvRingSize);
+            r.r2->setLatencySyncClock(latencySyncClock);
         }
     }
 
+    if( recvLoopsNum > 0 )
+        initRecvLoops(recvLoopsNum, recvLoopsCPU, recvIncomingCPU);
+
     if( sender )
     {
         sender->setSendPause(sendpause);
         sender->setPackSendPause(packsendpause);
         sender->setPackSendPauseFactor(packsendpauseFactor);
         sender->setCheckConnectionPause(checkConnectionPause);
+        sender->setCompactFormat(compactFormat);
+        sender->setKeyFrameCycles(keyFrameCycles);
+        sender->setSendBatch(sendBatch);
+        sender->setEventMode(sendEventMode, sendMinGap);
+        sender->setSendTimestamp(sendTimestamp);
+
+        if( !sender->setCompress(compress, compressAccel) )
+            unetwarn << myname << "(init): LZ4 compression is not supported (build without lz4). Ignore 'compress'" << endl;
     }
 
     if( sender2 )
@@ -167,6 +221,14 @@ UNetExchange::UNetExchange(uniset::ObjectId objId, uniset::ObjectId shmId, const
         sender2->setPackSendPause(packsendpause);
         sender2->setPackSendPauseFactor(packsendpauseFactor);
         sender2->setCheckConnectionPause(checkConnectionPause);
+        sender2->setCompactFormat(compactFormat);
+        sender2->setKeyFrameCycles(keyFrameCycles);
+        sender2->setSendBatch(sendBatch);
+        sender2->setEventMode(sendEventMode, sendMinGap);
+        sender2->setSendTimestamp(sendTimestamp);
+
+        if( !sender2->setCompress(compress2, compressAccel) )
+            unetwarn << myname << "(init): LZ4 compression is not supported (build without lz4). Ignore 'compress2'" << endl;
     }
 
     // -------------------------------
@@ -432,7 +494,8 @@ void UNetExchange::sysCommand( const uniset::SystemMessage* sm )
             {
                 uniset::uniset_rwmutex_rlock l(mutex_start);
 
-                if( shm->isLocalwork() )
+                // для посылки по изменению датчики заказываем и при работе в одном процессе с SM
+                if( shm->isLocalwork() || sendEventMode )
                     askSensors(UniversalIO::UIONotify);
             }
 
@@ -449,7 +512,7 @@ void UNetExchange::sysCommand( const uniset::SystemMessage* sm )
 
         case SystemMessage::FoldUp:
         case SystemMessage::Finish:
-            if( shm->isLocalwork() )
+            if( shm->isLocalwork() || sendEventMode )
                 askSensors(UniversalIO::UIODontNotify);
 
             break;
@@ -611,9 +674,26 @@ void UNetExchange::help_print( int argc, const char* argv[] ) noexcept
     cout << "--prefix-checkconnection-pause msec  - Пауза между попытками открыть соединение (если это не удалось до этого). По умолчанию: 10000 (10 сек)" << endl;
     cout << "--prefix-maxdifferense num       - Маскимальная разница в номерах пакетов для фиксации события 'потеря пакетов' " << endl;
     cout << "--prefix-nosender [0,1]          - Отключить посылку." << endl;
+    cout << "--prefix-compact-format [0,1]    - Посылать сообщения в компактном формате (только заполненные данные). По умолчанию: 0 (1 при --prefix-keyframe-cycles, --prefix-compress, --prefix-send-timestamp)" << endl;
+    cout << "--prefix-keyframe-cycles N       - Посылать полное состояние каждый N-ый раз, а между ними только изменения (дельта-пакеты). По умолчанию: 0 (отключено)" << endl;
+    cout << "--prefix-send-timestamp [0,1]    - Добавлять в пакеты метку времени отправки (для расчёта задержки и джиттера). По умолчанию: 0" << endl;
+    cout << "--prefix-latency-sync-clock [0,1] - Часы узлов синхронизированы (задержка считается без оценки смещения часов). По умолчанию: 0" << endl;
+    cout << "--prefix-compress [0,1]          - Сжимать пакеты (LZ4), если это уменьшает их размер. По умолчанию: 0" << endl;
+    cout << "--prefix-compress2 [0,1]         - Сжимать пакеты по второму каналу. По умолчанию: как --prefix-compress" << endl;
+    cout << "--prefix-compress-acceleration N - Ускорение LZ4 (1 - лучшее сжатие, больше - быстрее). По умолчанию: 1" << endl;
     cout << "--prefix-recv-buffer-size sz     - Размер циклического буфера для приёма сообщений. По умолчанию: 100" << endl;
-    cout << "--prefix-recv-max-at-time num    - Максимальное количество сообщений вычитываемых из сети за один раз. По умолчанию: 5" << endl;
+    cout << "--prefix-recv-max-at-time num    - Максимальное количество сообщений вычитываемых из сети за один раз (одним вызовом recvmmsg). По умолчанию: 5" << endl;
+    cout << "--prefix-send-batch num          - Максимальное количество пакетов посылаемых за один раз (одним вызовом sendmmsg). По умолчанию: 16" << endl;
+    cout << "--prefix-send-event-mode [0,1]   - Посылать изменившиеся пакеты сразу (не дожидаясь sendpause). По умолчанию: 0" << endl;
+    cout << "--prefix-send-min-gap msec       - Минимальный интервал между пакетами при посылке по изменению. По умолчанию: 0" << endl;
     cout << "--prefix-recv-ignore-crc  [0,1]  - Отключить оптимизацию по проверке crc, обновлять данные в SM всегда. По умолчанию: 0" << endl;
+    cout << "--prefix-recv-threads [0,1]      - Приём и обновление данных в SM в отдельных потоках (для каждого канала). По умолчанию: 0" << endl;
+    cout << "--prefix-recv-ring-size num      - Размер буфера между потоками приёма и обновления (количество сообщений). По умолчанию: 100" << endl;
+    cout << "--prefix-recv-loops num          - Распределить приёмники по num отдельным event loop (потокам). По умолчанию: 0 (один общий)" << endl;
+    cout << "--prefix-recv-loops-cpu 0,1,..   - Привязать потоки loop-ов к процессорам (loop i - к i-му в списке, по кругу). По умолчанию: не привязывать" << endl;
+    cout << "--prefix-recv-incoming-cpu [0,1] - Выставлять сокетам приёма SO_INCOMING_CPU равным процессору loop-а. По умолчанию: 0" << endl;
+    cout << "--prefix-io-uring [0,1]          - Приём и посылка через io_uring (один поток на все приёмники). По умолчанию: 0" << endl;
+    cout << "--prefix-io-uring-bufs num       - Количество буферов в общем пуле приёма для io_uring. По умолчанию: 256" << endl;
     cout << "--prefix-sm-ready-timeout msec   - Время ожидание я готовности SM к работе. По умолчанию 120000" << endl;
     cout << "--prefix-filter-field name       - Название фильтрующего поля при формировании списка датчиков посылаемых данным узлом" << endl;
     cout << "--prefix-filter-value name       - Значение фильтрующего поля при формировании списка датчиков посылаемых данным узлом" << endl;
@@ -781,6 +861,13 @@ uniset::SimpleInfo* UNetExchange::getInfo( const char* userparam )
         inf << "LogServer: NONE" << endl;
 
     inf << endl;
+
+    if( uring )
+        inf << uring->getInfo() << endl << endl;
+
+    if( !recvLoops.empty() )
+        inf << "Receive loops: " << recvLoops.size() << endl << endl;
+
     inf << "Receivers: " << endl;
 
     for( const auto& r : recvlist )
@@ -803,6 +890,86 @@ uniset::SimpleInfo* UNetExchange::getInfo( const char* userparam )
     i->info = inf.str().c_str();
     return i._retn();
 }
+// -----------------------------------------------------------------------------
+void UNetExchange::initRecvLoops( size_t num, const std::string& cpulist, bool incomingCPU )
+{
+    std::vector<int> cpus;
+
+    for( const auto& c : uniset::explode_str(cpulist, ',') )
+        cpus.push_back(uniset::uni_atoi(c));
+
+    if( incomingCPU && cpus.empty() )
+        unetwarn << myname << "(init): 'recvIncomingCPU' requires 'recvLoopsCPU'. Ignore.." << endl;
+
+    num = std::min(num, recvlist.size());
+
+    for( size_t i = 0; i < num; i++ )
+        recvLoops.emplace_back( std::make_shared<CommonEventLoop>() );
+
+    // оба канала узла обрабатываются в одном loop-е (у них общие данные узла в ReceiverInfo)
+    size_t k = 0;
+
+    for( auto&& r : recvlist )
+    {
+        const size_t n = k++ % recvLoops.size();
+        const int cpu = cpus.empty() ? -1 : cpus[n % cpus.size()];
+
+        for( auto&& rcv : { r.r1, r.r2 } )
+        {
+            if( !rcv )
+                continue;
+
+            rcv->setEventLoop(recvLoops[n], n, cpu);
+            rcv->setIncomingCPU(incomingCPU);
+        }
+    }
+
+    unetinfo << myname << "(init): receivers distributed over " << recvLoops.size() << " event loops"
+             << ( cpus.empty() ? "" : " cpu: " + cpulist ) << endl;
+}
+// -----------------------------------------------------------------------------
+uniset::ObjectId UNetExchange::getNodeSensorID( UniXML::iterator n_it, const std::string& prop )
+{
+    const string sname = n_it.getProp(prop);
+
+    if( sname.empty() )
+        return uniset::DefaultObjectId;
+
+    auto sid = uniset_conf()->getSensorID(sname);
+
+    if( sid == uniset::DefaultObjectId )
+    {
+        ostringstream err;
+        err << myname << ": " << n_it.getProp("name") << " : Unknown '" << prop << "'.. Not found id for '" << sname << "'" << endl;
+        unetcrit << myname << "(init): " << err.str() << endl;
+        throw SystemError(err.str());
+    }
+
+    return sid;
+}
+// -----------------------------------------------------------------------------
+std::unique_ptr<UNetReceiveTransport> UNetExchange::wrapTransport( std::unique_ptr<UNetReceiveTransport>&& t )
+{
+    if( !uring )
+        return std::move(t);
+
+    return unisetstd::make_unique<IOUringReceiveTransport>(std::move(t), uring);
+}
+// -----------------------------------------------------------------------------
+std::unique_ptr<UNetSendTransport> UNetExchange::wrapTransport( std::unique_ptr<UNetSendTransport>&& t )
+{
+    if( !uring )
+        return std::move(t);
+
+    std::string err;
+    auto u = IOUringSendTransport::create(t, err);
+
+    if( u )
+        return u;
+
+    unetwarn << myname << "(init): io_uring send is not available for " << t->toString() << " (" << err << ")" << endl;
+    return std::move(t);
+}
 // ----------------------------------------------------------------------------
 void UNetExchange::initUDPTransport( UniXML::iterator n_it,
                                      const std::string& n_field,
@@ -841,7 +1008,7 @@ void UNetExchange::initUDPTransport( UniXML::iterator n_it,
 
             unetinfo << myname << "(init): init sender.. my node " << n_it.getProp("name") << endl;
             auto s1 = UDPSendTransport::createFromXml(n_it, default_ip, 0);
-            sender = make_shared<UNetSender>(std::move(s1), shm, false, s_field, s_fvalue, "unet", prefix);
+            sender = make_shared<UNetSender>(wrapTransport(std::move(s1)), shm, false, s_field, s_fvalue, "unet", prefix);
             loga->add(sender->getLog());
 
             try
@@ -852,7 +1019,7 @@ void UNetExchange::initUDPTransport( UniXML::iterator n_it,
                 if( n_it.getProp("unet_broadcast_ip2").empty() || !default_ip2.empty() )
                 {
                     auto s2 = UDPSendTransport::createFromXml(n_it, default_ip2, 2);
-                    sender2 = make_shared<UNetSender>(std::move(s2), shm, false, s_field, s_fvalue, "unet", prefix);
+                    sender2 = make_shared<UNetSender>(wrapTransport(std::move(s2)), shm, false, s_field, s_fvalue, "unet", prefix);
                 }
 
                 if( sender2 )
@@ -1050,8 +1217,13 @@ void UNetExchange::initUDPTransport( UniXML::iterator n_it,
             unetinfo << myname << "(init): (node='" << n << "') unet_recvmode_id=" << s_recvmode_id << endl;
         }
 
+        uniset::ObjectId latency1_id = getNodeSensorID(n_it, "unet_latency1_id");
+        uniset::ObjectId latency2_id = getNodeSensorID(n_it, "unet_latency2_id");
+        uniset::ObjectId jitter1_id = getNodeSensorID(n_it, "unet_jitter1_id");
+        uniset::ObjectId jitter2_id = getNodeSensorID(n_it, "unet_jitter2_id");
+
         unetinfo << myname << "(init): (node='" << n << "') add basic receiver " << transport1->ID() << endl;
-        auto r1 = make_shared<UNetReceiver>(std::move(transport1), shm, false, prefix);
+        auto r1 = make_shared<UNetReceiver>(wrapTransport(std::move(transport1)), shm, false, prefix);
 
         loga->add(r1->getLog());
 
@@ -1060,6 +1232,8 @@ void UNetExchange::initUDPTransport( UniXML::iterator n_it,
         r1->setLockUpdate(false);
         r1->setRespondID(resp_id, resp_invert);
         r1->setLostPacketsID(lp_id);
+        r1->setLatencyID(latency1_id);
+        r1->setJitterID(jitter1_id);
         r1->setModeID(recvmode_id);
         r1->connectEvent( sigc::mem_fun(this, &UNetExchange::receiverEvent) );
 
@@ -1075,7 +1249,7 @@ void UNetExchange::initUDPTransport( UniXML::iterator n_it,
             if( transport2 ) // создаём читателя по второму каналу
             {
                 unetinfo << myname << "(init): (node='" << n << "') add reserv receiver " << transport2->ID() << endl;
-                r2 = make_shared<UNetReceiver>(std::move(transport2), shm, false, prefix);
+                r2 = make_shared<UNetReceiver>(wrapTransport(std::move(transport2)), shm, false, prefix);
 
                 loga->add(r2->getLog());
 
@@ -1083,6 +1257,8 @@ void UNetExchange::initUDPTransport( UniXML::iterator n_it,
                 r2->setLockUpdate(true);
                 r2->setRespondID(resp2_id, resp_invert);
                 r2->setLostPacketsID(lp2_id);
+                r2->setLatencyID(latency2_id);
+                r2->setJitterID(jitter2_id);
                 r2->setModeID(recvmode_id);
                 r2->connectEvent( sigc::mem_fun(this, &UNetExchange::receiverEvent) );
             }
@@ -1179,7 +1355,7 @@ void UNetExchange::initMulticastTransport( UniXML::iterator n_it,
         auto s1 = MulticastSendTransport::createFromXml(root, n_it, 0);
         unetinfo << myname << "(init): " << n_it.getProp("name") << " send (channel1) to multicast group: " << s1->getGroupAddress().toString() << endl;
 
-        sender = make_shared<UNetSender>(std::move(s1), shm, false, s_field, s_fvalue, "unet", prefix);
+        sender = make_shared<UNetSender>(wrapTransport(std::move(s1)), shm, false, s_field, s_fvalue, "unet", prefix);
         loga->add(sender->getLog());
         sender->setModeID(sendmode_id);
 
@@ -1194,7 +1370,7 @@ void UNetExchange::initMulticastTransport( UniXML::iterator n_it,
                 if( s2 )
                     unetinfo << myname << "(init): " << n_it.getProp("name") << " send (channel2) to multicast group: " << s2->getGroupAddress().toString() << endl;
 
-                sender2 = make_shared<UNetSender>(std::move(s2), shm, false, s_field, s_fvalue, "unet", prefix);
+                sender2 = make_shared<UNetSender>(wrapTransport(std::move(s2)), shm, false, s_field, s_fvalue, "unet", prefix);
             }
 
             if( sender2 )
@@ -1375,13 +1551,18 @@ void UNetExchange::initMulticastReceiverForNode( UniXML::iterator root, UniXML::
         }
     }
 
+    uniset::ObjectId latency1_id = getNodeSensorID(n_it, "unet_latency1_id");
+    uniset::ObjectId latency2_id = getNodeSensorID(n_it, "unet_latency2_id");
+    uniset::ObjectId jitter1_id = getNodeSensorID(n_it, "unet_jitter1_id");
+    uniset::ObjectId jitter2_id = getNodeSensorID(n_it, "unet_jitter2_id");
+
     unetinfo << myname << "(init): (node='" << n_it.getProp("name") << "') add channel1 receiver " << transport1->ID() << " iface: " << transport1->iface() << endl;
     unetinfo << myname << "(init): receive (channel1) from multicast groups: " << endl;
 
     for( const auto& gr : transport1->getGroups() )
         unetinfo << myname << "(init):  " << gr.toString() << endl;
 
-    auto r1 = make_shared<UNetReceiver>(std::move(transport1), shm, false, prefix);
+    auto r1 = make_shared<UNetReceiver>(wrapTransport(std::move(transport1)), shm, false, prefix);
 
     loga->add(r1->getLog());
 
@@ -1390,6 +1571,8 @@ void UNetExchange::initMulticastReceiverForNode( UniXML::iterator root, UniXML::
     r1->setLockUpdate(false);
     r1->setRespondID(resp_id, resp_invert);
     r1->setLostPacketsID(lp_id);
+    r1->setLatencyID(latency1_id);
+    r1->setJitterID(jitter1_id);
     r1->setModeID(recvmode_id);
     r1->connectEvent( sigc::mem_fun(this, &UNetExchange::receiverEvent) );
 
@@ -1410,7 +1593,7 @@ void UNetExchange::initMulticastReceiverForNode( UniXML::iterator root, UniXML::
             for( const auto& gr : transport2->getGroups() )
                 unetinfo << myname << "(init):  " << gr.toString() << endl;
 
-            r2 = make_shared<UNetReceiver>(std::move(transport2), shm, false, prefix);
+            r2 = make_shared<UNetReceiver>(wrapTransport(std::move(transport2)), shm, false, prefix);
 
             loga->add(r2->getLog());
 
@@ -1418,6 +1601,8 @@ void UNetExchange::initMulticastReceiverForNode( UniXML::iterator root, UniXML::
             r2->setLockUpdate(true);
             r2->setRespondID(resp2_id, resp_invert);
             r2->setLostPacketsID(lp2_id);
+            r2->setLatencyID(latency2_id);
+            r2->setJitterID(jitter2_id);
             r2->setModeID(recvmode_id);
             r2->connectEvent( sigc::mem_fun(this, &UNetExchange::receiverEvent) );
         }
@@ -1438,3 +1623,48 @@ void UNetExchange::initMulticastReceiverForNode( UniXML::iterator root, UniXML::
     recvlist.emplace_back( std::move(ri) );
 }
 // -----------------------------------------------------------------------------
+#ifndef DISABLE_REST_API
+Poco::JSON::Object::Ptr UNetExchange::httpHelp( const Poco::URI::QueryParameters& p )
+{
+    uniset::json::help::object myhelp(myname, UniSetObject::httpHelp(p));
+
+    {
+        // 'latency'
+        uniset::json::help::item cmd("latency", "latency and jitter statistics for receivers (see --prefix-send-timestamp)");
+        myhelp.add(cmd);
+    }
+
+    return myhelp;
+}
+// -----------------------------------------------------------------------------
+Poco::JSON::Object::Ptr UNetExchange::httpRequest( const std::string& req, const Poco::URI::QueryParameters& p )
+{
+    if( req == "latency" )
+        return request_latency(req, p);
+
+    return UniSetObject::httpRequest(req, p);
+}
+// -----------------------------------------------------------------------------
+Poco::JSON::Object::Ptr UNetExchange::request_latency( const std::string& req, const Poco::URI::QueryParameters& p )
+{
+    Poco::JSON::Object::Ptr json = new Poco::JSON::Object();
+    Poco::JSON::Array::Ptr jdata = uniset::json::make_child_array(json, "receivers");
+    httpGetMyInfo(json);
+
+    for( const auto& it : recvlist )
+    {
+        for( const auto& r : { it.r1, it.r2 } )
+        {
+            if( !r )
+                continue;
+
+            auto jr = r->getLatency().httpGet();
+            jr->set("transport", r->getTransportID());
+            jdata->add(jr);
+        }
+    }
+
+    return json;
+}
+// -----------------------------------------------------------------------------
+#endif
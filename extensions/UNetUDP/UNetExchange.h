@@ -29,6 +29,7 @@
 #include "ThreadCreator.h"
 #include "UNetReceiver.h"
 #include "UNetSender.h"
+#include "UNetIOUring.h"
 #include "LogServer.h"
 #include "DebugStream.h"
 #include "UNetLogSugar.h"
@@ -198,6 +199,108 @@ namespace uniset
     что необходимо делать паузы не между каждым пакетом, а через каждый N пакет.
     По умолчанию \b packsendpause=5 миллисекунд.
 
+    \section pgUNetUDP_Format Формат сообщений
+    Параметр \b --prefix-compact-format 1 или \b compactFormat="1" в настройках включает посылку в компактном формате:
+    передаётся только заголовок и заполненные данные, а не вся структура UniSetUDP::UDPMessage целиком (~40 Кб).
+    Это позволяет на типичных пакетах уменьшить трафик на порядок и избежать фрагментации IP-пакетов.
+
+    Приём понимает оба формата, но узлы старых версий понимают только полный формат. Поэтому (пока)
+    по умолчанию посылка ведётся в полном формате. Порядок обновления сети:
+    - обновить все узлы (без изменения настроек, посылка остаётся в полном формате);
+    - после того как обновлены все узлы, включить \b compactFormat="1".
+
+    Дельта-пакеты, сжатие и метки времени (см. ниже) работают только в компактном формате, поэтому
+    при их включении компактный формат включается по умолчанию. При запуске с компактным форматом
+    выводится предупреждение о том, что узлы старых версий не смогут принимать данные.
+
+    \section pgUNetUDP_Delta Дельта-пакеты
+    Параметр \b --prefix-keyframe-cycles N или \b keyFrameCycles="N" в настройках включает режим, в котором
+    каждый пакет только каждый N-ый раз посылается с полным состоянием ("ключевой" пакет), а в остальные циклы
+    посылаются только изменившиеся с прошлой посылки данные. Если данные не менялись, посылается пустой
+    пакет (только заголовок), чтобы приёмник мог контролировать последовательность пакетов.
+    Приёмник применяет изменения только если после ключевого пакета не было потерь, иначе
+    ждёт следующего ключевого пакета (т.е. восстановление после потери занимает не более N циклов посылки).
+    \warning Дельта-пакеты понимают только узлы с поддержкой компактного формата.
+
+    \section pgUNetUDP_Compress Сжатие пакетов
+    Для каналов с низкой пропускной способностью (радио, VPN) пакеты можно сжимать (LZ4 в "быстром" режиме).
+    Параметр \b --prefix-compress 1 (\b compress="1") включает сжатие для обоих каналов,
+    \b --prefix-compress2 (\b compress2) позволяет задать его отдельно для второго канала.
+    Пакет посылается сжатым, только если это уменьшает его размер (маленькие пакеты не сжимаются вовсе),
+    поэтому сжатые и несжатые пакеты в канале могут чередоваться. Сжатый пакет помечается в заголовке
+    (UniSetUDP::UNETUDP_LZ4_MAGICNUM), приёмник распаковывает его автоматически (настройка не требуется).
+    Параметр \b --prefix-compress-acceleration N (\b compressAcceleration) задаёт ускорение LZ4:
+    чем больше N, тем быстрее сжатие, но хуже степень сжатия. По умолчанию: 1.
+    Степень сжатия и затраты времени на сжатие (распаковку) выводятся в getInfo() отправителя (приёмника).
+    \warning Сжимаются только пакеты в компактном формате (см. \ref pgUNetUDP_Format).
+    Сжатые пакеты понимают только узлы с поддержкой сжатия. При сборке с \b --disable-lz4 сжатие недоступно.
+
+    \section pgUNetUDP_Latency Задержка и джиттер
+    Параметр \b --prefix-send-timestamp 1 (\b sendTimestamp="1") включает добавление в пакеты метки времени
+    отправки (CLOCK_REALTIME). По ней приёмник для каждого канала считает задержку доставки (от упаковки данных
+    отправителем до разбора пакета приёмником) и джиттер (по RFC 3550), а также ведёт их гистограммы (см. UNetLatency).
+    Если часы узлов синхронизированы (NTP, PTP), то следует указать \b --prefix-latency-sync-clock 1
+    (\b latencySyncClock="1"), тогда задержка считается как есть. Иначе смещение часов оценивается как минимальная
+    разница времени приёма и отправки за последнюю минуту, и задержка считается от неё (т.е. видно только её увеличение).
+    Джиттер от смещения часов не зависит.
+
+    Средняя задержка за последнюю секунду и джиттер (в мкс) могут сохраняться в SM (свойства узла \b unet_latency1_id,
+    \b unet_latency2_id, \b unet_jitter1_id, \b unet_jitter2_id), что позволяет выставлять предупреждения
+    об ухудшении связи ещё до появления потерь пакетов.
+    Полная статистика (с гистограммами) доступна через REST API: /api/VERSION/UNetExchangeName/latency
+    \warning Метка времени добавляется только в компактном формате. Узлы без её поддержки метку просто игнорируют.
+
+    \section pgUNetUDP_Batch Пакетный приём и посылка
+    Для уменьшения количества системных вызовов приём и посылка сообщений ведутся "пачками"
+    (recvmmsg/sendmmsg). За один вызов принимается не более \b --prefix-recv-max-at-time (\b recvMaxAtTime)
+    сообщений, а посылается не более \b --prefix-send-batch (\b sendBatch) пакетов.
+    Пакеты одного цикла посылки накапливаются и уходят одним вызовом, при этом пауза \b packsendpause
+    (см. \ref pgUNetUDP_PackSendPause) по-прежнему соблюдается: перед каждой паузой накопленные пакеты посылаются.
+    Т.е. выигрыш от пакетной посылки есть при \b packsendpause=0 или \b packsendpauseFactor > 1.
+
+    \section pgUNetUDP_EventSend Посылка по изменению
+    По умолчанию все пакеты посылаются раз в \b sendpause, поэтому изменение датчика попадает в сеть
+    с задержкой до sendpause (плюс паузы между пакетами). Параметр \b --prefix-send-event-mode 1
+    (\b sendEventMode="1") включает режим, в котором датчики заказываются (в том числе при работе
+    в одном процессе с SharedMemory) и пакет с изменившимся значением посылается сразу.
+    Параметр \b --prefix-send-min-gap msec (\b sendMinGap) задаёт минимальный интервал между такими пакетами
+    (изменения накопившиеся за это время уйдут одним пакетом). Полная посылка всех пакетов раз в \b sendpause
+    при этом сохраняется и служит "heartbeat"-ом для приёмников.
+
+    \section pgUNetUDP_RecvThreads Отдельные потоки приёма и обновления
+    По умолчанию все приёмники обрабатываются в общем event loop: приём пакета и сохранение данных в SM
+    идут последовательно, поэтому медленное сохранение в SM задерживает чтение сокета и при большом потоке
+    данных ядро отбрасывает пакеты. Параметр \b --prefix-recv-threads 1 (\b recvThreads="1") включает режим,
+    в котором для каждого канала создаются два потока: поток приёма только вычитывает пакеты в кольцевой
+    буфер (без блокировок), а поток обновления разбирает их и сохраняет в SM.
+    Размер буфера задаётся параметром \b --prefix-recv-ring-size (\b recvRingSize), по умолчанию 100 сообщений.
+    В информации о приёмнике (getInfo) выводятся: kernelDrops - количество отброшенных ядром пакетов (SO_RXQ_OVFL),
+    ringMax - максимальная заполненность буфера, ringFull - сколько раз буфер был заполнен,
+    updateLagMax - максимальная задержка от приёма пакета до сохранения в SM (за последнюю секунду).
+
+    \section pgUNetUDP_IOUring Использование io_uring
+    При большом количестве узлов у каждого приёмника свой сокет и на каждый пакет приходится
+    свой системный вызов. Параметр \b --prefix-io-uring 1 (\b ioUring="1") включает приём и посылку через io_uring:
+    все приёмники обслуживаются одним потоком, для каждого сокета ставится один "multishot" запрос
+    с буферами из общего пула (размер задаётся \b --prefix-io-uring-bufs, \b ioUringBufs, по умолчанию 256),
+    а каждая пачка пакетов (см. \b --prefix-send-batch) посылается одним вызовом.
+    Обработка принятых пакетов остаётся прежней (в том числе режим \b recvThreads).
+    Требуется ядро с поддержкой multishot recvmsg (>= 6.0). Если io_uring недоступен
+    (старое ядро, запрещён в контейнере), в лог выводится предупреждение и используются обычные транспорты.
+
+    \section pgUNetUDP_RecvLoops Распределение приёма по ядрам
+    По умолчанию все приёмники обрабатываются в одном общем event loop, т.е. на одном ядре.
+    Параметр \b --prefix-recv-loops N (\b recvLoops="N") создаёт N отдельных event loop (потоков) и распределяет
+    по ним узлы по кругу (оба канала узла всегда в одном loop-е). Параметр \b --prefix-recv-loops-cpu "0,2,4"
+    (\b recvLoopsCPU) привязывает поток i-го loop-а к i-му процессору из списка (по кругу, если loop-ов больше).
+    В режиме \b recvThreads к тому же процессору привязывается и поток приёма канала.
+    Параметр \b --prefix-recv-incoming-cpu 1 (\b recvIncomingCPU="1") дополнительно выставляет сокетам
+    SO_INCOMING_CPU равным процессору loop-а: если на один порт открыто несколько сокетов (SO_REUSEPORT
+    выставляется при создании всегда), ядро отдаёт пакет сокету с совпадающим процессором. Для полного эффекта
+    прерывания сетевой карты (RSS/RPS) тоже надо направить на эти процессоры.
+    При использовании io_uring сокеты читает общий поток io_uring, в loop-ах остаётся только обработка.
+    Номер loop-а и процессор выводятся в информации о приёмнике (getInfo).
+
      \section pgUNetUDP_Stat Статистика работы канала
      Для возможности мониторинга работы имеются счётчики, которые можно привязать к датчикам,
      задав их для соответствующего узла в секции '<nodes>' конфигурационного файла.
@@ -205,6 +308,10 @@ namespace uniset
      - unet_lostpackets_id=""  - общее количество потерянных пакетов с данным узлом (суммарно по обоим каналам)
      - unet_lostpackets1_id=""  - количество потерянных пакетов с данным узлом по первому каналу
      - unet_lostpackets2_id=""  - количество потерянных пакетов с данным узлом по второму каналу
+     - unet_latency1_id=""  - средняя задержка пакетов (мкс) по первому каналу (см. \ref pgUNetUDP_Latency)
+     - unet_latency2_id=""  - средняя задержка пакетов (мкс) по второму каналу
+     - unet_jitter1_id=""  - джиттер (мкс) по первому каналу
+     - unet_jitter2_id=""  - джиттер (мкс) по второму каналу
      - unet_respond_id=""  - наличие связи хотя бы по одному каналу
      - unet_respond1_id  - наличие связи по первому каналу
      - unet_respond2_id  - наличие связи по второму каналу
@@ -271,6 +378,13 @@ namespace uniset
             virtual bool activateObject() override;
             virtual bool deactivateObject() override;
 
+#ifndef DISABLE_REST_API
+            // http API
+            virtual Poco::JSON::Object::Ptr httpHelp( const Poco::URI::QueryParameters& p ) override;
+            virtual Poco::JSON::Object::Ptr httpRequest( const std::string& req, const Poco::URI::QueryParameters& p ) override;
+            Poco::JSON::Object::Ptr request_latency( const std::string& req, const Poco::URI::QueryParameters& p );
+#endif
+
             // действия при завершении работы
             void termSenders();
             void termReceivers();
@@ -279,6 +393,15 @@ namespace uniset
             void initMulticastReceiverForNode( UniXML::iterator root, UniXML::iterator n_it, const std::string& prefix );
 
             void initUDPTransport(UniXML::iterator nodes, const std::string& n_field, const std::string& n_fvalue, const std::string& prefix);
+
+            // при включённом io_uring возвращает обёртку над транспортом, иначе сам транспорт
+            std::unique_ptr<UNetReceiveTransport> wrapTransport( std::unique_ptr<UNetReceiveTransport>&& t );
+            std::unique_ptr<UNetSendTransport> wrapTransport( std::unique_ptr<UNetSendTransport>&& t );
+            // датчик из свойства узла (DefaultObjectId если свойство не задано)
+            // \throw SystemError если датчик не найден
+            uniset::ObjectId getNodeSensorID( UniXML::iterator n_it, const std::string& prop );
+            // распределить приёмники по отдельным event loop (см. recvLoops)
+            void initRecvLoops( size_t num, const std::string& cpulist, bool incomingCPU );
             void initIterators() noexcept;
             void startReceivers();
 
@@ -375,8 +498,11 @@ namespace uniset
             ReceiverList recvlist;
 
             bool no_sender = { false };  /*!< флаг отключения посылки сообщений (создания потока для посылки)*/
+            bool sendEventMode = { false }; /*!< посылка по изменению (датчики заказываются всегда) */
             std::shared_ptr<UNetSender> sender;
             std::shared_ptr<UNetSender> sender2;
+            std::shared_ptr<UNetIOUring> uring; /*!< общий поток приёма (если включён io_uring) */
+            std::vector< std::shared_ptr<CommonEventLoop> > recvLoops; /*!< отдельные loop-ы приёмников (recvLoops) */
 
             std::shared_ptr<LogAgregator> loga;
             std::shared_ptr<DebugStream> unetlog;
@@ -0,0 +1,1234 @@
+/*
+ * Copyright (c) 2021 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -------------------------------------------------------------------------
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <sstream>
+#include <algorithm>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include "Exceptions.h"
+#include "unisetstd.h"
+#include "UNetIOUring.h"
+// -------------------------------------------------------------------------
+// Используется интерфейс ядра напрямую (без liburing).
+// Если заголовков нет или они старые - io_uring недоступен (UNetIOUring::create() вернёт nullptr)
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_FEAT_EXT_ARG)
+#define UNET_IO_URING 1
+#endif
+#endif
+// -------------------------------------------------------------------------
+using namespace std;
+using namespace uniset;
+// -------------------------------------------------------------------------
+// user_data служебных запросов (для каналов - адрес Channel)
+static const uint64_t tagNone = 0;
+static const uint64_t tagWake = 1;
+static const uint64_t tagProbe = 2;
+// номер группы буферов пула
+static const uint16_t bufGroup = 0;
+// сколько сообщений передаём в ядро за один вызов при посылке
+static const size_t sendChunk = 64;
+// место под control-сообщение SO_RXQ_OVFL
+static const size_t ctrlSize = CMSG_SPACE(sizeof(uint32_t));
+// -------------------------------------------------------------------------
+namespace uniset
+{
+    // Кольца io_uring (очередь запросов и очередь завершений).
+    // Не потокобезопасный: используется только одним потоком.
+    class IOUringQueue
+    {
+        public:
+
+            struct Completion
+            {
+                uint64_t data;
+                int res;
+                bool more; /*!< multishot запрос продолжает работать */
+                int bid;   /*!< номер буфера из пула или -1 */
+            };
+
+            /*! \throw SystemError если io_uring недоступен */
+            IOUringQueue( unsigned entries, unsigned cqEntries );
+            ~IOUringQueue();
+
+            // пул буферов (provided buffers)
+            void setupBuffers( uint8_t* mem, size_t bsize, unsigned num );
+            void addBuffer( uint16_t bid ) noexcept;
+            void commitBuffers() noexcept;
+
+            // подготовка запросов (отправляются в ядро при enter())
+            void recvMultishot( int sock, struct msghdr* mh, uint64_t data ) noexcept;
+            void read( int fd, void* buf, size_t sz, uint64_t data ) noexcept;
+            void cancel( uint64_t data ) noexcept;
+            void sendmsg( int sock, const struct msghdr* mh, uint64_t data, bool link ) noexcept;
+
+            /*! отправить подготовленные запросы и дождаться не менее waitNr завершений
+             * \param msec - таймаут ожидания (<0 - без таймаута)
+             * \return < 0 - ошибка (-errno), в т.ч. -ETIME по таймауту
+             */
+            int enter( unsigned waitNr, int msec ) noexcept;
+
+            /*! обработать все готовые завершения */
+            template<typename Func>
+            size_t completions( Func&& f ) noexcept;
+
+            /*! разбор буфера multishot recvmsg
+             * \return false если сообщение некорректное или обрезано
+             */
+            static bool parseRecvMsg( const uint8_t* buf, size_t res, const struct msghdr& mh, uint32_t& off, uint32_t& len, std::atomic<uint32_t>& drops ) noexcept;
+            static size_t headerSize() noexcept;
+
+#ifdef UNET_IO_URING
+        protected:
+            struct io_uring_sqe* getSqe() noexcept;
+            void cleanup() noexcept;
+
+        private:
+            int fd = { -1 };
+
+            void* sqPtr = { nullptr };
+            size_t sqSize = { 0 };
+            void* cqPtr = { nullptr };
+            size_t cqSize = { 0 };
+            struct io_uring_sqe* sqes = { nullptr };
+            size_t sqesSize = { 0 };
+
+            unsigned* sqHead = { nullptr };
+            unsigned* sqTail = { nullptr };
+            unsigned sqMask = { 0 };
+            unsigned sqEntries = { 0 };
+            unsigned sqLocalTail = { 0 };
+
+            unsigned* cqHead = { nullptr };
+            unsigned* cqTail = { nullptr };
+            unsigned cqMask = { 0 };
+            struct io_uring_cqe* cqes = { nullptr };
+
+            struct io_uring_buf_ring* br = { nullptr };
+            size_t brSize = { 0 };
+            unsigned brMask = { 0 };
+            uint16_t brTail = { 0 };
+            uint16_t brAdded = { 0 };
+            uint8_t* bufMem = { nullptr };
+            size_t bufLen = { 0 };
+#endif
+    };
+}
+// -------------------------------------------------------------------------
+#ifdef UNET_IO_URING
+// -------------------------------------------------------------------------
+IOUringQueue::IOUringQueue( unsigned entries, unsigned cqEntries )
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    if( cqEntries > 0 )
+    {
+        p.flags |= IORING_SETUP_CQSIZE;
+        p.cq_entries = cqEntries;
+    }
+
+    fd = (int)::syscall(__NR_io_uring_setup, entries, &p);
+
+    if( fd < 0 )
+        throw SystemError(string("io_uring_setup: ") + strerror(errno));
+
+    // EXT_ARG (ожидание с таймаутом) - ядро >= 5.11
+    if( !(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP) )
+    {
+        cleanup();
+        throw SystemError("io_uring: kernel is too old");
+    }
+
+    sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+
+    if( p.features & IORING_FEAT_SINGLE_MMAP )
+        sqSize = cqSize = std::max(sqSize, cqSize);
+
+    sqPtr = ::mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+    if( sqPtr == MAP_FAILED )
+    {
+        sqPtr = nullptr;
+        int e = errno;
+        cleanup();
+        throw SystemError(string("io_uring mmap: ") + strerror(e));
+    }
+
+    if( p.features & IORING_FEAT_SINGLE_MMAP )
+        cqPtr = sqPtr;
+    else
+    {
+        cqPtr = ::mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+        if( cqPtr == MAP_FAILED )
+        {
+            cqPtr = nullptr;
+            int e = errno;
+            cleanup();
+            throw SystemError(string("io_uring mmap: ") + strerror(e));
+        }
+    }
+
+    sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    void* s = ::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    if( s == MAP_FAILED )
+    {
+        int e = errno;
+        cleanup();
+        throw SystemError(string("io_uring mmap: ") + strerror(e));
+    }
+
+    sqes = (struct io_uring_sqe*)s;
+
+    uint8_t* sq = (uint8_t*)sqPtr;
+    sqHead = (unsigned*)(sq + p.sq_off.head);
+    sqTail = (unsigned*)(sq + p.sq_off.tail);
+    sqMask = *(unsigned*)(sq + p.sq_off.ring_mask);
+    sqEntries = p.sq_entries;
+    sqLocalTail = *sqTail;
+
+    // индексы запросов совпадают с номерами в sqes
+    unsigned* array = (unsigned*)(sq + p.sq_off.array);
+
+    for( unsigned i = 0; i < sqEntries; i++ )
+        array[i] = i;
+
+    uint8_t* cq = (uint8_t*)cqPtr;
+    cqHead = (unsigned*)(cq + p.cq_off.head);
+    cqTail = (unsigned*)(cq + p.cq_off.tail);
+    cqMask = *(unsigned*)(cq + p.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+}
+// -------------------------------------------------------------------------
+IOUringQueue::~IOUringQueue()
+{
+    cleanup();
+}
+// -------------------------------------------------------------------------
+void IOUringQueue::cleanup() noexcept
+{
+    // закрытие отменяет все запросы, после этого ядро не обращается к буферам
+    if( fd >= 0 )
+        ::close(fd);
+
+    fd = -1;
+
+    if( sqes )
+        ::munmap(sqes, sqesSize);
+
+    if( cqPtr && cqPtr != sqPtr )
+        ::munmap(cqPtr, cqSize);
+
+    if( sqPtr )
+        ::munmap(sqPtr, sqSize);
+
+    if( br )
+        ::munmap(br, brSize);
+
+    sqes = nullptr;
+    cqPtr = sqPtr = nullptr;
+    br = nullptr;
+}
+// -------------------------------------------------------------------------
+void IOUringQueue::setupBuffers( uint8_t* mem, size_t bsize, unsigned num )
+{
+    // кольцо буферов должно быть выровнено по странице
+    brSize = num * sizeof(struct io_uring_buf);
+    void* r = ::mmap(nullptr, brSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+
+    if( r == MAP_FAILED )
+        throw SystemError(string("io_uring buffers: ") + strerror(errno));
+
+    br = (struct io_uring_buf_ring*)r;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)br;
+    reg.ring_entries = num;
+    reg.bgid = bufGroup;
+
+    // ядро >= 5.19
+    if( ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0 )
+        throw SystemError(string("io_uring register buffers: ") + strerror(errno));
+
+    brMask = num - 1;
+    brTail = 0;
+    brAdded = 0;
+    bufMem = mem;
+    bufLen = bsize;
+}
+// -------------------------------------------------------------------------
+void IOUringQueue::addBuffer( uint16_t bid ) noexcept
+{
+    // не br->bufs: в C++ __DECLARE_FLEX_ARRAY смещает массив (пустая структура имеет размер 1)
+    struct io_uring_buf* b = (struct io_uring_buf*)br + ((brTail + brAdded) & brMask);
+    b->addr = (uint64_t)(uintptr_t)(bufMem + (size_t)bid * bufLen);
+    b->len = bufLen;
+    b->bid = bid;
+    brAdded++;
+}
+// -------------------------------------------------------------------------
+void IOUringQueue::commitBuffers() noexcept
+{
+    if( brAdded == 0 )
+        return;
+
+    brTail += brAdded;
+    brAdded = 0;
+    __atomic_store_n(&br->tail, brTail, __ATOMIC_RELEASE);
+}
+// -------------------------------------------------------------------------
+struct io_uring_sqe* IOUringQueue::getSqe() noexcept
+{
+    // очередь заполнена - отправляем то, что есть
+    if( sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries )
+        enter(0, -1);
+
+    if( sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries )
+        return nullptr;
+
+    struct io_uring_sqe* sqe = &sqes[sqLocalTail & sqMask];
+    sqLocalTail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+// -------------------------------------------------------------------------
+void IOUringQueue::recvMultishot( int sock, struct msghdr* mh, uint64_t data ) noexcept
+{
+    struct io_uring_sqe* sqe = getSqe();
+
+    if( !sqe )
+        return;
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = sock;
+    sqe->addr = (uint64_t)(uintptr_t)mh;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bufGroup;
+    sqe->user_data = data;
+}
+// -------------------------------------------------------------------------
+void IOUringQueue::read( int rfd, void* buf, size_t sz, uint64_t data ) noexcept
+{
+    struct io_uring_sqe* sqe = getSqe();
+
+    if( !sqe )
+        return;
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = rfd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = sz;
+    sqe->user_data = data;
+}
+// -------------------------------------------------------------------------
+void IOUringQueue::cancel( uint64_t data ) noexcept
+{
+    struct io_uring_sqe* sqe = getSqe();
+
+    if( !sqe )
+        return;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = data;
+    sqe->user_data = tagNone;
+}
+// -------------------------------------------------------------------------
+void IOUringQueue::sendmsg( int sock, const struct msghdr* mh, uint64_t data, bool link ) noexcept
+{
+    struct io_uring_sqe* sqe = getSqe();
+
+    if( !sqe )
+        return;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = sock;
+    sqe->addr = (uint64_t)(uintptr_t)mh;
+    sqe->len = 1;
+    sqe->user_data = data;
+
+    // связанные запросы выполняются по порядку
+    if( link )
+        sqe->flags = IOSQE_IO_LINK;
+}
+// -------------------------------------------------------------------------
+int IOUringQueue::enter( unsigned waitNr, int msec ) noexcept
+{
+    __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+    const unsigned toSubmit = sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    const unsigned ready = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) - *cqHead;
+
+    unsigned flags = 0;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    void* parg = nullptr;
+    size_t argsz = 0;
+
+    if( waitNr > ready )
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+
+        if( msec >= 0 )
+        {
+            ts.tv_sec = msec / 1000;
+            ts.tv_nsec = (msec % 1000) * 1000000LL;
+            memset(&arg, 0, sizeof(arg));
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+            flags |= IORING_ENTER_EXT_ARG;
+            parg = &arg;
+            argsz = sizeof(arg);
+        }
+    }
+    else
+        waitNr = 0;
+
+    if( toSubmit == 0 && flags == 0 )
+        return 0;
+
+    int ret = (int)::syscall(__NR_io_uring_enter, fd, toSubmit, waitNr, flags, parg, argsz);
+    return ret < 0 ? -errno : ret;
+}
+// -------------------------------------------------------------------------
+template<typename Func>
+size_t IOUringQueue::completions( Func&& f ) noexcept
+{
+    unsigned head = *cqHead;
+    const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    size_t n = 0;
+
+    for( ; head != tail; head++, n++ )
+    {
+        const struct io_uring_cqe* cqe = &cqes[head & cqMask];
+        Completion c;
+        c.data = cqe->user_data;
+        c.res = cqe->res;
+        c.more = ( cqe->flags & IORING_CQE_F_MORE );
+        c.bid = ( cqe->flags & IORING_CQE_F_BUFFER ) ? (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+        f(c);
+    }
+
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    return n;
+}
+// -------------------------------------------------------------------------
+size_t IOUringQueue::headerSize() noexcept
+{
+    return sizeof(struct io_uring_recvmsg_out) + ctrlSize;
+}
+// -------------------------------------------------------------------------
+bool IOUringQueue::parseRecvMsg( const uint8_t* buf, size_t res, const struct msghdr& mh,
+                                 uint32_t& off, uint32_t& len, std::atomic<uint32_t>& drops ) noexcept
+{
+    // в буфере: заголовок, адрес (msg_namelen), control (msg_controllen), данные
+    if( res < sizeof(struct io_uring_recvmsg_out) )
+        return false;
+
+    struct io_uring_recvmsg_out o;
+    memcpy(&o, buf, sizeof(o));
+
+    const size_t hdr = sizeof(o) + mh.msg_namelen + mh.msg_controllen;
+
+    if( (o.flags & MSG_TRUNC) || hdr + o.payloadlen > res )
+        return false;
+
+    // ядро добавляет счётчик отброшенных пакетов (SO_RXQ_OVFL) только если он не нулевой
+    const uint8_t* ctrl = buf + sizeof(o) + mh.msg_namelen;
+    size_t pos = 0;
+
+    while( pos + sizeof(struct cmsghdr) <= o.controllen )
+    {
+        struct cmsghdr c;
+        memcpy(&c, ctrl + pos, sizeof(c));
+
+        if( c.cmsg_len < sizeof(c) || pos + c.cmsg_len > o.controllen )
+            break;
+
+        if( c.cmsg_level == SOL_SOCKET && c.cmsg_type == SO_RXQ_OVFL )
+        {
+            uint32_t v;
+            memcpy(&v, CMSG_DATA((const struct cmsghdr*)(ctrl + pos)), sizeof(v));
+            drops.store(v);
+        }
+
+        pos += CMSG_ALIGN(c.cmsg_len);
+    }
+
+    off = hdr;
+    len = o.payloadlen;
+    return true;
+}
+// -------------------------------------------------------------------------
+#else // UNET_IO_URING
+// -------------------------------------------------------------------------
+IOUringQueue::IOUringQueue( unsigned entries, unsigned cqEntries )
+{
+    throw SystemError("io_uring is not supported by this build");
+}
+IOUringQueue::~IOUringQueue() {}
+void IOUringQueue::setupBuffers( uint8_t* mem, size_t bsize, unsigned num ) {}
+void IOUringQueue::addBuffer( uint16_t bid ) noexcept {}
+void IOUringQueue::commitBuffers() noexcept {}
+void IOUringQueue::recvMultishot( int sock, struct msghdr* mh, uint64_t data ) noexcept {}
+void IOUringQueue::read( int fd, void* buf, size_t sz, uint64_t data ) noexcept {}
+void IOUringQueue::cancel( uint64_t data ) noexcept {}
+void IOUringQueue::sendmsg( int sock, const struct msghdr* mh, uint64_t data, bool link ) noexcept {}
+int IOUringQueue::enter( unsigned waitNr, int msec ) noexcept
+{
+    return -ENOSYS;
+}
+template<typename Func>
+size_t IOUringQueue::completions( Func&& f ) noexcept
+{
+    return 0;
+}
+size_t IOUringQueue::headerSize() noexcept
+{
+    return 0;
+}
+bool IOUringQueue::parseRecvMsg( const uint8_t* buf, size_t res, const struct msghdr& mh,
+                                 uint32_t& off, uint32_t& len, std::atomic<uint32_t>& drops ) noexcept
+{
+    return false;
+}
+// -------------------------------------------------------------------------
+#endif // UNET_IO_URING
+// -------------------------------------------------------------------------
+UNetIOUring::Channel::Channel( int _sock, size_t qsize ):
+    sock(_sock),
+    items(qsize)
+{
+    efd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if( efd < 0 )
+        throw SystemError(string("(UNetIOUring): eventfd: ") + strerror(errno));
+
+    memset(&mhdr, 0, sizeof(mhdr));
+    mhdr.msg_controllen = ctrlSize;
+}
+// -------------------------------------------------------------------------
+UNetIOUring::Channel::~Channel()
+{
+    if( efd >= 0 )
+        ::close(efd);
+}
+// -------------------------------------------------------------------------
+std::shared_ptr<UNetIOUring> UNetIOUring::create( size_t nbufs, size_t msgSize, std::string& err ) noexcept
+{
+    try
+    {
+        return std::shared_ptr<UNetIOUring>(new UNetIOUring(nbufs, msgSize));
+    }
+    catch( const std::exception& ex )
+    {
+        err = ex.what();
+    }
+
+    return nullptr;
+}
+// -------------------------------------------------------------------------
+static size_t poolSize( size_t n ) noexcept
+{
+    // количество буферов - степень 2, номер буфера - 16 бит
+    size_t sz = 2;
+
+    while( sz < n && sz < 32768 )
+        sz <<= 1;
+
+    return sz;
+}
+// -------------------------------------------------------------------------
+UNetIOUring::UNetIOUring( size_t _nbufs, size_t _msgSize ):
+    nbufs(poolSize(_nbufs)),
+    msgSize(_msgSize)
+{
+    // заголовок recvmsg + control + сообщение, с выравниванием
+    bufSize = ((IOUringQueue::headerSize() + msgSize + 63) / 64) * 64;
+    pool.resize(nbufs * bufSize);
+    freed.reserve(nbufs);
+    freedTmp.reserve(nbufs);
+
+    // очередь завершений с запасом (на каждый буфер пула по одному событию + служебные)
+    q = unisetstd::make_unique<IOUringQueue>(256, std::max<size_t>(nbufs * 2, 512));
+    q->setupBuffers(pool.data(), bufSize, nbufs);
+
+    for( size_t i = 0; i < nbufs; i++ )
+        q->addBuffer(i);
+
+    q->commitBuffers();
+    inPool = nbufs;
+
+    probe();
+
+    wakefd = ::eventfd(0, EFD_CLOEXEC);
+
+    if( wakefd < 0 )
+        throw SystemError(string("(UNetIOUring): eventfd: ") + strerror(errno));
+
+    q->read(wakefd, &wakeval, sizeof(wakeval), tagWake);
+
+    active = true;
+    thr = unisetstd::make_unique< ThreadCreator<UNetIOUring> >(this, &UNetIOUring::thread);
+    thr->start();
+}
+// -------------------------------------------------------------------------
+UNetIOUring::~UNetIOUring()
+{
+    active = false;
+
+    if( thr && thr->isRunning() )
+    {
+        wakeup();
+        thr->join();
+    }
+
+    // сперва закрываем io_uring (ядро перестаёт писать в буферы пула)
+    q = nullptr;
+
+    if( wakefd >= 0 )
+        ::close(wakefd);
+}
+// -------------------------------------------------------------------------
+void UNetIOUring::probe()
+{
+    // multishot recvmsg появился в ядре 6.0, на старых ядрах запрос завершается с EINVAL
+    int sock = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+    if( sock < 0 )
+        throw SystemError(string("(UNetIOUring): socket: ") + strerror(errno));
+
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+
+    q->recvMultishot(sock, &mh, tagProbe);
+    q->cancel(tagProbe);
+
+    int res = 0;
+    size_t num = 0;
+
+    for( int i = 0; i < 10 && num < 2; i++ )
+    {
+        int ret = q->enter(2 - num, 100);
+
+        if( ret < 0 && ret != -ETIME && ret != -EINTR )
+        {
+            res = ret;
+            break;
+        }
+
+        num += q->completions([&res]( const IOUringQueue::Completion & c )
+        {
+            if( c.data == tagProbe )
+                res = c.res;
+        });
+    }
+
+    ::close(sock);
+
+    if( res == -EINVAL || res == -EOPNOTSUPP )
+        throw SystemError("(UNetIOUring): multishot recvmsg is not supported by kernel");
+
+    if( res < 0 && res != -ECANCELED )
+        throw SystemError(string("(UNetIOUring): ") + strerror(-res));
+}
+// -------------------------------------------------------------------------
+void UNetIOUring::wakeup() noexcept
+{
+    uint64_t v = 1;
+
+    if( ::write(wakefd, &v, sizeof(v)) < 0 )
+        lastError = errno;
+}
+// -------------------------------------------------------------------------
+UNetIOUring::Channel* UNetIOUring::add( int sock )
+{
+    auto ch = unisetstd::make_unique<Channel>(sock, nbufs);
+    Channel* p = ch.get();
+
+    {
+        std::lock_guard<std::mutex> l(mut);
+        channels.push_back(std::move(ch));
+        toAdd.push_back(p);
+    }
+
+    wakeup();
+    return p;
+}
+// -------------------------------------------------------------------------
+void UNetIOUring::remove( Channel* ch ) noexcept
+{
+    {
+        std::lock_guard<std::mutex> l(mut);
+        toRemove.push_back(ch);
+    }
+
+    wakeup();
+
+    std::unique_lock<std::mutex> l(mut);
+    rmEvent.wait_for(l, std::chrono::seconds(1), [ch]
+    {
+        return ch->closed;
+    });
+}
+// -------------------------------------------------------------------------
+void UNetIOUring::release( const uint16_t* bids, size_t num ) noexcept
+{
+    {
+        std::lock_guard<std::mutex> l(mut);
+        freed.insert(freed.end(), bids, bids + num);
+    }
+
+    if( starving.exchange(false) )
+        wakeup();
+}
+// -------------------------------------------------------------------------
+void UNetIOUring::returnBuffer( uint16_t bid ) noexcept
+{
+    q->addBuffer(bid);
+    inPool++;
+}
+// -------------------------------------------------------------------------
+void UNetIOUring::arm( Channel* ch ) noexcept
+{
+    q->recvMultishot(ch->sock, &ch->mhdr, (uint64_t)(uintptr_t)ch);
+    ch->armed = true;
+}
+// -------------------------------------------------------------------------
+void UNetIOUring::onReceive( Channel* ch, int res, bool more, int bid ) noexcept
+{
+    if( bid >= 0 )
+        inPool--;
+
+    // запрос завершён (ошибка, отмена или кончились буферы), при необходимости будет поставлен заново
+    if( !more )
+        ch->armed = false;
+
+    if( res == -ENOBUFS )
+    {
+        nobufs++;
+        return;
+    }
+
+    if( res < 0 )
+    {
+        if( res != -ECANCELED )
+        {
+            ch->errors++;
+            lastError = -res;
+        }
+
+        return;
+    }
+
+    if( bid < 0 )
+        return;
+
+    uint32_t off = 0;
+    uint32_t len = 0;
+    const uint8_t* buf = pool.data() + (size_t)bid * bufSize;
+
+    if( !ch->active || !IOUringQueue::parseRecvMsg(buf, res, ch->mhdr, off, len, ch->kernelDrops) )
+    {
+        if( ch->active )
+            ch->errors++;
+
+        returnBuffer(bid);
+        return;
+    }
+
+    const size_t h = ch->head.load(std::memory_order_relaxed);
+    Channel::Item& it = ch->items[h % ch->items.size()];
+    it.bid = bid;
+    it.off = off;
+    it.len = len;
+    ch->head.store(h + 1, std::memory_order_release);
+
+    if( !ch->hasData )
+    {
+        ch->hasData = true;
+        notifyList.push_back(ch);
+    }
+}
+// -------------------------------------------------------------------------
+void UNetIOUring::thread() noexcept
+{
+    while( active )
+    {
+        // отправляем новые запросы и ждём хотя бы одного события (один системный вызов)
+        int ret = q->enter(1, 100);
+        enterCount++;
+
+        if( ret < 0 && ret != -ETIME && ret != -EINTR )
+            lastError = -ret;
+
+        cqeCount += q->completions([this]( const IOUringQueue::Completion & c )
+        {
+            if( c.data == tagWake )
+            {
+                q->read(wakefd, &wakeval, sizeof(wakeval), tagWake);
+                return;
+            }
+
+            if( c.data == tagNone || c.data == tagProbe )
+                return;
+
+            onReceive((Channel*)(uintptr_t)c.data, c.res, c.more, c.bid);
+        });
+
+        // будим читателей (только если они ещё не разбужены)
+        for( auto&& ch : notifyList )
+        {
+            ch->hasData = false;
+
+            if( !ch->notified.exchange(true) )
+            {
+                uint64_t v = 1;
+
+                if( ::write(ch->efd, &v, sizeof(v)) < 0 )
+                    lastError = errno;
+            }
+        }
+
+        notifyList.clear();
+
+        {
+            std::lock_guard<std::mutex> l(mut);
+            freedTmp.swap(freed);
+
+            for( auto&& ch : toAdd )
+                chlist.push_back(ch);
+
+            toAdd.clear();
+
+            for( auto&& ch : toRemove )
+            {
+                ch->active = false;
+
+                if( ch->armed )
+                    q->cancel((uint64_t)(uintptr_t)ch);
+
+                // читатель канал уже не использует, возвращаем в пул то, что пришло после clear()
+                for( auto it = ch->front(); it; it = ch->front() )
+                {
+                    freedTmp.push_back(it->bid);
+                    ch->pop();
+                }
+            }
+
+            toRemove.clear();
+        }
+
+        for( const auto& bid : freedTmp )
+            returnBuffer(bid);
+
+        freedTmp.clear();
+        q->commitBuffers();
+
+        // (пере)запускаем приём там где он завершился
+        bool needBuffers = false;
+
+        for( auto&& ch : chlist )
+        {
+            if( !ch->active || ch->armed )
+                continue;
+
+            if( inPool > 0 )
+                arm(ch);
+            else
+                needBuffers = true;
+        }
+
+        size_t closed = 0;
+
+        {
+            std::lock_guard<std::mutex> l(mut);
+            chlist.erase( std::remove_if(chlist.begin(), chlist.end(), [&closed]( Channel * ch )
+            {
+                if( ch->active || ch->armed )
+                    return false;
+
+                ch->closed = true;
+                closed++;
+                return true;
+            }), chlist.end() );
+        }
+
+        if( closed > 0 )
+            rmEvent.notify_all();
+
+        if( needBuffers )
+        {
+            // все буферы у читателей, ждём возврата (см. release())
+            starving = true;
+            std::lock_guard<std::mutex> l(mut);
+
+            if( !freed.empty() && starving.exchange(false) )
+                wakeup();
+        }
+    }
+}
+// -------------------------------------------------------------------------
+std::string UNetIOUring::getInfo() const
+{
+    ostringstream s;
+    s << "io_uring: bufs=" << inPool << "/" << nbufs
+      << " bufSize=" << bufSize
+      << " enter=" << enterCount
+      << " cqe=" << cqeCount
+      << " nobufs=" << nobufs;
+
+    if( lastError != 0 )
+        s << " lastError=" << strerror(lastError);
+
+    return s.str();
+}
+// -------------------------------------------------------------------------
+IOUringReceiveTransport::IOUringReceiveTransport( std::unique_ptr<UNetReceiveTransport>&& _tr, const std::shared_ptr<UNetIOUring>& _uring ):
+    tr(std::move(_tr)),
+    uring(_uring)
+{
+}
+// -------------------------------------------------------------------------
+IOUringReceiveTransport::~IOUringReceiveTransport()
+{
+    if( ch )
+    {
+        clear();
+        uring->remove(ch);
+    }
+}
+// -------------------------------------------------------------------------
+bool IOUringReceiveTransport::isConnected() const noexcept
+{
+    return ch && tr->isConnected();
+}
+// -------------------------------------------------------------------------
+std::string IOUringReceiveTransport::toString() const noexcept
+{
+    return tr->toString() + " (io_uring)";
+}
+// -------------------------------------------------------------------------
+std::string IOUringReceiveTransport::ID() const noexcept
+{
+    return tr->ID();
+}
+// -------------------------------------------------------------------------
+bool IOUringReceiveTransport::createConnection( bool throwEx, timeout_t readTimeout, bool noblock )
+{
+    if( ch )
+    {
+        clear();
+        uring->remove(ch);
+        ch = nullptr;
+    }
+
+    if( !tr->createConnection(throwEx, readTimeout, noblock) )
+        return false;
+
+    try
+    {
+        ch = uring->add(tr->getSocket());
+    }
+    catch( const std::exception& ex )
+    {
+        tr->disconnect();
+
+        if( throwEx )
+            throw SystemError(toString() + "(createConnection): " + ex.what());
+
+        return false;
+    }
+
+    return true;
+}
+// -------------------------------------------------------------------------
+void IOUringReceiveTransport::disconnect()
+{
+    if( ch )
+    {
+        clear();
+        uring->remove(ch);
+        ch = nullptr;
+    }
+
+    tr->disconnect();
+}
+// -------------------------------------------------------------------------
+void IOUringReceiveTransport::clear() noexcept
+{
+    bids.clear();
+
+    for( auto it = ch->front(); it; it = ch->front() )
+    {
+        bids.push_back(it->bid);
+        ch->pop();
+    }
+
+    if( !bids.empty() )
+        uring->release(bids.data(), bids.size());
+}
+// -------------------------------------------------------------------------
+int IOUringReceiveTransport::getSocket() const
+{
+    return ch ? ch->efd : -1;
+}
+// -------------------------------------------------------------------------
+int IOUringReceiveTransport::getNetSocket() const
+{
+    return tr->getSocket();
+}
+// -------------------------------------------------------------------------
+ssize_t IOUringReceiveTransport::receive( void* r_buf, size_t sz )
+{
+    UNetBuffer b;
+    b.data = r_buf;
+    b.size = sz;
+
+    ssize_t ret = receiveBatch(&b, 1);
+    return ret > 0 ? (ssize_t)b.len : ret;
+}
+// -------------------------------------------------------------------------
+ssize_t IOUringReceiveTransport::receiveBatch( UNetBuffer* bufs, size_t num )
+{
+    if( !ch )
+    {
+        errno = ENOTCONN;
+        return -1;
+    }
+
+    size_t n = 0;
+    bids.clear();
+
+    for( auto it = ch->front(); it && n < num; it = ch->front() )
+    {
+        if( it->len <= bufs[n].size )
+        {
+            memcpy(bufs[n].data, uring->data(*it), it->len);
+            bufs[n].len = it->len;
+            n++;
+        }
+        else
+            ch->errors++;
+
+        bids.push_back(it->bid);
+        ch->pop();
+    }
+
+    if( !bids.empty() )
+        uring->release(bids.data(), bids.size());
+
+    // очередь пуста - сбрасываем событие
+    // (если что-то пришло пока сбрасывали - выставляем заново)
+    if( ch->size() == 0 )
+    {
+        ch->notified = false;
+        uint64_t v;
+
+        if( ::read(ch->efd, &v, sizeof(v)) < 0 ) {}
+
+        if( ch->size() > 0 && !ch->notified.exchange(true) )
+        {
+            v = 1;
+
+            if( ::write(ch->efd, &v, sizeof(v)) < 0 ) {}
+        }
+    }
+
+    return n;
+}
+// -------------------------------------------------------------------------
+long IOUringReceiveTransport::getKernelDrops() const noexcept
+{
+    if( !ch || tr->getKernelDrops() < 0 )
+        return -1;
+
+    return ch->kernelDrops;
+}
+// -------------------------------------------------------------------------
+bool IOUringReceiveTransport::isReadyForReceive( timeout_t tout ) noexcept
+{
+    if( !ch )
+        return false;
+
+    if( ch->size() > 0 )
+        return true;
+
+    struct pollfd pfd;
+    pfd.fd = ch->efd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return ( ::poll(&pfd, 1, tout) > 0 );
+}
+// -------------------------------------------------------------------------
+int IOUringReceiveTransport::available()
+{
+    return ch ? ch->size() : 0;
+}
+// -------------------------------------------------------------------------
+std::unique_ptr<IOUringSendTransport> IOUringSendTransport::create( std::unique_ptr<UNetSendTransport>& tr, std::string& err ) noexcept
+{
+    const struct sockaddr* to = nullptr;
+    socklen_t tolen = 0;
+
+    if( !tr->getDestination(to, tolen) )
+    {
+        err = "unknown destination address for " + tr->toString();
+        return nullptr;
+    }
+
+    try
+    {
+        auto q = unisetstd::make_unique<IOUringQueue>(sendChunk, 0);
+        return std::unique_ptr<IOUringSendTransport>(new IOUringSendTransport(std::move(tr), std::move(q)));
+    }
+    catch( const std::exception& ex )
+    {
+        err = ex.what();
+    }
+
+    return nullptr;
+}
+// -------------------------------------------------------------------------
+IOUringSendTransport::IOUringSendTransport( std::unique_ptr<UNetSendTransport>&& _tr, std::unique_ptr<IOUringQueue>&& _q ):
+    tr(std::move(_tr)),
+    q(std::move(_q)),
+    msgs(sendChunk),
+    iovs(sendChunk)
+{
+}
+// -------------------------------------------------------------------------
+IOUringSendTransport::~IOUringSendTransport()
+{
+}
+// -------------------------------------------------------------------------
+bool IOUringSendTransport::isConnected() const
+{
+    return tr->isConnected();
+}
+// -------------------------------------------------------------------------
+std::string IOUringSendTransport::toString() const
+{
+    return tr->toString() + " (io_uring)";
+}
+// -------------------------------------------------------------------------
+bool IOUringSendTransport::createConnection( bool throwEx, timeout_t sendTimeout )
+{
+    return tr->createConnection(throwEx, sendTimeout);
+}
+// -------------------------------------------------------------------------
+int IOUringSendTransport::getSocket() const
+{
+    return tr->getSocket();
+}
+// -------------------------------------------------------------------------
+bool IOUringSendTransport::isReadyForSend( timeout_t tout )
+{
+    return tr->isReadyForSend(tout);
+}
+// -------------------------------------------------------------------------
+ssize_t IOUringSendTransport::send( const void* buf, size_t sz )
+{
+    UNetBuffer b;
+    b.data = (void*)buf;
+    b.len = sz;
+
+    ssize_t ret = sendBatch(&b, 1);
+    return ret > 0 ? (ssize_t)sz : ret;
+}
+// -------------------------------------------------------------------------
+ssize_t IOUringSendTransport::sendBatch( const UNetBuffer* bufs, size_t num )
+{
+    const struct sockaddr* to = nullptr;
+    socklen_t tolen = 0;
+    tr->getDestination(to, tolen);
+
+    const int sock = tr->getSocket();
+    size_t sent = 0;
+    int err = 0;
+
+    while( sent < num )
+    {
+        const size_t cnt = std::min(num - sent, sendChunk);
+
+        for( size_t i = 0; i < cnt; i++ )
+        {
+            iovs[i].iov_base = bufs[sent + i].data;
+            iovs[i].iov_len = bufs[sent + i].len;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_name = (void*)to;
+            msgs[i].msg_namelen = tolen;
+            msgs[i].msg_iov = &iovs[i];
+            msgs[i].msg_iovlen = 1;
+            q->sendmsg(sock, &msgs[i], i, i + 1 < cnt);
+        }
+
+        // отправляем всю пачку и ждём её завершения одним вызовом
+        // (буферы после возврата могут быть изменены)
+        size_t done = 0;
+        size_t ok = 0;
+        int ret = q->enter(cnt, -1);
+
+        while( true )
+        {
+            done += q->completions([&ok, &err]( const IOUringQueue::Completion & c )
+            {
+                if( c.res >= 0 )
+                    ok++;
+                else if( err == 0 )
+                    err = -c.res;
+            });
+
+            if( done >= cnt )
+                break;
+
+            if( ret < 0 && ret != -EINTR )
+            {
+                err = -ret;
+                break;
+            }
+
+            ret = q->enter(cnt - done, -1);
+        }
+
+        sent += ok;
+
+        if( ok < cnt )
+            break;
+    }
+
+    if( sent == 0 && num > 0 )
+    {
+        errno = err;
+        return -1;
+    }
+
+    return sent;
+}
+// -------------------------------------------------------------------------
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2021 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -------------------------------------------------------------------------
+#ifndef UNetIOUring_H_
+#define UNetIOUring_H_
+// -------------------------------------------------------------------------
+#include <string>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "UNetTransport.h"
+#include "ThreadCreator.h"
+// -------------------------------------------------------------------------
+namespace uniset
+{
+    class IOUringQueue; // кольца io_uring (реализация в UNetIOUring.cc)
+
+    /*! Общий для всех каналов приёма поток на основе io_uring.
+     *
+     * Для каждого сокета ставится один "multishot" recvmsg с буферами из общего пула
+     * (provided buffers, выделяются и регистрируются в ядре при создании).
+     * Поэтому один поток обслуживает все каналы и не делает системных вызовов на каждый пакет.
+     *
+     * Принятые сообщения остаются в буферах пула, в очередь канала кладётся только ссылка.
+     * Читатель (IOUringReceiveTransport) копирует сообщение к себе и возвращает буфер в пул (release()).
+     * О появлении данных в очереди канал сообщает через eventfd (Channel::efd).
+     *
+     * Если io_uring недоступен (нет поддержки при сборке, старое ядро, запрещён в контейнере),
+     * create() возвращает nullptr и надо использовать обычные транспорты.
+     * Требуется ядро с поддержкой multishot recvmsg (>= 6.0).
+     */
+    class UNetIOUring
+    {
+        public:
+
+            /*! \param nbufs - количество буферов в пуле (округляется до степени 2)
+             * \param msgSize - максимальный размер сообщения
+             * \param err - [out] причина, если io_uring недоступен
+             * \return nullptr если io_uring недоступен
+             */
+            static std::shared_ptr<UNetIOUring> create( size_t nbufs, size_t msgSize, std::string& err ) noexcept;
+
+            ~UNetIOUring();
+
+            // Очередь принятых сообщений одного сокета.
+            // Писатель - поток io_uring, читатель - IOUringReceiveTransport.
+            struct Channel
+            {
+                Channel( int sock, size_t qsize );
+                ~Channel();
+
+                struct Item
+                {
+                    uint16_t bid;  /*!< номер буфера в пуле */
+                    uint32_t off;  /*!< смещение сообщения в буфере */
+                    uint32_t len;  /*!< размер сообщения */
+                };
+
+                /*! \return nullptr если очередь пуста */
+                inline const Item* front() const noexcept
+                {
+                    const size_t t = tail.load(std::memory_order_relaxed);
+
+                    if( t == head.load(std::memory_order_acquire) )
+                        return nullptr;
+
+                    return &items[t % items.size()];
+                }
+
+                inline void pop() noexcept
+                {
+                    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+                }
+
+                inline size_t size() const noexcept
+                {
+                    const size_t t = tail.load(std::memory_order_acquire);
+                    return head.load(std::memory_order_acquire) - t;
+                }
+
+                const int sock;
+                int efd = { -1 }; /*!< eventfd: в очереди есть данные */
+                std::atomic_bool notified = { false }; /*!< в efd уже записано событие */
+                std::atomic<uint32_t> kernelDrops = { 0 }; /*!< SO_RXQ_OVFL */
+                std::atomic<size_t> errors = { 0 };  /*!< ошибки приёма (в т.ч. обрезанные сообщения) */
+                bool closed = { false }; /*!< приём остановлен (см. remove()), защищено mutex-ом */
+
+                // используется только потоком io_uring
+                std::vector<Item> items; /*!< размер равен размеру пула, поэтому очередь не переполняется */
+                bool active = { true };
+                bool armed = { false }; /*!< поставлен multishot recvmsg */
+                bool hasData = { false };
+                struct msghdr mhdr; /*!< задаёт только место под control-сообщения (SO_RXQ_OVFL) */
+
+                // счётчики только растут, индекс - остаток от деления на items.size()
+                alignas(64) std::atomic<size_t> head = { 0 }; /*!< меняет только поток io_uring */
+                alignas(64) std::atomic<size_t> tail = { 0 }; /*!< меняет только читатель */
+            };
+
+            /*! начать приём из сокета
+             * \return канал (действителен до уничтожения объекта)
+             * \throw SystemError
+             */
+            Channel* add( int sock );
+
+            /*! прекратить приём (сообщения из очереди канала надо вернуть в пул до вызова)
+             * Ждёт отмены запроса: до этого ядро держит сокет (и порт) открытым даже после close().
+             */
+            void remove( Channel* ch ) noexcept;
+
+            /*! адрес сообщения в пуле */
+            inline const uint8_t* data( const Channel::Item& it ) const noexcept
+            {
+                return pool.data() + (size_t)it.bid * bufSize + it.off;
+            }
+
+            /*! вернуть буферы в пул */
+            void release( const uint16_t* bids, size_t num ) noexcept;
+
+            inline size_t getMessageSize() const noexcept
+            {
+                return msgSize;
+            }
+
+            std::string getInfo() const;
+
+        protected:
+            UNetIOUring( size_t nbufs, size_t msgSize );
+
+            void thread() noexcept;
+            void wakeup() noexcept;
+            void probe();
+            void arm( Channel* ch ) noexcept;
+            void onReceive( Channel* ch, int res, bool more, int bid ) noexcept;
+            void returnBuffer( uint16_t bid ) noexcept;
+
+        private:
+            std::unique_ptr<IOUringQueue> q;
+            std::unique_ptr< ThreadCreator<UNetIOUring> > thr;
+            std::atomic_bool active = { false };
+
+            const size_t nbufs;
+            const size_t msgSize;
+            size_t bufSize;
+            std::vector<uint8_t> pool;
+            std::atomic<size_t> inPool = { 0 }; /*!< сколько буферов сейчас у ядра (меняет только поток io_uring) */
+
+            int wakefd = { -1 };  /*!< eventfd для пробуждения потока io_uring */
+            uint64_t wakeval = { 0 };
+            std::atomic_bool starving = { false }; /*!< ждём возврата буферов в пул */
+
+            std::mutex mut; // для списков ниже
+            std::condition_variable rmEvent;
+            std::vector<std::unique_ptr<Channel>> channels; /*!< каналы не удаляются до завершения (переподключение - редкое событие) */
+            std::vector<Channel*> toAdd;
+            std::vector<Channel*> toRemove;
+            std::vector<uint16_t> freed;
+
+            // используется только потоком io_uring
+            std::vector<Channel*> chlist;
+            std::vector<Channel*> notifyList;
+            std::vector<uint16_t> freedTmp;
+
+            // статистика
+            std::atomic<size_t> cqeCount = { 0 };
+            std::atomic<size_t> enterCount = { 0 };
+            std::atomic<size_t> nobufs = { 0 };  /*!< пул был пуст (ENOBUFS) */
+            std::atomic<int> lastError = { 0 };
+    };
+    // -------------------------------------------------------------------------
+    /*! Приём через UNetIOUring. Обёртка над обычным транспортом,
+     * который используется для создания (и настройки) сокета.
+     * getSocket() возвращает eventfd канала (его и надо ждать вместо сокета),
+     * а getNetSocket() - сокет обёрнутого транспорта.
+     */
+    class IOUringReceiveTransport:
+        public UNetReceiveTransport
+    {
+        public:
+            IOUringReceiveTransport( std::unique_ptr<UNetReceiveTransport>&& tr, const std::shared_ptr<UNetIOUring>& uring );
+            virtual ~IOUringReceiveTransport();
+
+            virtual bool isConnected() const noexcept override;
+            virtual std::string toString() const noexcept override;
+            virtual std::string ID() const noexcept override;
+
+            virtual bool createConnection( bool throwEx, timeout_t readTimeout, bool noblock ) override;
+            virtual void disconnect() override;
+            virtual int getSocket() const override;
+            virtual int getNetSocket() const override;
+            virtual ssize_t receive( void* r_buf, size_t sz ) override;
+            virtual ssize_t receiveBatch( UNetBuffer* bufs, size_t num ) override;
+            virtual long getKernelDrops() const noexcept override;
+            virtual bool isReadyForReceive(timeout_t tout) noexcept override;
+            virtual int available() override;
+
+        protected:
+            void clear() noexcept;
+
+            std::unique_ptr<UNetReceiveTransport> tr;
+            std::shared_ptr<UNetIOUring> uring;
+            UNetIOUring::Channel* ch = { nullptr };
+            std::vector<uint16_t> bids;
+    };
+    // -------------------------------------------------------------------------
+    /*! Посылка через io_uring: вся пачка (sendBatch()) - одним системным вызовом.
+     * Обёртка над обычным транспортом (создание сокета и адрес назначения).
+     */
+    class IOUringSendTransport:
+        public UNetSendTransport
+    {
+        public:
+
+            /*! \param tr - обычный транспорт (забирается только в случае успеха)
+             * \return nullptr если io_uring недоступен (см. err)
+             */
+            static std::unique_ptr<IOUringSendTransport> create( std::unique_ptr<UNetSendTransport>& tr, std::string& err ) noexcept;
+
+            virtual ~IOUringSendTransport();
+
+            virtual bool isConnected() const override;
+            virtual std::string toString() const override;
+
+            virtual bool createConnection( bool throwEx, timeout_t sendTimeout ) override;
+            virtual int getSocket() const override;
+
+            virtual bool isReadyForSend( timeout_t tout ) override;
+            virtual ssize_t send( const void* buf, size_t sz ) override;
+            virtual ssize_t sendBatch( const UNetBuffer* bufs, size_t num ) override;
+
+        protected:
+            IOUringSendTransport( std::unique_ptr<UNetSendTransport>&& tr, std::unique_ptr<IOUringQueue>&& q );
+
+            std::unique_ptr<UNetSendTransport> tr;
+            std::unique_ptr<IOUringQueue> q;
+            std::vector<struct msghdr> msgs;
+            std::vector<struct iovec> iovs;
+    };
+} // end of uniset namespace
+// -------------------------------------------------------------------------
+#endif // UNetIOUring_H_
+// -------------------------------------------------------------------------
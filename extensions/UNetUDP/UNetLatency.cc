@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2021 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -------------------------------------------------------------------------
+#include <sstream>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include "UNetLatency.h"
+// -------------------------------------------------------------------------
+namespace uniset
+{
+    // -------------------------------------------------------------------------
+    using namespace std;
+    // -------------------------------------------------------------------------
+    static const int64_t NoValue = std::numeric_limits<int64_t>::max();
+    // -------------------------------------------------------------------------
+    const std::array<int64_t, UNetLatency::NumBuckets - 1> UNetLatency::bounds =
+    {
+        50, 100, 200, 500,
+        1000, 2000, 5000, 10000, 20000, 50000,
+        100000, 200000, 500000, 1000000
+    };
+    // -------------------------------------------------------------------------
+    UNetLatency::UNetLatency() noexcept:
+        curMin(NoValue),
+        prevMin(NoValue)
+    {
+        for( auto&& h : latHist )
+            h = 0;
+
+        for( auto&& h : jitHist )
+            h = 0;
+    }
+    // -------------------------------------------------------------------------
+    void UNetLatency::setSyncClock( bool set ) noexcept
+    {
+        syncClock = set;
+    }
+    // -------------------------------------------------------------------------
+    void UNetLatency::setOffsetWindow( size_t periods ) noexcept
+    {
+        offsetWindow = std::max(periods, (size_t)1);
+    }
+    // -------------------------------------------------------------------------
+    size_t UNetLatency::bucket( int64_t usec ) noexcept
+    {
+        return std::upper_bound(bounds.begin(), bounds.end(), usec) - bounds.begin();
+    }
+    // -------------------------------------------------------------------------
+    void UNetLatency::add( const struct timespec& sendTime, const struct timespec& recvTime ) noexcept
+    {
+        const int64_t s = (int64_t)sendTime.tv_sec * 1000000000 + sendTime.tv_nsec;
+        const int64_t r = (int64_t)recvTime.tv_sec * 1000000000 + recvTime.tv_nsec;
+        const int64_t transit = r - s;
+
+        int64_t m = curMin.load(std::memory_order_relaxed);
+
+        while( transit < m && !curMin.compare_exchange_weak(m, transit, std::memory_order_relaxed) ) {}
+
+        // при несинхронизированных часах отсчитываем от оценки смещения
+        int64_t lat = syncClock ? transit : transit - offset();
+
+        if( lat < 0 )
+            lat = 0;
+
+        if( havePrev )
+        {
+            const int64_t d = std::abs(transit - prevTransit);
+            jitter16 += d - jitter16 / 16;
+            jitter.store(jitter16 / 16, std::memory_order_relaxed);
+            jitHist[bucket(d / 1000)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        prevTransit = transit;
+        havePrev = true;
+
+        sum.fetch_add(lat, std::memory_order_relaxed);
+        num.fetch_add(1, std::memory_order_relaxed);
+
+        int64_t mx = maxv.load(std::memory_order_relaxed);
+
+        while( lat > mx && !maxv.compare_exchange_weak(mx, lat, std::memory_order_relaxed) ) {}
+
+        latHist[bucket(lat / 1000)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+    }
+    // -------------------------------------------------------------------------
+    void UNetLatency::period() noexcept
+    {
+        const uint64_t n = num.exchange(0);
+        const int64_t s = sum.exchange(0);
+        const int64_t mx = maxv.exchange(0);
+
+        lastAvg = ( n > 0 ) ? s / (int64_t)n / 1000 : 0;
+        lastMax = mx / 1000;
+
+        // окно для оценки смещения: текущий минимум становится предыдущим
+        if( ++nperiod >= offsetWindow )
+        {
+            nperiod = 0;
+            prevMin = curMin.exchange(NoValue);
+        }
+    }
+    // -------------------------------------------------------------------------
+    void UNetLatency::reset() noexcept
+    {
+        havePrev = false;
+        prevTransit = 0;
+        jitter16 = 0;
+        jitter = 0;
+        curMin = NoValue;
+        prevMin = NoValue;
+        total = 0;
+        sum = 0;
+        num = 0;
+        maxv = 0;
+        lastAvg = 0;
+        lastMax = 0;
+        nperiod = 0;
+
+        for( auto&& h : latHist )
+            h = 0;
+
+        for( auto&& h : jitHist )
+            h = 0;
+    }
+    // -------------------------------------------------------------------------
+    int64_t UNetLatency::offset() const noexcept
+    {
+        return std::min(curMin.load(std::memory_order_relaxed), prevMin.load(std::memory_order_relaxed));
+    }
+    // -------------------------------------------------------------------------
+    int64_t UNetLatency::getLatency() const noexcept
+    {
+        return lastAvg;
+    }
+    // -------------------------------------------------------------------------
+    int64_t UNetLatency::getLatencyMax() const noexcept
+    {
+        return lastMax;
+    }
+    // -------------------------------------------------------------------------
+    int64_t UNetLatency::getJitter() const noexcept
+    {
+        return jitter / 1000;
+    }
+    // -------------------------------------------------------------------------
+    int64_t UNetLatency::getOffset() const noexcept
+    {
+        const int64_t o = offset();
+        return ( o == NoValue ) ? 0 : o / 1000;
+    }
+    // -------------------------------------------------------------------------
+    static void printHistogram( std::ostream& os, const UNetLatency::Histogram& h )
+    {
+        for( size_t i = 0; i < h.size(); i++ )
+        {
+            const uint64_t n = h[i].load(std::memory_order_relaxed);
+
+            if( n == 0 )
+                continue;
+
+            if( i < UNetLatency::bounds.size() )
+                os << " <" << UNetLatency::bounds[i] << ":" << n;
+            else
+                os << " >=" << UNetLatency::bounds.back() << ":" << n;
+        }
+    }
+    // -------------------------------------------------------------------------
+    std::string UNetLatency::getInfo() const
+    {
+        ostringstream s;
+        s << "latency: avg=" << getLatency()
+          << " max=" << getLatencyMax()
+          << " jitter=" << getJitter()
+          << " offset=" << ( syncClock ? 0 : getOffset() )
+          << " usec"
+          << " packets=" << count()
+          << " clock=" << ( syncClock ? "sync" : "estimate" );
+
+        s << endl << "\t  latency histogram(usec):";
+        printHistogram(s, latHist);
+        s << endl << "\t  jitter histogram(usec):";
+        printHistogram(s, jitHist);
+        return s.str();
+    }
+    // -------------------------------------------------------------------------
+#ifndef DISABLE_REST_API
+    static Poco::JSON::Array::Ptr histogramToJSON( const UNetLatency::Histogram& h )
+    {
+        Poco::JSON::Array::Ptr jdata = new Poco::JSON::Array();
+
+        for( size_t i = 0; i < h.size(); i++ )
+        {
+            Poco::JSON::Object::Ptr jb = new Poco::JSON::Object();
+
+            if( i < UNetLatency::bounds.size() )
+                jb->set("lt_usec", UNetLatency::bounds[i]);
+            else
+                jb->set("lt_usec", "inf");
+
+            jb->set("count", (uint64_t)h[i].load(std::memory_order_relaxed));
+            jdata->add(jb);
+        }
+
+        return jdata;
+    }
+    // -------------------------------------------------------------------------
+    Poco::JSON::Object::Ptr UNetLatency::httpGet() const
+    {
+        Poco::JSON::Object::Ptr json = new Poco::JSON::Object();
+        json->set("packets", (uint64_t)count());
+        json->set("syncClock", syncClock);
+        json->set("latency_usec", getLatency());
+        json->set("latencyMax_usec", getLatencyMax());
+        json->set("jitter_usec", getJitter());
+        json->set("offset_usec", syncClock ? 0 : getOffset());
+        json->set("latencyHistogram", histogramToJSON(latHist));
+        json->set("jitterHistogram", histogramToJSON(jitHist));
+        return json;
+    }
+#endif
+    // -------------------------------------------------------------------------
+} // end of namespace uniset
+// -------------------------------------------------------------------------
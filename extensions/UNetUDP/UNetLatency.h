@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2021 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -------------------------------------------------------------------------
+#ifndef UNetLatency_H_
+#define UNetLatency_H_
+// -------------------------------------------------------------------------
+#include <atomic>
+#include <array>
+#include <string>
+#include <ctime>
+#include <cstdint>
+#ifndef DISABLE_REST_API
+#include <Poco/JSON/Object.h>
+#endif
+// -------------------------------------------------------------------------
+namespace uniset
+{
+    /*! Статистика задержки доставки пакетов по меткам времени отправителя (см. UniSetUDP::addTimestamp()).
+     *
+     * Задержка считается как разница между временем приёма и меткой отправителя (обе CLOCK_REALTIME).
+     * Если часы узлов синхронизированы (NTP, PTP), то это и есть задержка (setSyncClock()).
+     * Иначе в разнице есть неизвестное смещение часов. В качестве его оценки берётся минимальная
+     * разница за последние offsetWindow периодов (т.е. считается, что хотя бы один пакет прошёл без задержек),
+     * и задержка отсчитывается от неё ("дополнительная" задержка в очередях сети и приёмника).
+     *
+     * Джиттер считается по RFC 3550 (от смещения часов не зависит):
+     *   D(i) = (R(i) - R(i-1)) - (S(i) - S(i-1)),  J += (|D(i)| - J) / 16
+     *
+     * Кроме того ведутся гистограммы задержки и |D(i)|.
+     * add() вызывается только из одного потока (приём), остальные функции могут вызываться из других потоков.
+     */
+    class UNetLatency
+    {
+        public:
+            UNetLatency() noexcept;
+
+            static const size_t NumBuckets = 15;
+            static const std::array<int64_t, NumBuckets - 1> bounds; /*!< верхние границы интервалов гистограмм, мкс */
+
+            typedef std::array<std::atomic<uint64_t>, NumBuckets> Histogram;
+
+            /*! часы отправителя и приёмника синхронизированы (задержка = приём - отправка) */
+            void setSyncClock( bool set ) noexcept;
+
+            /*! за сколько периодов (см. period()) ищется минимум для оценки смещения часов */
+            void setOffsetWindow( size_t periods ) noexcept;
+
+            void add( const struct timespec& sendTime, const struct timespec& recvTime ) noexcept;
+
+            /*! завершить очередной период (вызывается периодически, обычно раз в секунду) */
+            void period() noexcept;
+
+            void reset() noexcept;
+
+            /*! количество пакетов с меткой времени */
+            inline uint64_t count() const noexcept
+            {
+                return total.load(std::memory_order_relaxed);
+            }
+
+            /*! средняя задержка за прошлый период, мкс */
+            int64_t getLatency() const noexcept;
+
+            /*! максимальная задержка за прошлый период, мкс */
+            int64_t getLatencyMax() const noexcept;
+
+            /*! текущее значение джиттера, мкс */
+            int64_t getJitter() const noexcept;
+
+            /*! оценка смещения часов отправителя (плюс минимальная задержка), мкс */
+            int64_t getOffset() const noexcept;
+
+            inline const Histogram& latencyHistogram() const noexcept
+            {
+                return latHist;
+            }
+
+            inline const Histogram& jitterHistogram() const noexcept
+            {
+                return jitHist;
+            }
+
+            static size_t bucket( int64_t usec ) noexcept;
+
+            std::string getInfo() const;
+
+#ifndef DISABLE_REST_API
+            Poco::JSON::Object::Ptr httpGet() const;
+#endif
+
+        protected:
+            int64_t offset() const noexcept;
+
+        private:
+            bool syncClock = { false };
+            size_t offsetWindow = { 60 };
+            size_t nperiod = { 0 };
+
+            // используется только в add()
+            bool havePrev = { false };
+            int64_t prevTransit = { 0 };
+            int64_t jitter16 = { 0 }; /*!< джиттер * 16, нс */
+
+            std::atomic<int64_t> curMin; /*!< минимальная разница (приём - отправка) в текущем окне, нс */
+            std::atomic<int64_t> prevMin; /*!< то же для предыдущего окна */
+            std::atomic<int64_t> jitter = { 0 }; /*!< нс */
+            std::atomic<uint64_t> total = { 0 };
+
+            // текущий период
+            std::atomic<int64_t> sum = { 0 };
+            std::atomic<uint64_t> num = { 0 };
+            std::atomic<int64_t> maxv = { 0 };
+
+            // результаты прошлого периода
+            std::atomic<int64_t> lastAvg = { 0 };
+            std::atomic<int64_t> lastMax = { 0 };
+
+            Histogram latHist;
+            Histogram jitHist;
+    };
+    // -------------------------------------------------------------------------
+} // end of uniset namespace
+// -------------------------------------------------------------------------
+#endif // UNetLatency_H_
+// -------------------------------------------------------------------------
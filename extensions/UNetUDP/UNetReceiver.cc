@@ -17,6 +17,9 @@
 #include <sstream>
 #include <cmath>
 #include <iomanip>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
 #include <Poco/Net/NetException.h>
 #include "unisetstd.h"
 #include "Exceptions.h"
@@ -32,6 +35,18 @@ namespace uniset
     // -----------------------------------------------------------------------------
     CommonEventLoop UNetReceiver::loop;
     // -----------------------------------------------------------------------------
+    // привязать текущий поток к процессору
+    static bool setThreadCPU( int cpu ) noexcept
+    {
+        if( cpu < 0 || cpu >= CPU_SETSIZE )
+            return false;
+
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        return ( pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) == 0 );
+    }
+    // -----------------------------------------------------------------------------
     UNetReceiver::UNetReceiver(std::unique_ptr<UNetReceiveTransport>&& _transport
                                , const std::shared_ptr<SMInterface>& smi
                                , bool nocheckConnection
@@ -70,6 +85,7 @@ namespace uniset
     // -----------------------------------------------------------------------------
     UNetReceiver::~UNetReceiver()
     {
+        stopThreads();
     }
     // -----------------------------------------------------------------------------
     void UNetReceiver::setBufferSize( size_t sz ) noexcept
@@ -86,6 +102,27 @@ namespace uniset
         ignoreCRC = set;
     }
     // -----------------------------------------------------------------------------
+    void UNetReceiver::setThreadedMode( bool set, size_t sz ) noexcept
+    {
+        threadedMode = set;
+
+        if( sz > 0 )
+            ringSize = sz;
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::setEventLoop( const std::shared_ptr<CommonEventLoop>& l, int num, int cpu ) noexcept
+    {
+        ownLoop = l;
+        eventLoop = ownLoop ? ownLoop.get() : &loop;
+        loopNum = ownLoop ? num : -1;
+        loopCPU = ownLoop ? cpu : -1;
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::setIncomingCPU( bool set ) noexcept
+    {
+        incomingCPU = set;
+    }
+    // -----------------------------------------------------------------------------
     void UNetReceiver::setMaxReceiveAtTime( size_t sz ) noexcept
     {
         if( sz > 0 )
@@ -161,6 +198,23 @@ namespace uniset
         shm->initIterator(itLostPackets);
     }
     // -----------------------------------------------------------------------------
+    void UNetReceiver::setLatencyID( uniset::ObjectId id ) noexcept
+    {
+        sidLatency = id;
+        shm->initIterator(itLatency);
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::setJitterID( uniset::ObjectId id ) noexcept
+    {
+        sidJitter = id;
+        shm->initIterator(itJitter);
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::setLatencySyncClock( bool set ) noexcept
+    {
+        latency.setSyncClock(set);
+    }
+    // -----------------------------------------------------------------------------
     void UNetReceiver::setLockUpdate( bool st ) noexcept
     {
         lockUpdate = st;
@@ -214,9 +268,12 @@ namespace uniset
             if( evCheckConnection.is_active() )
                 evCheckConnection.stop();
 
+            if( incomingCPU && loopCPU >= 0 && !UNetBatchIO::setIncomingCPU(transport->getNetSocket(), loopCPU) )
+                unetwarn << myname << "(createConnection): set SO_INCOMING_CPU=" << loopCPU << " failed: " << strerror(errno) << endl;
+
             ptRecvTimeout.setTiming(recvTimeout);
             ptPrepare.setTiming(prepareTime);
-            evprepare(loop.evloop());
+            evprepare(eventLoop->evloop());
             return true;
         }
         catch( const std::exception& e )
@@ -247,7 +304,7 @@ namespace uniset
         {
             activated = true;
 
-            if( !loop.async_evrun(this, evrunTimeout) )
+            if( !eventLoop->async_evrun(this, evrunTimeout) )
             {
                 unetcrit << myname << "(start): evrun FAILED! (timeout=" << evrunTimeout << " msec)" << endl;
                 std::terminate();
@@ -260,6 +317,10 @@ namespace uniset
     // -----------------------------------------------------------------------------
     void UNetReceiver::evprepare( const ev::loop_ref& eloop ) noexcept
     {
+        // evprepare вызывается в потоке loop-а
+        if( loopCPU >= 0 && !setThreadCPU(loopCPU) )
+            unetwarn << myname << "(evprepare): can't bind loop thread to cpu " << loopCPU << endl;
+
         evStatistic.set(eloop);
         evStatistic.start(0, 1.0); // раз в сек
         evInitPause.set(eloop);
@@ -276,8 +337,14 @@ namespace uniset
         }
         else
         {
-            evReceive.set(eloop);
-            evReceive.start(transport->getSocket(), ev::READ);
+            if( threadedMode )
+                startThreads();
+            else
+            {
+                evReceive.set(eloop);
+                evReceive.start(transport->getSocket(), ev::READ);
+            }
+
             evInitPause.start(0);
         }
     }
@@ -305,6 +372,7 @@ namespace uniset
         if( evForceUpdate.is_active() )
             evForceUpdate.stop();
 
+        stopThreads();
         transport->disconnect();
     }
     // -----------------------------------------------------------------------------
@@ -327,8 +395,13 @@ namespace uniset
         t_stats = t_end;
         stats.recvPerSec = recvCount / sec;
         stats.upPerSec = upCount / sec;
+        stats.recvPerCall = recvCalls > 0 ? float(recvCount) / recvCalls : 0;
+        stats.ringMax = ringMax.exchange(0);
+        stats.updateLagMax_microsec = lagMax.exchange(0);
+        latency.period();
 
         recvCount = 0;
+        recvCalls = 0;
         upCount = 0;
         tm.again();
     }
@@ -341,6 +414,19 @@ namespace uniset
             return;
         }
 
+        // в режиме setThreadedMode() данные обрабатываются в потоке обновления
+        if( threadedMode )
+        {
+            needForceUpdate = true;
+            wakeupUpdater();
+            return;
+        }
+
+        forceUpdateNow();
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::forceUpdateNow() noexcept
+    {
         // ещё не было пакетов
         if( wnum == 1 && rnum == 0 )
             return;
@@ -421,6 +507,7 @@ namespace uniset
 
                 unetwarn << myname << "(update): lostTimeout(" << ptLostTimeout.getInterval() << ")! pnum=" << p->header.num << " lost " << sub << " packets " << endl;
                 lostPackets += sub;
+                resetDeltaSync();
 
                 // ищем следующий пакет для обработки
                 rnum = rnext(rnum);
@@ -432,11 +519,18 @@ namespace uniset
             upCount++;
 
             // обновление данных в SM (блокировано)
-            if( lockUpdate )
+            // пропущенные изменения можно будет восстановить только по ключевому пакету
+            if( lockUpdate || mode == Mode::mDisabled )
+            {
+                resetDeltaSync();
                 continue;
+            }
 
-            if( mode == Mode::mDisabled )
+            if( p->isDelta() )
+            {
+                applyDelta(p);
                 continue;
+            }
 
             // Обработка дискретных
             auto dcache = getDCache(p);
@@ -527,6 +621,140 @@ namespace uniset
                     }
                 }
             }
+
+            // синхронизируемся по каждому ключевому пакету, а не только после первой дельты,
+            // иначе дельты, пришедшие после ключевых пакетов, будут пропущены (deltaSkipped)
+            // до следующего ключевого. Повторная синхронизация сводится к одному поиску в deltaSync.
+            syncKeyFrame(p);
+        }
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::resetDeltaSync() noexcept
+    {
+        for( auto&& s : deltaSync )
+            s.second = false;
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::syncKeyFrame( UniSetUDP::UDPMessage* p ) noexcept
+    {
+        const long key = p->getDataID();
+        auto& sync = deltaSync[key];
+
+        if( sync )
+            return;
+
+        for( size_t i = 0; i < p->header.acount; i++ )
+        {
+            auto& d = deltaItems[p->a_dat[i].id];
+
+            if( d.packKey != key )
+            {
+                d.packKey = key;
+                shm->initIterator(d.ioit);
+            }
+        }
+
+        for( size_t i = 0; i < p->header.dcount; i++ )
+        {
+            auto& d = deltaItems[p->d_id[i]];
+
+            if( d.packKey != key )
+            {
+                d.packKey = key;
+                shm->initIterator(d.ioit);
+            }
+        }
+
+        sync = true;
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::applyDelta( UniSetUDP::UDPMessage* p ) noexcept
+    {
+        deltaMode = true;
+
+        // изменений нет (пакет нужен только для контроля последовательности)
+        if( p->header.acount == 0 && p->header.dcount == 0 )
+            return;
+
+        // пакет, к которому относится дельта, определяем по первому датчику
+        const long first = ( p->header.acount > 0 ) ? p->a_dat[0].id : p->d_id[0];
+        auto fit = deltaItems.find(first);
+
+        if( fit == deltaItems.end() )
+        {
+            deltaSkipped++;
+            return;
+        }
+
+        const long key = fit->second.packKey;
+        auto sit = deltaSync.find(key);
+
+        if( sit == deltaSync.end() || !sit->second )
+        {
+            deltaSkipped++;
+            return;
+        }
+
+        // данные в SM меняются в обход ключевых пакетов, поэтому сбрасываем crc,
+        // чтобы очередной ключевой пакет был обработан полностью
+        auto dcache = d_icache_map.find(key);
+
+        if( dcache != d_icache_map.end() )
+            dcache->second.crc = 0;
+
+        auto acache = a_icache_map.find(key);
+
+        if( acache != a_icache_map.end() )
+            acache->second.crc = 0;
+
+        long s_id = uniset::DefaultObjectId;
+
+        try
+        {
+            for( size_t i = 0; i < p->header.acount; i++ )
+            {
+                s_id = p->a_dat[i].id;
+                auto it = deltaItems.find(s_id);
+
+                if( it == deltaItems.end() || it->second.packKey != key )
+                {
+                    unetwarn << myname << "(applyDelta): unknown sid=" << s_id << " for dataID=" << key << endl;
+                    sit->second = false;
+                    deltaSkipped++;
+                    return;
+                }
+
+                shm->localSetValue(it->second.ioit, s_id, p->a_dat[i].val, shm->ID());
+            }
+
+            for( size_t i = 0; i < p->header.dcount; i++ )
+            {
+                s_id = p->d_id[i];
+                auto it = deltaItems.find(s_id);
+
+                if( it == deltaItems.end() || it->second.packKey != key )
+                {
+                    unetwarn << myname << "(applyDelta): unknown sid=" << s_id << " for dataID=" << key << endl;
+                    sit->second = false;
+                    deltaSkipped++;
+                    return;
+                }
+
+                shm->localSetValue(it->second.ioit, s_id, p->dValue(i), shm->ID());
+            }
+
+            deltaApplied++;
+        }
+        catch( const uniset::Exception& ex )
+        {
+            // состояние восстановится по ключевому пакету
+            sit->second = false;
+            unetcrit << myname << "(applyDelta): id=" << s_id << " error: " << ex << std::endl;
+        }
+        catch( ... )
+        {
+            sit->second = false;
+            unetcrit << myname << "(applyDelta): id=" << s_id << " error: catch..." << std::endl;
         }
     }
     // -----------------------------------------------------------------------------
@@ -552,12 +780,21 @@ namespace uniset
 
         try
         {
-            for( size_t i = 0; transport->available() > 0 && i < maxReceiveCount; i++ )
-            {
-                if( receive() != retOK )
-                    break;
+            if( rvec.size() != maxReceiveCount )
+                initReceiveBuffers();
 
-                ok = true;
+            // читаем всю пачку за один системный вызов (где поддерживается)
+            ssize_t num = transport->receiveBatch(rvec.data(), rvec.size());
+
+            if( num < 0 )
+                unetcrit << myname << "(receive): recv err(" << errno << "): " << strerror(errno) << endl;
+            else if( num > 0 )
+                recvCalls++;
+
+            for( ssize_t i = 0; i < num; i++ )
+            {
+                if( receive((const uint8_t*)rvec[i].data, rvec[i].len) == retOK )
+                    ok = true;
             }
         }
         catch( uniset::Exception& ex)
@@ -632,19 +869,23 @@ namespace uniset
         bool recvOk = checkConnection();
 
         // обновление данных в SM
-        t_start = chrono::steady_clock::now();
-
-        try
-        {
-            update();
-        }
-        catch( std::exception& ex )
+        // (в режиме setThreadedMode() обновление ведёт отдельный поток)
+        if( !threadedMode )
         {
-            unetcrit << myname << "(updateEvent): " << ex.what() << std::endl;
-        }
+            t_start = chrono::steady_clock::now();
 
-        t_end = chrono::steady_clock::now();
-        stats.upProcessingTime_microsec = std::chrono::duration_cast<std::chrono::microseconds>(t_end - t_start).count();
+            try
+            {
+                update();
+            }
+            catch( std::exception& ex )
+            {
+                unetcrit << myname << "(updateEvent): " << ex.what() << std::endl;
+            }
+
+            t_end = chrono::steady_clock::now();
+            stats.upProcessingTime_microsec = std::chrono::duration_cast<std::chrono::microseconds>(t_end - t_start).count();
+        }
 
         if( sidMode != DefaultObjectId )
         {
@@ -689,6 +930,30 @@ namespace uniset
                 unetcrit << myname << "(updateEvent): (lostPackets) " << ex.what() << std::endl;
             }
         }
+
+        if( sidLatency != DefaultObjectId )
+        {
+            try
+            {
+                shm->localSetValue(itLatency, sidLatency, latency.getLatency(), shm->ID());
+            }
+            catch( const std::exception& ex )
+            {
+                unetcrit << myname << "(updateEvent): (latency) " << ex.what() << std::endl;
+            }
+        }
+
+        if( sidJitter != DefaultObjectId )
+        {
+            try
+            {
+                shm->localSetValue(itJitter, sidJitter, latency.getJitter(), shm->ID());
+            }
+            catch( const std::exception& ex )
+            {
+                unetcrit << myname << "(updateEvent): (jitter) " << ex.what() << std::endl;
+            }
+        }
     }
     // -----------------------------------------------------------------------------
     void UNetReceiver::checkConnectionEvent( ev::periodic& tm, int revents ) noexcept
@@ -714,24 +979,202 @@ namespace uniset
     {
         unetinfo << myname << ": stop.." << endl;
         activated = false;
-        loop.evstop(this);
+        eventLoop->evstop(this);
     }
     // -----------------------------------------------------------------------------
-    UNetReceiver::ReceiveRetCode UNetReceiver::receive() noexcept
+    static inline void atomic_max( std::atomic<size_t>& v, size_t val ) noexcept
     {
+        size_t cur = v.load();
+
+        while( val > cur && !v.compare_exchange_weak(cur, val) ) {}
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::startThreads() noexcept
+    {
+        if( thrActive )
+            return;
+
         try
         {
-            // сперва пробуем сохранить пакет в том месте, где должен быть очередной пакет
-            pack = &(cbuf[wnum % cbufSize]);
-            ssize_t ret = transport->receive(pack, sizeof(UniSetUDP::UDPMessage));
+            if( !ring || ring->capacity() != ringSize )
+                ring = unisetstd::make_unique<UNetRing>(ringSize, sizeof(UniSetUDP::UDPMessage));
+
+            thrActive = true;
+            u_thr = unisetstd::make_unique< ThreadCreator<UNetReceiver> >(this, &UNetReceiver::updateThread);
+            r_thr = unisetstd::make_unique< ThreadCreator<UNetReceiver> >(this, &UNetReceiver::receiveThread);
+            u_thr->start();
+            r_thr->start();
+        }
+        catch( const std::exception& ex )
+        {
+            unetcrit << myname << "(startThreads): " << ex.what() << endl;
+            stopThreads();
+        }
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::stopThreads() noexcept
+    {
+        if( !thrActive )
+            return;
+
+        thrActive = false;
+        wakeupUpdater();
+
+        if( r_thr && r_thr->isRunning() )
+            r_thr->join();
 
-            if( ret < 0 )
+        if( u_thr && u_thr->isRunning() )
+            u_thr->join();
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::wakeupUpdater() noexcept
+    {
+        // захват mutex нужен, чтобы не потерять пробуждение
+        // (между проверкой условия и засыпанием в updateThread)
+        {
+            std::lock_guard<std::mutex> l(upMutex);
+        }
+
+        upEvent.notify_one();
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::receiveThread() noexcept
+    {
+        unetinfo << myname << "(receiveThread): run.." << endl;
+
+        if( loopCPU >= 0 && !setThreadCPU(loopCPU) )
+            unetwarn << myname << "(receiveThread): can't bind thread to cpu " << loopCPU << endl;
+
+        while( thrActive )
+        {
+            try
             {
-                unetcrit << myname << "(receive): recv err(" << errno << "): " << strerror(errno) << endl;
-                return retError;
+                // ждём с таймаутом, чтобы периодически проверять thrActive
+                if( !transport->isReadyForReceive(100) )
+                    continue;
+
+                size_t num = maxReceiveCount;
+                UNetBuffer* bufs = ring->writeSlots(num);
+
+                if( num == 0 )
+                {
+                    // буфер заполнен: поток обновления не успевает,
+                    // дальше пакеты накапливаются в сокете (и могут быть отброшены ядром)
+                    ringFull++;
+                    wakeupUpdater();
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    continue;
+                }
+
+                ssize_t ret = transport->receiveBatch(bufs, num);
+
+                if( ret < 0 )
+                {
+                    unetcrit << myname << "(receiveThread): recv err(" << errno << "): " << strerror(errno) << endl;
+                    continue;
+                }
+
+                if( ret == 0 )
+                    continue;
+
+                recvCalls++;
+                ring->push(ret, chrono::steady_clock::now());
+                atomic_max(ringMax, ring->size());
+                wakeupUpdater();
+            }
+            catch( const std::exception& ex )
+            {
+                unetwarn << myname << "(receiveThread): " << ex.what() << std::endl;
+            }
+        }
+
+        unetinfo << myname << "(receiveThread): finished.." << endl;
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::updateThread() noexcept
+    {
+        unetinfo << myname << "(updateThread): run.." << endl;
+
+        while( thrActive )
+        {
+            {
+                // просыпаемся по приходу данных, но не реже чем раз в updatepause
+                // (для обработки lostTimeout)
+                std::unique_lock<std::mutex> l(upMutex);
+                upEvent.wait_for(l, std::chrono::milliseconds(updatepause), [this]
+                {
+                    return !thrActive || ring->size() > 0 || needForceUpdate;
+                });
+            }
+
+            if( !thrActive )
+                break;
+
+            auto tstart = chrono::steady_clock::now();
+            UNetRing::Time oldest;
+            bool haveData = false;
+            bool ok = false;
+
+            for( auto b = ring->front(); b != nullptr; b = ring->front() )
+            {
+                if( !haveData )
+                {
+                    oldest = ring->frontTime();
+                    haveData = true;
+                }
+
+                if( receive((const uint8_t*)b->data, b->len) == retOK )
+                    ok = true;
+
+                ring->pop();
+            }
+
+            if( ok )
+            {
+                std::lock_guard<std::mutex> l(tmMutex);
+                ptRecvTimeout.reset();
             }
 
-            if( ret == 0 )
+            try
+            {
+                if( needForceUpdate.exchange(false) )
+                    forceUpdateNow();
+                else
+                    update();
+            }
+            catch( std::exception& ex )
+            {
+                unetcrit << myname << "(updateThread): " << ex.what() << std::endl;
+            }
+
+            auto tend = chrono::steady_clock::now();
+            stats.upProcessingTime_microsec = chrono::duration_cast<chrono::microseconds>(tend - tstart).count();
+
+            if( haveData )
+                atomic_max(lagMax, chrono::duration_cast<chrono::microseconds>(tend - oldest).count());
+        }
+
+        unetinfo << myname << "(updateThread): finished.." << endl;
+    }
+    // -----------------------------------------------------------------------------
+    void UNetReceiver::initReceiveBuffers() noexcept
+    {
+        rbuf.resize(maxReceiveCount * sizeof(UniSetUDP::UDPMessage));
+        rvec.resize(maxReceiveCount);
+
+        for( size_t i = 0; i < maxReceiveCount; i++ )
+        {
+            rvec[i].data = rbuf.data() + i * sizeof(UniSetUDP::UDPMessage);
+            rvec[i].size = sizeof(UniSetUDP::UDPMessage);
+            rvec[i].len = 0;
+        }
+    }
+    // -----------------------------------------------------------------------------
+    UNetReceiver::ReceiveRetCode UNetReceiver::receive( const uint8_t* buf, size_t sz ) noexcept
+    {
+        try
+        {
+            if( sz == 0 )
             {
                 unetwarn << myname << "(receive): disconnected?!... recv 0 bytes.." << endl;
                 return retNoData;
@@ -739,11 +1182,48 @@ namespace uniset
 
             recvCount++;
 
-            // конвертируем byte order
-            pack->ntoh();
+            // сжатый пакет распаковываем в свой буфер и дальше разбираем уже его
+            if( UniSetUDP::isCompressed(buf, sz) )
+            {
+                auto t_start = chrono::steady_clock::now();
 
-            if( !pack->isOk() )
+                if( zbuf.size() < sizeof(UniSetUDP::UDPMessage) )
+                    zbuf.resize(sizeof(UniSetUDP::UDPMessage));
+
+                const size_t n = UniSetUDP::decompress(buf, sz, zbuf.data(), zbuf.size());
+                decompressTime_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t_start).count();
+
+                if( n == 0 )
+                {
+                    badPackets++;
+                    return retError;
+                }
+
+                decompressCount++;
+                zBytes += sz;
+                rawBytes += n;
+                buf = zbuf.data();
+                sz = n;
+            }
+
+            // сперва пробуем сохранить пакет в том месте, где должен быть очередной пакет
+            pack = &(cbuf[wnum % cbufSize]);
+
+            // разбираем (полный или компактный формат) и конвертируем byte order
+            if( !pack->deserialize(buf, sz) )
+            {
+                badPackets++;
                 return retError;
+            }
+
+            struct timespec sendTime;
+
+            if( UniSetUDP::getTimestamp(buf, sz, sendTime) )
+            {
+                struct timespec now;
+                clock_gettime(CLOCK_REALTIME, &now);
+                latency.add(sendTime, now);
+            }
 
             if( size_t(abs(long(pack->header.num - wnum))) > maxDifferens || size_t(abs( long(wnum - rnum) )) >= (cbufSize - 2) )
             {
@@ -757,6 +1237,7 @@ namespace uniset
                          << endl;
 
                 lostPackets += pack->header.num > wnum ? (pack->header.num - wnum - 1) : 1;
+                resetDeltaSync();
                 // реинициализируем позицию для чтения
                 rnum = pack->header.num;
                 wnum = pack->header.num + 1;
@@ -821,6 +1302,9 @@ namespace uniset
             for( auto&& it : a_icache.items )
                 shm->initIterator(it.ioit);
         }
+
+        for( auto&& it : deltaItems )
+            shm->initIterator(it.second.ioit);
     }
     // -----------------------------------------------------------------------------
     UNetReceiver::CacheInfo* UNetReceiver::getDCache( UniSetUDP::UDPMessage* upack ) noexcept
@@ -918,8 +1402,37 @@ namespace uniset
           << " receivepack=" << rnum
           << " lostPackets=" << setw(6) << getLostPacketsNum()
           << " cacheMissed=" << setw(6) << cacheMissed
-          << endl
-          << "\t["
+          << " badPackets=" << setw(6) << badPackets
+          << " kernelDrops=" << transport->getKernelDrops()
+          << endl;
+
+        if( threadedMode )
+        {
+            s << "\t[ threads: ring=" << ( ring ? ring->size() : 0 ) << "/" << ringSize
+              << " ringMax=" << stats.ringMax
+              << " ringFull=" << ringFull
+              << " updateLagMax=" << stats.updateLagMax_microsec << " usec"
+              << " ]" << endl;
+        }
+
+        if( loopNum >= 0 )
+            s << "\t[ loop: " << loopNum << " cpu=" << loopCPU << ( incomingCPU ? " incoming_cpu" : "" ) << " ]" << endl;
+
+        if( deltaMode )
+            s << "\t[ delta: applied=" << deltaApplied << " skipped=" << deltaSkipped << " ]" << endl;
+
+        if( latency.count() > 0 )
+            s << "\t[ " << latency.getInfo() << " ]" << endl;
+
+        if( decompressCount > 0 )
+        {
+            s << "\t[ compress: packets=" << decompressCount
+              << " ratio=" << setprecision(3) << ( zBytes > 0 ? double(rawBytes) / zBytes : 0 )
+              << " cpu=" << decompressTime_ns / decompressCount << " ns/pack"
+              << " ]" << endl;
+        }
+
+        s << "\t["
           << " recvTimeout=" << recvTimeout
           << " prepareTime=" << prepareTime
           << " evrunTimeout=" << evrunTimeout
@@ -933,6 +1446,7 @@ namespace uniset
           << " update:" << setprecision(3) << setw(6) << stats.upPerSec << " msg/sec"
           << " upTime:" << setw(6) << stats.upProcessingTime_microsec << " usec"
           << " recvTime:" << setw(6) << stats.recvProcessingTime_microsec << " usec"
+          << " batch:" << setprecision(3) << setw(4) << stats.recvPerCall << " msg/call"
           << " ]";
 
         return s.str();
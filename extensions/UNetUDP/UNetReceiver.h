@@ -22,6 +22,7 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <condition_variable>
 #include <sigc++/sigc++.h>
 #include <ev++.h>
 #include "UniSetObject.h"
@@ -31,7 +32,10 @@
 #include "SharedMemory.h"
 #include "UDPPacket.h"
 #include "CommonEventLoop.h"
+#include "ThreadCreator.h"
 #include "UNetTransport.h"
+#include "UNetRing.h"
+#include "UNetLatency.h"
 // --------------------------------------------------------------------------
 namespace uniset
 {
@@ -77,6 +81,33 @@ namespace uniset
      * crc хранится отдельно для дискретных и отдельно для аналоговых датчиков.
      * Эту оптимизацию можно отключить параметром --prefix-recv-ignore-crc или recvIgnoreCRC="1" в конф. файле.
      *
+     * ДЕЛЬТА-ПАКЕТЫ
+     * ===
+     * Если отправитель посылает дельта-пакеты (только изменившиеся данные, см. UNetSender::setKeyFrameCycles()),
+     * то они применяются только если с момента последнего ключевого пакета (с полным состоянием)
+     * не было потерь (см. update). При обнаружении "дырки" в последовательности, а также пока обновление
+     * заблокировано (setLockUpdate) или отключено (Mode::mDisabled), дельта-пакеты пропускаются до прихода
+     * следующего ключевого пакета. Состояние синхронизации хранится отдельно для каждого пакета отправителя
+     * (ключ UDPMessage::getDataID() ключевого пакета), а пакет для дельты определяется по ID первого датчика в ней.
+     *
+     * ОТДЕЛЬНЫЕ ПОТОКИ ПРИЁМА И ОБНОВЛЕНИЯ
+     * ===
+     * Если сохранение в SM занимает много времени, то пока идёт обновление сокет не вычитывается
+     * и ядро начинает отбрасывать пакеты. Для этого случая есть режим (см. setThreadedMode()), в котором
+     * отдельный поток только вычитывает пакеты из сокета в кольцевой буфер (UNetRing) без их разбора,
+     * а второй поток разбирает их (receive) и сохраняет в SM (update). В event loop при этом остаются только
+     * проверка связи, статистика и обновление служебных датчиков.
+     * Для контроля выводятся: количество отброшенных ядром пакетов (SO_RXQ_OVFL),
+     * максимальная заполненность кольцевого буфера и максимальная задержка от приёма пакета до сохранения в SM.
+     *
+     * НЕСКОЛЬКО EVENT LOOP
+     * ===
+     * По умолчанию все приёмники обрабатываются в одном общем event loop (одном потоке).
+     * Чтобы распределить приём по нескольким ядрам, приёмнику можно задать отдельный loop (см. setEventLoop()),
+     * поток которого при необходимости привязывается к заданному процессору. Дополнительно сокету
+     * можно выставить SO_INCOMING_CPU (см. setIncomingCPU()), тогда обработка пакета в ядре и в программе
+     * идёт на одном процессоре.
+     *
      * Обработка сбоев в номере пакетов
      * =========================================================================
      * Если в какой-то момент расстояние между rnum и wnum превышает maxDifferens пакетов
@@ -139,8 +170,35 @@ namespace uniset
             void setMaxReceiveAtTime( size_t sz ) noexcept;
             void setIgnoreCRC( bool set ) noexcept;
 
+            /*! режим с отдельными потоками приёма и обновления данных в SM
+             * \param ringSize - размер кольцевого буфера между потоками (количество сообщений)
+             * \warning задаётся до запуска (start())
+             */
+            void setThreadedMode( bool set, size_t ringSize = 100 ) noexcept;
+
+            /*! обрабатывать приёмник в отдельном event loop (по умолчанию - общий для всех)
+             * \param num - номер loop-а (для вывода информации)
+             * \param cpu - процессор, к которому привязывается поток loop-а (-1 - не привязывать)
+             * \warning задаётся до запуска (start())
+             */
+            void setEventLoop( const std::shared_ptr<CommonEventLoop>& l, int num, int cpu = -1 ) noexcept;
+
+            /*! выставлять сокету SO_INCOMING_CPU равным процессору loop-а (см. setEventLoop()) */
+            void setIncomingCPU( bool set ) noexcept;
+
             void setRespondID( uniset::ObjectId id, bool invert = false ) noexcept;
             void setLostPacketsID( uniset::ObjectId id ) noexcept;
+            void setLatencyID( uniset::ObjectId id ) noexcept; /*!< средняя задержка (мкс), см. UNetLatency::getLatency() */
+            void setJitterID( uniset::ObjectId id ) noexcept;  /*!< джиттер (мкс), см. UNetLatency::getJitter() */
+
+            /*! часы отправителя и приёмника синхронизированы (см. UNetLatency::setSyncClock()) */
+            void setLatencySyncClock( bool set ) noexcept;
+
+            /*! статистика задержки (если отправитель добавляет метки времени) */
+            inline const UNetLatency& getLatency() const noexcept
+            {
+                return latency;
+            }
             void setModeID( uniset::ObjectId id ) noexcept;
 
             void forceUpdate() noexcept; // пересохранить очередной пакет в SM даже если данные не менялись
@@ -186,8 +244,10 @@ namespace uniset
                 retNoData = 2
             };
 
-            ReceiveRetCode receive() noexcept;
+            // разобрать очередное принятое сообщение
+            ReceiveRetCode receive( const uint8_t* buf, size_t sz ) noexcept;
             void update() noexcept;
+            void forceUpdateNow() noexcept;
             void callback( ev::io& watcher, int revents ) noexcept;
             void readEvent( ev::io& watcher ) noexcept;
             void updateEvent( ev::periodic& watcher, int revents ) noexcept;
@@ -204,6 +264,13 @@ namespace uniset
 
             void initIterators() noexcept;
             bool createConnection( bool throwEx = false );
+
+            // потоки для режима setThreadedMode()
+            void receiveThread() noexcept;
+            void updateThread() noexcept;
+            void startThreads() noexcept;
+            void stopThreads() noexcept;
+            void wakeupUpdater() noexcept;
             bool checkConnection();
             size_t rnext( size_t num );
 
@@ -223,8 +290,9 @@ namespace uniset
             ev::async evForceUpdate;
 
             // счётчики для подсчёта статистики
-            size_t recvCount = { 0 };
-            size_t upCount = { 0 };
+            std::atomic<size_t> recvCount = { 0 };
+            std::atomic<size_t> recvCalls = { 0 }; /*!< количество вызовов receiveBatch (с данными) */
+            std::atomic<size_t> upCount = { 0 };
             std::chrono::steady_clock::time_point t_start;
             std::chrono::steady_clock::time_point t_end;
             std::chrono::steady_clock::time_point t_stats;
@@ -236,12 +304,20 @@ namespace uniset
                 float upPerSec = {0};    /*!< количество обработанных пакетов в секунду */
                 size_t upProcessingTime_microsec = {0}; /*!< время обработки данных */
                 size_t recvProcessingTime_microsec = {0}; /*!< время обработки получения данных */
+                float recvPerCall = {0}; /*!< среднее количество пакетов за один вызов receiveBatch */
+                size_t ringMax = {0}; /*!< максимальная заполненность кольцевого буфера (setThreadedMode) */
+                size_t updateLagMax_microsec = {0}; /*!< максимальная задержка от приёма до сохранения в SM (setThreadedMode) */
             };
 
             Stats stats;
 
             // делаем loop общим.. одним на всех!
             static CommonEventLoop loop;
+            CommonEventLoop* eventLoop = { &loop }; /*!< loop в котором работает приёмник */
+            std::shared_ptr<CommonEventLoop> ownLoop; /*!< отдельный loop (см. setEventLoop()) */
+            int loopNum = { -1 };
+            int loopCPU = { -1 };
+            bool incomingCPU = { false };
 
             double checkConnectionTime = { 10.0 }; // sec
             std::mutex checkConnMutex;
@@ -252,7 +328,7 @@ namespace uniset
             timeout_t prepareTime = { 2000 };
             timeout_t evrunTimeout = { 15000 };
             timeout_t lostTimeout = { 200 };
-            size_t maxReceiveCount = { 5 }; // количество читаемых за один раз
+            size_t maxReceiveCount = { 5 }; // количество читаемых за один раз (размер пачки для receiveBatch)
 
             double initPause = { 5.0 }; // пауза на начальную инициализацию (сек)
             std::atomic_bool initOK = { false };
@@ -265,6 +341,10 @@ namespace uniset
             bool respondInvert = { false };
             uniset::ObjectId sidLostPackets = { uniset::DefaultObjectId };
             IOController::IOStateList::iterator itLostPackets;
+            uniset::ObjectId sidLatency = { uniset::DefaultObjectId };
+            IOController::IOStateList::iterator itLatency;
+            uniset::ObjectId sidJitter = { uniset::DefaultObjectId };
+            IOController::IOStateList::iterator itJitter;
 
             // режим работы
             uniset::ObjectId sidMode = { uniset::DefaultObjectId };
@@ -278,6 +358,34 @@ namespace uniset
             size_t wnum = { 1 }; /*!< номер следующего ожидаемого пакета */
             size_t rnum = { 0 }; /*!< номер последнего обработанного пакета */
             UniSetUDP::UDPMessage* pack; // текущий обрабатываемый пакет
+            // буферы для пакетного приёма (maxReceiveCount сообщений в полном или компактном формате)
+            std::vector<uint8_t> rbuf;
+            std::vector<UNetBuffer> rvec;
+            void initReceiveBuffers() noexcept;
+            size_t badPackets = { 0 }; /*!< количество пакетов, которые не удалось разобрать */
+
+            // приём сжатых пакетов (см. UniSetUDP::decompress())
+            std::vector<uint8_t> zbuf; /*!< буфер для распаковки */
+            size_t decompressCount = { 0 }; /*!< количество принятых сжатых пакетов */
+            size_t zBytes = { 0 }; /*!< размер сжатых пакетов */
+            size_t rawBytes = { 0 }; /*!< размер пакетов после распаковки */
+            size_t decompressTime_ns = { 0 }; /*!< суммарное время распаковки */
+
+            UNetLatency latency; /*!< задержка по меткам времени отправителя */
+
+            // режим с отдельными потоками приёма и обновления (см. setThreadedMode())
+            bool threadedMode = { false };
+            size_t ringSize = { 100 };
+            std::unique_ptr<UNetRing> ring;
+            std::unique_ptr< ThreadCreator<UNetReceiver> > r_thr; // поток приёма
+            std::unique_ptr< ThreadCreator<UNetReceiver> > u_thr; // поток обновления
+            std::atomic_bool thrActive = { false };
+            std::mutex upMutex;
+            std::condition_variable upEvent;
+            std::atomic_bool needForceUpdate = { false };
+            std::atomic<size_t> ringFull = { 0 }; /*!< сколько раз приём ждал освобождения буфера */
+            std::atomic<size_t> ringMax = { 0 };
+            std::atomic<size_t> lagMax = { 0 }; // мксек
 
             /*! максимальная разница между номерами пакетов, при которой считается, что счётчик пакетов
              * прошёл через максимум или сбился...
@@ -319,6 +427,23 @@ namespace uniset
 
             CacheInfo* getDCache( UniSetUDP::UDPMessage* upack ) noexcept;
             CacheInfo* getACache( UniSetUDP::UDPMessage* pack ) noexcept;
+
+            // дельта-пакеты
+            struct DeltaItem
+            {
+                long packKey = { uniset::DefaultObjectId }; /*!< UDPMessage::getDataID() ключевого пакета */
+                IOController::IOStateList::iterator ioit;
+            };
+
+            std::unordered_map<long, DeltaItem> deltaItems; /*!< ключом является ID датчика */
+            std::unordered_map<long, bool> deltaSync; /*!< ключом является UDPMessage::getDataID() ключевого пакета */
+            bool deltaMode = { false }; /*!< отправитель посылает дельта-пакеты */
+            size_t deltaApplied = { 0 };
+            size_t deltaSkipped = { 0 };
+
+            void applyDelta( UniSetUDP::UDPMessage* p ) noexcept;
+            void syncKeyFrame( UniSetUDP::UDPMessage* p ) noexcept;
+            void resetDeltaSync() noexcept;
     };
     // --------------------------------------------------------------------------
 } // end of namespace uniset
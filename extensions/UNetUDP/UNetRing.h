@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2021 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -------------------------------------------------------------------------
+#ifndef UNetRing_H_
+#define UNetRing_H_
+// -------------------------------------------------------------------------
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "UNetTransport.h"
+// -------------------------------------------------------------------------
+namespace uniset
+{
+    /*! Кольцевой буфер принятых сообщений для одного писателя и одного читателя (SPSC), без блокировок.
+     * Память под все слоты выделяется сразу.
+     * Писатель (поток приёма) берёт непрерывный участок свободных слотов (writeSlots()),
+     * принимает в них сообщения (UNetReceiveTransport::receiveBatch()) и публикует их (push()).
+     * Читатель (поток обновления) забирает сообщения по одному (front(), pop()).
+     */
+    class UNetRing
+    {
+        public:
+            typedef std::chrono::steady_clock::time_point Time;
+
+            UNetRing( size_t num, size_t slotSize ):
+                mem(num * slotSize),
+                slots(num),
+                stamps(num)
+            {
+                for( size_t i = 0; i < num; i++ )
+                {
+                    slots[i].data = mem.data() + i * slotSize;
+                    slots[i].size = slotSize;
+                }
+            }
+
+            // --- писатель ---
+
+            /*! свободные слоты подряд (без перехода через конец буфера)
+             * \param num - [in] сколько нужно, [out] сколько доступно (0 - буфер заполнен)
+             */
+            inline UNetBuffer* writeSlots( size_t& num ) noexcept
+            {
+                const size_t h = head.load(std::memory_order_relaxed);
+                const size_t t = tail.load(std::memory_order_acquire);
+                const size_t idx = h % slots.size();
+
+                num = std::min( { num, slots.size() - (h - t), slots.size() - idx } );
+                return &slots[idx];
+            }
+
+            /*! опубликовать n заполненных слотов (из полученных writeSlots()) */
+            inline void push( size_t n, const Time& t ) noexcept
+            {
+                const size_t h = head.load(std::memory_order_relaxed);
+
+                for( size_t i = 0; i < n; i++ )
+                    stamps[(h + i) % slots.size()] = t;
+
+                head.store(h + n, std::memory_order_release);
+            }
+
+            // --- читатель ---
+
+            /*! \return nullptr если буфер пуст */
+            inline const UNetBuffer* front() const noexcept
+            {
+                const size_t t = tail.load(std::memory_order_relaxed);
+
+                if( t == head.load(std::memory_order_acquire) )
+                    return nullptr;
+
+                return &slots[t % slots.size()];
+            }
+
+            /*! время публикации сообщения (см. push()) */
+            inline Time frontTime() const noexcept
+            {
+                return stamps[tail.load(std::memory_order_relaxed) % slots.size()];
+            }
+
+            inline void pop() noexcept
+            {
+                tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            // ---
+
+            inline size_t size() const noexcept
+            {
+                // сперва tail, т.к. head >= tail в любой момент
+                const size_t t = tail.load(std::memory_order_acquire);
+                return head.load(std::memory_order_acquire) - t;
+            }
+
+            inline size_t capacity() const noexcept
+            {
+                return slots.size();
+            }
+
+        private:
+            std::vector<uint8_t> mem;
+            std::vector<UNetBuffer> slots;
+            std::vector<Time> stamps;
+
+            // счётчики только растут, индекс слота - остаток от деления на capacity()
+            alignas(64) std::atomic<size_t> head = { 0 }; /*!< меняет только писатель */
+            alignas(64) std::atomic<size_t> tail = { 0 }; /*!< меняет только читатель */
+    };
+} // end of uniset namespace
+// -------------------------------------------------------------------------
+#endif // UNetRing_H_
+// -------------------------------------------------------------------------
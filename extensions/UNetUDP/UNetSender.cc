@@ -16,6 +16,9 @@
 // -------------------------------------------------------------------------
 #include <sstream>
 #include <iomanip>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
 #include <Poco/Net/NetException.h>
 #include "unisetstd.h"
 #include "Exceptions.h"
@@ -48,6 +51,7 @@ namespace uniset
         maxDData(maxDCount)
     {
         items.reserve(100);
+        setSendBatch(sendBatchSize);
 
         {
             ostringstream s;
@@ -169,7 +173,8 @@ namespace uniset
     // -----------------------------------------------------------------------------
     void UNetSender::updateSensor( uniset::ObjectId id, long value )
     {
-        if( !shm->isLocalwork() )
+        // в режиме посылки по изменению датчики заказаны и при работе в одном процессе с SM
+        if( !shm->isLocalwork() && !eventMode )
             return;
 
         if( id == sidMode )
@@ -186,12 +191,40 @@ namespace uniset
         auto& pk = mypacks[it.pack_sendfactor];
 
         auto& mypack(pk[it.pack_num]);
-        uniset::uniset_rwmutex_wrlock l(mypack.mut);
+        bool changed = false;
 
-        if( it.iotype == UniversalIO::DI || it.iotype == UniversalIO::DO )
-            mypack.msg.setDData(it.pack_ind, value);
-        else if( it.iotype == UniversalIO::AI || it.iotype == UniversalIO::AO )
-            mypack.msg.setAData(it.pack_ind, value);
+        {
+            uniset::uniset_rwmutex_wrlock l(mypack.mut);
+
+            if( it.iotype == UniversalIO::DI || it.iotype == UniversalIO::DO )
+            {
+                changed = ( mypack.msg.dValue(it.pack_ind) != (bool)value );
+                mypack.msg.setDData(it.pack_ind, value);
+            }
+            else if( it.iotype == UniversalIO::AI || it.iotype == UniversalIO::AO )
+            {
+                changed = ( mypack.msg.a_dat[it.pack_ind].val != value );
+                mypack.msg.setAData(it.pack_ind, value);
+            }
+
+            if( !eventMode || !changed || mypack.dirty )
+                return;
+
+            mypack.dirty = true;
+        }
+
+        dirtyEvent = true;
+        wakeup();
+    }
+    // -----------------------------------------------------------------------------
+    void UNetSender::wakeup() noexcept
+    {
+        // захват mutex нужен, чтобы не потерять пробуждение (см. eventSend)
+        {
+            std::lock_guard<std::mutex> l(evMutex);
+        }
+
+        evCond.notify_one();
     }
     // -----------------------------------------------------------------------------
     void UNetSender::setModeID( uniset::ObjectId id ) noexcept
@@ -205,6 +238,53 @@ namespace uniset
             ptCheckConnection.setTiming(msec);
     }
     // -----------------------------------------------------------------------------
+    void UNetSender::setCompactFormat( bool set ) noexcept
+    {
+        compactFormat = set;
+    }
+    // -----------------------------------------------------------------------------
+    bool UNetSender::setCompress( bool set, int accel ) noexcept
+    {
+        if( set && !UniSetUDP::isCompressSupported() )
+        {
+            compress = false;
+            return false;
+        }
+
+        compress = set;
+        compressAccel = std::max(accel, 1);
+        return true;
+    }
+    // -----------------------------------------------------------------------------
+    void UNetSender::setSendTimestamp( bool set ) noexcept
+    {
+        sendTimestamp = set;
+    }
+    // -----------------------------------------------------------------------------
+    void UNetSender::setKeyFrameCycles( size_t n ) noexcept
+    {
+        keyFrameCycles = n;
+    }
+    // -----------------------------------------------------------------------------
+    void UNetSender::setEventMode( bool set, timeout_t gap ) noexcept
+    {
+        eventMode = set;
+        minGap = gap;
+        ptMinGap.setTiming(gap);
+    }
+    // -----------------------------------------------------------------------------
+    void UNetSender::setSendBatch( size_t n ) noexcept
+    {
+        // вызывается только до запуска потока посылки
+        if( n == 0 )
+            n = 1;
+
+        sendBatchSize = n;
+        sbufs.resize(n);
+        svec.resize(n);
+        scount = 0;
+    }
+    // -----------------------------------------------------------------------------
     void UNetSender::send() noexcept
     {
         unetinfo << myname << "(send): dlist size = " << items.size() << endl;
@@ -280,16 +360,20 @@ namespace uniset
                         {
                             if( packsendpauseFactor <= 0 )
                             {
+                                flushSend();
                                 msleep(packsendpause);
                             }
                             else if( i > 0 && (i % packsendpauseFactor) == 0 )
                             {
+                                flushSend();
                                 msleep(packsendpause);
                             }
                         }
                     }
                 }
 
+                flushSend();
+                ptMinGap.reset();
                 ncycle++;
             }
             catch( Poco::Net::NetException& e )
@@ -312,12 +396,81 @@ namespace uniset
             if( !activated )
                 break;
 
-            msleep(sendpause);
+            if( eventMode )
+                eventSend();
+            else
+                msleep(sendpause);
         }
 
         unetinfo << "************* execute FINISH **********" << endl;
     }
     // -----------------------------------------------------------------------------
+    void UNetSender::eventSend() noexcept
+    {
+        // до очередной полной посылки посылаем только изменившиеся пакеты
+        PassiveTimer ptHeartBeat(sendpause);
+
+        while( activated && mode != Mode::mDisabled )
+        {
+            timeout_t left = ptHeartBeat.getLeft(sendpause);
+
+            if( left == 0 )
+                break;
+
+            {
+                std::unique_lock<std::mutex> l(evMutex);
+                evCond.wait_for(l, std::chrono::milliseconds(left), [this]
+                {
+                    return dirtyEvent || !activated;
+                });
+            }
+
+            if( !activated )
+                break;
+
+            if( dirtyEvent.exchange(false) )
+                sendDirty();
+        }
+    }
+    // -----------------------------------------------------------------------------
+    void UNetSender::sendDirty() noexcept
+    {
+        for( auto&& it : mypacks )
+        {
+            for( auto&& pk : it.second )
+            {
+                if( !activated )
+                    return;
+
+                {
+                    uniset::uniset_rwmutex_rlock l(pk.mut);
+
+                    if( !pk.dirty )
+                        continue;
+                }
+
+                if( minGap > 0 )
+                {
+                    timeout_t left = ptMinGap.getLeft(minGap);
+
+                    if( left > 0 )
+                        msleep(left);
+                }
+
+                real_send(pk);
+                eventPacks++;
+
+                if( minGap > 0 )
+                {
+                    flushSend();
+                    ptMinGap.reset();
+                }
+            }
+        }
+
+        flushSend();
+    }
+    // -----------------------------------------------------------------------------
     void UNetSender::real_send( PackMessage& mypack ) noexcept
     {
         try
@@ -331,29 +484,185 @@ namespace uniset
 
             uniset::uniset_rwmutex_rlock l(mypack.mut);
             mypack.msg.header.num = packetnum;
-            mypack.msg.updatePacketCrc();
+            mypack.dirty = false;
+
+            // данные пакета копируются в буфер пачки,
+            // т.к. сам пакет может обновляться (updateItem) до фактической посылки
+            auto& buf = sbufs[scount];
+            size_t sz = 0;
 
+            if( keyFrameCycles > 0 && (mypack.sendCount++ % keyFrameCycles) != 0 )
+            {
+                sz = makeDelta(mypack, buf);
+                deltaCount++;
+            }
+            else
+            {
+                mypack.msg.updatePacketCrc();
+
+                if( compactFormat )
+                {
+                    buf.resize(mypack.msg.compactSize());
+                    sz = mypack.msg.serialize(buf.data(), buf.size());
+                }
+                else
+                {
+                    sz = sizeof(mypack.msg);
+                    buf.resize(sz);
+                    memcpy(buf.data(), &mypack.msg, sz);
+                }
+
+                if( keyFrameCycles > 0 )
+                {
+                    saveKeyFrame(mypack);
+                    keyFrameCount++;
+                }
+            }
+
+            if( sendTimestamp && compactFormat && sz > 0 )
+            {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                buf.resize(sz + sizeof(UniSetUDP::UDPTimestamp));
+                sz = UniSetUDP::addTimestamp(buf.data(), sz, buf.size(), ts);
+            }
+
+            if( compress && compactFormat )
+                compressPacket(buf, sz);
+
+            svec[scount].data = buf.data();
+            svec[scount].len = sz;
+            scount++;
+        }
+        catch( Poco::Net::NetException& ex )
+        {
+            unetcrit << myname << "(real_send): error: " << ex.displayText() << endl;
+        }
+        catch( std::exception& ex )
+        {
+            unetcrit << myname << "(real_send): error: " << ex.what() << endl;
+        }
+
+        if( scount >= sendBatchSize )
+            flushSend();
+    }
+    // -----------------------------------------------------------------------------
+    void UNetSender::flushSend() noexcept
+    {
+        if( scount == 0 )
+            return;
+
+        const size_t num = scount;
+        scount = 0;
+
+        try
+        {
             if( !transport->isReadyForSend(writeTimeout) )
                 return;
 
-            size_t ret = transport->send(&mypack.msg, sizeof(mypack.msg));
+            ssize_t ret = transport->sendBatch(svec.data(), num);
+            sendCalls++;
+
+            if( ret < 0 )
+            {
+                unetcrit << myname << "(flushSend): send err(" << errno << "): " << strerror(errno) << endl;
+                return;
+            }
+
+            sendPacks += ret;
 
-            if( ret < sizeof(mypack.msg) )
-                unetcrit << myname << "(real_send): FAILED ret=" << ret << " < sizeof=" << sizeof(mypack.msg) << endl;
+            if( (size_t)ret < num )
+                unetcrit << myname << "(flushSend): FAILED sent " << ret << " of " << num << " packets" << endl;
         }
         catch( Poco::Net::NetException& ex )
         {
-            unetcrit << myname << "(real_send): sz=" << sizeof(mypack.msg) << " error: " << ex.displayText() << endl;
+            unetcrit << myname << "(flushSend): error: " << ex.displayText() << endl;
         }
         catch( std::exception& ex )
         {
-            unetcrit << myname << "(real_send): sz=" << sizeof(mypack.msg) << " error: " << ex.what() << endl;
+            unetcrit << myname << "(flushSend): error: " << ex.what() << endl;
+        }
+    }
+    // -----------------------------------------------------------------------------
+    void UNetSender::compressPacket( std::vector<uint8_t>& buf, size_t& sz ) noexcept
+    {
+        auto t_start = chrono::steady_clock::now();
+
+        zbuf.resize(UniSetUDP::compressBound(sz));
+        size_t n = UniSetUDP::compress(buf.data(), sz, zbuf.data(), zbuf.size(), compressAccel);
+
+        compressTime_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t_start).count();
+
+        if( n == 0 )
+        {
+            compressSkipped++;
+            return;
+        }
+
+        compressCount++;
+        rawBytes += sz;
+        zBytes += n;
+
+        // буфер пачки и буфер сжатия просто меняются местами
+        buf.swap(zbuf);
+        sz = n;
+    }
+    // -----------------------------------------------------------------------------
+    void UNetSender::saveKeyFrame( PackMessage& mypack ) noexcept
+    {
+        const auto& m = mypack.msg;
+        mypack.alast.resize(m.header.acount);
+        mypack.dlast.resize(m.header.dcount);
+
+        for( size_t i = 0; i < m.header.acount; i++ )
+            mypack.alast[i] = m.a_dat[i].val;
+
+        for( size_t i = 0; i < m.header.dcount; i++ )
+            mypack.dlast[i] = m.dValue(i);
+    }
+    // -----------------------------------------------------------------------------
+    size_t UNetSender::makeDelta( PackMessage& mypack, std::vector<uint8_t>& buf ) noexcept
+    {
+        const auto& m = mypack.msg;
+
+        // пакет посылается даже если изменений нет,
+        // чтобы приёмник мог проверять непрерывность последовательности
+        dmsg.header = m.header;
+        dmsg.header.acount = 0;
+        dmsg.header.dcount = 0;
+        dmsg.header.acrc = 0;
+        dmsg.header.dcrc = 0;
+
+        // количество данных в пакете не меняется после инициализации,
+        // а первым всегда посылается ключевой пакет (см. saveKeyFrame)
+        for( size_t i = 0; i < m.header.acount && i < mypack.alast.size(); i++ )
+        {
+            if( m.a_dat[i].val != mypack.alast[i] )
+            {
+                dmsg.addAData(m.a_dat[i]);
+                mypack.alast[i] = m.a_dat[i].val;
+            }
+        }
+
+        for( size_t i = 0; i < m.header.dcount && i < mypack.dlast.size(); i++ )
+        {
+            bool val = m.dValue(i);
+
+            if( val != (bool)mypack.dlast[i] )
+            {
+                dmsg.addDData(m.d_id[i], val);
+                mypack.dlast[i] = val;
+            }
         }
+
+        buf.resize(dmsg.compactSize());
+        return dmsg.serialize(buf.data(), buf.size(), true);
     }
     // -----------------------------------------------------------------------------
     void UNetSender::stop()
     {
         activated = false;
+        wakeup();
 
         //    s_thr->stop();
         if( s_thr )
@@ -584,8 +893,40 @@ namespace uniset
           << " items=" << items.size() << " maxAData=" << getADataSize() << " maxDData=" << getDDataSize()
           << " packsendpause[factor=" << packsendpauseFactor << "]=" << packsendpause
           << " sendpause=" << sendpause
-          << endl
-          << "\t   packs([sendfactor]=num): "
+          << " format=" << ( compactFormat ? "compact" : "full" )
+          << " timestamp=" << sendTimestamp
+          << " sendBatch=" << sendBatchSize
+          << " batch=" << ( sendCalls > 0 ? double(sendPacks) / sendCalls : 0 ) << " msg/call"
+          << endl;
+
+        if( keyFrameCycles > 0 )
+        {
+            s << "\t   delta: keyFrameCycles=" << keyFrameCycles
+              << " keyFrames=" << keyFrameCount
+              << " deltas=" << deltaCount
+              << endl;
+        }
+
+        if( compress )
+        {
+            const size_t total = compressCount + compressSkipped;
+
+            s << "\t   compress: lz4(accel=" << compressAccel << ")"
+              << " compressed=" << compressCount
+              << " skipped=" << compressSkipped
+              << " ratio=" << setprecision(3) << ( zBytes > 0 ? double(rawBytes) / zBytes : 0 )
+              << " cpu=" << ( total > 0 ? compressTime_ns / total : 0 ) << " ns/pack"
+              << endl;
+        }
+
+        if( eventMode )
+        {
+            s << "\t   event: minGap=" << minGap
+              << " eventPacks=" << eventPacks
+              << endl;
+        }
+
+        s << "\t   packs([sendfactor]=num): "
           << endl;
 
         for( const auto& p : mypacks )
@@ -596,7 +937,7 @@ namespace uniset
             for( const auto& pack : p.second )
             {
                 //uniset_rwmutex_rlock l(p->mut);
-                s << "        \t\t[" << (n++) << "]=" << sizeof(pack.msg) << " bytes"
+                s << "        \t\t[" << (n++) << "]=" << ( compactFormat ? pack.msg.compactSize() : sizeof(pack.msg) ) << " bytes"
                   << " (dataID=" << setw(5) << pack.msg.getDataID()
                   << " numA=" << setw(5) << pack.msg.asize()
                   << " numD=" << setw(5) << pack.msg.dsize()
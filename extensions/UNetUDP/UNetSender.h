@@ -22,6 +22,8 @@
 #include <vector>
 #include <limits>
 #include <unordered_map>
+#include <mutex>
+#include <condition_variable>
 #include "UniSetObject.h"
 #include "Trigger.h"
 #include "Mutex.h"
@@ -59,6 +61,14 @@ namespace uniset
      * тогда при создании объекта UNetSender, в конструкторе будет
      * выкинуто исключение при неудачной попытке создания соединения.
      * \warning setCheckConnectionPause(msec) должно быть кратно sendpause!
+     *
+     * Посылка по изменению (setEventMode)
+     * ======================================
+     * По умолчанию все пакеты посылаются раз в sendpause, т.е. изменение датчика уходит в сеть
+     * с задержкой до sendpause (+ паузы между пакетами). В режиме посылки по изменению
+     * датчики заказываются (см. UNetExchange::askSensors), пакет в котором изменилось значение помечается
+     * как изменённый и посылается сразу (но не чаще чем раз в minGap между пакетами).
+     * Полная посылка всех пакетов раз в sendpause при этом сохраняется (heartbeat).
      */
     class UNetSender final
     {
@@ -121,9 +131,25 @@ namespace uniset
 
                 uniset::UniSetUDP::UDPMessage msg;
                 uniset::uniset_rwmutex mut;
+
+                // для дельта-пакетов (см. setKeyFrameCycles())
+                size_t sendCount = { 0 };
+                std::vector<int64_t> alast; /*!< последние посланные значения аналоговых */
+                std::vector<uint8_t> dlast; /*!< последние посланные значения булевых */
+
+                bool dirty = { false }; /*!< данные изменились с последней посылки (см. setEventMode()) */
             };
 
+            /*! подготовить пакет к посылке (добавить в пачку для sendBatch).
+             * Пачка посылается при заполнении, перед паузой между пакетами и в конце цикла посылки (см. flushSend())
+             */
             void real_send( PackMessage& mypack ) noexcept;
+            void flushSend() noexcept;
+
+            // ожидание и посылка изменившихся пакетов до очередной полной посылки (см. setEventMode())
+            void eventSend() noexcept;
+            void sendDirty() noexcept;
+            void wakeup() noexcept;
 
             /*! (принудительно) обновить все данные (из SM) */
             void updateFromSM();
@@ -151,6 +177,45 @@ namespace uniset
 
             void setCheckConnectionPause( int msec ) noexcept;
 
+            /*! посылать сообщения в компактном формате (см. UniSetUDP::UDPMessage::serialize())
+             * false - полный формат (для совместимости со старыми версиями)
+             */
+            void setCompactFormat( bool set ) noexcept;
+
+            /*! сжимать пакеты (LZ4, см. UniSetUDP::compress()). Пакет посылается сжатым,
+             * только если это уменьшает его размер. Работает только с компактным форматом.
+             * \param accel - ускорение LZ4 (1 - лучшее сжатие, больше - быстрее)
+             * \return false - если сжатие не поддерживается (собрано без lz4)
+             */
+            bool setCompress( bool set, int accel = 1 ) noexcept;
+
+            /*! добавлять в пакеты метку времени отправки (см. UniSetUDP::addTimestamp()),
+             * по которой приёмник считает задержку и джиттер (см. UNetLatency).
+             * Работает только с компактным форматом.
+             */
+            void setSendTimestamp( bool set ) noexcept;
+
+            /*! режим дельта-пакетов: каждый N-ый пакет посылается с полным состоянием ("ключевой"),
+             * а между ними только изменившиеся данные.
+             * 0 - отключено (всегда посылается полное состояние)
+             */
+            void setKeyFrameCycles( size_t n ) noexcept;
+
+            /*! максимальное количество пакетов посылаемых за один системный вызов (sendBatch) */
+            void setSendBatch( size_t n ) noexcept;
+
+            /*! посылка по изменению: изменившиеся пакеты посылаются сразу,
+             * но с интервалом между пакетами не меньше minGap (мсек).
+             * Полная посылка раз в sendpause сохраняется.
+             * \warning датчики должны быть заказаны (askSensors), данные обновляются через updateSensor()
+             */
+            void setEventMode( bool set, timeout_t minGap = 0 ) noexcept;
+
+            inline bool isEventMode() const noexcept
+            {
+                return eventMode;
+            }
+
             /*! заказать датчики */
             void askSensors( UniversalIO::UIOCommand cmd );
 
@@ -189,6 +254,11 @@ namespace uniset
 
             bool createConnection( bool throwEx );
 
+            // сформировать в buf дельта-пакет
+            size_t makeDelta( PackMessage& mypack, std::vector<uint8_t>& buf ) noexcept;
+            // запомнить посланное полное состояние
+            void saveKeyFrame( PackMessage& mypack ) noexcept;
+
         private:
             UNetSender();
 
@@ -218,6 +288,44 @@ namespace uniset
             UItemMap items;
             size_t packetnum = { 1 }; /*!< номер очередного посылаемого пакета */
 
+            bool compactFormat = { false };
+
+            // пачка сообщений для sendBatch
+            size_t sendBatchSize = { 16 };
+            std::vector< std::vector<uint8_t> > sbufs; /*!< буферы для упаковки сообщений */
+            std::vector<UNetBuffer> svec;
+            size_t scount = { 0 }; /*!< количество накопленных в пачке сообщений */
+            size_t sendCalls = { 0 }; /*!< количество вызовов sendBatch */
+            size_t sendPacks = { 0 }; /*!< количество посланных пакетов */
+
+            // посылка по изменению (см. setEventMode())
+            bool eventMode = { false };
+            timeout_t minGap = { 0 };
+            PassiveTimer ptMinGap;
+            std::atomic_bool dirtyEvent = { false };
+            std::mutex evMutex;
+            std::condition_variable evCond;
+            size_t eventPacks = { 0 }; /*!< количество пакетов посланных по изменению */
+
+            size_t keyFrameCycles = { 0 };
+            UniSetUDP::UDPMessage dmsg; /*!< дельта-пакет */
+            size_t keyFrameCount = { 0 };
+            size_t deltaCount = { 0 };
+
+            // сжатие (см. setCompress())
+            bool compress = { false };
+            int compressAccel = { 1 };
+            std::vector<uint8_t> zbuf;
+            size_t compressCount = { 0 }; /*!< количество сжатых пакетов */
+            size_t compressSkipped = { 0 }; /*!< пакеты, которые не имело смысла сжимать */
+            size_t rawBytes = { 0 }; /*!< размер сжатых пакетов до сжатия */
+            size_t zBytes = { 0 }; /*!< размер сжатых пакетов после сжатия */
+            size_t compressTime_ns = { 0 }; /*!< суммарное время сжатия (включая неудачные попытки) */
+
+            void compressPacket( std::vector<uint8_t>& buf, size_t& sz ) noexcept;
+
+            bool sendTimestamp = { false };
+
             size_t maxAData = { UniSetUDP::MaxACount };
             size_t maxDData = { UniSetUDP::MaxDCount };
 
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2021 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -------------------------------------------------------------------------
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <sys/uio.h>
+#include "UNetTransport.h"
+// -------------------------------------------------------------------------
+using namespace std;
+using namespace uniset;
+// -------------------------------------------------------------------------
+// сколько сообщений передаём в ядро за один вызов recvmmsg/sendmmsg
+// (для sendmmsg ограничено UIO_MAXIOV)
+static const size_t mmsgChunk = 64;
+// -------------------------------------------------------------------------
+ssize_t UNetReceiveTransport::receiveBatch( UNetBuffer* bufs, size_t num )
+{
+    size_t n = 0;
+
+    for( ; n < num && available() > 0; n++ )
+    {
+        ssize_t ret = receive(bufs[n].data, bufs[n].size);
+
+        if( ret < 0 )
+            return n > 0 ? (ssize_t)n : -1;
+
+        if( ret == 0 )
+            break;
+
+        bufs[n].len = ret;
+    }
+
+    return n;
+}
+// -------------------------------------------------------------------------
+ssize_t UNetSendTransport::sendBatch( const UNetBuffer* bufs, size_t num )
+{
+    for( size_t i = 0; i < num; i++ )
+    {
+        ssize_t ret = send(bufs[i].data, bufs[i].len);
+
+        if( ret < 0 )
+            return i > 0 ? (ssize_t)i : -1;
+    }
+
+    return num;
+}
+// -------------------------------------------------------------------------
+bool UNetBatchIO::enableKernelDrops( int sock ) noexcept
+{
+    int on = 1;
+    return ( ::setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) == 0 );
+}
+// -------------------------------------------------------------------------
+bool UNetBatchIO::setIncomingCPU( int sock, int cpu ) noexcept
+{
+#ifdef SO_INCOMING_CPU
+    return ( ::setsockopt(sock, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == 0 );
+#else
+    errno = ENOTSUP;
+    return false;
+#endif
+}
+// -------------------------------------------------------------------------
+ssize_t UNetBatchIO::recv( int sock, UNetBuffer* bufs, size_t num, std::atomic<uint32_t>* drops )
+{
+    struct mmsghdr msgs[mmsgChunk];
+    struct iovec iovs[mmsgChunk];
+    // ядро добавляет счётчик отброшенных пакетов (SO_RXQ_OVFL) только если он не нулевой
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(uint32_t))];
+        struct cmsghdr align;
+    } ctrl[mmsgChunk];
+    size_t n = 0;
+
+    while( n < num )
+    {
+        const size_t cnt = std::min(num - n, mmsgChunk);
+
+        for( size_t i = 0; i < cnt; i++ )
+        {
+            iovs[i].iov_base = bufs[n + i].data;
+            iovs[i].iov_len = bufs[n + i].size;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+
+            if( drops )
+            {
+                msgs[i].msg_hdr.msg_control = ctrl[i].buf;
+                msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i].buf);
+            }
+        }
+
+        int ret = ::recvmmsg(sock, msgs, cnt, MSG_DONTWAIT, nullptr);
+
+        if( ret < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            if( errno == EAGAIN || errno == EWOULDBLOCK )
+                break;
+
+            return n > 0 ? (ssize_t)n : -1;
+        }
+
+        for( int i = 0; i < ret; i++ )
+        {
+            bufs[n + i].len = msgs[i].msg_len;
+
+            if( !drops || msgs[i].msg_hdr.msg_controllen == 0 )
+                continue;
+
+            for( struct cmsghdr* c = CMSG_FIRSTHDR(&msgs[i].msg_hdr); c; c = CMSG_NXTHDR(&msgs[i].msg_hdr, c) )
+            {
+                if( c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL )
+                {
+                    uint32_t v;
+                    memcpy(&v, CMSG_DATA(c), sizeof(v));
+                    drops->store(v);
+                }
+            }
+        }
+
+        n += ret;
+
+        // очередь сокета опустела
+        if( (size_t)ret < cnt )
+            break;
+    }
+
+    return n;
+}
+// -------------------------------------------------------------------------
+ssize_t UNetBatchIO::send( int sock, const struct sockaddr* to, socklen_t tolen, const UNetBuffer* bufs, size_t num )
+{
+    struct mmsghdr msgs[mmsgChunk];
+    struct iovec iovs[mmsgChunk];
+    size_t n = 0;
+
+    while( n < num )
+    {
+        const size_t cnt = std::min(num - n, mmsgChunk);
+
+        for( size_t i = 0; i < cnt; i++ )
+        {
+            iovs[i].iov_base = bufs[n + i].data;
+            iovs[i].iov_len = bufs[n + i].len;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = (void*)to;
+            msgs[i].msg_hdr.msg_namelen = tolen;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        // sendmmsg может послать меньше чем просили (например при заполнении буфера сокета)
+        // поэтому досылаем остаток
+        int ret = ::sendmmsg(sock, msgs, cnt, 0);
+
+        if( ret < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return n > 0 ? (ssize_t)n : -1;
+        }
+
+        if( ret == 0 )
+            break;
+
+        n += ret;
+    }
+
+    return n;
+}
+// -------------------------------------------------------------------------
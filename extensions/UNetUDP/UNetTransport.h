@@ -18,10 +18,20 @@
 #define UNetTransport_H_
 // -------------------------------------------------------------------------
 #include <string>
+#include <atomic>
+#include <sys/socket.h>
 #include "PassiveTimer.h" // for typedef timeout_t
 // -------------------------------------------------------------------------
 namespace uniset
 {
+    // Буфер для пакетного приёма/посылки (receiveBatch/sendBatch)
+    struct UNetBuffer
+    {
+        void* data = { nullptr };
+        size_t size = { 0 }; /*!< размер буфера (для приёма) */
+        size_t len = { 0 };  /*!< размер сообщения (принятого или посылаемого) */
+    };
+
     // Интерфейс для получения данных по сети
     class UNetReceiveTransport
     {
@@ -40,6 +50,29 @@ namespace uniset
             virtual ssize_t receive( void* r_buf, size_t sz ) = 0;
             virtual void disconnect() = 0;
             virtual int available() = 0;
+
+            /*! Пакетное чтение: не более num сообщений (каждое в свой буфер).
+             * Не блокируется, если данных нет.
+             * По умолчанию реализовано через receive().
+             * \return количество принятых сообщений (0 - нет данных) или -1 при ошибке (см. errno)
+             */
+            virtual ssize_t receiveBatch( UNetBuffer* bufs, size_t num );
+
+            /*! количество пакетов, отброшенных ядром из-за переполнения буфера приёма сокета (SO_RXQ_OVFL)
+             * \return -1 если не поддерживается
+             */
+            virtual long getKernelDrops() const noexcept
+            {
+                return -1;
+            }
+
+            /*! сетевой сокет (для setsockopt). Отличается от getSocket(), если транспорт - обёртка
+             * и ждать надо другой дескриптор (см. IOUringReceiveTransport)
+             */
+            virtual int getNetSocket() const
+            {
+                return getSocket();
+            }
     };
 
     // Интерфейс для посылки данных в сеть
@@ -58,7 +91,38 @@ namespace uniset
             // write
             virtual bool isReadyForSend( timeout_t tout ) = 0;
             virtual ssize_t send( const void* r_buf, size_t sz ) = 0;
+
+            /*! Пакетная посылка num сообщений.
+             * По умолчанию реализовано через send().
+             * \return количество посланных сообщений или -1 при ошибке (см. errno)
+             */
+            virtual ssize_t sendBatch( const UNetBuffer* bufs, size_t num );
+
+            /*! адрес назначения (нужен для посылки в обход send(), см. IOUringSendTransport)
+             * \return false если не поддерживается
+             */
+            virtual bool getDestination( const struct sockaddr*& addr, socklen_t& len ) const noexcept
+            {
+                return false;
+            }
     };
+
+    namespace UNetBatchIO
+    {
+        // реализация receiveBatch/sendBatch через recvmmsg/sendmmsg
+        // (одним системным вызовом на всю пачку)
+        // drops - если задан, сохраняется счётчик отброшенных ядром пакетов (см. enableKernelDrops)
+        ssize_t recv( int sock, UNetBuffer* bufs, size_t num, std::atomic<uint32_t>* drops = nullptr );
+        ssize_t send( int sock, const struct sockaddr* to, socklen_t tolen, const UNetBuffer* bufs, size_t num );
+
+        // включить для сокета подсчёт отброшенных ядром пакетов (SO_RXQ_OVFL)
+        bool enableKernelDrops( int sock ) noexcept;
+
+        // задать процессор, на котором обрабатывается сокет (SO_INCOMING_CPU).
+        // Для сокетов на одном порту (SO_REUSEPORT) ядро предпочитает сокет,
+        // у которого этот процессор совпадает с процессором принявшим пакет.
+        bool setIncomingCPU( int sock, int cpu ) noexcept;
+    }
 } // end of uniset namespace
 // -------------------------------------------------------------------------
 #endif // UNetTransport_H_
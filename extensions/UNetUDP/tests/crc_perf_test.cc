@@ -0,0 +1,116 @@
+// Сравнение скорости расчёта crc для UniSetUDP::UDPMessage:
+// побайтовый расчёт по всему массиву (как было раньше) и
+// расчёт "slice-by-8" только по заполненным данным.
+// -----------------------------------------------------------------------------
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+#include "UDPPacket.h"
+// --------------------------------------------------------------------------
+using namespace std;
+using namespace uniset;
+using namespace std::chrono;
+// --------------------------------------------------------------------------
+static volatile uint16_t sink = 0;
+// --------------------------------------------------------------------------
+template<typename Func>
+static double bench( size_t ncycles, Func&& f )
+{
+    auto t_start = steady_clock::now();
+
+    for( size_t i = 0; i < ncycles; i++ )
+        sink ^= f();
+
+    auto t_end = steady_clock::now();
+    return duration_cast<duration<double, std::nano>>(t_end - t_start).count() / ncycles;
+}
+// --------------------------------------------------------------------------
+// расчёт как было раньше: побайтово по всем массивам целиком
+static uint16_t oldPacketCrc( const UniSetUDP::UDPMessage& m )
+{
+    uint16_t crc[2];
+    crc[0] = UniSetUDP::makeCRC_bytewise( (const unsigned char*)(m.d_id), sizeof(m.d_id) );
+    crc[1] = UniSetUDP::makeCRC_bytewise( (const unsigned char*)(m.d_dat), sizeof(m.d_dat) );
+    uint16_t dcrc = UniSetUDP::makeCRC_bytewise( (const unsigned char*)(&crc), sizeof(crc) );
+    uint16_t acrc = UniSetUDP::makeCRC_bytewise( (const unsigned char*)(&m.a_dat), sizeof(m.a_dat) );
+    return dcrc ^ acrc;
+}
+// --------------------------------------------------------------------------
+static void packTest( size_t count, size_t ncycles )
+{
+    UniSetUDP::UDPMessage m;
+
+    for( size_t i = 0; i < count && i < UniSetUDP::MaxACount; i++ )
+        m.addAData(i, i * 10);
+
+    for( size_t i = 0; i < count && i < UniSetUDP::MaxDCount; i++ )
+        m.addDData(i, i % 2);
+
+    double t_old = bench(ncycles, [&m]()
+    {
+        return oldPacketCrc(m);
+    });
+
+    double t_new = bench(ncycles, [&m]()
+    {
+        return (uint16_t)(m.calcAcrc() ^ m.calcDcrc());
+    });
+
+    cout << "packet[A=" << setw(4) << m.asize() << " D=" << setw(4) << m.dsize() << "]: "
+         << " old: " << setw(10) << fixed << setprecision(1) << t_old << " ns"
+         << " new: " << setw(10) << t_new << " ns"
+         << " (x" << setprecision(1) << (t_old / t_new) << ")"
+         << endl;
+}
+// --------------------------------------------------------------------------
+int main( int argc, char** argv )
+{
+    size_t ncycles = 20000;
+
+    if( argc > 1 )
+        ncycles = std::atoi(argv[1]);
+
+    // проверка совпадения результатов
+    std::vector<unsigned char> buf(64 * 1024);
+
+    for( size_t i = 0; i < buf.size(); i++ )
+        buf[i] = std::rand() & 0xff;
+
+    for( size_t len = 0; len < 1024; len++ )
+    {
+        if( UniSetUDP::makeCRC(buf.data() + (len % 7), len) != UniSetUDP::makeCRC_bytewise(buf.data() + (len % 7), len) )
+        {
+            cerr << "CRC MISMATCH for len=" << len << endl;
+            return 1;
+        }
+    }
+
+    cout << "crc check: OK" << endl;
+
+    for( size_t len : { 64, 1024, 24000, 65536 } )
+    {
+        double t_old = bench(ncycles, [&buf, len]()
+        {
+            return UniSetUDP::makeCRC_bytewise(buf.data(), len);
+        });
+
+        double t_new = bench(ncycles, [&buf, len]()
+        {
+            return UniSetUDP::makeCRC(buf.data(), len);
+        });
+
+        cout << "len=" << setw(6) << len << ": "
+             << " bytewise: " << setw(8) << fixed << setprecision(1) << (len * 1000.0 / t_old) << " MB/s"
+             << " slice-by-8: " << setw(8) << (len * 1000.0 / t_new) << " MB/s"
+             << " (x" << setprecision(1) << (t_old / t_new) << ")"
+             << endl;
+    }
+
+    for( size_t count : { 10, 30, 100, 1000, 4000 } )
+        packTest(count, ncycles / 10 + 1);
+
+    return 0;
+}
+// --------------------------------------------------------------------------
@@ -1,10 +1,18 @@
 #include <catch.hpp>
 // -----------------------------------------------------------------------------
 #include <memory>
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
 #include "UniSetTypes.h"
 #include "UInterface.h"
 #include "UDPPacket.h"
 #include "UDPCore.h"
+#include "UDPTransport.h"
+#include "UNetRing.h"
+#include "UNetIOUring.h"
+#include "UNetLatency.h"
 // -----------------------------------------------------------------------------
 // include-ы искплючительно для того, чтобы их обработал gcov (покрытие кода)
 #include "UNetReceiver.h"
@@ -67,18 +75,19 @@ void InitTest()
 static UniSetUDP::UDPMessage receive( unsigned int pnum = 0, timeout_t tout = 2000, int ncycle = 30 )
 {
     UniSetUDP::UDPMessage pack;
+    std::vector<uint8_t> rbuf(sizeof(pack));
 
     while( ncycle > 0 )
     {
         if( !udp_r->poll(UniSetTimer::millisecToPoco(tout), Poco::Net::Socket::SELECT_READ) )
             break;
 
-        size_t ret = udp_r->receiveBytes(&pack, sizeof(pack) );
+        size_t ret = udp_r->receiveBytes(rbuf.data(), rbuf.size() );
 
         if( ret <= 0 )
             break;
 
-        pack.ntoh();
+        REQUIRE( pack.deserialize(rbuf.data(), ret) );
 
         if( pnum > 0 && pack.header.num >= pnum ) // -V560
             break;
@@ -103,6 +112,23 @@ void send( UniSetUDP::UDPMessage& pack, int tout = 2000 )
     REQUIRE( ret == sizeof(pack) );
 }
 // -----------------------------------------------------------------------------
+void sendCompact( UniSetUDP::UDPMessage& pack, bool delta = false, int tout = 2000 )
+{
+    CHECK( udp_s->poll(UniSetTimer::millisecToPoco(tout), Poco::Net::Socket::SELECT_WRITE) );
+
+    pack.header.nodeID = s_nodeID;
+    pack.header.procID = s_procID;
+    pack.header.num = s_numpack++;
+    pack.updatePacketCrc();
+
+    std::vector<uint8_t> buf(sizeof(pack));
+    size_t sz = pack.serialize(buf.data(), buf.size(), delta);
+    REQUIRE( sz == pack.compactSize() );
+
+    size_t ret = udp_s->sendTo(buf.data(), sz, s_addr);
+    REQUIRE( ret == sz );
+}
+// -----------------------------------------------------------------------------
 TEST_CASE("[UNetUDP]: repack", "[unetudp][udp][repack]")
 {
     UniSetUDP::UDPMessage pack;
@@ -172,6 +198,568 @@ TEST_CASE("[UNetUDP]: UDPMessage", "[unetudp][udp][udpmessage]")
     }
 }
 // -----------------------------------------------------------------------------
+TEST_CASE("[UNetUDP]: crc", "[unetudp][udp][crc]")
+{
+    SECTION("makeCRC")
+    {
+        std::vector<unsigned char> buf(1024);
+
+        for( size_t i = 0; i < buf.size(); i++ )
+            buf[i] = (i * 7 + 3) & 0xff;
+
+        for( size_t len = 0; len < 100; len++ )
+            REQUIRE( UniSetUDP::makeCRC(buf.data() + 1, len) == UniSetUDP::makeCRC_bytewise(buf.data() + 1, len) );
+
+        REQUIRE( UniSetUDP::makeCRC(buf.data(), buf.size()) == UniSetUDP::makeCRC_bytewise(buf.data(), buf.size()) );
+    }
+
+    SECTION("only used data")
+    {
+        UniSetUDP::UDPMessage pack;
+        pack.addAData(1, 10);
+        pack.addDData(2, true);
+        uint16_t acrc = pack.calcAcrc();
+        uint16_t dcrc = pack.calcDcrc();
+
+        // данные за пределами acount/dcount не влияют на crc
+        pack.a_dat[1].val = 100;
+        pack.d_id[1] = 100;
+        REQUIRE( pack.calcAcrc() == acrc );
+        REQUIRE( pack.calcDcrc() == dcrc );
+
+        pack.setAData(0, 11);
+        pack.setDData(0, false);
+        REQUIRE( pack.calcAcrc() != acrc );
+        REQUIRE( pack.calcDcrc() != dcrc );
+    }
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[UNetUDP]: compact format", "[unetudp][udp][compact]")
+{
+    UniSetUDP::UDPMessage pack;
+    pack.header.nodeID = 100;
+    pack.header.procID = 100;
+    pack.header.num = 1;
+
+    for( size_t i = 0; i < 30; i++ )
+        pack.addAData(i + 1, i * 10);
+
+    for( size_t i = 0; i < 13; i++ )
+        pack.addDData(i + 100, i % 2);
+
+    pack.updatePacketCrc();
+
+    std::vector<uint8_t> buf(sizeof(pack));
+
+    SECTION("serialize/deserialize")
+    {
+        size_t sz = pack.serialize(buf.data(), buf.size());
+        REQUIRE( sz == pack.compactSize() );
+        REQUIRE( sz < 1432 ); // не больше MTU (без заголовков)
+
+        // мал буфер
+        REQUIRE( pack.serialize(buf.data(), sz - 1) == 0 );
+
+        UniSetUDP::UDPMessage pack2;
+        REQUIRE( pack2.deserialize(buf.data(), sz) );
+        REQUIRE( pack2.isOk() );
+        REQUIRE( pack2.header.nodeID == 100 );
+        REQUIRE( pack2.header.procID == 100 );
+        REQUIRE( pack2.header.num == 1 );
+        REQUIRE( pack2.header.acrc == pack.header.acrc );
+        REQUIRE( pack2.header.dcrc == pack.header.dcrc );
+        REQUIRE( pack2.asize() == 30 );
+        REQUIRE( pack2.dsize() == 13 );
+
+        for( size_t i = 0; i < pack2.asize(); i++ )
+        {
+            REQUIRE( pack2.a_dat[i].id == (long)(i + 1) );
+            REQUIRE( pack2.a_dat[i].val == (long)(i * 10) );
+        }
+
+        for( size_t i = 0; i < pack2.dsize(); i++ )
+        {
+            REQUIRE( pack2.dID(i) == (long)(i + 100) );
+            REQUIRE( pack2.dValue(i) == (bool)(i % 2) );
+        }
+
+        // обрезанный пакет
+        REQUIRE_FALSE( pack2.deserialize(buf.data(), sz - 1) );
+        REQUIRE_FALSE( pack2.deserialize(buf.data(), 10) );
+    }
+
+    SECTION("full format")
+    {
+        UniSetUDP::UDPMessage pack2;
+        REQUIRE( pack2.deserialize((const uint8_t*)&pack, sizeof(pack)) );
+        REQUIRE( pack2.asize() == 30 );
+        REQUIRE( pack2.dsize() == 13 );
+        REQUIRE( pack2.a_dat[29].val == 290 );
+        REQUIRE( pack2.dValue(12) == false );
+
+        REQUIRE_FALSE( pack2.deserialize((const uint8_t*)&pack, sizeof(pack) - 1) );
+    }
+
+    SECTION("bad magic")
+    {
+        size_t sz = pack.serialize(buf.data(), buf.size());
+        buf[0] ^= 0xFF;
+        UniSetUDP::UDPMessage pack2;
+        REQUIRE_FALSE( pack2.deserialize(buf.data(), sz) );
+    }
+
+    SECTION("max size")
+    {
+        UniSetUDP::UDPMessage u;
+
+        for( size_t i = 0; i < UniSetUDP::MaxACount; i++ )
+            u.addAData(i, i);
+
+        for( size_t i = 0; i < UniSetUDP::MaxDCount; i++ )
+            u.addDData(i, true);
+
+        size_t sz = u.serialize(buf.data(), buf.size());
+        REQUIRE( sz > 0 );
+        REQUIRE( sz <= sizeof(UniSetUDP::UDPMessage) );
+
+        UniSetUDP::UDPMessage u2;
+        REQUIRE( u2.deserialize(buf.data(), sz) );
+        REQUIRE( u2.dValue(UniSetUDP::MaxDCount - 1) == true );
+        REQUIRE( u2.a_dat[UniSetUDP::MaxACount - 1].val == (long)(UniSetUDP::MaxACount - 1) );
+    }
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[UNetUDP]: compress", "[unetudp][udp][compress]")
+{
+    if( !UniSetUDP::isCompressSupported() )
+    {
+        WARN("LZ4 compression is not supported (build without lz4). Skip test..");
+        return;
+    }
+
+    UniSetUDP::UDPMessage pack;
+    pack.header.nodeID = 100;
+    pack.header.procID = 100;
+    pack.header.num = 5;
+
+    // "типичный" пакет: идущие подряд ID и мало меняющиеся значения
+    for( size_t i = 0; i < 200; i++ )
+        pack.addAData(i + 1, i % 3);
+
+    for( size_t i = 0; i < 300; i++ )
+        pack.addDData(i + 1000, i % 2);
+
+    pack.updatePacketCrc();
+
+    std::vector<uint8_t> buf(sizeof(pack));
+    std::vector<uint8_t> zbuf(UniSetUDP::compressBound(buf.size()));
+    std::vector<uint8_t> ubuf(sizeof(pack));
+
+    size_t sz = pack.serialize(buf.data(), buf.size());
+    REQUIRE( sz > 0 );
+    REQUIRE_FALSE( UniSetUDP::isCompressed(buf.data(), sz) );
+
+    SECTION("compress/decompress")
+    {
+        size_t zsz = UniSetUDP::compress(buf.data(), sz, zbuf.data(), zbuf.size());
+        REQUIRE( zsz > 0 );
+        REQUIRE( zsz < sz );
+        REQUIRE( UniSetUDP::isCompressed(zbuf.data(), zsz) );
+
+        // сжатый пакет напрямую не разбирается
+        UniSetUDP::UDPMessage pack2;
+        REQUIRE_FALSE( pack2.deserialize(zbuf.data(), zsz) );
+
+        size_t usz = UniSetUDP::decompress(zbuf.data(), zsz, ubuf.data(), ubuf.size());
+        REQUIRE( usz == sz );
+        REQUIRE( std::memcmp(buf.data(), ubuf.data(), sz) == 0 );
+
+        REQUIRE( pack2.deserialize(ubuf.data(), usz) );
+        REQUIRE( pack2.isOk() );
+        REQUIRE( pack2.header.num == 5 );
+        REQUIRE( pack2.asize() == 200 );
+        REQUIRE( pack2.dsize() == 300 );
+        REQUIRE( pack2.header.acrc == pack2.calcAcrc() );
+        REQUIRE( pack2.header.dcrc == pack2.calcDcrc() );
+        REQUIRE( pack2.a_dat[199].val == 199 % 3 );
+        REQUIRE( pack2.dValue(299) == true );
+
+        // повреждённые данные
+        REQUIRE( UniSetUDP::decompress(zbuf.data(), zsz - 1, ubuf.data(), ubuf.size()) == 0 );
+        REQUIRE( UniSetUDP::decompress(zbuf.data(), zsz, ubuf.data(), sz - 1) == 0 );
+    }
+
+    SECTION("delta")
+    {
+        size_t dsz = pack.serialize(buf.data(), buf.size(), true);
+        size_t zsz = UniSetUDP::compress(buf.data(), dsz, zbuf.data(), zbuf.size(), 10);
+        REQUIRE( zsz > 0 );
+
+        size_t usz = UniSetUDP::decompress(zbuf.data(), zsz, ubuf.data(), ubuf.size());
+        REQUIRE( usz == dsz );
+
+        UniSetUDP::UDPMessage pack2;
+        REQUIRE( pack2.deserialize(ubuf.data(), usz) );
+        REQUIRE( pack2.isDelta() );
+    }
+
+    SECTION("incompressible")
+    {
+        // маленький пакет не сжимается
+        UniSetUDP::UDPMessage small;
+        small.addAData(1, 1);
+        size_t ssz = small.serialize(buf.data(), buf.size());
+        REQUIRE( UniSetUDP::compress(buf.data(), ssz, zbuf.data(), zbuf.size()) == 0 );
+
+        // случайные данные тоже
+        UniSetUDP::UDPMessage rnd;
+
+        for( size_t i = 0; i < 100; i++ )
+            rnd.addAData(std::rand(), ((int64_t)std::rand() << 32) | std::rand());
+
+        size_t rsz = rnd.serialize(buf.data(), buf.size());
+        REQUIRE( UniSetUDP::compress(buf.data(), rsz, zbuf.data(), zbuf.size()) == 0 );
+    }
+}
+// -----------------------------------------------------------------------------
+static struct timespec usec_to_ts( int64_t usec )
+{
+    struct timespec ts;
+    ts.tv_sec = usec / 1000000;
+    ts.tv_nsec = (usec % 1000000) * 1000;
+    return ts;
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[UNetUDP]: timestamp", "[unetudp][udp][latency]")
+{
+    UniSetUDP::UDPMessage pack;
+    pack.header.num = 10;
+
+    for( size_t i = 0; i < 100; i++ )
+        pack.addAData(i + 1, i);
+
+    std::vector<uint8_t> buf(sizeof(pack));
+    struct timespec ts = usec_to_ts(1600000000123456);
+    struct timespec ts2;
+
+    size_t sz = pack.serialize(buf.data(), buf.size());
+    REQUIRE_FALSE( UniSetUDP::getTimestamp(buf.data(), sz, ts2) );
+
+    REQUIRE( UniSetUDP::addTimestamp(buf.data(), sz, sz, ts) == 0 ); // мал буфер
+    size_t tsz = UniSetUDP::addTimestamp(buf.data(), sz, buf.size(), ts);
+    REQUIRE( tsz == sz + sizeof(UniSetUDP::UDPTimestamp) );
+
+    REQUIRE( UniSetUDP::getTimestamp(buf.data(), tsz, ts2) );
+    REQUIRE( ts2.tv_sec == ts.tv_sec );
+    REQUIRE( ts2.tv_nsec == ts.tv_nsec );
+    REQUIRE_FALSE( UniSetUDP::getTimestamp(buf.data(), tsz - 1, ts2) );
+
+    // метка не мешает разбору пакета
+    UniSetUDP::UDPMessage pack2;
+    REQUIRE( pack2.deserialize(buf.data(), tsz) );
+    REQUIRE( pack2.header.num == 10 );
+    REQUIRE( pack2.asize() == 100 );
+
+    if( UniSetUDP::isCompressSupported() )
+    {
+        std::vector<uint8_t> zbuf(UniSetUDP::compressBound(tsz));
+        std::vector<uint8_t> ubuf(sizeof(pack));
+        size_t zsz = UniSetUDP::compress(buf.data(), tsz, zbuf.data(), zbuf.size());
+        REQUIRE( zsz > 0 );
+
+        size_t usz = UniSetUDP::decompress(zbuf.data(), zsz, ubuf.data(), ubuf.size());
+        REQUIRE( usz == tsz );
+        REQUIRE( UniSetUDP::getTimestamp(ubuf.data(), usz, ts2) );
+        REQUIRE( ts2.tv_nsec == ts.tv_nsec );
+    }
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[UNetUDP]: latency", "[unetudp][udp][latency]")
+{
+    REQUIRE( UNetLatency::bucket(0) == 0 );
+    REQUIRE( UNetLatency::bucket(49) == 0 );
+    REQUIRE( UNetLatency::bucket(50) == 1 );
+    REQUIRE( UNetLatency::bucket(5000000) == UNetLatency::NumBuckets - 1 );
+
+    SECTION("sync clock")
+    {
+        UNetLatency l;
+        l.setSyncClock(true);
+
+        for( int64_t i = 0; i < 10; i++ )
+            l.add(usec_to_ts(1000000 + i * 1000), usec_to_ts(1000300 + i * 1000));
+
+        l.period();
+        REQUIRE( l.count() == 10 );
+        REQUIRE( l.getLatency() == 300 );
+        REQUIRE( l.getLatencyMax() == 300 );
+        REQUIRE( l.getJitter() == 0 );
+        REQUIRE( l.latencyHistogram()[UNetLatency::bucket(300)] == 10 );
+    }
+
+    SECTION("offset estimate")
+    {
+        UNetLatency l;
+
+        // часы отправителя отстают на 5 сек, минимальная задержка 100 мкс,
+        // каждый 10-ый пакет задерживается ещё на 2 мсек
+        for( int64_t i = 0; i < 100; i++ )
+        {
+            int64_t s = 1000000000 + i * 1000;
+            l.add(usec_to_ts(s), usec_to_ts(s + 5000000 + 100 + ( i % 10 ? 0 : 2000 )));
+        }
+
+        l.period();
+        REQUIRE( l.getOffset() == 5000100 );
+        REQUIRE( l.getLatencyMax() == 2000 );
+        REQUIRE( l.getLatency() < 300 );
+        REQUIRE( l.getJitter() > 0 );
+        REQUIRE( l.latencyHistogram()[UNetLatency::bucket(2000)] == 9 );
+
+        // без пакетов средняя задержка за период нулевая
+        l.period();
+        REQUIRE( l.getLatency() == 0 );
+        REQUIRE( l.count() == 100 );
+
+        l.reset();
+        REQUIRE( l.count() == 0 );
+        REQUIRE( l.getOffset() == 0 );
+    }
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[UNetUDP]: batch transport", "[unetudp][udp][batch]")
+{
+    UDPReceiveTransport r("127.0.0.1", 3050);
+    UDPSendTransport s("127.0.0.1", 3050);
+    REQUIRE( r.createConnection(false, 1000, true) );
+    REQUIRE( s.createConnection(false, 1000) );
+
+    // пакетов больше, чем отдаётся ядру за один вызов sendmmsg/recvmmsg
+    const size_t num = 100;
+    std::vector<UniSetUDP::UDPMessage> msg(num);
+    std::vector< std::vector<uint8_t> > sbuf(num);
+    std::vector<UNetBuffer> svec(num);
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        msg[i].header.num = i + 1;
+        msg[i].addAData(i, i * 10);
+        sbuf[i].resize(msg[i].compactSize());
+        svec[i].data = sbuf[i].data();
+        svec[i].len = msg[i].serialize(sbuf[i].data(), sbuf[i].size());
+    }
+
+    REQUIRE( s.sendBatch(svec.data(), num) == (ssize_t)num );
+    REQUIRE( r.isReadyForReceive(2000) );
+
+    std::vector<uint8_t> rbuf(num * sizeof(UniSetUDP::UDPMessage));
+    std::vector<UNetBuffer> rvec(num);
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        rvec[i].data = rbuf.data() + i * sizeof(UniSetUDP::UDPMessage);
+        rvec[i].size = sizeof(UniSetUDP::UDPMessage);
+    }
+
+    size_t n = 0;
+
+    for( size_t k = 0; k < 10 && n < num; k++ )
+    {
+        ssize_t ret = r.receiveBatch(rvec.data() + n, num - n);
+        REQUIRE( ret >= 0 );
+        n += ret;
+
+        if( n < num )
+            msleep(50);
+    }
+
+    REQUIRE( n == num );
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        UniSetUDP::UDPMessage m;
+        REQUIRE( m.deserialize((const uint8_t*)rvec[i].data, rvec[i].len) );
+        REQUIRE( m.header.num == i + 1 );
+        REQUIRE( m.a_dat[0].val == (long)(i * 10) );
+    }
+
+    // данных больше нет
+    REQUIRE( r.receiveBatch(rvec.data(), num) == 0 );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[UNetUDP]: io_uring transport", "[unetudp][udp][io_uring]")
+{
+    std::string err;
+    auto uring = UNetIOUring::create(64, sizeof(UniSetUDP::UDPMessage), err);
+
+    if( !uring )
+    {
+        WARN("io_uring is not available: " << err);
+        return;
+    }
+
+    std::unique_ptr<UNetReceiveTransport> rt(new UDPReceiveTransport("127.0.0.1", 3051));
+    IOUringReceiveTransport r(std::move(rt), uring);
+
+    std::unique_ptr<UNetSendTransport> st(new UDPSendTransport("127.0.0.1", 3051));
+    auto s = IOUringSendTransport::create(st, err);
+    REQUIRE( s != nullptr );
+
+    REQUIRE( r.createConnection(false, 1000, true) );
+    REQUIRE( s->createConnection(false, 1000) );
+
+    // больше чем буферов в пуле (часть пакетов ждёт в сокете, пока буферы не вернут)
+    const size_t num = 100;
+    std::vector<UniSetUDP::UDPMessage> msg(num);
+    std::vector< std::vector<uint8_t> > sbuf(num);
+    std::vector<UNetBuffer> svec(num);
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        msg[i].header.num = i + 1;
+        msg[i].addAData(i, i * 10);
+        sbuf[i].resize(msg[i].compactSize());
+        svec[i].data = sbuf[i].data();
+        svec[i].len = msg[i].serialize(sbuf[i].data(), sbuf[i].size());
+    }
+
+    REQUIRE( s->sendBatch(svec.data(), num) == (ssize_t)num );
+
+    std::vector<uint8_t> rbuf(num * sizeof(UniSetUDP::UDPMessage));
+    std::vector<UNetBuffer> rvec(num);
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        rvec[i].data = rbuf.data() + i * sizeof(UniSetUDP::UDPMessage);
+        rvec[i].size = sizeof(UniSetUDP::UDPMessage);
+    }
+
+    size_t n = 0;
+
+    for( size_t k = 0; k < 50 && n < num; k++ )
+    {
+        if( !r.isReadyForReceive(100) )
+            continue;
+
+        ssize_t ret = r.receiveBatch(rvec.data() + n, num - n);
+        REQUIRE( ret >= 0 );
+        n += ret;
+    }
+
+    REQUIRE( n == num );
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        UniSetUDP::UDPMessage m;
+        REQUIRE( m.deserialize((const uint8_t*)rvec[i].data, rvec[i].len) );
+        REQUIRE( m.header.num == i + 1 );
+        REQUIRE( m.a_dat[0].val == (long)(i * 10) );
+    }
+
+    // данных больше нет
+    REQUIRE( r.receiveBatch(rvec.data(), num) == 0 );
+    REQUIRE( r.available() == 0 );
+
+    // повторное подключение (порт должен освободиться)
+    REQUIRE( r.createConnection(false, 1000, true) );
+    REQUIRE( s->send(svec[0].data, svec[0].len) == (ssize_t)svec[0].len );
+    REQUIRE( r.isReadyForReceive(2000) );
+    REQUIRE( r.receive(rvec[0].data, rvec[0].size) == (ssize_t)svec[0].len );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[UNetUDP]: spsc ring", "[unetudp][udp][ring]")
+{
+    UNetRing r(8, sizeof(uint32_t));
+    REQUIRE( r.capacity() == 8 );
+    REQUIRE( r.front() == nullptr );
+
+    SECTION("wrap")
+    {
+        size_t num = 6;
+        UNetBuffer* b = r.writeSlots(num);
+        REQUIRE( num == 6 );
+
+        for( size_t i = 0; i < num; i++ )
+        {
+            REQUIRE( b[i].size == sizeof(uint32_t) );
+            *(uint32_t*)b[i].data = i;
+            b[i].len = sizeof(uint32_t);
+        }
+
+        r.push(num, UNetRing::Time());
+        REQUIRE( r.size() == 6 );
+
+        for( size_t i = 0; i < 4; i++ )
+        {
+            REQUIRE( *(const uint32_t*)r.front()->data == i );
+            r.pop();
+        }
+
+        // до конца буфера осталось только 2 слота
+        num = 10;
+        r.writeSlots(num);
+        REQUIRE( num == 2 );
+        r.push(num, UNetRing::Time());
+
+        // дальше с начала (свободно ещё 4)
+        num = 10;
+        r.writeSlots(num);
+        REQUIRE( num == 4 );
+        r.push(num, UNetRing::Time());
+        REQUIRE( r.size() == 8 );
+
+        num = 1;
+        r.writeSlots(num);
+        REQUIRE( num == 0 );
+    }
+
+    SECTION("threads")
+    {
+        const uint32_t total = 100000;
+
+        std::thread producer([&r, total]()
+        {
+            uint32_t n = 0;
+
+            while( n < total )
+            {
+                size_t num = 3;
+                UNetBuffer* b = r.writeSlots(num);
+
+                if( num == 0 )
+                    std::this_thread::yield();
+
+                for( size_t i = 0; i < num && n < total; i++ )
+                {
+                    *(uint32_t*)b[i].data = n++;
+                    b[i].len = sizeof(uint32_t);
+                    r.push(1, UNetRing::Time());
+                }
+            }
+        });
+
+        uint32_t expected = 0;
+
+        while( expected < total )
+        {
+            auto b = r.front();
+
+            if( !b )
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            REQUIRE( *(const uint32_t*)b->data == expected );
+            expected++;
+            r.pop();
+        }
+
+        producer.join();
+        REQUIRE( r.size() == 0 );
+    }
+}
+// -----------------------------------------------------------------------------
 #if 0
 TEST_CASE("[UNetUDP]: respond sensor", "[unetudp][udp]")
 {
@@ -307,6 +895,20 @@ TEST_CASE("[UNetUDP]: check receiver", "[unetudp][udp][receiver]")
         //msleep(2000); // в запускающем файле стоит --unet-recv-timeout 2000
         //REQUIRE( ui->getValue(node2_respond_s) == 0 );
     }
+    SECTION("Test: send compact data pack.")
+    {
+        UniSetUDP::UDPMessage pack;
+        pack.addAData(8, 20);
+        pack.addAData(9, -20);
+        pack.addDData(10, true);
+        pack.addDData(11, false);
+        sendCompact(pack);
+        msleep(600);
+        REQUIRE( ui->getValue(8) == 20 );
+        REQUIRE( ui->getValue(9) == -20 );
+        REQUIRE( ui->getValue(10) == 1 );
+        REQUIRE( ui->getValue(11) == 0 );
+    }
 }
 // -----------------------------------------------------------------------------
 TEST_CASE("[UNetUDP]: check send mode", "[unetudp][udp][sendmode]")
@@ -486,6 +1088,73 @@ TEST_CASE("[UNetUDP]: check packets 'hole'", "[unetudp][udp][udphole]")
     }
 }
 // -----------------------------------------------------------------------------
+TEST_CASE("[UNetUDP]: delta packets", "[unetudp][udp][delta]")
+{
+    InitTest();
+
+    UniSetUDP::UDPMessage key;
+    key.addAData(8, 40);
+    key.addAData(9, -40);
+    key.addDData(10, false);
+    key.addDData(11, false);
+    sendCompact(key);
+    msleep(120);
+    REQUIRE( ui->getValue(8) == 40 );
+    REQUIRE( ui->getValue(9) == -40 );
+
+    // дельта сразу после первого ключевого пакета применяется
+    UniSetUDP::UDPMessage delta1;
+    delta1.addAData(9, -41);
+    sendCompact(delta1, true);
+    msleep(120);
+    REQUIRE( ui->getValue(9) == -41 );
+
+    // ключевой пакет обрабатывается полностью (crc сброшен дельтой)
+    sendCompact(key);
+    msleep(120);
+    REQUIRE( ui->getValue(9) == -40 );
+
+    UniSetUDP::UDPMessage delta2;
+    delta2.addAData(9, -42);
+    delta2.addDData(11, true);
+    sendCompact(delta2, true);
+    msleep(120);
+    REQUIRE( ui->getValue(8) == 40 );
+    REQUIRE( ui->getValue(9) == -42 );
+    REQUIRE( ui->getValue(11) == 1 );
+
+    // пустая дельта (изменений нет)
+    UniSetUDP::UDPMessage empty;
+    sendCompact(empty, true);
+    msleep(120);
+    REQUIRE( ui->getValue(9) == -42 );
+
+    // потеря пакета: дельты не применяются до следующего ключевого пакета
+    s_numpack++;
+    UniSetUDP::UDPMessage delta3;
+    delta3.addAData(9, -43);
+    sendCompact(delta3, true);
+    msleep(500); // > lostTimeout
+    REQUIRE( ui->getValue(9) == -42 );
+
+    UniSetUDP::UDPMessage delta4;
+    delta4.addAData(8, 44);
+    sendCompact(delta4, true);
+    msleep(120);
+    REQUIRE( ui->getValue(8) == 40 );
+
+    // ключевой пакет восстанавливает состояние (crc совпадает с прошлым ключевым пакетом)
+    sendCompact(key);
+    msleep(120);
+    REQUIRE( ui->getValue(8) == 40 );
+    REQUIRE( ui->getValue(9) == -40 );
+    REQUIRE( ui->getValue(11) == 0 );
+
+    sendCompact(delta3, true);
+    msleep(120);
+    REQUIRE( ui->getValue(9) == -43 );
+}
+// -----------------------------------------------------------------------------
 TEST_CASE("[UNetUDP]: check packets 'MaxDifferens'", "[unetudp][udp][maxdifferens]")
 {
     InitTest();
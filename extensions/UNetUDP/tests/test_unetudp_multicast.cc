@@ -1,6 +1,7 @@
 #include <catch.hpp>
 // -----------------------------------------------------------------------------
 #include <memory>
+#include <vector>
 #include "UniSetTypes.h"
 #include "UInterface.h"
 #include "UDPPacket.h"
@@ -97,18 +98,19 @@ void InitMulticastTest()
 static UniSetUDP::UDPMessage mreceive( unsigned int pnum = 0, timeout_t tout = 2000, int ncycle = 20 )
 {
     UniSetUDP::UDPMessage pack;
+    std::vector<uint8_t> rbuf(sizeof(pack));
 
     while( ncycle > 0 )
     {
         if( !udp_r->isReadyForReceive(tout) )
             break;
 
-        size_t ret = udp_r->receive(&pack, sizeof(pack) );
+        size_t ret = udp_r->receive(rbuf.data(), rbuf.size() );
 
         if( ret <= 0 )
             break;
 
-        pack.ntoh();
+        REQUIRE( pack.deserialize(rbuf.data(), ret) );
 
         if( pnum > 0 && pack.header.num >= pnum ) // -V560
             break;
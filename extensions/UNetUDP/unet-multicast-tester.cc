@@ -6,6 +6,7 @@
 #include <chrono>
 #include <thread>
 #include <iomanip>
+#include <vector>
 #include <Poco/Net/NetException.h>
 #include "UDPPacket.h"
 #include "PassiveTimer.h"
@@ -270,6 +271,7 @@ int main(int argc, char* argv[])
                     udp.setLoopBack(true);
 
                 UniSetUDP::UDPMessage pack;
+                std::vector<uint8_t> rbuf(sizeof(UniSetUDP::UDPMessage));
                 unsigned long prev_num = 1;
 
                 int nc = 1;
@@ -301,7 +303,7 @@ int main(int argc, char* argv[])
                             continue;
                         }
 
-                        size_t ret = udp.receive(&pack, sizeof(UniSetUDP::UDPMessage));
+                        size_t ret = udp.receive(rbuf.data(), rbuf.size());
 
                         if( ret < 0 )
                         {
@@ -315,11 +317,9 @@ int main(int argc, char* argv[])
                             continue;
                         }
 
-                        pack.ntoh();
-
-                        if( pack.header.magic != UniSetUDP::UNETUDP_MAGICNUM )
+                        if( !pack.deserialize(rbuf.data(), ret) )
                         {
-                            cerr << "(recv): BAD PROTOCOL VERSION! [ need version '" << UniSetUDP::UNETUDP_MAGICNUM << "']" << endl;
+                            cerr << "(recv): BAD PROTOCOL VERSION! [ need version '" << UniSetUDP::UNETUDP_MAGICNUM << "' or '" << UniSetUDP::UNETUDP_COMPACT_MAGICNUM << "']" << endl;
                             continue;
                         }
 
@@ -5,6 +5,7 @@
 #include <chrono>
 #include <thread>
 #include <iomanip>
+#include <vector>
 #include <Poco/Net/NetException.h>
 #include "UDPPacket.h"
 #include "PassiveTimer.h"
@@ -222,6 +223,7 @@ int main(int argc, char* argv[])
                 UDPReceiveU udp(s_host, port);
 
                 UniSetUDP::UDPMessage pack;
+                std::vector<uint8_t> rbuf(sizeof(UniSetUDP::UDPMessage));
                 unsigned long prev_num = 1;
 
                 int nc = 1;
@@ -253,7 +255,7 @@ int main(int argc, char* argv[])
                             continue;
                         }
 
-                        size_t ret = udp.receiveBytes(&pack, sizeof(pack));
+                        size_t ret = udp.receiveBytes(rbuf.data(), rbuf.size());
 
                         if( ret < 0 )
                         {
@@ -267,11 +269,9 @@ int main(int argc, char* argv[])
                             continue;
                         }
 
-                        pack.ntoh();
-
-                        if( pack.header.magic != UniSetUDP::UNETUDP_MAGICNUM )
+                        if( !pack.deserialize(rbuf.data(), ret) )
                         {
-                            cerr << "(recv): BAD PROTOCOL VERSION! [ need version '" << UniSetUDP::UNETUDP_MAGICNUM << "']" << endl;
+                            cerr << "(recv): BAD PROTOCOL VERSION! [ need version '" << UniSetUDP::UNETUDP_MAGICNUM << "' or '" << UniSetUDP::UNETUDP_COMPACT_MAGICNUM << "']" << endl;
                             continue;
                         }
 
@@ -37,6 +37,11 @@ namespace uniset
             ~SMInterface();
 
             void setValue ( uniset::ObjectId, long value );
+
+            /*! выставить значения группы датчиков одним вызовом
+             * \return количество датчиков, значения которых выставить не удалось
+             */
+            size_t setValueSeq( const IOController_i::OutSeq& lst );
             void setUndefinedState( const IOController_i::SensorInfo& si, bool undefined, uniset::ObjectId supplier );
 
             long getValue ( uniset::ObjectId id );
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+//--------------------------------------------------------------------------
+// Дисковый журнал для временного хранения данных (при недоступности БД)
+//--------------------------------------------------------------------------
+#ifndef SpillJournal_H_
+#define SpillJournal_H_
+//--------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <cstdint>
+//--------------------------------------------------------------------------
+namespace uniset
+{
+    /*! \class SpillJournal
+     * Журнал (очередь) записей на диске. Предназначен для сохранения данных на время
+     * недоступности (или медленной работы) БД, с последующей "досылкой" после восстановления связи.
+     *
+     * Журнал состоит из сегментов - файлов фиксированного размера (segment-NNNN.jrn) в каталоге dir,
+     * которые отображаются в память (mmap). Запись только добавляется в конец текущего сегмента,
+     * когда место заканчивается создаётся новый сегмент.
+     * Каждая запись снабжена заголовком (длина + CRC32), при открытии журнала (open())
+     * записи проверяются и "оборванный" (испорченный) хвост отбрасывается.
+     *
+     * Чтение: read() возвращает очередные записи начиная с последней подтверждённой позиции,
+     * commit() подтверждает прочитанное (например после успешной записи в БД). Позиция чтения
+     * сохраняется в файле read.pos, поэтому после перезапуска процесса досылка продолжается
+     * с места остановки. Полностью прочитанные сегменты удаляются.
+     *
+     * Размер журнала ограничен maxSegments*segmentSize. При переполнении удаляется самый старый
+     * сегмент, а потерянные (не прочитанные) записи учитываются в getLost().
+     *
+     * Все функции потокобезопасны.
+     *
+     * \code
+     *  SpillJournal j("/var/spool/uniset/dbserver");
+     *  j.open();
+     *  ...
+     *  j.write(rec); // нет связи с БД
+     *  ...
+     *  std::vector<std::string> recs;
+     *  if( j.read(recs, 1000) > 0 && writeToDB(recs) )
+     *      j.commit();
+     * \endcode
+     */
+    class SpillJournal
+    {
+        public:
+            SpillJournal( const std::string& dir, size_t segmentSize = 4 * 1024 * 1024, size_t maxSegments = 64 );
+            ~SpillJournal();
+
+            /*! открыть (создать) журнал, проверить сегменты и восстановить позицию чтения
+             * \throw SystemError в случае ошибки
+             */
+            void open();
+            void close();
+
+            inline bool isOpen() const noexcept
+            {
+                return opened;
+            }
+
+            /*! добавить запись
+             * \return false если запись не помещается в сегмент или произошла ошибка (запись потеряна)
+             */
+            bool write( const char* data, size_t len );
+            bool write( const std::string& s );
+
+            /*! прочитать (добавить в out) не более maxRecords записей начиная с последней подтверждённой позиции
+             * \return количество прочитанных записей
+             */
+            size_t read( std::vector<std::string>& out, size_t maxRecords );
+
+            /*! подтвердить записи полученные последним вызовом read() */
+            void commit();
+
+            /*! сбросить данные на диск (msync) */
+            void sync();
+
+            bool empty() const noexcept;
+            size_t getPending() const noexcept;      // количество не прочитанных (не подтверждённых) записей
+            size_t getPendingBytes() const noexcept; // их размер (без заголовков)
+            size_t getLost() const noexcept;         // потеряно при переполнении
+            size_t getSegments() const noexcept;
+
+            inline std::string getDir() const noexcept
+            {
+                return dir;
+            }
+
+            inline size_t getSegmentSize() const noexcept
+            {
+                return segSize;
+            }
+
+            inline size_t getMaxSegments() const noexcept
+            {
+                return maxSegments;
+            }
+
+            static const size_t HeaderSize = 16;      // заголовок сегмента: magic(4) + version(4) + seq(8)
+            static const size_t RecordHeaderSize = 8; // заголовок записи: len(4) + crc32(4)
+
+            static uint32_t crc32( const void* data, size_t len ) noexcept;
+
+        protected:
+
+            struct Segment
+            {
+                uint64_t seq = { 0 };
+                std::string fname;
+                int fd = { -1 };
+                char* addr = { nullptr };
+                size_t size = { 0 };
+                size_t wpos = { 0 }; // конец записанных данных
+            };
+
+            void createSegment( uint64_t seq );
+            bool loadSegment( Segment& s );
+            void removeFront();
+            void closeSegment( Segment& s ) noexcept;
+            void savePos() noexcept;
+            void loadPos();
+            size_t countRecords( const Segment& s, size_t from, size_t& bytes ) const noexcept;
+            std::string segmentName( uint64_t seq ) const;
+
+        private:
+            std::string dir;
+            size_t segSize;
+            size_t maxSegments;
+            bool opened = { false };
+
+            std::deque<Segment> segs;
+            uint64_t lastSeq = { 0 }; // номер последнего созданного сегмента
+
+            // подтверждённая позиция чтения
+            uint64_t rseq = { 0 };
+            size_t rpos = { 0 };
+
+            // позиция после последнего read() (до commit())
+            bool readValid = { false };
+            uint64_t nseq = { 0 };
+            size_t npos = { 0 };
+            size_t nrecords = { 0 };
+            size_t nbytes = { 0 };
+
+            size_t pending = { 0 };
+            size_t pendingBytes = { 0 };
+            size_t lost = { 0 };
+
+            mutable std::mutex mut;
+    };
+    // -------------------------------------------------------------------------
+} // end of namespace uniset
+// -----------------------------------------------------------------------------
+#endif // SpillJournal_H_
+// -----------------------------------------------------------------------------
@@ -131,6 +131,25 @@ void SMInterface::setValue( uniset::ObjectId id, long value )
     END_FUNC(SMInterface::setValue)
 }
 // --------------------------------------------------------------------------
+size_t SMInterface::setValueSeq( const IOController_i::OutSeq& lst )
+{
+    if( lst.length() == 0 )
+        return 0;
+
+    if( ic )
+    {
+        BEG_FUNC1(SMInterface::setValueSeq)
+        uniset::IDSeq_var badlist = ic->setOutputSeq(lst, myid);
+        return badlist->length();
+        END_FUNC(SMInterface::setValueSeq)
+    }
+
+    BEG_FUNC(SMInterface::setValueSeq)
+    uniset::IDSeq_var badlist = shm->setOutputSeq(lst, myid);
+    return badlist->length();
+    END_FUNC(SMInterface::setValueSeq)
+}
+// --------------------------------------------------------------------------
 long SMInterface::getValue( uniset::ObjectId id )
 {
     if( ic )
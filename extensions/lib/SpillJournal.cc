@@ -0,0 +1,616 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -----------------------------------------------------------------------------
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <sstream>
+#include "Exceptions.h"
+#include "SpillJournal.h"
+// -----------------------------------------------------------------------------
+namespace uniset
+{
+    // -------------------------------------------------------------------------
+    using namespace std;
+    // -------------------------------------------------------------------------
+    const size_t SpillJournal::HeaderSize;
+    const size_t SpillJournal::RecordHeaderSize;
+    // -------------------------------------------------------------------------
+    static const char JournalMagic[4] = { 'U', 'S', 'J', '1' };
+    static const uint32_t JournalVersion = 1;
+    // -------------------------------------------------------------------------
+    static const std::array<uint32_t, 256> crcTable = []()
+    {
+        std::array<uint32_t, 256> t;
+
+        for( uint32_t i = 0; i < 256; i++ )
+        {
+            uint32_t c = i;
+
+            for( int k = 0; k < 8; k++ )
+                c = ( c & 1 ) ? ( 0xEDB88320 ^ (c >> 1) ) : ( c >> 1 );
+
+            t[i] = c;
+        }
+
+        return t;
+    }();
+    // -------------------------------------------------------------------------
+    uint32_t SpillJournal::crc32( const void* data, size_t len ) noexcept
+    {
+        const uint8_t* p = (const uint8_t*)data;
+        uint32_t crc = 0xFFFFFFFF;
+
+        for( size_t i = 0; i < len; i++ )
+            crc = crcTable[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+
+        return crc ^ 0xFFFFFFFF;
+    }
+    // -------------------------------------------------------------------------
+    static void makeDirs( const std::string& dir )
+    {
+        for( size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos + 1) )
+        {
+            const std::string d = dir.substr(0, pos);
+
+            if( !d.empty() && mkdir(d.c_str(), 0755) == -1 && errno != EEXIST )
+            {
+                ostringstream err;
+                err << "(SpillJournal): mkdir '" << d << "' error: " << strerror(errno);
+                throw SystemError(err.str());
+            }
+
+            if( pos == std::string::npos )
+                break;
+        }
+    }
+    // -------------------------------------------------------------------------
+    SpillJournal::SpillJournal( const std::string& _dir, size_t segmentSize, size_t _maxSegments ):
+        dir(_dir),
+        segSize( std::max(segmentSize, (size_t)4096) ),
+        maxSegments( std::max(_maxSegments, (size_t)1) )
+    {
+        while( dir.size() > 1 && dir.back() == '/' )
+            dir.pop_back();
+    }
+    // -------------------------------------------------------------------------
+    SpillJournal::~SpillJournal()
+    {
+        close();
+    }
+    // -------------------------------------------------------------------------
+    std::string SpillJournal::segmentName( uint64_t seq ) const
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "segment-%016llu.jrn", (unsigned long long)seq);
+        return dir + "/" + buf;
+    }
+    // -------------------------------------------------------------------------
+    void SpillJournal::open()
+    {
+        std::lock_guard<std::mutex> l(mut);
+
+        if( opened )
+            return;
+
+        makeDirs(dir);
+
+        DIR* d = opendir(dir.c_str());
+
+        if( !d )
+        {
+            ostringstream err;
+            err << "(SpillJournal): opendir '" << dir << "' error: " << strerror(errno);
+            throw SystemError(err.str());
+        }
+
+        std::vector<uint64_t> found;
+
+        while( struct dirent* e = readdir(d) )
+        {
+            const std::string nm(e->d_name);
+
+            if( nm.size() <= 12 || nm.compare(0, 8, "segment-") != 0 || nm.compare(nm.size() - 4, 4, ".jrn") != 0 )
+                continue;
+
+            const std::string snum = nm.substr(8, nm.size() - 12);
+
+            if( snum.find_first_not_of("0123456789") != std::string::npos )
+                continue;
+
+            found.push_back( std::stoull(snum) );
+        }
+
+        closedir(d);
+        std::sort(found.begin(), found.end());
+
+        segs.clear();
+        lastSeq = 0;
+
+        for( const auto& seq : found )
+        {
+            Segment s;
+            s.seq = seq;
+            s.fname = segmentName(seq);
+
+            if( !loadSegment(s) )
+            {
+                // сегмент с испорченным заголовком не содержит ничего полезного
+                closeSegment(s);
+                unlink(s.fname.c_str());
+                continue;
+            }
+
+            segs.push_back(s);
+            lastSeq = seq;
+        }
+
+        loadPos();
+
+        // удаляем сегменты, прочитанные до перезапуска
+        while( !segs.empty() && segs.front().seq < rseq )
+        {
+            if( segs.size() == 1 )
+            {
+                rseq = segs.front().seq;
+                rpos = segs.front().wpos;
+                break;
+            }
+
+            closeSegment(segs.front());
+            unlink(segs.front().fname.c_str());
+            segs.pop_front();
+        }
+
+        if( segs.empty() )
+        {
+            lastSeq = std::max(lastSeq, rseq);
+            rseq = lastSeq + 1;
+            rpos = HeaderSize;
+        }
+        else if( segs.front().seq != rseq )
+        {
+            rseq = segs.front().seq;
+            rpos = HeaderSize;
+        }
+        else
+        {
+            // проверяем, что позиция попадает на начало записи
+            // (иначе повторяем сегмент целиком: лучше повтор, чем потеря)
+            const Segment& s = segs.front();
+            size_t pos = HeaderSize;
+
+            while( pos < rpos && pos + RecordHeaderSize <= s.wpos )
+            {
+                uint32_t len = 0;
+                memcpy(&len, s.addr + pos, sizeof(len));
+                pos += RecordHeaderSize + len;
+            }
+
+            if( pos != rpos || rpos > s.wpos )
+                rpos = HeaderSize;
+        }
+
+        pending = 0;
+        pendingBytes = 0;
+
+        for( const auto& s : segs )
+        {
+            size_t bytes = 0;
+            pending += countRecords(s, ( s.seq == rseq ? rpos : HeaderSize ), bytes);
+            pendingBytes += bytes;
+        }
+
+        readValid = false;
+        opened = true;
+    }
+    // -------------------------------------------------------------------------
+    void SpillJournal::close()
+    {
+        std::lock_guard<std::mutex> l(mut);
+
+        if( !opened )
+            return;
+
+        savePos();
+
+        for( auto&& s : segs )
+            closeSegment(s);
+
+        segs.clear();
+        readValid = false;
+        opened = false;
+    }
+    // -------------------------------------------------------------------------
+    void SpillJournal::closeSegment( Segment& s ) noexcept
+    {
+        if( s.addr )
+        {
+            munmap(s.addr, s.size);
+            s.addr = nullptr;
+        }
+
+        if( s.fd != -1 )
+        {
+            ::close(s.fd);
+            s.fd = -1;
+        }
+    }
+    // -------------------------------------------------------------------------
+    bool SpillJournal::loadSegment( Segment& s )
+    {
+        s.fd = ::open(s.fname.c_str(), O_RDWR | O_CLOEXEC);
+
+        if( s.fd == -1 )
+            return false;
+
+        struct stat st;
+
+        if( fstat(s.fd, &st) == -1 || (size_t)st.st_size < HeaderSize + RecordHeaderSize )
+            return false;
+
+        s.size = st.st_size;
+        void* a = mmap(nullptr, s.size, PROT_READ | PROT_WRITE, MAP_SHARED, s.fd, 0);
+
+        if( a == MAP_FAILED )
+            return false;
+
+        s.addr = (char*)a;
+
+        uint32_t ver = 0;
+        uint64_t seq = 0;
+        memcpy(&ver, s.addr + 4, sizeof(ver));
+        memcpy(&seq, s.addr + 8, sizeof(seq));
+
+        if( memcmp(s.addr, JournalMagic, sizeof(JournalMagic)) != 0 || ver != JournalVersion || seq != s.seq )
+            return false;
+
+        size_t pos = HeaderSize;
+
+        while( pos + RecordHeaderSize <= s.size )
+        {
+            uint32_t len = 0;
+            uint32_t crc = 0;
+            memcpy(&len, s.addr + pos, sizeof(len));
+            memcpy(&crc, s.addr + pos + 4, sizeof(crc));
+
+            if( len == 0 )
+                break;
+
+            if( len > s.size - pos - RecordHeaderSize || crc32(s.addr + pos + RecordHeaderSize, len) != crc )
+            {
+                // оборванная (не до конца записанная) запись, отбрасываем хвост
+                memset(s.addr + pos, 0, s.size - pos);
+                break;
+            }
+
+            pos += RecordHeaderSize + len;
+        }
+
+        s.wpos = pos;
+        return true;
+    }
+    // -------------------------------------------------------------------------
+    void SpillJournal::createSegment( uint64_t seq )
+    {
+        Segment s;
+        s.seq = seq;
+        s.fname = segmentName(seq);
+        s.size = segSize;
+
+        s.fd = ::open(s.fname.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+        if( s.fd == -1 )
+        {
+            ostringstream err;
+            err << "(SpillJournal): create '" << s.fname << "' error: " << strerror(errno);
+            throw SystemError(err.str());
+        }
+
+        // место на диске выделяем сразу, иначе при его нехватке
+        // запись в отображённую память закончится SIGBUS
+        int ret = posix_fallocate(s.fd, 0, s.size);
+
+        void* a = MAP_FAILED;
+
+        if( ret == 0 )
+        {
+            a = mmap(nullptr, s.size, PROT_READ | PROT_WRITE, MAP_SHARED, s.fd, 0);
+            ret = ( a == MAP_FAILED ) ? errno : 0;
+        }
+
+        if( ret != 0 )
+        {
+            closeSegment(s);
+            unlink(s.fname.c_str());
+            ostringstream err;
+            err << "(SpillJournal): create '" << s.fname << "' error: " << strerror(ret);
+            throw SystemError(err.str());
+        }
+
+        s.addr = (char*)a;
+        memcpy(s.addr, JournalMagic, sizeof(JournalMagic));
+        memcpy(s.addr + 4, &JournalVersion, sizeof(JournalVersion));
+        memcpy(s.addr + 8, &seq, sizeof(seq));
+        s.wpos = HeaderSize;
+
+        if( segs.empty() )
+        {
+            rseq = seq;
+            rpos = HeaderSize;
+        }
+
+        segs.push_back(s);
+        lastSeq = seq;
+    }
+    // -------------------------------------------------------------------------
+    void SpillJournal::removeFront()
+    {
+        Segment& s = segs.front();
+
+        if( s.seq == rseq && rpos < s.wpos )
+        {
+            size_t bytes = 0;
+            size_t n = countRecords(s, rpos, bytes);
+            lost += n;
+            pending -= std::min(pending, n);
+            pendingBytes -= std::min(pendingBytes, bytes);
+        }
+
+        closeSegment(s);
+        unlink(s.fname.c_str());
+        segs.pop_front();
+
+        rseq = segs.empty() ? lastSeq + 1 : segs.front().seq;
+        rpos = HeaderSize;
+
+        // прочитанное, но не подтверждённое могло быть из удалённого сегмента
+        readValid = false;
+        savePos();
+    }
+    // -------------------------------------------------------------------------
+    size_t SpillJournal::countRecords( const Segment& s, size_t from, size_t& bytes ) const noexcept
+    {
+        size_t n = 0;
+        size_t pos = from;
+
+        while( pos + RecordHeaderSize <= s.wpos )
+        {
+            uint32_t len = 0;
+            memcpy(&len, s.addr + pos, sizeof(len));
+            bytes += len;
+            pos += RecordHeaderSize + len;
+            n++;
+        }
+
+        return n;
+    }
+    // -------------------------------------------------------------------------
+    bool SpillJournal::write( const std::string& s )
+    {
+        return write(s.data(), s.size());
+    }
+    // -------------------------------------------------------------------------
+    bool SpillJournal::write( const char* data, size_t len )
+    {
+        std::lock_guard<std::mutex> l(mut);
+
+        if( !opened || HeaderSize + RecordHeaderSize + len > segSize )
+        {
+            lost++;
+            return false;
+        }
+
+        if( segs.empty() || segs.back().wpos + RecordHeaderSize + len > segs.back().size )
+        {
+            try
+            {
+                // единственный сегмент уже полностью прочитан
+                if( segs.size() == 1 && rseq == segs.front().seq && rpos >= segs.front().wpos )
+                {
+                    closeSegment(segs.front());
+                    unlink(segs.front().fname.c_str());
+                    segs.pop_front();
+                    readValid = false;
+                }
+
+                if( segs.size() >= maxSegments )
+                    removeFront();
+
+                createSegment(lastSeq + 1);
+            }
+            catch( const std::exception& )
+            {
+                lost++;
+                return false;
+            }
+        }
+
+        Segment& s = segs.back();
+        char* p = s.addr + s.wpos;
+        uint32_t len32 = len;
+        uint32_t crc = crc32(data, len);
+
+        // длину пишем последней, т.к. по ней определяется конец данных
+        memcpy(p + RecordHeaderSize, data, len);
+        memcpy(p + 4, &crc, sizeof(crc));
+        memcpy(p, &len32, sizeof(len32));
+
+        s.wpos += RecordHeaderSize + len;
+        pending++;
+        pendingBytes += len;
+        return true;
+    }
+    // -------------------------------------------------------------------------
+    size_t SpillJournal::read( std::vector<std::string>& out, size_t maxRecords )
+    {
+        std::lock_guard<std::mutex> l(mut);
+
+        readValid = false;
+        nrecords = 0;
+        nbytes = 0;
+
+        if( !opened || segs.empty() )
+            return 0;
+
+        nseq = rseq;
+        npos = rpos;
+
+        for( auto it = segs.begin(); it != segs.end() && nrecords < maxRecords; ++it )
+        {
+            if( it->seq < rseq )
+                continue;
+
+            size_t pos = ( it->seq == rseq ) ? rpos : HeaderSize;
+
+            while( nrecords < maxRecords && pos + RecordHeaderSize <= it->wpos )
+            {
+                uint32_t len = 0;
+                memcpy(&len, it->addr + pos, sizeof(len));
+                out.emplace_back( it->addr + pos + RecordHeaderSize, len );
+                pos += RecordHeaderSize + len;
+                nbytes += len;
+                nrecords++;
+            }
+
+            nseq = it->seq;
+            npos = pos;
+        }
+
+        readValid = true;
+        return nrecords;
+    }
+    // -------------------------------------------------------------------------
+    void SpillJournal::commit()
+    {
+        std::lock_guard<std::mutex> l(mut);
+
+        if( !opened || !readValid )
+            return;
+
+        readValid = false;
+        rseq = nseq;
+        rpos = npos;
+        pending -= std::min(pending, nrecords);
+        pendingBytes -= std::min(pendingBytes, nbytes);
+
+        // удаляем прочитанные сегменты (кроме текущего, в который идёт запись)
+        while( segs.size() > 1 && ( segs.front().seq < rseq || ( segs.front().seq == rseq && rpos >= segs.front().wpos ) ) )
+        {
+            bool cur = ( segs.front().seq == rseq );
+            closeSegment(segs.front());
+            unlink(segs.front().fname.c_str());
+            segs.pop_front();
+
+            if( cur )
+            {
+                rseq = segs.front().seq;
+                rpos = HeaderSize;
+            }
+        }
+
+        savePos();
+    }
+    // -------------------------------------------------------------------------
+    void SpillJournal::sync()
+    {
+        std::lock_guard<std::mutex> l(mut);
+
+        if( !segs.empty() && segs.back().addr )
+            msync(segs.back().addr, segs.back().size, MS_SYNC);
+    }
+    // -------------------------------------------------------------------------
+    void SpillJournal::savePos() noexcept
+    {
+        const std::string fname = dir + "/read.pos";
+        const std::string tmp = fname + ".tmp";
+
+        {
+            std::ofstream f(tmp, std::ios::trunc);
+
+            if( !f )
+                return;
+
+            f << rseq << " " << rpos << endl;
+
+            if( !f )
+                return;
+        }
+
+        ::rename(tmp.c_str(), fname.c_str());
+    }
+    // -------------------------------------------------------------------------
+    void SpillJournal::loadPos()
+    {
+        rseq = 0;
+        rpos = HeaderSize;
+
+        std::ifstream f(dir + "/read.pos");
+
+        if( !f )
+            return;
+
+        uint64_t seq = 0;
+        size_t pos = 0;
+
+        if( f >> seq >> pos )
+        {
+            rseq = seq;
+            rpos = pos;
+        }
+    }
+    // -------------------------------------------------------------------------
+    bool SpillJournal::empty() const noexcept
+    {
+        std::lock_guard<std::mutex> l(mut);
+        return pending == 0;
+    }
+    // -------------------------------------------------------------------------
+    size_t SpillJournal::getPending() const noexcept
+    {
+        std::lock_guard<std::mutex> l(mut);
+        return pending;
+    }
+    // -------------------------------------------------------------------------
+    size_t SpillJournal::getPendingBytes() const noexcept
+    {
+        std::lock_guard<std::mutex> l(mut);
+        return pendingBytes;
+    }
+    // -------------------------------------------------------------------------
+    size_t SpillJournal::getLost() const noexcept
+    {
+        std::lock_guard<std::mutex> l(mut);
+        return lost;
+    }
+    // -------------------------------------------------------------------------
+    size_t SpillJournal::getSegments() const noexcept
+    {
+        std::lock_guard<std::mutex> l(mut);
+        return segs.size();
+    }
+    // -------------------------------------------------------------------------
+} // end of namespace uniset
+// -----------------------------------------------------------------------------
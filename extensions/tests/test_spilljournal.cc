@@ -0,0 +1,161 @@
+#include <catch.hpp>
+
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include "SpillJournal.h"
+// -----------------------------------------------------------------------------
+using namespace std;
+using namespace uniset;
+// -----------------------------------------------------------------------------
+static std::string makeJournalDir()
+{
+    char tmpl[] = "/tmp/uniset-spilljournal-XXXXXX";
+    REQUIRE( mkdtemp(tmpl) != nullptr );
+    return std::string(tmpl) + "/journal";
+}
+// -----------------------------------------------------------------------------
+static void removeJournalDir( const std::string& dir )
+{
+    std::string cmd = "rm -rf '" + dir.substr(0, dir.rfind('/')) + "'";
+    REQUIRE( system(cmd.c_str()) == 0 );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[SpillJournal]: crc32", "[SpillJournal]")
+{
+    const std::string s("123456789");
+    REQUIRE( SpillJournal::crc32(s.data(), s.size()) == 0xCBF43926 );
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[SpillJournal]: write/read/commit", "[SpillJournal]")
+{
+    auto dir = makeJournalDir();
+
+    SpillJournal j(dir, 4096, 8);
+    j.open();
+    REQUIRE( j.empty() );
+
+    for( int i = 0; i < 1000; i++ )
+        REQUIRE( j.write("record " + std::to_string(i)) );
+
+    REQUIRE( j.getPending() == 1000 );
+    REQUIRE( j.getSegments() > 1 );
+
+    std::vector<std::string> recs;
+    REQUIRE( j.read(recs, 300) == 300 );
+    REQUIRE( recs.front() == "record 0" );
+    REQUIRE( recs.back() == "record 299" );
+
+    // без commit() читаем то же самое
+    recs.clear();
+    REQUIRE( j.read(recs, 300) == 300 );
+    REQUIRE( recs.front() == "record 0" );
+    j.commit();
+    REQUIRE( j.getPending() == 700 );
+
+    recs.clear();
+    REQUIRE( j.read(recs, 10000) == 700 );
+    REQUIRE( recs.front() == "record 300" );
+    REQUIRE( recs.back() == "record 999" );
+    j.commit();
+    REQUIRE( j.empty() );
+    REQUIRE( j.getSegments() == 1 );
+    REQUIRE( j.getLost() == 0 );
+
+    // слишком большая запись
+    REQUIRE_FALSE( j.write(std::string(8192, 'x')) );
+    REQUIRE( j.getLost() == 1 );
+
+    j.close();
+    removeJournalDir(dir);
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[SpillJournal]: restart", "[SpillJournal]")
+{
+    auto dir = makeJournalDir();
+
+    {
+        SpillJournal j(dir, 4096, 8);
+        j.open();
+
+        for( int i = 0; i < 500; i++ )
+            REQUIRE( j.write("record " + std::to_string(i)) );
+
+        std::vector<std::string> recs;
+        REQUIRE( j.read(recs, 100) == 100 );
+        j.commit();
+    }
+
+    SpillJournal j(dir, 4096, 8);
+    j.open();
+    REQUIRE( j.getPending() == 400 );
+
+    std::vector<std::string> recs;
+    REQUIRE( j.read(recs, 1000) == 400 );
+    REQUIRE( recs.front() == "record 100" );
+    REQUIRE( recs.back() == "record 499" );
+
+    j.close();
+    removeJournalDir(dir);
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[SpillJournal]: broken tail", "[SpillJournal]")
+{
+    auto dir = makeJournalDir();
+
+    {
+        SpillJournal j(dir, 4096, 8);
+        j.open();
+
+        for( int i = 0; i < 10; i++ )
+            REQUIRE( j.write("record " + std::to_string(i)) );
+    }
+
+    // портим последнюю запись
+    {
+        std::fstream f(dir + "/segment-0000000000000001.jrn", std::ios::in | std::ios::out | std::ios::binary);
+        REQUIRE( f );
+        size_t pos = SpillJournal::HeaderSize + 9 * (SpillJournal::RecordHeaderSize + 8) + SpillJournal::RecordHeaderSize;
+        f.seekp(pos);
+        f.put('X');
+    }
+
+    SpillJournal j(dir, 4096, 8);
+    j.open();
+    REQUIRE( j.getPending() == 9 );
+
+    // запись продолжается после последней целой записи
+    REQUIRE( j.write("record 10") );
+
+    std::vector<std::string> recs;
+    REQUIRE( j.read(recs, 100) == 10 );
+    REQUIRE( recs[8] == "record 8" );
+    REQUIRE( recs[9] == "record 10" );
+
+    j.close();
+    removeJournalDir(dir);
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("[SpillJournal]: overflow", "[SpillJournal]")
+{
+    auto dir = makeJournalDir();
+
+    SpillJournal j(dir, 4096, 2);
+    j.open();
+
+    for( int i = 0; i < 2000; i++ )
+        j.write("record " + std::to_string(i));
+
+    REQUIRE( j.getSegments() == 2 );
+    REQUIRE( j.getLost() > 0 );
+    REQUIRE( j.getPending() + j.getLost() == 2000 );
+
+    // остаются самые новые записи
+    std::vector<std::string> recs;
+    REQUIRE( j.read(recs, 10000) == j.getPending() );
+    REQUIRE( recs.back() == "record 1999" );
+
+    j.close();
+    removeJournalDir(dir);
+}
+// -----------------------------------------------------------------------------
@@ -19,6 +19,7 @@
 #include <string>
 #include <sigc++/sigc++.h>
 #include <vector>
+#include <ctime>
 #include "Debug.h"
 
 /** DebugStream is a ostream intended for debug output.
@@ -57,6 +58,12 @@
     debug.debug(Debug::type(Debug::INFO | Debug::CRIT)) << "...info/crit...\n";
     debug[Debug::type(Debug::INFO | Debug::CRIT)] << "...info/crit...\n";
 
+    Structured mode (setStructured(true)):
+    date, time and log type are not formatted when a message is written.
+    They are stored as raw values and the complete line is emitted as a Record
+    (see signal_record_event()). The text "date time (type): message" is formatted
+    lazily, only if somebody needs it (screen, log file or signal_stream_event() subscribers).
+    LogServer sends such records to clients in binary form (see LogServerTypes::cmdBinaryMode).
 */
 class DebugStream : public std::ostream
 {
@@ -74,6 +81,47 @@ class DebugStream : public std::ostream
         typedef sigc::signal<void, const std::string&> StreamEvent_Signal;
         StreamEvent_Signal signal_stream_event();
 
+        /*! Record of log (see "structured mode").
+         * If tm == {0,0} then the text is already formatted (normal mode)
+         * and the record is just a piece of text stream.
+         */
+        struct Record
+        {
+            Record( const std::string& lname, const std::string& txt ):
+                logname(lname), text(txt) {}
+
+            Record( const std::string& lname, const std::string& txt, const struct timespec& t, Debug::type l ):
+                logname(lname), text(txt), tm(t), level(l) {}
+
+            inline bool isFormatted() const noexcept
+            {
+                return tm.tv_sec == 0 && tm.tv_nsec == 0;
+            }
+
+            const std::string& logname;
+            const std::string& text;
+            struct timespec tm = { 0, 0 };
+            Debug::type level = { Debug::NONE };
+            const DebugStream* src = { nullptr }; // source stream (if known)
+        };
+
+        typedef sigc::signal<void, const Record&> StreamRecord_Signal;
+        StreamRecord_Signal signal_record_event();
+
+        /*! Format record as text.
+         * Date/time settings of the source stream (r.src) are used if it is known,
+         * otherwise settings of this stream.
+         */
+        std::string formatRecord( const Record& r ) const;
+
+        /// Enable/disable structured mode
+        void setStructured( bool s );
+
+        inline bool isStructured() const noexcept
+        {
+            return structured;
+        }
+
         /// Sets the debug level to t.
         void level(Debug::type t) noexcept
         {
@@ -287,7 +335,12 @@ class DebugStream : public std::ostream
         }
 
     protected:
-        void sbuf_overflow( const std::string& s ) noexcept;
+        virtual void sbuf_overflow( const std::string& s ) noexcept;
+
+        // replace stream buffer (internal buffers are not deleted)
+        void setBuf( std::streambuf* b );
+
+        std::ostream& printRecordHead( std::ostream& os, const struct timespec& tm, Debug::type t ) const;
 
         // private:
         /// The current debug level
@@ -306,8 +359,11 @@ class DebugStream : public std::ostream
         std::string fname = { "" };
 
         StreamEvent_Signal s_stream;
+        StreamRecord_Signal s_record;
         std::string logname = { "" };
 
+        bool structured = { false };
+
         bool isWriteLogFile = { false };
         bool onScreen = { true };
 
@@ -115,6 +115,7 @@ namespace uniset
             // http API
             virtual Poco::JSON::Object::Ptr httpHelp( const Poco::URI::QueryParameters& p ) override;
             virtual Poco::JSON::Object::Ptr httpRequest( const std::string& req, const Poco::URI::QueryParameters& p ) override;
+            virtual bool httpRequestStream( const std::string& req, const Poco::URI::QueryParameters& p, std::ostream& out ) override;
 #endif
 
         public:
@@ -203,6 +204,13 @@ namespace uniset
             virtual Poco::JSON::Object::Ptr request_get( const std::string& req, const Poco::URI::QueryParameters& p );
             virtual Poco::JSON::Object::Ptr request_sensors( const std::string& req, const Poco::URI::QueryParameters& p );
             void getSensorInfo( Poco::JSON::Array::Ptr& jdata, std::shared_ptr<USensorInfo>& s, bool shortInfo = false );
+            Poco::JSON::Object::Ptr makeSensorInfo( const std::shared_ptr<USensorInfo>& s, bool shortInfo = false );
+
+            // потоковая выдача списка датчиков (format=ndjson)
+            void request_sensors_stream( const std::string& req, const Poco::URI::QueryParameters& p, std::ostream& out );
+
+            // начало выборки для 'sensors' (after=ID или offset=N)
+            IOStateList::iterator sensorsBegin( const Poco::URI::QueryParameters& p, size_t& limit );
 #endif
 
             // переопределяем для добавления вызова регистрации датчиков
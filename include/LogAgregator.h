@@ -186,7 +186,16 @@ namespace uniset
             static std::ostream& printLogList( std::ostream& os, std::list<iLog>& lst );
 
         protected:
-            void logOnEvent( const std::string& s );
+            // записи подчинённых логов (текст формируется только если он кому-то нужен)
+            void recordOnEvent( const DebugStream::Record& r );
+
+            // записи вложенного агрегатора: берём только текст записанный прямо в него
+            // (записи его логов приходят напрямую, см. addLogAgregator)
+            void agregatorRecordOnEvent( const DebugStream::Record& r, const LogAgregator* la );
+
+            // агрегатор сам ничего не выводит на экран, а только пересылает текст
+            virtual void sbuf_overflow( const std::string& s ) noexcept override;
+
             void addLog( std::shared_ptr<DebugStream> l, const std::string& lname, bool connect );
             void addLogAgregator( std::shared_ptr<LogAgregator> la, const std::string& lname );
 
@@ -202,6 +211,9 @@ namespace uniset
             // получить список по именам удовлетворяющим регулярному выражению (рекурсивная функция)
             void getListByLogNameWithRule( std::list<iLog>& lst, const std::regex& rule, const std::string& prefix ) const;
 
+            // все вложенные агрегаторы (рекурсивно)
+            void getAgregatorList( std::list<std::shared_ptr<LogAgregator>>& lst ) const;
+
         private:
             typedef std::unordered_map<std::string, std::shared_ptr<DebugStream>> LogMap;
             LogMap lmap;
@@ -21,6 +21,8 @@
 #include <memory>
 #include <queue>
 #include <vector>
+#include <sstream>
+#include <regex>
 #include "UTCPStream.h"
 #include "DebugStream.h"
 #include "LogServerTypes.h"
@@ -41,7 +43,7 @@ namespace uniset
 
                 LogServerTypes::Command cmd = { LogServerTypes::cmdNOP };
                 unsigned int data = {0};
-                std::string logfilter = { "" };
+                std::string logfilter = { "" }; // не длиннее LogServerTypes::lsMessage::MAXLOGNAME (иначе команда не посылается)
             };
 
             void sendCommand( const std::string& addr, int port,
@@ -60,6 +62,28 @@ namespace uniset
             void setReconnectDelay( timeout_t msec );
             void setTextFilter( const std::string& f );
 
+            /*! получать логи в бинарном виде (LogServerTypes::cmdBinaryMode).
+             * Время и уровень форматируются на стороне клиента (см. log()).
+             * Если сервер не поддерживает этот режим, то логи выводятся как обычный текст.
+             */
+            void setBinaryMode( bool s );
+
+            /*! фильтрация на стороне сервера (cmdSetFilter):
+             * текстовый фильтр (setTextFilter) передаётся серверу (если s=true)
+             * и записи отбрасываются ещё до отправки. Локальная фильтрация при этом тоже остаётся
+             * (на случай если сервер не поддерживает команду).
+             * Фильтр длиннее LogServerTypes::lsMessage::MAXLOGNAME серверу не передаётся (выводится предупреждение).
+             */
+            void setServerFilter( bool s );
+
+            /*! маска уровней для фильтра на стороне сервера (Debug::NONE - без фильтра) */
+            void setLevelFilter( Debug::type t );
+
+            /*! запросить сжатие потока (cmdCompressMode).
+             * Если сервер не поддерживает сжатие, то данные принимаются как есть.
+             */
+            void setCompressMode( bool s );
+
             DebugStream::StreamEvent_Signal signal_stream_event();
 
             void setLogLevel( Debug::type t );
@@ -71,7 +95,12 @@ namespace uniset
             void connect( const std::string& addr, int port, timeout_t tout = UniSetTimer::WaitUpTime );
             void disconnect();
             void logOnEvent( const std::string& s );
+            void printText( const char* buf, size_t len, std::ostringstream& line, const std::regex& rule );
+            void printRecords( const char* buf, size_t len, std::ostringstream& line, const std::regex& rule );
+            void printData( const char* buf, size_t len, std::ostringstream& line, const std::regex& rule );
             void sendCommand(LogServerTypes::lsMessage& msg, bool verbose = false );
+            // послать несколько команд одним пакетом (настройка сессии + основная команда)
+            void sendCommand( const std::vector<LogServerTypes::lsMessage>& msgs, bool verbose = false );
 
             timeout_t inTimeout = { 10000 };
             timeout_t outTimeout = { 6000 };
@@ -84,6 +113,13 @@ namespace uniset
             bool cmdonly { false };
             size_t readcount = { 0 }; // количество циклов чтения
             std::string textfilter = { "" };
+            bool binaryMode = { false };
+            bool serverFilter = { false };
+            bool compressMode = { false };
+            LogServerTypes::Decompressor unzip;
+            std::string zbuf; // распакованные данные
+            Debug::type levelFilter = { Debug::NONE };
+            LogServerTypes::RecordReader rreader;
 
             DebugStream rlog;
             std::shared_ptr<DebugStream> outlog; // рабочий лог в который выводиться полученная информация..
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -------------------------------------------------------------------------
+#ifndef LogRing_H_
+#define LogRing_H_
+// -------------------------------------------------------------------------
+#include <string>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+// -------------------------------------------------------------------------
+namespace uniset
+{
+    /*! \class LogRing
+     * Общий (для всех сессий LogServer) циклический буфер записей лога.
+     *
+     * Каждая запись создаётся один раз (std::shared_ptr) и далее только "раздаётся" читателям
+     * без копирования. Читатель (LogSession) хранит у себя только позицию чтения (курсор).
+     * Позиция записи (wpos) монотонно растёт, реальное место в буфере вычисляется как (pos%size).
+     *
+     * Если читатель отстал больше чем на размер буфера, то при очередном чтении
+     * его курсор "перепрыгивает" на самую старую из имеющихся записей, а функция read()
+     * возвращает количество потерянных (затёртых) записей. Таким образом медленный клиент
+     * не приводит к росту потребляемой памяти.
+     *
+     * Писателей может быть много (логи пишутся из разных потоков), читатели работают в event loop.
+     */
+    class LogRing
+    {
+        public:
+            typedef std::shared_ptr<const std::string> Record;
+
+            explicit LogRing( size_t capacity = 10000 );
+
+            /*! поместить запись в буфер (самая старая запись при этом затирается) */
+            void push( const std::string& s );
+
+            /*! прочитать не более maxnum записей начиная с позиции cursor (записи добавляются в конец out).
+             * Курсор сдвигается на количество прочитанных записей.
+             * \return количество потерянных записей (читатель отстал больше чем на размер буфера)
+             */
+            size_t read( uint64_t& cursor, std::vector<Record>& out, size_t maxnum ) const;
+
+            /*! позиция для следующей записи (курсор для "новых" читателей) */
+            uint64_t head() const noexcept;
+
+            /*! количество записей которые ещё не прочитаны с позиции cursor (но не более размера буфера) */
+            size_t pending( uint64_t cursor ) const noexcept;
+
+            size_t capacity() const noexcept;
+
+            // статистика
+            size_t getMinSizeMsg() const noexcept;
+            size_t getMaxSizeMsg() const noexcept;
+
+        private:
+            std::vector<Record> ring;
+            mutable std::mutex mut;
+            uint64_t wpos = { 0 }; // позиция на запись (монотонно растёт)
+
+            size_t minSizeMsg = { 0 }; // минимальная встретившаяся длинна сообщения
+            size_t maxSizeMsg = { 0 }; // максимальная встретившаяся длинна сообщения
+    };
+    // -------------------------------------------------------------------------
+} // end of uniset namespace
+// -------------------------------------------------------------------------
+#endif // LogRing_H_
+// -------------------------------------------------------------------------
@@ -29,6 +29,7 @@
 #include "UTCPSocket.h"
 #include "CommonEventLoop.h"
 #include "LogServerTypes.h"
+#include "LogRing.h"
 
 #ifndef DISABLE_REST_API
 #include <Poco/JSON/Object.h>
@@ -87,6 +88,19 @@ namespace uniset
 
     \warning Т.к. LogServer в основном только отдаёт "клиентам" логи, то он реализован с использованием CommonEventLoop,
     т.е. у всех LogServer будет ОДИН ОБЩИЙ event loop.
+
+    Сообщения лога не копируются для каждой сессии. LogServer (пока есть хотя бы одна сессия) сам
+    подключается к логу и складывает записи в общий циклический буфер (LogRing), а сессии хранят только
+    свою позицию чтения в нём и отправляют данные через writev() прямо из общих буферов.
+    Если клиент не успевает читать, он "перепрыгивает" вперёд и получает сообщение о количестве потерянных записей.
+    Размер буфера (количество записей) задаётся setBufferSize() или параметром --prefix-buffer-size.
+
+    Клиент может запросить бинарный режим (LogServerTypes::cmdBinaryMode). Тогда записи передаются
+    в виде LogServerTypes::lsRecord (время и уровень "как есть"), а форматирование делается на стороне клиента.
+    Для таких сессий используется второй общий буфер уже закодированных записей. К текстовому потоку
+    и потоку записей LogServer подключается только пока есть сессии соответствующего типа.
+    Максимальный выигрыш получается если логи работают в структурированном режиме (DebugStream::setStructured()),
+    тогда на стороне процесса текст "дата время (уровень)" вообще не формируется.
     */
     // -------------------------------------------------------------------------
     class LogServer:
@@ -102,6 +116,10 @@ namespace uniset
             void setSessionLog( Debug::type t ) noexcept;
             void setMaxSessionCount( size_t num ) noexcept;
 
+            //! Установить размер общего буфера (количество записей. Не в байтах!!)
+            //! \warning действует только до запуска первой сессии
+            void setBufferSize( size_t num ) noexcept;
+
             bool async_run( const std::string& addr, Poco::UInt16 port );
             bool run( const std::string& addr, Poco::UInt16 port );
 
@@ -129,6 +147,10 @@ namespace uniset
             virtual std::string wname() const noexcept override;
 
             void ioAccept( ev::io& watcher, int revents );
+            void onLogEvent( ev::async& watcher, int revents );
+            void logOnEvent( const std::string& s ) noexcept;
+            void recordOnEvent( const DebugStream::Record& r ) noexcept;
+            void updateConnections();
             void sessionFinished( LogSession* s );
             void saveDefaultLogLevels( const std::string& logname );
             void restoreDefaultLogLevels( const std::string& logname );
@@ -139,6 +161,7 @@ namespace uniset
             timeout_t cmdTimeout = { 2000 };
             Debug::type sessLogLevel = { Debug::NONE };
             size_t sessMaxCount = { 10 };
+            size_t bufSize = { 10000 };
 
             typedef std::vector< std::shared_ptr<LogSession> > SessionList;
             SessionList slist;
@@ -146,6 +169,12 @@ namespace uniset
 
             DebugStream mylog;
             ev::io io;
+            ev::async asyncEvent; // уведомление сессий о новых записях в ring
+
+            std::shared_ptr<LogRing> ring;
+            sigc::connection logConn;
+            std::shared_ptr<LogRing> bring; // буфер бинарных записей (для сессий в режиме cmdBinaryMode)
+            sigc::connection recConn;
 
             // делаем loop общим.. одним на всех!
             static CommonEventLoop loop;
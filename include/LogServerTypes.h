@@ -20,6 +20,9 @@
 #include <ostream>
 #include <cstring>
 #include <vector>
+#include <string>
+#include <ctime>
+#include "DebugStream.h"
 // -------------------------------------------------------------------------
 namespace uniset
 {
@@ -50,7 +53,10 @@ namespace uniset
 
             // другие команды
             cmdShowLocalTime,    /*!< выводить локальное время */
-            cmdShowUTCTime   /*!< выводить UTC время (по умолчанию) */
+            cmdShowUTCTime,   /*!< выводить UTC время (по умолчанию) */
+            cmdBinaryMode,   /*!< получать логи в виде бинарных записей (lsRecord), а не текстом */
+            cmdSetFilter,    /*!< фильтр сессии: data - маска уровней (0 - все), logname - regexp для текста (пустой - любой) */
+            cmdCompressMode  /*!< сжимать поток (data - алгоритм CompressType) */
         };
 
         std::ostream& operator<<(std::ostream& os, Command c );
@@ -87,6 +93,145 @@ namespace uniset
          * 'logfilter' - regexp for name of log. Default: ALL logs
          */
         std::vector<lsMessage> getCommands( const std::string& cmd );
+
+        // -------------------------------------------------------------------------
+        /*! Бинарный режим (cmdBinaryMode).
+         * Каждая запись передаётся в виде заголовка lsRecord, за которым следует
+         * имя лога (namelen байт) и текст (textlen байт).
+         * Дата, время и уровень передаются "как есть" и форматируются на стороне клиента.
+         * Имя лога передаётся в каждой записи, т.к. при переполнении буфера сервер
+         * может пропускать записи (поэтому отдельный "словарь" имён мог бы потеряться).
+         */
+        const uint32_t RECORDMAGIC = 20201223;
+        const size_t MAXRECORDTEXT = 1024 * 1024; // ограничение на длину текста одной записи
+
+        enum RecordType
+        {
+            rtText = 0,  /*!< уже отформатированный текст (ответы на команды, служебные сообщения) */
+            rtRecord = 1 /*!< запись лога (время и уровень не отформатированы) */
+        };
+
+        struct lsRecord
+        {
+            uint32_t magic;
+            uint8_t _be_order; // 1 - BE byte order, 0 - LE byte order
+            uint8_t type;      // RecordType
+            uint8_t namelen;
+            uint32_t level;
+            uint64_t sec;
+            uint32_t nsec;
+            uint32_t textlen;
+
+            void convertFromNet() noexcept;
+        } __attribute__((packed));
+
+        /*! добавить в конец buf запись лога в бинарном виде */
+        void encodeRecord( std::string& buf, const DebugStream::Record& r );
+
+        /*! добавить в конец buf уже отформатированный текст (rtText) в бинарном виде */
+        void encodeText( std::string& buf, const std::string& text );
+
+        /*! Разбор потока бинарных записей.
+         * Данные добавляются по мере чтения из сокета (add), записи извлекаются функцией next().
+         * Если поток не начинается с RECORDMAGIC (например сервер старой версии не поддерживает cmdBinaryMode),
+         * то далее все данные считаются обычным текстом (rtText).
+         */
+        class RecordReader
+        {
+            public:
+
+                struct Data
+                {
+                    RecordType type = { rtText };
+                    std::string logname;
+                    std::string text;
+                    struct timespec tm = { 0, 0 };
+                    Debug::type level = { Debug::NONE };
+                };
+
+                void add( const char* buf, size_t len );
+
+                /*! \return false - если нет (полностью полученных) записей */
+                bool next( Data& d );
+
+                void reset() noexcept;
+
+                inline bool isTextStream() const noexcept
+                {
+                    return textStream;
+                }
+
+            private:
+                std::string buf;
+                size_t rpos = { 0 };
+                bool textStream = { false };
+        };
+
+        // -------------------------------------------------------------------------
+        /*! Сжатие потока (cmdCompressMode).
+         * Сервер накапливает пачку записей (как есть: текст или бинарные записи) и отправляет её
+         * одним блоком: заголовок lsCompressHeader + данные. Блоки сжимаются независимо друг от друга.
+         * Маленькие блоки (и блоки которые не удалось сжать) передаются без сжатия (ctNone).
+         * Если клиент запросил сжатие, а сервер его не поддерживает, то поток остаётся обычным
+         * (Decompressor это определяет по отсутствию COMPRESSMAGIC в начале потока).
+         */
+        const uint32_t COMPRESSMAGIC = 20201224;
+        const size_t MAXCOMPRESSBLOCK = 4 * 1024 * 1024; // ограничение на размер блока
+
+        enum CompressType
+        {
+            ctNone = 0, /*!< без сжатия */
+            ctLZ4 = 1   /*!< LZ4 (block format) */
+        };
+
+        /*! поддерживается ли сжатие (собрано ли с поддержкой lz4) */
+        bool isCompressSupported( CompressType t ) noexcept;
+
+        struct lsCompressHeader
+        {
+            uint32_t magic;
+            uint8_t _be_order; // 1 - BE byte order, 0 - LE byte order
+            uint8_t type;      // CompressType
+            uint32_t rawlen;   // размер исходных данных
+            uint32_t len;      // размер данных блока
+
+            void convertFromNet() noexcept;
+        } __attribute__((packed));
+
+        /*! добавить в конец out блок с данными data (сжатыми по возможности) */
+        void compress( std::string& out, const char* data, size_t len, CompressType t );
+
+        /*! Разбор сжатого потока.
+         * Данные добавляются по мере чтения из сокета (add), распакованные данные
+         * добавляются в конец out функцией read().
+         */
+        class Decompressor
+        {
+            public:
+
+                void add( const char* buf, size_t len );
+
+                /*! \return количество байт добавленных в out */
+                size_t read( std::string& out );
+
+                void reset() noexcept;
+
+                inline bool isPlainStream() const noexcept
+                {
+                    return plainStream;
+                }
+
+                inline bool isError() const noexcept
+                {
+                    return error;
+                }
+
+            private:
+                std::string buf;
+                size_t rpos = { 0 };
+                bool plainStream = { false };
+                bool error = { false };
+        };
     }
     // -------------------------------------------------------------------------
 } // end of uniset namespace
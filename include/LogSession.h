@@ -20,6 +20,10 @@
 #include <string>
 #include <memory>
 #include <queue>
+#include <deque>
+#include <vector>
+#include <regex>
+#include <unordered_map>
 #include <ev++.h>
 #include "Poco/Net/StreamSocket.h"
 #include "Mutex.h"
@@ -27,6 +31,7 @@
 #include "UTCPCore.h"
 #include "UTCPStream.h"
 #include "LogAgregator.h"
+#include "LogRing.h"
 #ifndef DISABLE_REST_API
 #include <Poco/JSON/Object.h>
 #endif
@@ -34,12 +39,35 @@
 namespace uniset
 {
 
-    /*! Реализация "сессии" для клиентов LogServer. */
+    /*! Реализация "сессии" для клиентов LogServer.
+     *
+     * Сессия не хранит у себя копий сообщений. Записи лога читаются из общего для всех сессий
+     * циклического буфера (LogRing), сессия хранит только свою позицию чтения.
+     * Отправка делается при помощи writev() сразу из общих буферов.
+     * Если ring не задан (или включён режим cmdFilterMode), сессия заводит свой собственный буфер.
+     *
+     * По команде cmdBinaryMode сессия переходит на передачу бинарных записей (LogServerTypes::lsRecord).
+     * Для этого используется второй общий буфер (bring), в который LogServer кладёт уже закодированные записи.
+     * Ответы на команды и служебные сообщения в этом режиме тоже передаются как записи (rtText).
+     *
+     * Фильтр сессии (cmdSetFilter): маска уровней и регулярное выражение для текста.
+     * Фильтр компилируется один раз при получении команды и применяется к записям
+     * ещё до помещения в буфер сессии (в потоке пишущем в лог). Поэтому сессия с фильтром
+     * работает с собственным буфером и подключается к записям логов (signal_record_event).
+     * Маска уровней применима только к структурированным логам (DebugStream::setStructured),
+     * у обычных логов уровень записи неизвестен и проверяется только текст (целыми строками).
+     *
+     * Сжатие (cmdCompressMode): пачка записей подготовленная для отправки склеивается
+     * и отправляется одним сжатым блоком (см. LogServerTypes::compress).
+     */
     class LogSession
     {
         public:
 
-            LogSession( const Poco::Net::StreamSocket& s, std::shared_ptr<DebugStream>& log, timeout_t cmdTimeout = 2000, timeout_t checkConnectionTime = 10000 );
+            LogSession( const Poco::Net::StreamSocket& s, std::shared_ptr<DebugStream>& log,
+                        std::shared_ptr<LogRing> ring = nullptr,
+                        std::shared_ptr<LogRing> bring = nullptr,
+                        timeout_t cmdTimeout = 2000, timeout_t checkConnectionTime = 10000 );
             ~LogSession();
 
             typedef sigc::slot<void, LogSession*> FinalSlot;
@@ -59,7 +87,8 @@ namespace uniset
             void addSessionLogLevel( Debug::type t ) noexcept;
             void delSessionLogLevel( Debug::type t ) noexcept;
 
-            //! Установить размер буфера для сообщений (количество записей. Не в байтах!!)
+            //! Установить размер собственного буфера сессии (количество записей. Не в байтах!!)
+            //! используется только если сессия не работает с общим буфером (см. cmdFilterMode)
             void setMaxBufSize( size_t num );
             size_t getMaxBufSize() const noexcept;
 
@@ -67,8 +96,18 @@ namespace uniset
             void run( const ev::loop_ref& loop ) noexcept;
             void terminate();
 
+            // уведомление о появлении новых записей в общем буфере
+            // \warning вызывается только из потока event loop
+            void wakeup() noexcept;
+
             bool isAcive() const noexcept;
 
+            // сессия работает в бинарном режиме (cmdBinaryMode)
+            bool isBinaryMode() const noexcept;
+
+            // сессия читает из общего буфера (а не из собственного)
+            bool isSharedRing() const noexcept;
+
             std::string name() const noexcept;
 
             std::string getShortInfo() noexcept;
@@ -84,13 +123,28 @@ namespace uniset
             void callback( ev::io& watcher, int revents ) noexcept;
             void readEvent( ev::io& watcher ) noexcept;
             void writeEvent( ev::io& watcher );
+            void fillWriteBuffer();
+            bool hasPendingData() noexcept;
             size_t readData( unsigned char* buf, int len );
+            void startOutput() noexcept;
             void cmdProcessing( const std::string& cmdLogName, const LogServerTypes::lsMessage& msg );
             void onCmdTimeout( ev::timer& watcher, int revents ) noexcept;
             void onCheckConnectionTimer( ev::timer& watcher, int revents ) noexcept;
             void final() noexcept;
 
             void logOnEvent( const std::string& s ) noexcept;
+            void recordOnEvent( const DebugStream::Record& r ) noexcept;
+
+            // подключиться к логу (для работы с собственным буфером)
+            void connectLog( const std::shared_ptr<DebugStream>& l );
+            void disconnectLogs() noexcept;
+            void setBinaryMode();
+
+            // фильтр сессии (см. cmdSetFilter)
+            void setFilter( Debug::type levels, const std::string& regexp );
+            void pushRecord( const DebugStream::Record& r );
+
+            void compressWriteBuffer();
 
             timeout_t cmdTimeout = { 2000 };
             double checkConnectionTime = { 10. }; // время на проверку живости соединения..(сек)
@@ -98,28 +152,62 @@ namespace uniset
             // Т.к. сообщений может быть ОЧЕНЬ МНОГО.. сеть медленная
             // очередь будет не успевать рассасываться,
             // то потенциально может "скушаться" вся память.
-            // Поэтому приходиться ограничить доступное количество записей.
-            // Рассчитываем, что средний размер одного сообщения 150 символов (байт)
-            // тогда выделяем буфер на 200 сообщений (~ 30кB)
-            // На самом деле сообщения могут быть совершенно разные..
-            size_t maxRecordsNum = { 30000 }; // максимальное количество сообщение в очереди
+            // Поэтому размер собственного буфера сессии ограничен (количество записей).
+            // Медленный клиент не увеличивает потребление памяти, а просто
+            // "перепрыгивает" вперёд с пометкой о потерянных сообщениях.
+            size_t maxRecordsNum = { 30000 }; // размер собственного буфера сессии
+
+            // максимальное количество записей отправляемых за один вызов writev()
+            static const size_t maxWriteBatch = 64;
 
         private:
-            std::queue<UTCPCore::Buffer*> logbuf;
+            // ответы на команды и служебные сообщения (отправляются вперёд записей лога)
+            std::queue<LogRing::Record> logbuf;
             std::mutex logbuf_mutex;
-            bool lostMsg = { false };
+
+            // буфер читается из потоков пишущих в лог, а меняется в потоке сессии,
+            // поэтому после создания сессии доступ к нему только через atomic_load/atomic_store
+            std::shared_ptr<LogRing> ring;
+            uint64_t rpos = { 0 }; // позиция чтения в ring
+            std::shared_ptr<LogRing> bring; // общий буфер бинарных записей
+            bool ownRing = { false }; // сессия работает с собственным буфером
+            std::atomic_bool binaryMode = { false };
+
+            struct Filter
+            {
+                Debug::type levels = { Debug::NONE }; // NONE - все уровни
+                bool useRegexp = { false };
+                std::regex re;
+
+                bool check( Debug::type t, const std::string& txt ) const;
+            };
+
+            // фильтр читается из потоков пишущих в лог, поэтому меняется только целиком (atomic_store)
+            std::shared_ptr<const Filter> filter;
+            std::unordered_map<std::string, std::string> partLines; // недописанные строки логов (для фильтрации по тексту)
+            std::mutex partMutex;
+            std::atomic<size_t> numFiltered = { 0 }; // количество отброшенных фильтром записей
+
+            LogServerTypes::CompressType compressType = { LogServerTypes::ctNone };
+            std::string zbuf; // буфер для склейки записей перед сжатием
+            size_t rawBytes = { 0 }; // статистика: объём данных до сжатия
+            size_t zipBytes = { 0 }; // статистика: объём данных после сжатия
+
+            std::deque<LogRing::Record> wbuf; // записи в процессе отправки
+            size_t wpos = { 0 }; // сколько байт первой записи из wbuf уже отправлено
+            std::vector<LogRing::Record> rbuf; // временный буфер для чтения из ring
+            std::string cmdbuf; // принятые, но ещё не разобранные команды (сообщение может прийти по частям)
 
             // статистика по использованию буфера
-            size_t maxCount = { 0 }; // максимальное количество побывавшее в очереди
-            size_t minSizeMsg = { 0 }; // минимальная встретившаяся длинна сообщения
-            size_t maxSizeMsg = { 0 }; // максимальная встретившаяся длинна сообщения
+            size_t maxCount = { 0 }; // максимальное отставание от писателя (количество записей)
             size_t numLostMsg = { 0 }; // количество потерянных сообщений
 
             std::string peername = { "" };
             std::string caddr = { "" };
             std::shared_ptr<DebugStream> log;
             std::shared_ptr<LogAgregator> alog;
-            sigc::connection conn;
+            std::vector<sigc::connection> conns; // подключения к логам (если у сессии свой буфер)
+            std::vector<std::shared_ptr<DebugStream>> clogs; // логи к которым подключена сессия
 
             std::shared_ptr<UTCPStream> sock;
 
@@ -42,6 +42,12 @@
  * - /api/version/ObjectName        - получение информации об объекте ObjectName
  * - /api/version/ObjectName/help   - получение списка доступных команд для объекта ObjectName
  * - /api/version/ObjectName/xxxx   - 'xxx' запрос к объекту ObjectName
+ *
+ * Для запросов возвращающих большие списки объект может поддерживать потоковую выдачу
+ * (параметр \b format=ndjson): ответ передаётся частями (chunked transfer encoding),
+ * по одному json-объекту в строке (NDJSON), без формирования всего ответа в памяти.
+ * Если объект не поддерживает потоковую выдачу для запроса, возвращается обычный json (одной строкой).
+ * См. IHttpRequest::httpRequestStream()
  *\code
  *  HELP FORMAT:
  *  myname {
@@ -90,6 +96,9 @@ namespace uniset
         // текущая версия API
         const std::string UHTTP_API_VERSION = "v01";
 
+        /*! запрошена потоковая выдача (format=ndjson) */
+        bool isNDJSON( const Poco::URI::QueryParameters& p );
+
         /*! интерфейс для объекта выдающего json-данные */
         class IHttpRequest
         {
@@ -103,6 +112,13 @@ namespace uniset
 
                 // не обязательная функция.
                 virtual Poco::JSON::Object::Ptr httpRequest( const std::string& req, const Poco::URI::QueryParameters& p );
+
+                /*! Потоковая выдача (format=ndjson): по одному json-объекту в строке.
+                 * Не обязательная функция.
+                 * \return false - запрос не поддерживает потоковую выдачу (в out ничего не записано)
+                 * throw SystemError
+                 */
+                virtual bool httpRequestStream( const std::string& req, const Poco::URI::QueryParameters& p, std::ostream& out );
         };
         // -------------------------------------------------------------------------
         /*! интерфейс для обработки запросов к объектам */
@@ -119,6 +135,10 @@ namespace uniset
                 virtual Poco::JSON::Array::Ptr httpGetObjectsList( const Poco::URI::QueryParameters& p ) = 0;
                 virtual Poco::JSON::Object::Ptr httpHelpByName( const std::string& name, const Poco::URI::QueryParameters& p ) = 0;
                 virtual Poco::JSON::Object::Ptr httpRequestByName( const std::string& name, const std::string& req, const Poco::URI::QueryParameters& p ) = 0;
+
+                // throw SystemError, NameNotFound
+                // \return false - потоковая выдача не поддерживается (см. IHttpRequest::httpRequestStream)
+                virtual bool httpRequestStreamByName( const std::string& name, const std::string& req, const Poco::URI::QueryParameters& p, std::ostream& out );
         };
 
         // -------------------------------------------------------------------------
@@ -106,6 +106,7 @@ namespace uniset
             virtual Poco::JSON::Array::Ptr httpGetObjectsList( const Poco::URI::QueryParameters& p ) override;
             virtual Poco::JSON::Object::Ptr httpHelpByName( const std::string& name, const Poco::URI::QueryParameters& p ) override;
             virtual Poco::JSON::Object::Ptr httpRequestByName( const std::string& name, const std::string& req, const Poco::URI::QueryParameters& p ) override;
+            virtual bool httpRequestStreamByName( const std::string& name, const std::string& req, const Poco::URI::QueryParameters& p, std::ostream& out ) override;
 #endif
 
         protected:
@@ -102,8 +102,19 @@ namespace uniset
 		const std::string objectName(seg[2]);
 		auto qp = uri.getQueryParameters();
 
+		// потоковая выдача возможна только для запросов к объекту
+		const bool ndjson = ( seg.size() >= 4 && seg[3] != "help" && isNDJSON(qp) );
+
 		resp.setStatus(HTTPResponse::HTTP_OK);
-		resp.setContentType("text/json");
+
+		if( ndjson )
+		{
+			resp.setContentType("application/x-ndjson");
+			resp.setChunkedTransferEncoding(true);
+		}
+		else
+			resp.setContentType("text/json");
+
 		std::ostream& out = resp.send();
 
 		try
@@ -128,6 +139,15 @@ namespace uniset
 				auto json = registry->httpHelpByName(objectName, qp);
 				json->stringify(out);
 			}
+			else if( ndjson ) // /api/version/ObjectName/xxx?format=ndjson
+			{
+				if( !registry->httpRequestStreamByName(objectName, seg[3], qp, out) )
+				{
+					auto json = registry->httpRequestByName(objectName, seg[3], qp);
+					json->stringify(out);
+					out << endl;
+				}
+			}
 			else if( seg.size() >= 4 ) // /api/version/ObjectName/xxx..
 			{
 				auto json = registry->httpRequestByName(objectName, seg[3], qp);
@@ -153,6 +173,11 @@ namespace uniset
 			jdata.set("error", err.str());
 			jdata.set("ecode", (int)resp.getStatus());
 			jdata.stringify(out);
+
+			// при потоковой выдаче заголовок уже отправлен,
+			// ошибка передаётся последней строкой
+			if( ndjson )
+				out << endl;
 		}
 
 		out.flush();
@@ -182,6 +207,27 @@ namespace uniset
 		throw uniset::SystemError(err.str());
 	}
 	// -------------------------------------------------------------------------
+	bool IHttpRequest::httpRequestStream( const string& req, const Poco::URI::QueryParameters& p, std::ostream& out )
+	{
+		return false;
+	}
+	// -------------------------------------------------------------------------
+	bool IHttpRequestRegistry::httpRequestStreamByName( const string& name, const string& req, const Poco::URI::QueryParameters& p, std::ostream& out )
+	{
+		return false;
+	}
+	// -------------------------------------------------------------------------
+	bool UHttp::isNDJSON( const Poco::URI::QueryParameters& p )
+	{
+		for( const auto& i : p )
+		{
+			if( i.first == "format" )
+				return ( i.second == "ndjson" );
+		}
+
+		return false;
+	}
+	// -------------------------------------------------------------------------
 } // end of namespace uniset
 // -------------------------------------------------------------------------
 #endif
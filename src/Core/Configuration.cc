@@ -66,6 +66,7 @@ std::string uniset::Configuration::help()
     print_help(os, 25, "--ulog-show-microseconds", "Выводить время с микросекундами\n");
     print_help(os, 25, "--ulog-show-milliseconds", "Выводить время с миллисекундами\n");
     print_help(os, 25, "--ulog-show-localtime", "Выводить локальное время. По умолчанию UTC.\n");
+    print_help(os, 25, "--ulog-structured", "Структурированный режим (время и уровень форматируются только при необходимости)\n");
     print_help(os, 25, "--ulog-no-debug", "отключение логов\n");
     print_help(os, 25, "--ulog-logfile", "перенаправление лога в файл\n");
     print_help(os, 25, "--ulog-levels N", "уровень 'говорливости' логов");
@@ -1066,6 +1067,9 @@ namespace uniset
 
             if( getPIntProp(dnode, "showLocalTime", 0) != 0 )
                 deb->showLocalTime(true);
+
+            if( getPIntProp(dnode, "structured", 0) != 0 )
+                deb->setStructured(true);
         }
 
         // теперь смотрим командную строку
@@ -1076,6 +1080,7 @@ namespace uniset
         const string show_usec("--" + debname + "-show-microseconds");
         const string verb_level("--" + debname + "-verbosity");
         const string show_localtime("--" + debname + "-show-localtime");
+        const string structured("--" + debname + "-structured");
 
         // смотрим командную строку
         for (int i = 1; i < (_argc - 1); i++)
@@ -1108,6 +1113,10 @@ namespace uniset
             {
                 deb->showLocalTime(uniset::uni_atoi(_argv[i + 1]));
             }
+            else if( structured == _argv[i] )
+            {
+                deb->setStructured(true);
+            }
         }
 
         if( !debug_file.empty() )
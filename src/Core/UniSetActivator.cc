@@ -465,6 +465,24 @@ namespace uniset
         throw uniset::NameNotFound(err.str());
     }
     // ------------------------------------------------------------------------------------------
+    bool UniSetActivator::httpRequestStreamByName( const string& name, const std::string& req, const Poco::URI::QueryParameters& p, std::ostream& out )
+    {
+        if( name == myname )
+            return httpRequestStream(req, p, out);
+
+        if( name == "configure" )
+            return false;
+
+        auto obj = deepFindObject(name);
+
+        if( obj )
+            return obj->httpRequestStream(req, p, out);
+
+        ostringstream err;
+        err << "Object '" << name << "' not found";
+        throw uniset::NameNotFound(err.str());
+    }
+    // ------------------------------------------------------------------------------------------
 #endif // #ifndef DISABLE_REST_API
     // ------------------------------------------------------------------------------------------
 } // end of namespace uniset
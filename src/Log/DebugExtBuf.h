@@ -33,6 +33,7 @@
 #include <iomanip>
 #include <time.h>
 #include <iomanip>
+#include <cstring>
 
 using std::ostream;
 using std::streambuf;
@@ -286,6 +287,12 @@ class stringsigbuf : public streambuf
 			return s_overflow;
 		}
 
+		// line mode: the signal is emitted only for complete lines (ended with '\n')
+		inline void setLineMode( bool s )
+		{
+			lineMode = s;
+		}
+
 	protected:
 #ifdef MODERN_STL_STREAMS
 		///
@@ -300,6 +307,10 @@ class stringsigbuf : public streambuf
 		{
 			uniset::uniset_rwmutex_wrlock l(mut);
 			streamsize r = sb->sputn(p, n);
+
+			if( lineMode && std::memchr(p, '\n', n) == nullptr )
+				return r;
+
 			s_overflow.emit( sb->str() );
 			sb->str("");
 			return r;
@@ -351,6 +362,7 @@ class stringsigbuf : public streambuf
 		StrBufOverflow_Signal s_overflow;
 		stringbuf* sb;
 		uniset::uniset_rwmutex mut;
+		bool lineMode = { false };
 };
 //--------------------------------------------------------------------------
 /// So that public parts of DebugStream does not need to know about filebuf
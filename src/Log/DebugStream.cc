@@ -30,6 +30,21 @@ using std::stringbuf;
 using std::cerr;
 using std::ios;
 //--------------------------------------------------------------------------
+// time and level of the current record (structured mode).
+// The stream is shared by several threads, so they are kept per thread:
+// sbuf_overflow() is called by the same thread that started the record in debug().
+namespace
+{
+	struct RecordInfo
+	{
+		const DebugStream* owner = { nullptr };
+		struct timespec tm = { 0, 0 };
+		Debug::type level = { Debug::NONE };
+	};
+
+	thread_local RecordInfo recInfo;
+}
+//--------------------------------------------------------------------------
 /// Constructor, sets the debug level to t.
 DebugStream::DebugStream(Debug::type t, Debug::verbosity v)
 	: /* ostream(new debugbuf(cerr.rdbuf())),*/
@@ -67,15 +82,63 @@ void DebugStream::sbuf_overflow( const std::string& s ) noexcept
 {
 	try
 	{
-		s_stream.emit(s);
+		if( !structured )
+		{
+			s_stream.emit(s);
+
+			if( !s_record.empty() )
+				s_record.emit( Record(logname, s) );
+
+			return;
+		}
+
+		// the record was not started by debug() of this stream in this thread
+		if( recInfo.owner != this )
+		{
+			recInfo.owner = this;
+			recInfo.tm = uniset::now_to_timespec();
+			recInfo.level = Debug::NONE;
+		}
+
+		Record r(logname, s, recInfo.tm, recInfo.level);
+		r.src = this;
+
+		if( !s_record.empty() )
+			s_record.emit(r);
+
+		// the text is formatted only if somebody needs it
+		if( !onScreen && !isWriteLogFile && s_stream.empty() )
+			return;
+
+		const std::string txt( formatRecord(r) );
+
+		if( onScreen )
+			cerr.rdbuf()->sputn(txt.data(), txt.size());
+
+		if( isWriteLogFile )
+		{
+			internal->fbuf.sputn(txt.data(), txt.size());
+			internal->fbuf.pubsync();
+		}
+
+		s_stream.emit(txt);
 	}
 	catch(...) {}
 }
 //--------------------------------------------------------------------------
+void DebugStream::setBuf( std::streambuf* b )
+{
+	std::streambuf* old = rdbuf(b);
+
+	// internal buffers must not be deleted
+	if( old && old != b && old != &internal->sbuf )
+		delete old;
+}
+//--------------------------------------------------------------------------
 DebugStream::~DebugStream()
 {
 	delete nullstream.rdbuf(0); // Without this we leak
-	delete rdbuf(0);            // Without this we leak
+	setBuf(0);                  // Without this we leak
 	delete internal;
 }
 
@@ -123,27 +186,50 @@ void DebugStream::logFile( const std::string& f, bool truncate )
 		mode |= truncate ? ios::trunc : ios::app;
 
 		internal->fbuf.open(f.c_str(), mode);
+	}
 
+	// structured mode: screen and file are written from sbuf_overflow()
+	if( structured )
+	{
+		setBuf(&internal->sbuf);
+		return;
+	}
+
+	if( !f.empty() )
+	{
 		if( onScreen )
 		{
-			delete rdbuf(new threebuf(cerr.rdbuf(),
-									  &internal->fbuf, &internal->sbuf));
+			setBuf(new threebuf(cerr.rdbuf(),
+								&internal->fbuf, &internal->sbuf));
 		}
 		else
 		{
 			// print to cerr disabled
-			delete rdbuf(new teebuf(&internal->fbuf, &internal->sbuf));
+			setBuf(new teebuf(&internal->fbuf, &internal->sbuf));
 		}
 	}
 	else
 	{
 		if( onScreen )
-			delete rdbuf(new teebuf(cerr.rdbuf(), &internal->sbuf));
+			setBuf(new teebuf(cerr.rdbuf(), &internal->sbuf));
 		else
-			delete rdbuf(&internal->sbuf);
+			setBuf(&internal->sbuf);
 	}
 }
 //--------------------------------------------------------------------------
+void DebugStream::setStructured( bool s )
+{
+	if( structured == s )
+		return;
+
+	flush();
+	structured = s;
+	internal->sbuf.setLineMode(s);
+
+	// reopen streams
+	logFile( (isWriteLogFile ? fname : ""), false);
+}
+//--------------------------------------------------------------------------
 void DebugStream::enableOnScreen()
 {
 	onScreen = true;
@@ -162,13 +248,23 @@ std::ostream& DebugStream::debug(Debug::type t) noexcept
 {
 	if( (dt & t) && (vv <= verb) )
 	{
-		uniset::ios_fmt_restorer ifs(*this);
+		if( structured )
+		{
+			// date, time and type are stored "as is" and will be formatted later (if needed)
+			recInfo.owner = this;
+			recInfo.tm = uniset::now_to_timespec();
+			recInfo.level = t;
+		}
+		else
+		{
+			uniset::ios_fmt_restorer ifs(*this);
 
-		if( show_datetime )
-			printDateTime(t);
+			if( show_datetime )
+				printDateTime(t);
 
-		if( show_logtype )
-			*this << "(" << std::setfill(' ') << std::setw(6) << t << "):  "; // "):\t";
+			if( show_logtype )
+				*this << "(" << std::setfill(' ') << std::setw(6) << t << "):  "; // "):\t";
+		}
 
 		if( show_labels )
 		{
@@ -299,6 +395,51 @@ std::ostream& DebugStream::printDateTime(Debug::type t) noexcept
 	return nullstream;
 }
 //--------------------------------------------------------------------------
+std::ostream& DebugStream::printRecordHead( std::ostream& os, const struct timespec& tm, Debug::type t ) const
+{
+	if( show_datetime )
+	{
+		std::tm tms;
+
+		if( show_localtime )
+			localtime_r(&tm.tv_sec, &tms);
+		else
+			gmtime_r(&tm.tv_sec, &tms);
+
+#if __GNUC__ >= 5
+		os << std::put_time(&tms, "%Od/%Om/%Y %OH:%OM:%OS");
+#else
+		os << std::setw(2) << std::setfill('0') << tms.tm_mday << "/"
+		   << std::setw(2) << std::setfill('0') << tms.tm_mon + 1 << "/"
+		   << std::setw(4) << std::setfill('0') << tms.tm_year + 1900 << " "
+		   << std::setw(2) << std::setfill('0') << tms.tm_hour << ":"
+		   << std::setw(2) << std::setfill('0') << tms.tm_min << ":"
+		   << std::setw(2) << std::setfill('0') << tms.tm_sec;
+#endif
+
+		if( show_usec )
+			os << "." << std::setw(6) << std::setfill('0') << (tm.tv_nsec / 1000);
+		else if( show_msec )
+			os << "." << std::setw(3) << std::setfill('0') << (tm.tv_nsec / 1000000);
+	}
+
+	if( show_logtype )
+		os << "(" << std::setfill(' ') << std::setw(6) << t << "):  ";
+
+	return os;
+}
+//--------------------------------------------------------------------------
+std::string DebugStream::formatRecord( const Record& r ) const
+{
+	if( r.isFormatted() )
+		return r.text;
+
+	std::ostringstream os;
+	(r.src ? r.src : this)->printRecordHead(os, r.tm, r.level);
+	os << r.text;
+	return os.str();
+}
+//--------------------------------------------------------------------------
 std::ostream& DebugStream::pos(int x, int y) noexcept
 {
 	if( !dt )
@@ -313,6 +454,11 @@ DebugStream::StreamEvent_Signal DebugStream::signal_stream_event()
 	return s_stream;
 }
 //--------------------------------------------------------------------------
+DebugStream::StreamRecord_Signal DebugStream::signal_record_event()
+{
+	return s_record;
+}
+//--------------------------------------------------------------------------
 void DebugStream::addLabel( const std::string& key, const std::string& value ) noexcept
 {
 	auto it = std::find_if(labels.begin(), labels.end(), [key] (const Label & l)
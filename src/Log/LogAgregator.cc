@@ -45,7 +45,7 @@ namespace uniset
 		DebugStream(t)
 	{
 		setLogName(name);
-		delete rdbuf(new teebuf(&internal->nbuf, &internal->sbuf));
+		setBuf(new teebuf(&internal->nbuf, &internal->sbuf));
 	}
 	// -------------------------------------------------------------------------
 	void LogAgregator::logFile( const std::string& f, bool truncate )
@@ -53,18 +53,66 @@ namespace uniset
 		DebugStream::logFile(f, truncate);
 
 		if( !f.empty() )
-			delete rdbuf(new teebuf(&internal->fbuf, &internal->sbuf));
+			setBuf(new teebuf(&internal->fbuf, &internal->sbuf));
 		else
-			delete rdbuf(new teebuf(&internal->nbuf, &internal->sbuf));
+			setBuf(new teebuf(&internal->nbuf, &internal->sbuf));
 	}
 	// -------------------------------------------------------------------------
 	LogAgregator::~LogAgregator()
 	{
 	}
 	// -------------------------------------------------------------------------
-	void LogAgregator::logOnEvent( const std::string& s )
+	// агрегатор, который сейчас пересылает запись дочернего лога (в этом потоке).
+	// Текст этой записи попадает и в собственный поток агрегатора (sbuf_overflow),
+	// но как запись уже отправлен, поэтому повторно его не посылаем.
+	static thread_local const LogAgregator* forwarding = nullptr;
+	// -------------------------------------------------------------------------
+	void LogAgregator::recordOnEvent( const DebugStream::Record& r )
+	{
+		if( !s_record.empty() )
+			s_record.emit(r);
+
+		const LogAgregator* prev = forwarding;
+		forwarding = this;
+
+		try
+		{
+			if( r.isFormatted() )
+				(*this) << r.text;
+			else if( isWriteLogFile || !s_stream.empty() ) // текст формируем только если он кому-то нужен
+				(*this) << formatRecord(r);
+		}
+		catch(...)
+		{
+			forwarding = prev;
+			throw;
+		}
+
+		forwarding = prev;
+	}
+	// -------------------------------------------------------------------------
+	void LogAgregator::agregatorRecordOnEvent( const DebugStream::Record& r, const LogAgregator* la )
+	{
+		if( r.src == la )
+			recordOnEvent(r);
+	}
+	// -------------------------------------------------------------------------
+	void LogAgregator::sbuf_overflow( const std::string& s ) noexcept
 	{
-		(*this) << s;
+		try
+		{
+			s_stream.emit(s);
+
+			// текст записанный прямо в агрегатор (а не в дочерний лог)
+			// должен дойти и до подписчиков на записи (вышестоящий агрегатор, бинарные сессии)
+			if( forwarding != this && !s_record.empty() )
+			{
+				Record r(logname, s);
+				r.src = this;
+				s_record.emit(r);
+			}
+		}
+		catch(...) {}
 	}
 	// -------------------------------------------------------------------------
 	std::shared_ptr<DebugStream> LogAgregator::create( const std::string& logname )
@@ -76,7 +124,7 @@ namespace uniset
 
 		auto l = std::make_shared<DebugStream>();
 		l->setLogName(logname);
-		auto conn = l->signal_stream_event().connect( sigc::mem_fun(this, &LogAgregator::logOnEvent) );
+		auto conn = l->signal_record_event().connect( sigc::mem_fun(this, &LogAgregator::recordOnEvent) );
 		conmap.emplace(l, conn);
 		lmap[logname] = l;
 		return l;
@@ -112,11 +160,27 @@ namespace uniset
 
 			if( c == conmap.end() )
 			{
-				auto conn = l.log->signal_stream_event().connect( sigc::mem_fun(this, &LogAgregator::logOnEvent) );
+				auto conn = l.log->signal_record_event().connect( sigc::mem_fun(this, &LogAgregator::recordOnEvent) );
 				conmap.emplace(l.log, conn);
 			}
 		}
 
+		// текст записанный прямо в агрегаторы
+		std::list<std::shared_ptr<LogAgregator>> alst;
+		alst.push_back(la);
+		la->getAgregatorList(alst);
+
+		for( auto&& a : alst )
+		{
+			auto c = conmap.find(a);
+
+			if( c == conmap.end() )
+			{
+				auto conn = a->signal_record_event().connect( sigc::bind( sigc::mem_fun(this, &LogAgregator::agregatorRecordOnEvent), a.get()) );
+				conmap.emplace(a, conn);
+			}
+		}
+
 		addLog(la, lname, false);
 	}
 	// ------------------------------------------------------------------------
@@ -133,7 +197,7 @@ namespace uniset
 
 			if( c == conmap.end() )
 			{
-				auto conn = l->signal_stream_event().connect( sigc::mem_fun(this, &LogAgregator::logOnEvent) );
+				auto conn = l->signal_record_event().connect( sigc::mem_fun(this, &LogAgregator::recordOnEvent) );
 				conmap.emplace(l, conn);
 			}
 		}
@@ -371,6 +435,20 @@ namespace uniset
 		}
 	}
 	// -------------------------------------------------------------------------
+	void LogAgregator::getAgregatorList( std::list<std::shared_ptr<LogAgregator>>& lst ) const
+	{
+		for( const auto& l : lmap )
+		{
+			auto ag = dynamic_pointer_cast<LogAgregator>(l.second);
+
+			if( ag )
+			{
+				lst.push_back(ag);
+				ag->getAgregatorList(lst);
+			}
+		}
+	}
+	// -------------------------------------------------------------------------
 	std::list<LogAgregator::iLog> LogAgregator::getLogList( const std::string& regex_str ) const
 	{
 		std::list<LogAgregator::iLog> lst;
@@ -18,6 +18,7 @@
 #include <iostream>
 #include <sstream>
 #include <regex>
+#include <algorithm>
 #include "PassiveTimer.h"
 #include "LogReader.h"
 #include "UniSetTypes.h"
@@ -180,6 +181,26 @@ void LogReader::setTextFilter(const string& f)
     textfilter  = f;
 }
 // -------------------------------------------------------------------------
+void LogReader::setBinaryMode( bool s )
+{
+    binaryMode = s;
+}
+// -------------------------------------------------------------------------
+void LogReader::setCompressMode( bool s )
+{
+    compressMode = s;
+}
+// -------------------------------------------------------------------------
+void LogReader::setServerFilter( bool s )
+{
+    serverFilter = s;
+}
+// -------------------------------------------------------------------------
+void LogReader::setLevelFilter( Debug::type t )
+{
+    levelFilter = t;
+}
+// -------------------------------------------------------------------------
 void LogReader::sendCommand(const std::string& _addr, int _port, std::vector<Command>& vcmd, bool cmd_only, bool verbose )
 {
     if( vcmd.empty() )
@@ -208,6 +229,19 @@ void LogReader::sendCommand(const std::string& _addr, int _port, std::vector<Com
             continue;
         }
 
+        if( c.logfilter.size() > LogServerTypes::lsMessage::MAXLOGNAME )
+        {
+            cerr << "WARNING: sendCommand() ignore '" << c.cmd << "': logname filter '" << c.logfilter
+                 << "' is too long (max " << LogServerTypes::lsMessage::MAXLOGNAME << " symbols)" << endl;
+            continue;
+        }
+
+        // в бинарном режиме время форматирует сам клиент
+        if( c.cmd == LogServerTypes::cmdShowLocalTime )
+            outlog->showLocalTime(true);
+        else if( c.cmd == LogServerTypes::cmdShowUTCTime )
+            outlog->showLocalTime(false);
+
         LogServerTypes::lsMessage msg;
         msg.cmd = c.cmd;
         msg.data = c.data;
@@ -327,21 +361,55 @@ void LogReader::readlogs( const std::string& _addr, int _port, LogServerTypes::C
     if( readcount > 0 )
         rcount = readcount;
 
+    // обрезанный regexp выбрал бы не те логи
+    if( logfilter.size() > LogServerTypes::lsMessage::MAXLOGNAME )
+    {
+        cerr << "(LogReader): logname filter '" << logfilter << "' is too long (max "
+             << LogServerTypes::lsMessage::MAXLOGNAME << " symbols)" << endl;
+        return;
+    }
+
     LogServerTypes::lsMessage msg;
     msg.cmd = cmd;
     msg.data = 0;
     msg.setLogName(logfilter);
 
     bool send_ok = cmd == LogServerTypes::cmdNOP ? true : false;
+    bool binary_ok = false;
+    bool filter_ok = false;
 
     std::regex rule(textfilter);
 
+    std::string sfilter = serverFilter ? textfilter : "";
+
+    if( sfilter.size() > LogServerTypes::lsMessage::MAXLOGNAME )
+    {
+        cerr << "(LogReader): WARNING: text filter is too long for server side filtering (max "
+             << LogServerTypes::lsMessage::MAXLOGNAME << " symbols). Use local filter only." << endl;
+        sfilter = "";
+    }
+
+    const bool useServerFilter = ( !sfilter.empty() || levelFilter != Debug::NONE );
+
+    if( compressMode && !LogServerTypes::isCompressSupported(LogServerTypes::ctLZ4) )
+    {
+        rlog.warn() << "(LogReader): compression is not supported (build without lz4)" << endl;
+        compressMode = false;
+    }
+
+    bool compress_ok = false;
+
     while( rcount > 0 )
     {
         try
         {
             if( !isConnection() )
+            {
                 connect(_addr, _port, reconDelay);
+                binary_ok = false;
+                filter_ok = false;
+                compress_ok = false;
+            }
 
             if( !isConnection() )
             {
@@ -357,12 +425,42 @@ void LogReader::readlogs( const std::string& _addr, int _port, LogServerTypes::C
                 continue;
             }
 
+            // Настройка сессии (сжатие, бинарный режим, фильтр) и основная команда уходят одним пакетом.
+            // Сервер начинает выдачу только после основной команды, поэтому настройки должны быть перед ней.
+            std::vector<LogServerTypes::lsMessage> hs;
+
+            // сжатие включаем самым первым (чтобы весь поток от сервера был сжатым)
+            if( compressMode && !compress_ok )
+            {
+                hs.emplace_back(LogServerTypes::cmdCompressMode, LogServerTypes::ctLZ4, "");
+                unzip.reset();
+                compress_ok = true;
+            }
+
+            // бинарный режим включаем на каждом новом соединении
+            if( binaryMode && !binary_ok )
+            {
+                hs.emplace_back(LogServerTypes::cmdBinaryMode, 0, "");
+                rreader.reset();
+                binary_ok = true;
+            }
+
+            // фильтр тоже "живёт" только в рамках сессии
+            if( useServerFilter && !filter_ok )
+            {
+                hs.emplace_back(LogServerTypes::cmdSetFilter, (uint32_t)levelFilter, sfilter);
+                filter_ok = true;
+            }
+
             if( !send_ok )
             {
-                sendCommand(msg, verbose);
+                hs.push_back(msg);
                 send_ok = true;
             }
 
+            if( !hs.empty() )
+                sendCommand(hs, verbose);
+
             // Если мы работаем с текстовым фильтром
             // то надо читать построчно..
             ostringstream line;
@@ -373,37 +471,26 @@ void LogReader::readlogs( const std::string& _addr, int _port, LogServerTypes::C
 
                 if( n > 0 )
                 {
-                    tcp->receiveBytes(buf, n);
+                    n = tcp->receiveBytes(buf, std::min(n, (ssize_t)sizeof(buf) - 1));
                     buf[n] = '\0';
 
-                    if( textfilter.empty() )
+                    if( compressMode )
                     {
-                        outlog->any(false) << buf;
-                    }
-                    else
-                    {
-                        // Всё это пока не оптимально,
-                        // но мы ведь и не спешим..
-                        for( ssize_t i = 0; i < n; i++ )
-                        {
-                            // пока не встретили конец строки
-                            // наполняем line..
-                            if( buf[i] != '\n' )
-                            {
-                                line << buf[i];
-                                continue;
-                            }
-
-                            line << endl;
+                        unzip.add(buf, n);
+                        zbuf.clear();
 
-                            const std::string s(line.str());
+                        if( unzip.read(zbuf) > 0 )
+                            printData(zbuf.data(), zbuf.size(), line, rule);
 
-                            if( std::regex_search(s, rule) )
-                                outlog->any(false) << s;
-
-                            line.str("");
+                        if( unzip.isError() )
+                        {
+                            rlog.crit() << "(LogReader): bad compressed data. Reconnect.." << endl;
+                            disconnect();
+                            break;
                         }
                     }
+                    else
+                        printData(buf, n, line, rule);
                 }
                 else if( n == 0 && readcount <= 0 )
                     break;
@@ -445,11 +532,108 @@ void LogReader::readlogs( const std::string& _addr, int _port, LogServerTypes::C
         disconnect();
 }
 // -------------------------------------------------------------------------
+void LogReader::printData( const char* buf, size_t n, std::ostringstream& line, const std::regex& rule )
+{
+    if( binaryMode )
+        printRecords(buf, n, line, rule);
+    else
+        printText(buf, n, line, rule);
+}
+// -------------------------------------------------------------------------
+void LogReader::printText( const char* buf, size_t n, std::ostringstream& line, const std::regex& rule )
+{
+    if( textfilter.empty() )
+    {
+        outlog->any(false).write(buf, n);
+        return;
+    }
+
+    // Всё это пока не оптимально,
+    // но мы ведь и не спешим..
+    for( size_t i = 0; i < n; i++ )
+    {
+        // пока не встретили конец строки
+        // наполняем line..
+        if( buf[i] != '\n' )
+        {
+            line << buf[i];
+            continue;
+        }
+
+        line << endl;
+
+        const std::string s(line.str());
+
+        if( std::regex_search(s, rule) )
+            outlog->any(false) << s;
+
+        line.str("");
+    }
+}
+// -------------------------------------------------------------------------
+void LogReader::printRecords( const char* buf, size_t n, std::ostringstream& line, const std::regex& rule )
+{
+    rreader.add(buf, n);
+
+    LogServerTypes::RecordReader::Data d;
+
+    while( rreader.next(d) )
+    {
+        // обычный текст (служебные сообщения или сервер не поддерживает бинарный режим)
+        if( d.type == LogServerTypes::rtText )
+        {
+            printText(d.text.data(), d.text.size(), line, rule);
+            continue;
+        }
+
+        // запись всегда содержит целую строку, поэтому фильтр применяем сразу
+        if( !textfilter.empty() && !std::regex_search(d.text, rule) )
+            continue;
+
+        outlog->any(false) << outlog->formatRecord( DebugStream::Record(d.logname, d.text, d.tm, d.level) );
+    }
+}
+// -------------------------------------------------------------------------
 void LogReader::logOnEvent( const std::string& s )
 {
     m_logsig.emit(s);
 }
 // -------------------------------------------------------------------------
+void LogReader::sendCommand( const std::vector<LogServerTypes::lsMessage>& msgs, bool verbose )
+{
+    if( !tcp || !tcp->isConnected() )
+    {
+        cerr << "(LogReader::sendCommand): tcp=NULL! no connection?!" << endl;
+        return;
+    }
+
+    try
+    {
+        if( tcp->poll(UniSetTimer::millisecToPoco(outTimeout), Poco::Net::Socket::SELECT_WRITE) )
+        {
+            for( const auto& m : msgs )
+                rlog.info() << "(LogReader): ** send command: cmd='" << m.cmd << "' logname='" << m.logname << "' data='" << m.data << "'" << endl;
+
+            // lsMessage - packed-структура, поэтому вектор можно отправить целиком
+            tcp->sendBytes((const unsigned char*)msgs.data(), msgs.size() * sizeof(LogServerTypes::lsMessage));
+        }
+        else
+            rlog.warn() << "(LogReader): **** SEND COMMANDS FAILED!" << endl;
+    }
+    catch( const Poco::Net::NetException& e )
+    {
+        cerr << "(LogReader): send error:  " << e.displayText() << endl;
+    }
+    catch( Poco::IOException& ex )
+    {
+        cerr << "(LogReader): send error:  " << ex.displayText() << endl;
+    }
+    catch( const std::exception& ex )
+    {
+        cerr << "(LogReader): send error: " << ex.what() << endl;
+    }
+}
+// -------------------------------------------------------------------------
 void LogReader::sendCommand(LogServerTypes::lsMessage& msg, bool verbose )
 {
     if( !tcp || !tcp->isConnected() )
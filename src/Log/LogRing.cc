@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2015 Pavel Vainerman.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, version 2.1.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+// -------------------------------------------------------------------------
+#include <algorithm>
+#include "LogRing.h"
+// -------------------------------------------------------------------------
+namespace uniset
+{
+    // -------------------------------------------------------------------------
+    using namespace std;
+    // -------------------------------------------------------------------------
+    LogRing::LogRing( size_t capacity ):
+        ring( capacity > 0 ? capacity : 1 )
+    {
+    }
+    // -------------------------------------------------------------------------
+    void LogRing::push( const std::string& s )
+    {
+        // память выделяем и копируем вне mutex-а
+        Record rec = make_shared<const std::string>(s);
+
+        // а старую запись (если её уже никто не держит) удаляем тоже вне mutex-а
+        Record old;
+
+        {
+            std::lock_guard<std::mutex> l(mut);
+            auto& slot = ring[wpos % ring.size()];
+            old.swap(slot);
+            slot = std::move(rec);
+            wpos++;
+
+            if( s.size() < minSizeMsg || minSizeMsg == 0 )
+                minSizeMsg = s.size();
+
+            if( s.size() > maxSizeMsg )
+                maxSizeMsg = s.size();
+        }
+    }
+    // -------------------------------------------------------------------------
+    size_t LogRing::read( uint64_t& cursor, std::vector<Record>& out, size_t maxnum ) const
+    {
+        std::lock_guard<std::mutex> l(mut);
+
+        size_t lost = 0;
+
+        // курсор "из будущего" (такого быть не должно, но на всякий случай)
+        if( cursor > wpos )
+            cursor = wpos;
+
+        // читатель отстал больше чем на размер буфера,
+        // перескакиваем на самую старую запись
+        if( wpos - cursor > ring.size() )
+        {
+            lost = wpos - ring.size() - cursor;
+            cursor = wpos - ring.size();
+        }
+
+        for( size_t i = 0; i < maxnum && cursor < wpos; i++, cursor++ )
+            out.push_back( ring[cursor % ring.size()] );
+
+        return lost;
+    }
+    // -------------------------------------------------------------------------
+    uint64_t LogRing::head() const noexcept
+    {
+        std::lock_guard<std::mutex> l(mut);
+        return wpos;
+    }
+    // -------------------------------------------------------------------------
+    size_t LogRing::pending( uint64_t cursor ) const noexcept
+    {
+        std::lock_guard<std::mutex> l(mut);
+
+        if( cursor >= wpos )
+            return 0;
+
+        return std::min( (size_t)(wpos - cursor), ring.size() );
+    }
+    // -------------------------------------------------------------------------
+    size_t LogRing::capacity() const noexcept
+    {
+        return ring.size();
+    }
+    // -------------------------------------------------------------------------
+    size_t LogRing::getMinSizeMsg() const noexcept
+    {
+        std::lock_guard<std::mutex> l(mut);
+        return minSizeMsg;
+    }
+    // -------------------------------------------------------------------------
+    size_t LogRing::getMaxSizeMsg() const noexcept
+    {
+        std::lock_guard<std::mutex> l(mut);
+        return maxSizeMsg;
+    }
+    // -------------------------------------------------------------------------
+} // end of namespace uniset
@@ -39,6 +39,9 @@ namespace uniset
                 loop.evstop(this);
         }
         catch(...) {}
+
+        logConn.disconnect();
+        recConn.disconnect();
     }
     // -------------------------------------------------------------------------
     void LogServer::setCmdTimeout( timeout_t msec ) noexcept
@@ -56,6 +59,11 @@ namespace uniset
         sessMaxCount = num;
     }
     // -------------------------------------------------------------------------
+    void LogServer::setBufferSize( size_t num ) noexcept
+    {
+        bufSize = num;
+    }
+    // -------------------------------------------------------------------------
     LogServer::LogServer( std::shared_ptr<LogAgregator> log ):
         LogServer()
     {
@@ -116,6 +124,9 @@ namespace uniset
             catch( std::exception& ex ) {}
         }
 
+        logConn.disconnect();
+        recConn.disconnect();
+        asyncEvent.stop();
         io.stop();
         isrunning = false;
 
@@ -275,6 +286,11 @@ namespace uniset
         io.set( eloop );
         io.set<LogServer, &LogServer::ioAccept>(this);
         io.start(sock->getSocket(), ev::READ);
+
+        asyncEvent.set( eloop );
+        asyncEvent.set<LogServer, &LogServer::onLogEvent>(this);
+        asyncEvent.start();
+
         isrunning = true;
     }
     // -------------------------------------------------------------------------
@@ -314,7 +330,15 @@ namespace uniset
         {
             Poco::Net::StreamSocket ss = sock->acceptConnection();
 
-            auto s = make_shared<LogSession>( ss, elog, cmdTimeout );
+            // общие буферы создаются при первом подключении
+            // и подключаемся к логу только пока есть хотя бы одна сессия (см. updateConnections)
+            if( !ring )
+                ring = make_shared<LogRing>(bufSize);
+
+            if( !bring )
+                bring = make_shared<LogRing>(bufSize);
+
+            auto s = make_shared<LogSession>( ss, elog, ring, bring, cmdTimeout );
             s->setSessionLogLevel(sessLogLevel);
             s->connectFinalSession( sigc::mem_fun(this, &LogServer::sessionFinished) );
             s->signal_logsession_command().connect( sigc::mem_fun(this, &LogServer::onCommand) );
@@ -327,6 +351,7 @@ namespace uniset
                     saveDefaultLogLevels("ALL");
             }
 
+            updateConnections();
             s->run(watcher.loop);
         }
         catch( const std::exception& ex )
@@ -335,24 +360,114 @@ namespace uniset
         }
     }
     // -------------------------------------------------------------------------
-    void LogServer::sessionFinished( LogSession* s )
+    void LogServer::logOnEvent( const std::string& s ) noexcept
     {
-        uniset_rwmutex_wrlock l(mutSList);
+        // вызывается из потоков пишущих в лог
+        if( s.empty() )
+            return;
 
-        for( SessionList::iterator i = slist.begin(); i != slist.end(); ++i )
+        try
         {
-            if( i->get() == s )
+            ring->push(s);
+        }
+        catch(...) {}
+
+        // сессиям сообщаем уже в потоке event loop (см. onLogEvent)
+        if( asyncEvent.is_active() )
+            asyncEvent.send();
+    }
+    // -------------------------------------------------------------------------
+    void LogServer::recordOnEvent( const DebugStream::Record& r ) noexcept
+    {
+        // вызывается из потоков пишущих в лог
+        if( r.text.empty() )
+            return;
+
+        try
+        {
+            std::string buf;
+            LogServerTypes::encodeRecord(buf, r);
+            bring->push(buf);
+        }
+        catch(...) {}
+
+        if( asyncEvent.is_active() )
+            asyncEvent.send();
+    }
+    // -------------------------------------------------------------------------
+    void LogServer::updateConnections()
+    {
+        // к логу подключаемся только если есть сессии читающие соответствующий общий буфер
+        // (сессии с собственным буфером подключаются к логам сами)
+        bool needText = false;
+        bool needRecords = false;
+
+        {
+            uniset_rwmutex_rlock l(mutSList);
+
+            for( const auto& s : slist )
             {
-                slist.erase(i);
-                break;
+                if( !s->isSharedRing() )
+                    continue;
+
+                if( s->isBinaryMode() )
+                    needRecords = true;
+                else
+                    needText = true;
             }
         }
 
-        if( slist.empty() )
+        if( !elog )
+            return;
+
+        if( needText && !logConn.connected() )
+            logConn = elog->signal_stream_event().connect( sigc::mem_fun(this, &LogServer::logOnEvent) );
+        else if( !needText && logConn.connected() )
+            logConn.disconnect();
+
+        if( needRecords && !recConn.connected() )
+            recConn = elog->signal_record_event().connect( sigc::mem_fun(this, &LogServer::recordOnEvent) );
+        else if( !needRecords && recConn.connected() )
+            recConn.disconnect();
+    }
+    // -------------------------------------------------------------------------
+    void LogServer::onLogEvent( ev::async& watcher, int revents )
+    {
+        if( EV_ERROR & revents )
         {
+            if( mylog.is_crit() )
+                mylog.crit() << myname << "(LogServer::onLogEvent): invalid event" << endl;
+
+            return;
+        }
+
+        uniset_rwmutex_rlock l(mutSList);
+
+        for( const auto& s : slist )
+            s->wakeup();
+    }
+    // -------------------------------------------------------------------------
+    void LogServer::sessionFinished( LogSession* s )
+    {
+        {
+            uniset_rwmutex_wrlock l(mutSList);
+
+            for( SessionList::iterator i = slist.begin(); i != slist.end(); ++i )
+            {
+                if( i->get() == s )
+                {
+                    slist.erase(i);
+                    break;
+                }
+            }
+
             // восстанавливаем уровни логов по умолчанию
-            restoreDefaultLogLevels("ALL");
+            if( slist.empty() )
+                restoreDefaultLogLevels("ALL");
         }
+
+        // если читать больше некому, отключаемся от лога
+        updateConnections();
     }
     // -------------------------------------------------------------------------
     void LogServer::init( const std::string& prefix, xmlNode* cnode )
@@ -364,12 +479,16 @@ namespace uniset
 
         timeout_t cmdTimeout = conf->getArgPInt("--" + prefix + "-cmd-timeout", it.getProp("cmdTimeout"), 2000);
         setCmdTimeout(cmdTimeout);
+
+        size_t bsize = conf->getArgPInt("--" + prefix + "-buffer-size", it.getProp("bufferSize"), bufSize);
+        setBufferSize(bsize);
     }
     // -----------------------------------------------------------------------------
     std::string LogServer::help_print( const std::string& prefix )
     {
         std::ostringstream h;
         h << "--" << prefix << "-cmd-timeout msec      - Timeout for wait command. Default: 2000 msec." << endl;
+        h << "--" << prefix << "-buffer-size num       - Size of shared log buffer (number of records). Default: 10000." << endl;
         return h.str();
     }
     // -----------------------------------------------------------------------------
@@ -380,6 +499,7 @@ namespace uniset
         inf << "LogServer: " << myname
             << " ["
             << " sessMaxCount=" << sessMaxCount
+            << " bufSize=" << bufSize
             << " ]"
             << endl;
 
@@ -401,6 +521,7 @@ namespace uniset
         jdata->set("host", addr);
         jdata->set("port", port);
         jdata->set("sessMaxCount", sessMaxCount);
+        jdata->set("bufSize", bufSize);
 
         {
             uniset_rwmutex_rlock l(mutSList);
@@ -474,6 +595,10 @@ namespace uniset
     // -----------------------------------------------------------------------------
     std::string LogServer::onCommand( LogSession* s, LogServerTypes::Command cmd, const std::string& logname )
     {
+        // сессия могла сменить режим (или перейти на собственный буфер)
+        if( cmd == LogServerTypes::cmdBinaryMode || cmd == LogServerTypes::cmdFilterMode || cmd == LogServerTypes::cmdSetFilter )
+            updateConnections();
+
         if( cmd == LogServerTypes::cmdSaveLogLevel )
         {
             saveDefaultLogLevels(logname);
@@ -17,6 +17,10 @@
 #include "UniSetTypes.h"
 #include "LogServerTypes.h"
 #include "Debug.h"
+#include <algorithm>
+#ifndef DISABLE_LZ4
+#include <lz4.h>
+#endif
 // -------------------------------------------------------------------------
 #if __BYTE_ORDER != __LITTLE_ENDIAN && __BYTE_ORDER != __BIG_ENDIAN
 #error LogServerTypes: Unknown byte order!
@@ -34,6 +38,18 @@
 #else
 #define BE32_TO_H(x) x = be32toh(x)
 #endif
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+#define LE64_TO_H(x) {}
+#else
+#define LE64_TO_H(x) x = le64toh(x)
+#endif
+
+#if __BYTE_ORDER == __BIG_ENDIAN
+#define BE64_TO_H(x) {}
+#else
+#define BE64_TO_H(x) x = be64toh(x)
+#endif
 // -------------------------------------------------------------------------
 namespace uniset
 {
@@ -124,6 +140,21 @@ namespace uniset
             case LogServerTypes::cmdViewDefaultLogLevel:
                 return os << "cmdViewRestoreLogLevel";
 
+            case LogServerTypes::cmdShowLocalTime:
+                return os << "cmdShowLocalTime";
+
+            case LogServerTypes::cmdShowUTCTime:
+                return os << "cmdShowUTCTime";
+
+            case LogServerTypes::cmdBinaryMode:
+                return os << "cmdBinaryMode";
+
+            case LogServerTypes::cmdSetFilter:
+                return os << "cmdSetFilter";
+
+            case LogServerTypes::cmdCompressMode:
+                return os << "cmdCompressMode";
+
             case LogServerTypes::cmdNOP:
                 return os << "No command(NOP)";
 
@@ -205,7 +236,331 @@ namespace uniset
         return vcmd;
     }
     // -------------------------------------------------------------------------
+    void LogServerTypes::lsRecord::convertFromNet() noexcept
+    {
+        if( _be_order )
+        {
+            BE32_TO_H(magic);
+            BE32_TO_H(level);
+            BE64_TO_H(sec);
+            BE32_TO_H(nsec);
+            BE32_TO_H(textlen);
+        }
+        else
+        {
+            LE32_TO_H(magic);
+            LE32_TO_H(level);
+            LE64_TO_H(sec);
+            LE32_TO_H(nsec);
+            LE32_TO_H(textlen);
+        }
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        _be_order = 0;
+#elif __BYTE_ORDER == __BIG_ENDIAN
+        _be_order = 1;
+#endif
+    }
+    // -------------------------------------------------------------------------
+    static void encode( std::string& buf, LogServerTypes::RecordType type, const std::string& logname,
+                        const std::string& text, const struct timespec& tm, Debug::type level )
+    {
+        LogServerTypes::lsRecord h;
+        h.magic = LogServerTypes::RECORDMAGIC;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        h._be_order = 0;
+#elif __BYTE_ORDER == __BIG_ENDIAN
+        h._be_order = 1;
+#endif
+        h.type = type;
+        h.namelen = std::min(logname.size(), (size_t)UINT8_MAX);
+        h.level = level;
+        h.sec = tm.tv_sec;
+        h.nsec = tm.tv_nsec;
+        h.textlen = std::min(text.size(), LogServerTypes::MAXRECORDTEXT);
+
+        buf.reserve( buf.size() + sizeof(h) + h.namelen + h.textlen );
+        buf.append( (const char*)&h, sizeof(h) );
+        buf.append( logname.data(), h.namelen );
+        buf.append( text.data(), h.textlen );
+    }
+    // -------------------------------------------------------------------------
+    void LogServerTypes::encodeRecord( std::string& buf, const DebugStream::Record& r )
+    {
+        encode(buf, (r.isFormatted() ? rtText : rtRecord), r.logname, r.text, r.tm, r.level);
+    }
+    // -------------------------------------------------------------------------
+    void LogServerTypes::encodeText( std::string& buf, const std::string& text )
+    {
+        static const struct timespec zero = { 0, 0 };
+        static const std::string noname;
+        encode(buf, rtText, noname, text, zero, Debug::NONE);
+    }
+    // -------------------------------------------------------------------------
+    void LogServerTypes::RecordReader::add( const char* b, size_t len )
+    {
+        // "прочитанное" удаляем только когда накопилось достаточно (чтобы не двигать память на каждый вызов)
+        if( rpos > 0 && (rpos >= buf.size() || rpos > 64 * 1024) )
+        {
+            buf.erase(0, rpos);
+            rpos = 0;
+        }
+
+        buf.append(b, len);
+    }
+    // -------------------------------------------------------------------------
+    bool LogServerTypes::RecordReader::next( Data& d )
+    {
+        if( rpos >= buf.size() )
+            return false;
+
+        if( textStream )
+        {
+            d.type = rtText;
+            d.logname.clear();
+            d.text.assign(buf, rpos, std::string::npos);
+            d.tm = { 0, 0 };
+            d.level = Debug::NONE;
+            rpos = buf.size();
+            return true;
+        }
+
+        if( buf.size() - rpos < sizeof(uint32_t) )
+            return false;
+
+        if( buf.size() - rpos < sizeof(lsRecord) )
+        {
+            // заголовок ещё не получен полностью, но magic уже можно проверить
+            uint32_t m;
+            std::memcpy(&m, buf.data() + rpos, sizeof(m));
+
+            if( le32toh(m) != RECORDMAGIC && be32toh(m) != RECORDMAGIC )
+            {
+                textStream = true;
+                return next(d);
+            }
+
+            return false;
+        }
+
+        lsRecord h;
+        std::memcpy(&h, buf.data() + rpos, sizeof(h));
+        h.convertFromNet();
+
+        if( h.magic != RECORDMAGIC || h.textlen > MAXRECORDTEXT || h.type > rtRecord )
+        {
+            // это не бинарный поток (сервер не поддерживает cmdBinaryMode)
+            textStream = true;
+            return next(d);
+        }
+
+        const size_t len = sizeof(h) + h.namelen + h.textlen;
+
+        if( buf.size() - rpos < len )
+            return false;
+
+        const char* p = buf.data() + rpos + sizeof(h);
+        d.type = (RecordType)h.type;
+        d.logname.assign(p, h.namelen);
+        d.text.assign(p + h.namelen, h.textlen);
+        d.tm.tv_sec = h.sec;
+        d.tm.tv_nsec = h.nsec;
+        d.level = (Debug::type)h.level;
+        rpos += len;
+        return true;
+    }
+    // -------------------------------------------------------------------------
+    void LogServerTypes::RecordReader::reset() noexcept
+    {
+        buf.clear();
+        rpos = 0;
+        textStream = false;
+    }
+    // -------------------------------------------------------------------------
+    bool LogServerTypes::isCompressSupported( CompressType t ) noexcept
+    {
+        if( t == ctNone )
+            return true;
+
+#ifndef DISABLE_LZ4
+
+        if( t == ctLZ4 )
+            return true;
+
+#endif
+        return false;
+    }
+    // -------------------------------------------------------------------------
+    void LogServerTypes::lsCompressHeader::convertFromNet() noexcept
+    {
+        if( _be_order )
+        {
+            BE32_TO_H(magic);
+            BE32_TO_H(rawlen);
+            BE32_TO_H(len);
+        }
+        else
+        {
+            LE32_TO_H(magic);
+            LE32_TO_H(rawlen);
+            LE32_TO_H(len);
+        }
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        _be_order = 0;
+#elif __BYTE_ORDER == __BIG_ENDIAN
+        _be_order = 1;
+#endif
+    }
     // -------------------------------------------------------------------------
+    void LogServerTypes::compress( std::string& out, const char* data, size_t len, CompressType t )
+    {
+        // слишком большие данные разбиваем на несколько блоков
+        while( len > MAXCOMPRESSBLOCK )
+        {
+            compress(out, data, MAXCOMPRESSBLOCK, t);
+            data += MAXCOMPRESSBLOCK;
+            len -= MAXCOMPRESSBLOCK;
+        }
+
+        // слишком маленькие блоки не сжимаем (накладные расходы больше выигрыша)
+        static const size_t minCompressSize = 64;
+
+        lsCompressHeader h;
+        h.magic = COMPRESSMAGIC;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        h._be_order = 0;
+#elif __BYTE_ORDER == __BIG_ENDIAN
+        h._be_order = 1;
+#endif
+        h.type = ctNone;
+        h.rawlen = len;
+        h.len = len;
+
+        const size_t hpos = out.size();
+        out.append( (const char*)&h, sizeof(h) );
+
+#ifndef DISABLE_LZ4
+
+        if( t == ctLZ4 && len >= minCompressSize )
+        {
+            const int bound = LZ4_compressBound(len);
+            out.resize( hpos + sizeof(h) + bound );
+            const int n = LZ4_compress_default(data, &out[hpos + sizeof(h)], len, bound);
 
+            if( n > 0 && (size_t)n < len )
+            {
+                out.resize( hpos + sizeof(h) + n );
+                h.type = ctLZ4;
+                h.len = n;
+                std::memcpy(&out[hpos], &h, sizeof(h));
+                return;
+            }
+
+            // не сжалось
+            out.resize( hpos + sizeof(h) );
+        }
+
+#endif
+
+        out.append(data, len);
+    }
+    // -------------------------------------------------------------------------
+    void LogServerTypes::Decompressor::add( const char* b, size_t len )
+    {
+        if( rpos > 0 && (rpos >= buf.size() || rpos > 64 * 1024) )
+        {
+            buf.erase(0, rpos);
+            rpos = 0;
+        }
+
+        buf.append(b, len);
+    }
+    // -------------------------------------------------------------------------
+    size_t LogServerTypes::Decompressor::read( std::string& out )
+    {
+        const size_t beg = out.size();
+
+        while( rpos < buf.size() && !error )
+        {
+            if( plainStream )
+            {
+                out.append(buf, rpos, std::string::npos);
+                rpos = buf.size();
+                break;
+            }
+
+            if( buf.size() - rpos < sizeof(uint32_t) )
+                break;
+
+            if( buf.size() - rpos < sizeof(lsCompressHeader) )
+            {
+                // заголовок ещё не получен полностью, но magic уже можно проверить
+                uint32_t m;
+                std::memcpy(&m, buf.data() + rpos, sizeof(m));
+
+                if( le32toh(m) != COMPRESSMAGIC && be32toh(m) != COMPRESSMAGIC )
+                {
+                    plainStream = true;
+                    continue;
+                }
+
+                break;
+            }
+
+            lsCompressHeader h;
+            std::memcpy(&h, buf.data() + rpos, sizeof(h));
+            h.convertFromNet();
+
+            if( h.magic != COMPRESSMAGIC )
+            {
+                // сервер не поддерживает сжатие
+                plainStream = true;
+                continue;
+            }
+
+            if( h.rawlen > MAXCOMPRESSBLOCK || h.len > MAXCOMPRESSBLOCK || !isCompressSupported((CompressType)h.type) )
+            {
+                error = true;
+                break;
+            }
+
+            if( buf.size() - rpos < sizeof(h) + h.len )
+                break;
+
+            const char* p = buf.data() + rpos + sizeof(h);
+
+            if( h.type == ctNone )
+                out.append(p, h.len);
+
+#ifndef DISABLE_LZ4
+            else if( h.type == ctLZ4 )
+            {
+                const size_t opos = out.size();
+                out.resize( opos + h.rawlen );
+                const int n = LZ4_decompress_safe(p, &out[opos], h.len, h.rawlen);
+
+                if( n < 0 || (size_t)n != h.rawlen )
+                {
+                    out.resize(opos);
+                    error = true;
+                    break;
+                }
+            }
+
+#endif
+            rpos += sizeof(h) + h.len;
+        }
+
+        return out.size() - beg;
+    }
+    // -------------------------------------------------------------------------
+    void LogServerTypes::Decompressor::reset() noexcept
+    {
+        buf.clear();
+        rpos = 0;
+        plainStream = false;
+        error = false;
+    }
     // -------------------------------------------------------------------------
 } // end of namespace uniset
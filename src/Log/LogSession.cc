@@ -22,6 +22,7 @@
 #include <regex>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/uio.h>
 #include <cstring>
 #include <Poco/Net/NetException.h>
 #include <Poco/Exception.h>
@@ -40,7 +41,8 @@ namespace uniset
     {
         cancelled = true;
 
-        conn.disconnect();
+        for( auto&& c : conns )
+            c.disconnect();
 
         if( io.is_active() )
             io.stop();
@@ -55,9 +57,14 @@ namespace uniset
             asyncEvent.stop();
     }
     // -------------------------------------------------------------------------
-    LogSession::LogSession( const Poco::Net::StreamSocket& s, std::shared_ptr<DebugStream>& _log, timeout_t _cmdTimeout, timeout_t _checkConnectionTime ):
+    LogSession::LogSession( const Poco::Net::StreamSocket& s, std::shared_ptr<DebugStream>& _log,
+                            std::shared_ptr<LogRing> _ring,
+                            std::shared_ptr<LogRing> _bring,
+                            timeout_t _cmdTimeout, timeout_t _checkConnectionTime ):
         cmdTimeout(_cmdTimeout),
         checkConnectionTime(_checkConnectionTime / 1000.),
+        ring(_ring),
+        bring(_bring),
         peername(""),
         caddr(""),
         log(_log)
@@ -106,63 +113,221 @@ namespace uniset
         asyncEvent.set<LogSession, &LogSession::event>(this);
         checkConnectionTimer.set<LogSession, &LogSession::onCheckConnectionTimer>(this);
 
-        if( log )
-            conn = log->signal_stream_event().connect( sigc::mem_fun(this, &LogSession::logOnEvent) );
-        else
+        rbuf.reserve(maxWriteBatch);
+
+        if( !log )
             mylog.crit() << "(LogSession): LOG NULL!!" << endl;
+
+        if( ring )
+        {
+            // читаем только новые записи
+            rpos = ring->head();
+        }
+        else
+        {
+            // общего буфера нет, работаем со своим
+            ring = make_shared<LogRing>(maxRecordsNum);
+            ownRing = true;
+
+            if( log )
+                connectLog(log);
+        }
     }
     // -------------------------------------------------------------------------
-    void LogSession::logOnEvent( const std::string& s ) noexcept
+    void LogSession::connectLog( const std::shared_ptr<DebugStream>& l )
     {
-        if( cancelled || s.empty() )
+        if( binaryMode || std::atomic_load(&filter) )
+            conns.push_back( l->signal_record_event().connect( sigc::mem_fun(this, &LogSession::recordOnEvent) ) );
+        else
+            conns.push_back( l->signal_stream_event().connect( sigc::mem_fun(this, &LogSession::logOnEvent) ) );
+
+        clogs.push_back(l);
+    }
+    // -------------------------------------------------------------------------
+    void LogSession::disconnectLogs() noexcept
+    {
+        for( auto&& c : conns )
+            c.disconnect();
+
+        conns.clear();
+        clogs.clear();
+    }
+    // -------------------------------------------------------------------------
+    void LogSession::setBinaryMode()
+    {
+        if( binaryMode )
+            return;
+
+        binaryMode = true;
+
+        if( ownRing || !bring )
+        {
+            // переподключаемся к тем же логам, но уже к бинарным записям
+            // (текстовые записи из старого буфера отправлять уже нельзя)
+            auto lst = clogs;
+
+            if( !ownRing && log )
+                lst.push_back(log);
+
+            disconnectLogs();
+            std::atomic_store(&ring, make_shared<LogRing>(maxRecordsNum));
+            rpos = 0;
+            ownRing = true;
+
+            for( auto&& l : lst )
+                connectLog(l);
+
+            return;
+        }
+
+        rpos = bring->head();
+        std::atomic_store(&ring, bring);
+    }
+    // -------------------------------------------------------------------------
+    void LogSession::recordOnEvent( const DebugStream::Record& r ) noexcept
+    {
+        // сюда попадаем только если у сессии собственный буфер
+        if( cancelled || r.text.empty() )
             return;
 
         try
         {
-            // чтобы поменьше удерживать mutex
-            std::unique_lock<std::mutex> lk(logbuf_mutex);
+            auto f = std::atomic_load(&filter);
 
-            // собираем статистику..
-            // --------------------------
-            if( s.size() < minSizeMsg || minSizeMsg == 0 )
-                minSizeMsg = s.size();
+            if( !f )
+            {
+                pushRecord(r);
+                return;
+            }
 
-            if( s.size() > maxSizeMsg )
-                maxSizeMsg = s.size();
+            if( !r.isFormatted() )
+            {
+                if( f->check(r.level, r.text) )
+                    pushRecord(r);
+                else
+                    numFiltered++;
 
-            if( logbuf.size() > maxCount )
-                maxCount = logbuf.size();
+                return;
+            }
 
-            // --------------------------
+            // уже отформатированный текст приходит кусками,
+            // поэтому фильтруем только целые строки
+            std::string lines;
 
-            // проверяем на переполнение..
-            if( logbuf.size() >= maxRecordsNum )
             {
-                numLostMsg++;
+                std::lock_guard<std::mutex> l(partMutex);
+                auto& part = partLines[r.logname];
+                part += r.text;
 
-                if( numLostMsg > maxRecordsNum )
-                {
-                    // видимо клиент отвалился или совсем не успевает читать
-                    // разрываем сессию..
-                    if( mylog.is_info() )
-                        mylog.info() << peername << "(LogSession::onEvent): too many lost messages. Close session.." << endl;
+                auto pos = part.rfind('\n');
 
-                    cancelled = true;
-                }
+                if( pos == std::string::npos )
+                    return;
 
-                if( !lostMsg )
-                {
-                    ostringstream err;
-                    err <<  "(LogSession): The buffer is full. Message is lost...(size of buffer " << maxRecordsNum << ")" << endl;
-                    logbuf.emplace(new UTCPCore::Buffer(std::move(err.str())));
-                    lostMsg = true;
-                }
+                lines = part.substr(0, pos + 1);
+                part.erase(0, pos + 1);
+            }
 
-                return;
+            size_t beg = 0;
+
+            while( beg < lines.size() )
+            {
+                size_t end = lines.find('\n', beg);
+                const std::string line( lines.substr(beg, end - beg + 1) );
+                beg = end + 1;
+
+                if( f->check(Debug::NONE, line) )
+                    pushRecord( DebugStream::Record(r.logname, line) );
+                else
+                    numFiltered++;
             }
+        }
+        catch(...) {}
+    }
+    // -------------------------------------------------------------------------
+    void LogSession::pushRecord( const DebugStream::Record& r )
+    {
+        auto rg = std::atomic_load(&ring);
+
+        if( binaryMode )
+        {
+            std::string buf;
+            LogServerTypes::encodeRecord(buf, r);
+            rg->push(buf);
+        }
+        else
+            rg->push( r.isFormatted() ? r.text : log->formatRecord(r) );
+
+        if( asyncEvent.is_active() )
+            asyncEvent.send();
+    }
+    // -------------------------------------------------------------------------
+    bool LogSession::Filter::check( Debug::type t, const std::string& txt ) const
+    {
+        // у неструктурированных логов уровень неизвестен
+        if( levels != Debug::NONE && t != Debug::NONE && !(levels & t) )
+            return false;
+
+        if( useRegexp && !std::regex_search(txt, re) )
+            return false;
+
+        return true;
+    }
+    // -------------------------------------------------------------------------
+    void LogSession::setFilter( Debug::type levels, const std::string& regexp )
+    {
+        if( levels == Debug::NONE && regexp.empty() )
+        {
+            // фильтр снимаем, но остаёмся на собственном буфере
+            std::atomic_store(&filter, std::shared_ptr<const Filter>());
+            return;
+        }
+
+        auto f = make_shared<Filter>();
+        f->levels = levels;
+
+        if( !regexp.empty() )
+        {
+            // компилируем один раз (может выкинуть std::regex_error)
+            f->re = std::regex(regexp, std::regex::optimize);
+            f->useRegexp = true;
+        }
+
+        std::atomic_store(&filter, std::shared_ptr<const Filter>(f));
+
+        {
+            std::lock_guard<std::mutex> l(partMutex);
+            partLines.clear();
+        }
+
+        // переподключаемся к записям логов (в собственный буфер)
+        auto lst = clogs;
+
+        if( !ownRing && log )
+            lst.push_back(log);
+
+        disconnectLogs();
+
+        if( !ownRing )
+        {
+            std::atomic_store(&ring, make_shared<LogRing>(maxRecordsNum));
+            rpos = 0;
+            ownRing = true;
+        }
+
+        for( auto&& l : lst )
+            connectLog(l);
+    }
+    // -------------------------------------------------------------------------
+    void LogSession::logOnEvent( const std::string& s ) noexcept
+    {
+        // сюда попадаем только если у сессии собственный буфер
+        if( cancelled || s.empty() )
+            return;
 
-            lostMsg = false;
-            logbuf.emplace(new UTCPCore::Buffer(s));
+        try
+        {
+            std::atomic_load(&ring)->push(s);
         }
         catch(...) {}
 
@@ -198,7 +363,7 @@ namespace uniset
             io.stop();
             cmdTimer.stop();
             asyncEvent.stop();
-            conn.disconnect();
+            disconnectLogs();
         }
 
         {
@@ -208,6 +373,8 @@ namespace uniset
                 logbuf.pop();
         }
 
+        wbuf.clear();
+
         sock->disconnect();
         sock->close();
         final();
@@ -223,7 +390,17 @@ namespace uniset
             return;
         }
 
-        io.set(ev::WRITE);
+        io.set(ev::READ | ev::WRITE);
+    }
+    // ---------------------------------------------------------------------
+    void LogSession::wakeup() noexcept
+    {
+        // пока сессия не начала "выдачу" (см. startOutput) ничего не делаем,
+        // записи остаются в буфере
+        if( cancelled || !asyncEvent.is_active() )
+            return;
+
+        io.set(ev::READ | ev::WRITE);
     }
     // ---------------------------------------------------------------------
     void LogSession::callback( ev::io& watcher, int revents ) noexcept
@@ -266,7 +443,7 @@ namespace uniset
             {
                 std::unique_lock<std::mutex> lk(logbuf_mutex);
                 asyncEvent.stop();
-                conn.disconnect();
+                disconnectLogs();
             }
             catch(...) {}
 
@@ -274,30 +451,134 @@ namespace uniset
         }
     }
     // -------------------------------------------------------------------------
-    void LogSession::writeEvent( ev::io& watcher )
+    void LogSession::fillWriteBuffer()
     {
-        if( cancelled.load() )
+        // сперва ответы на команды
+        {
+            std::unique_lock<std::mutex> lk(logbuf_mutex);
+
+            while( !logbuf.empty() && wbuf.size() < maxWriteBatch )
+            {
+                if( binaryMode )
+                {
+                    auto buf = make_shared<std::string>();
+                    LogServerTypes::encodeText(*buf, *logbuf.front());
+                    wbuf.push_back(buf);
+                }
+                else
+                    wbuf.push_back(logbuf.front());
+
+                logbuf.pop();
+            }
+        }
+
+        // записи лога выдаём только после настройки сессии (см. startOutput)
+        if( wbuf.size() >= maxWriteBatch || !asyncEvent.is_active() )
             return;
 
-        UTCPCore::Buffer* buffer = 0;
+        // потом записи лога (без копирования, только "захватываем" ссылки)
+        auto rg = std::atomic_load(&ring);
+        const size_t lag = rg->pending(rpos);
+
+        if( lag > maxCount )
+            maxCount = lag;
 
+        rbuf.clear();
+        size_t lost = rg->read(rpos, rbuf, maxWriteBatch - wbuf.size());
+
+        if( lost > 0 )
         {
-            std::unique_lock<std::mutex> lk(logbuf_mutex);
+            numLostMsg += lost;
+            ostringstream err;
+            err << "(LogSession): The buffer is full. " << lost << " messages lost...(size of buffer " << rg->capacity() << ")" << endl;
 
-            if( logbuf.empty() )
+            if( binaryMode )
             {
-                io.set(EV_NONE);
-                checkConnectionTimer.start( checkConnectionTime ); // restart timer
-                return;
+                auto buf = make_shared<std::string>();
+                LogServerTypes::encodeText(*buf, err.str());
+                wbuf.push_back(buf);
             }
+            else
+                wbuf.push_back( make_shared<const std::string>(err.str()) );
+        }
+
+        for( auto&& r : rbuf )
+            wbuf.push_back(std::move(r));
+
+        rbuf.clear();
+    }
+    // -------------------------------------------------------------------------
+    void LogSession::compressWriteBuffer()
+    {
+        if( wbuf.empty() )
+            return;
+
+        zbuf.clear();
+
+        for( const auto& r : wbuf )
+            zbuf.append(*r);
+
+        auto z = make_shared<std::string>();
+        z->reserve( zbuf.size() / 2 );
+        LogServerTypes::compress(*z, zbuf.data(), zbuf.size(), compressType);
+
+        rawBytes += zbuf.size();
+        zipBytes += z->size();
+
+        wbuf.clear();
+        wbuf.push_back(z);
+
+        // большой буфер не держим
+        if( zbuf.capacity() > 1024 * 1024 )
+            std::string().swap(zbuf);
+    }
+    // -------------------------------------------------------------------------
+    bool LogSession::hasPendingData() noexcept
+    {
+        if( !wbuf.empty() || ( asyncEvent.is_active() && std::atomic_load(&ring)->pending(rpos) > 0 ) )
+            return true;
+
+        std::unique_lock<std::mutex> lk(logbuf_mutex);
+        return !logbuf.empty();
+    }
+    // -------------------------------------------------------------------------
+    void LogSession::writeEvent( ev::io& watcher )
+    {
+        if( cancelled.load() )
+            return;
+
+        if( wbuf.empty() )
+        {
+            wpos = 0;
+            fillWriteBuffer();
 
-            buffer = logbuf.front();
+            // вся пачка уходит одним сжатым блоком
+            if( compressType != LogServerTypes::ctNone )
+                compressWriteBuffer();
         }
 
-        if( !buffer )
+        if( wbuf.empty() )
+        {
+            io.set(ev::READ);
+            checkConnectionTimer.start( checkConnectionTime ); // restart timer
             return;
+        }
+
+        struct iovec iov[maxWriteBatch];
+        size_t num = 0;
+
+        for( const auto& r : wbuf )
+        {
+            if( num >= maxWriteBatch )
+                break;
+
+            const size_t offset = ( num == 0 ? wpos : 0 );
+            iov[num].iov_base = (void*)(r->data() + offset);
+            iov[num].iov_len = r->size() - offset;
+            num++;
+        }
 
-        ssize_t ret = ::write(watcher.fd, buffer->dpos(), buffer->nbytes());
+        ssize_t ret = ::writev(watcher.fd, iov, num);
 
         if( ret < 0 )
         {
@@ -323,35 +604,29 @@ namespace uniset
             return;
         }
 
-        buffer->pos += ret;
+        // убираем полностью отправленные записи
+        size_t sent = wpos + ret;
 
-        if( buffer->nbytes() == 0 )
+        while( !wbuf.empty() && sent >= wbuf.front()->size() )
         {
-            {
-                std::unique_lock<std::mutex> lk(logbuf_mutex);
-                logbuf.pop();
-            }
-
-            delete buffer;
+            sent -= wbuf.front()->size();
+            wbuf.pop_front();
         }
 
+        wpos = sent;
 
+        if( !hasPendingData() )
         {
-            std::unique_lock<std::mutex> lk(logbuf_mutex);
-
-            if( logbuf.empty() )
-            {
-                io.set(EV_NONE);
-                checkConnectionTimer.start( checkConnectionTime ); // restart timer
-                return;
-            }
+            io.set(ev::READ);
+            checkConnectionTimer.start( checkConnectionTime ); // restart timer
+            return;
         }
 
         if( checkConnectionTimer.is_active() )
             checkConnectionTimer.stop();
 
-        io.set(ev::WRITE);
-        //io.set(ev::READ | ev::WRITE);
+        // чтение не отключаем: клиент может прислать команды и во время выдачи
+        io.set(ev::READ | ev::WRITE);
     }
     // -------------------------------------------------------------------------
     size_t LogSession::readData( unsigned char* buf, int len )
@@ -394,49 +669,65 @@ namespace uniset
         if( cancelled )
             return;
 
-        LogServerTypes::lsMessage msg;
+        // клиент может прислать несколько команд подряд (сжатие, бинарный режим, фильтр и т.п.),
+        // поэтому вычитываем всё, что есть, и обрабатываем все целиком принятые команды
+        unsigned char buf[sizeof(LogServerTypes::lsMessage) * 4];
 
-        size_t ret = readData( (unsigned char*)(&msg), sizeof(msg) );
+        while( !cancelled )
+        {
+            size_t ret = readData(buf, sizeof(buf));
 
-        if( ret == 0  || cancelled )
-            return;
+            if( ret == 0 )
+                break;
 
-        msg.convertFromNet();
+            cmdbuf.append((const char*)buf, ret);
 
-        if( ret != sizeof(msg) || msg.magic != LogServerTypes::MAGICNUM )
+            if( ret < sizeof(buf) )
+                break;
+        }
+
+        while( !cancelled && cmdbuf.size() >= sizeof(LogServerTypes::lsMessage) )
         {
-            if( mylog.is_warn() )
-            {
-                ostringstream err;
-                err << peername << "(LogSession::readEvent): MESSAGE ERROR: ";
+            LogServerTypes::lsMessage msg;
+            std::memcpy(&msg, cmdbuf.data(), sizeof(msg));
+            cmdbuf.erase(0, sizeof(msg));
 
-                if( msg.magic != LogServerTypes::MAGICNUM )
-                    err << "BAD MAGICNUM";
+            msg.convertFromNet();
 
-                if( ret != sizeof(msg) )
-                    err << "BAD size of message (" << ret << ")";
+            if( msg.magic != LogServerTypes::MAGICNUM )
+            {
+                // границу следующего сообщения уже не найти, поэтому остаток отбрасываем
+                if( mylog.is_warn() )
+                    mylog.warn() << peername << "(LogSession::readEvent): MESSAGE ERROR: BAD MAGICNUM" << endl;
 
-                mylog.warn() << err.str() << endl;
+                cmdbuf.clear();
+                break;
             }
 
-            return;
-        }
+            if( mylog.is_info() )
+                mylog.info() << peername << "(LogSession::readEvent): receive command: '" << (LogServerTypes::Command)msg.cmd << "'" << endl;
 
-        if( mylog.is_info() )
-            mylog.info() << peername << "(LogSession::readEvent): receive command: '" << (LogServerTypes::Command)msg.cmd << "'" << endl;
+            msg.logname[LogServerTypes::lsMessage::MAXLOGNAME] = '\0';
+            const string cmdLogName(msg.logname);
 
-        const string cmdLogName(msg.logname);
+            try
+            {
+                cmdProcessing(cmdLogName, msg);
+            }
+            catch( std::exception& ex )
+            {
+                if( mylog.is_warn() )
+                    mylog.warn() << peername << "(LogSession::readEvent): " << ex.what() << endl;
+            }
+            catch(...) {}
 
-        try
-        {
-            cmdProcessing(cmdLogName, msg);
-        }
-        catch( std::exception& ex )
-        {
-            if( mylog.is_warn() )
-                mylog.warn() << peername << "(LogSession::readEvent): " << ex.what() << endl;
+            // команды настройки сессии присылаются перед основной командой,
+            // выдачу начинаем только после неё (или по cmdTimeout), иначе клиент получит данные не в том формате
+            if( msg.cmd != LogServerTypes::cmdCompressMode
+                    && msg.cmd != LogServerTypes::cmdBinaryMode
+                    && msg.cmd != LogServerTypes::cmdSetFilter )
+                startOutput();
         }
-        catch(...) {}
 
 #if 0
         // Выводим итоговый получившийся список (с учётом выполненных команд)
@@ -473,9 +764,19 @@ namespace uniset
         }
 
 #endif
+    }
+    // --------------------------------------------------------------------------------
+    void LogSession::startOutput() noexcept
+    {
+        if( cmdTimer.is_active() )
+            cmdTimer.stop();
+
+        if( !asyncEvent.is_active() )
+        {
+            asyncEvent.start();
+            io.set(ev::READ | ev::WRITE);
+        }
 
-        cmdTimer.stop();
-        asyncEvent.start();
         checkConnectionTimer.start( checkConnectionTime ); // restart timer
     }
     // --------------------------------------------------------------------------------
@@ -483,24 +784,78 @@ namespace uniset
     {
         std::list<LogAgregator::iLog> loglist;
 
-        if( alog ) // если у нас "агрегатор", то работаем с его списком потоков
+        // для cmdSetFilter в logname передаётся не имя лога, а фильтр текста
+        if( msg.cmd != LogServerTypes::cmdSetFilter )
         {
-            if( cmdLogName.empty() || cmdLogName == "ALL" || cmdLogName == alog->getLogName())
-                loglist = alog->getLogList();
+            if( alog ) // если у нас "агрегатор", то работаем с его списком потоков
+            {
+                if( cmdLogName.empty() || cmdLogName == "ALL" || cmdLogName == alog->getLogName())
+                    loglist = alog->getLogList();
+                else
+                    loglist = alog->getLogList(cmdLogName);
+            }
             else
-                loglist = alog->getLogList(cmdLogName);
+            {
+                if( cmdLogName.empty() || cmdLogName == "ALL" || log->getLogName() == cmdLogName )
+                    loglist.emplace_back(log, log->getLogName());
+            }
         }
-        else
+
+        if( msg.cmd == LogServerTypes::cmdFilterMode )
         {
-            if( cmdLogName.empty() || cmdLogName == "ALL" || log->getLogName() == cmdLogName )
-                loglist.emplace_back(log, log->getLogName());
+            // отключаем старые обработчики
+            disconnectLogs();
+
+            // в режиме фильтра нужны не все записи, поэтому от общего буфера отключаемся
+            // и заводим свой (в него попадают только сообщения от выбранных логов)
+            std::atomic_store(&ring, make_shared<LogRing>(maxRecordsNum));
+            rpos = 0;
+            ownRing = true;
         }
+        else if( msg.cmd == LogServerTypes::cmdBinaryMode )
+            setBinaryMode();
+        else if( msg.cmd == LogServerTypes::cmdCompressMode )
+        {
+            if( LogServerTypes::isCompressSupported( (LogServerTypes::CompressType)msg.data ) )
+                compressType = (LogServerTypes::CompressType)msg.data;
+            else
+            {
+                ostringstream err;
+                err << "(LogSession): compression type " << msg.data << " is not supported" << endl;
 
-        if( msg.cmd == LogServerTypes::cmdFilterMode )
+                if( mylog.is_warn() )
+                    mylog.warn() << peername << err.str();
+
+                {
+                    std::unique_lock<std::mutex> lk(logbuf_mutex);
+                    logbuf.emplace( make_shared<const std::string>(err.str()) );
+                }
+
+                io.set(ev::READ | ev::WRITE);
+            }
+        }
+        else if( msg.cmd == LogServerTypes::cmdSetFilter )
         {
-            // отключаем старый обработчик
-            if( conn )
-                conn.disconnect();
+            try
+            {
+                setFilter( (Debug::type)msg.data, cmdLogName );
+            }
+            catch( const std::regex_error& ex )
+            {
+                ostringstream err;
+                err << "(LogSession): bad filter regexp '" << cmdLogName << "': " << ex.what() << endl;
+
+                if( mylog.is_warn() )
+                    mylog.warn() << peername << err.str();
+
+                {
+                    std::unique_lock<std::mutex> lk(logbuf_mutex);
+                    logbuf.emplace( make_shared<const std::string>(err.str()) );
+                }
+
+                io.set(ev::READ | ev::WRITE);
+            }
+
         }
 
         // обрабатываем команды только если нашли подходящие логи
@@ -539,7 +894,7 @@ namespace uniset
                     break;
 
                 case LogServerTypes::cmdFilterMode:
-                    l.log->signal_stream_event().connect( sigc::mem_fun(this, &LogSession::logOnEvent) );
+                    connectLog(l.log);
                     break;
 
                 case LogServerTypes::cmdShowLocalTime:
@@ -554,6 +909,9 @@ namespace uniset
                 case LogServerTypes::cmdSaveLogLevel:
                 case LogServerTypes::cmdRestoreLogLevel:
                 case LogServerTypes::cmdViewDefaultLogLevel:
+                case LogServerTypes::cmdBinaryMode:
+                case LogServerTypes::cmdSetFilter:
+                case LogServerTypes::cmdCompressMode:
                     break;
 
                 default:
@@ -574,10 +932,10 @@ namespace uniset
 
             {
                 std::unique_lock<std::mutex> lk(logbuf_mutex);
-                logbuf.emplace(new UTCPCore::Buffer(s.str()));
+                logbuf.emplace( make_shared<const std::string>(s.str()) );
             }
 
-            io.set(ev::WRITE);
+            io.set(ev::READ | ev::WRITE);
         }
 
         try
@@ -588,10 +946,10 @@ namespace uniset
             {
                 {
                     std::unique_lock<std::mutex> lk(logbuf_mutex);
-                    logbuf.emplace(new UTCPCore::Buffer( std::move(ret) ));
+                    logbuf.emplace( make_shared<const std::string>(std::move(ret)) );
                 }
 
-                io.set(ev::WRITE);
+                io.set(ev::READ | ev::WRITE);
             }
         }
         catch( std::exception& ex )
@@ -612,8 +970,7 @@ namespace uniset
         }
 
         t.stop();
-        io.set(ev::WRITE);
-        asyncEvent.start();
+        startOutput();
     }
     // -------------------------------------------------------------------------
     void LogSession::onCheckConnectionTimer( ev::timer& t, int revents ) noexcept
@@ -626,11 +983,11 @@ namespace uniset
             return;
         }
 
-        std::unique_lock<std::mutex> lk(logbuf_mutex);
-
-        if( !logbuf.empty() )
+        if( hasPendingData() )
             return;
 
+        std::unique_lock<std::mutex> lk(logbuf_mutex);
+
         // если клиент уже отвалился.. то при попытке write.. сессия будет закрыта.
 
         // длинное сообщение ("keep alive message") забивает логи, что потом неудобно смотреть
@@ -638,11 +995,11 @@ namespace uniset
         try
         {
             //
-            logbuf.emplace(new UTCPCore::Buffer(" \b"));
+            logbuf.emplace( make_shared<const std::string>(" \b") );
         }
         catch(...) {}
 
-        io.set(ev::WRITE);
+        io.set(ev::READ | ev::WRITE);
     }
     // -------------------------------------------------------------------------
     void LogSession::final() noexcept
@@ -691,7 +1048,6 @@ namespace uniset
     // ---------------------------------------------------------------------
     void LogSession::setMaxBufSize( size_t num )
     {
-        std::unique_lock<std::mutex> lk(logbuf_mutex);
         maxRecordsNum = num;
     }
     // ---------------------------------------------------------------------
@@ -705,22 +1061,33 @@ namespace uniset
         return io.is_active();
     }
     // ---------------------------------------------------------------------
+    bool LogSession::isBinaryMode() const noexcept
+    {
+        return binaryMode;
+    }
+    // ---------------------------------------------------------------------
+    bool LogSession::isSharedRing() const noexcept
+    {
+        return !ownRing;
+    }
+    // ---------------------------------------------------------------------
     string LogSession::getShortInfo() noexcept
     {
-        size_t sz = 0;
-        {
-            std::unique_lock<std::mutex> lk(logbuf_mutex);
-            sz = logbuf.size();
-        }
-
         ostringstream inf;
+        auto rg = std::atomic_load(&ring);
 
         inf << "client: " << caddr << " :"
-            << " buffer[" << maxRecordsNum << "]: size=" << sz
+            << " buffer[" << rg->capacity() << "]: size=" << rg->pending(rpos)
             << " maxCount=" << maxCount
-            << " minSizeMsg=" << minSizeMsg
-            << " maxSizeMsg=" << maxSizeMsg
+            << " minSizeMsg=" << rg->getMinSizeMsg()
+            << " maxSizeMsg=" << rg->getMaxSizeMsg()
             << " numLostMsg=" << numLostMsg
+            << " binary=" << (bool)binaryMode
+            << " filter=" << ( std::atomic_load(&filter) ? 1 : 0 )
+            << " numFiltered=" << numFiltered
+            << " compress=" << (int)compressType
+            << " rawBytes=" << rawBytes
+            << " zipBytes=" << zipBytes
             << endl;
 
         return inf.str();
@@ -731,22 +1098,23 @@ namespace uniset
     {
         Poco::JSON::Object::Ptr jret = new Poco::JSON::Object();
 
-        size_t sz = 0;
-        {
-            std::unique_lock<std::mutex> lk(logbuf_mutex);
-            sz = logbuf.size();
-        }
-
         Poco::JSON::Object::Ptr jdata = new Poco::JSON::Object();
         jret->set(caddr, jdata);
 
+        auto rg = std::atomic_load(&ring);
         jdata->set("client", caddr);
-        jdata->set("maxbufsize", maxRecordsNum);
-        jdata->set("bufsize", sz);
+        jdata->set("maxbufsize", rg->capacity());
+        jdata->set("bufsize", rg->pending(rpos));
         jdata->set("maxCount", maxCount);
-        jdata->set("minSizeMsg", minSizeMsg);
-        jdata->set("maxSizeMsg", maxSizeMsg);
+        jdata->set("minSizeMsg", rg->getMinSizeMsg());
+        jdata->set("maxSizeMsg", rg->getMaxSizeMsg());
         jdata->set("numLostMsg", numLostMsg);
+        jdata->set("binary", (bool)binaryMode);
+        jdata->set("filter", std::atomic_load(&filter) ? true : false);
+        jdata->set("numFiltered", (size_t)numFiltered);
+        jdata->set("compress", (int)compressType);
+        jdata->set("rawBytes", rawBytes);
+        jdata->set("zipBytes", zipBytes);
 
         return jret;
     }
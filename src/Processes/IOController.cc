@@ -1007,6 +1007,8 @@ Poco::JSON::Object::Ptr IOController::httpHelp( const Poco::URI::QueryParameters
 		cmd.param("nameonly", "get only name sensors");
 		cmd.param("offset=N", "get from N record");
 		cmd.param("limit=M", "limit of records");
+		cmd.param("after=ID", "get records after sensor ID (cursor, see 'next' in response)");
+		cmd.param("format=ndjson", "stream records (one json object per line)");
 		myhelp.add(cmd);
 	}
 
@@ -1024,6 +1026,17 @@ Poco::JSON::Object::Ptr IOController::httpRequest( const string& req, const Poco
 	return UniSetManager::httpRequest(req, p);
 }
 // -----------------------------------------------------------------------------
+bool IOController::httpRequestStream( const string& req, const Poco::URI::QueryParameters& p, std::ostream& out )
+{
+	if( req == "sensors" )
+	{
+		request_sensors_stream(req, p, out);
+		return true;
+	}
+
+	return UniSetManager::httpRequestStream(req, p, out);
+}
+// -----------------------------------------------------------------------------
 Poco::JSON::Object::Ptr IOController::request_get( const string& req, const Poco::URI::QueryParameters& p )
 {
 	if( p.empty() )
@@ -1099,9 +1112,13 @@ Poco::JSON::Object::Ptr IOController::request_get( const string& req, const Poco
 }
 // -----------------------------------------------------------------------------
 void IOController::getSensorInfo( Poco::JSON::Array::Ptr& jdata, std::shared_ptr<USensorInfo>& s, bool shortInfo )
+{
+	jdata->add( makeSensorInfo(s, shortInfo) );
+}
+// -----------------------------------------------------------------------------
+Poco::JSON::Object::Ptr IOController::makeSensorInfo( const std::shared_ptr<USensorInfo>& s, bool shortInfo )
 {
 	Poco::JSON::Object::Ptr jsens = new Poco::JSON::Object();
-	jdata->add(jsens);
 
 	{
 		uniset_rwmutex_rlock lock(s->val_lock);
@@ -1115,7 +1132,7 @@ void IOController::getSensorInfo( Poco::JSON::Array::Ptr& jdata, std::shared_ptr
 	jsens->set("tv_nsec", s->tv_nsec);
 
 	if( shortInfo )
-		return;
+		return jsens;
 
 	jsens->set("type", uniset::iotype2str(s->type));
 	jsens->set("default_val", s->default_val);
@@ -1140,6 +1157,8 @@ void IOController::getSensorInfo( Poco::JSON::Array::Ptr& jdata, std::shared_ptr
 	calibr->set("rmax", s->ci.maxRaw);
 	calibr->set("precision", s->ci.precision);
 
+	return jsens;
+
 	//	::CORBA::Boolean undefined;
 	//	::CORBA::Boolean blocked;
 	//	::CORBA::Long priority;
@@ -1153,10 +1172,45 @@ Poco::JSON::Object::Ptr IOController::request_sensors( const string& req, const
 	Poco::JSON::Array::Ptr jsens = uniset::json::make_child_array(jdata, "sensors");
 	auto my = httpGetMyInfo(jdata);
 
-	size_t num = 0;
-	size_t offset = 0;
 	size_t limit = 0;
 	size_t count = 0;
+	ObjectId last = DefaultObjectId;
+	auto it = sensorsBegin(params, limit);
+
+	for( ; it != myioEnd() && (limit == 0 || count < limit); ++it )
+	{
+		getSensorInfo(jsens, it->second, false);
+		last = it->first;
+		count++;
+	}
+
+	// курсор для получения следующей порции (after=ID)
+	if( it != myioEnd() && last != DefaultObjectId )
+		jdata->set("next", last);
+
+	jdata->set("count", count);
+	jdata->set("size", ioCount());
+	return jdata;
+}
+// -----------------------------------------------------------------------------
+void IOController::request_sensors_stream( const string& req, const Poco::URI::QueryParameters& params, std::ostream& out )
+{
+	// каждый датчик отдельной строкой, в памяти держим только текущий
+	// (для продолжения используется after=id последней полученной записи)
+	size_t limit = 0;
+	size_t count = 0;
+
+	for( auto it = sensorsBegin(params, limit); it != myioEnd() && (limit == 0 || count < limit); ++it, count++ )
+	{
+		makeSensorInfo(it->second, false)->stringify(out);
+		out << '\n';
+	}
+}
+// -----------------------------------------------------------------------------
+IOController::IOStateList::iterator IOController::sensorsBegin( const Poco::URI::QueryParameters& params, size_t& limit )
+{
+	size_t offset = 0;
+	ObjectId after = DefaultObjectId;
 
 	for( const auto& p : params )
 	{
@@ -1164,25 +1218,33 @@ Poco::JSON::Object::Ptr IOController::request_sensors( const string& req, const
 			offset = uni_atoi(p.second);
 		else if( p.first == "limit" )
 			limit = uni_atoi(p.second);
+		else if( p.first == "after" )
+			after = uni_atoi(p.second);
 	}
 
-	size_t endnum = offset + limit;
-
-	for( auto it = myioBegin(); it != myioEnd(); ++it, num++ )
+	// Курсор - это id датчика, на котором закончилась предыдущая порция.
+	// Список датчиков формируется при запуске и в процессе работы не меняется,
+	// поэтому порядок обхода ioList неизменен и продолжение "после id" не требует перебора с начала.
+	if( after != DefaultObjectId )
 	{
-		if( limit > 0 && num >= endnum )
-			break;
+		auto it = myiofind(after);
 
-		if( offset > 0 && num < offset )
-			continue;
+		if( it == myioEnd() )
+		{
+			ostringstream err;
+			err << myname << "(request): 'sensors'. Unknown sensor ID=" << after << " for 'after'";
+			throw uniset::SystemError(err.str());
+		}
 
-		getSensorInfo(jsens, it->second, false);
-		count++;
+		return ++it;
 	}
 
-	jdata->set("count", count);
-	jdata->set("size", ioCount());
-	return jdata;
+	auto it = myioBegin();
+
+	for( size_t num = 0; num < offset && it != myioEnd(); num++ )
+		++it;
+
+	return it;
 }
 // -----------------------------------------------------------------------------
 #endif // #ifndef DISABLE_REST_API
@@ -1,6 +1,7 @@
 #include <catch.hpp>
 // -----------------------------------------------------------------------------
 #include <sstream>
+#include <thread>
 #include "DebugStream.h"
 // -----------------------------------------------------------------------------
 using namespace std;
@@ -151,3 +152,69 @@ TEST_CASE("Debugstream: labels", "[debugstream][labels]" )
 
 }
 // -----------------------------------------------------------------------------
+static std::vector<std::string> test_records;
+static std::vector<Debug::type> test_levels;
+static void test_record_buffer( const DebugStream::Record& r )
+{
+    test_records.push_back(r.text);
+    test_levels.push_back(r.level);
+}
+// -----------------------------------------------------------------------------
+TEST_CASE("Debugstream: structured", "[debugstream][structured]" )
+{
+    DebugStream d(Debug::ANY);
+    d.disableOnScreen();
+    d.setStructured(true);
+    REQUIRE( d.isStructured() );
+
+    test_records.clear();
+    test_levels.clear();
+    d.signal_record_event().connect( &test_record_buffer );
+
+    // запись формируется только по концу строки
+    d.info() << "text " << 10;
+    REQUIRE( test_records.empty() );
+    d << endl;
+    REQUIRE( test_records.size() == 1 );
+    REQUIRE( test_records[0] == "text 10\n" );
+    REQUIRE( test_levels[0] == Debug::INFO );
+
+    d.warn() << "warning" << endl;
+    REQUIRE( test_records.size() == 2 );
+    REQUIRE( test_records[1] == "warning\n" );
+    REQUIRE( test_levels[1] == Debug::WARN );
+
+    // текст формируется только для тех, кому он нужен
+    test_log_str.str(""); // clean
+    d.signal_stream_event().connect( &test_log_buffer );
+    d.showDateTime(false);
+    d.crit() << "text" << endl;
+    REQUIRE( test_records.size() == 3 );
+    REQUIRE( test_log_str.str().find("text\n") != std::string::npos );
+    REQUIRE( test_log_str.str().find("crit") != std::string::npos );
+
+    d.showLogType(false);
+    REQUIRE( d.formatRecord( DebugStream::Record("log", "text\n", {10, 0}, Debug::INFO) ) == "text\n" );
+
+    // уровень записи хранится отдельно для каждого потока
+    test_records.clear();
+    test_levels.clear();
+    d.info() << "main";
+    std::thread( [&d]()
+    {
+        d.warn() << "thread" << endl;
+    }).join();
+    d << endl;
+    REQUIRE( test_levels.size() == 2 );
+    REQUIRE( test_levels[0] == Debug::WARN );
+    REQUIRE( test_levels[1] == Debug::INFO );
+
+    // обычный режим: записи содержат уже отформатированный текст
+    d.setStructured(false);
+    test_records.clear();
+    test_levels.clear();
+    d.info() << "text2" << endl;
+    REQUIRE( test_records.size() > 0 );
+    REQUIRE( test_levels[0] == Debug::NONE );
+}
+// -----------------------------------------------------------------------------
@@ -0,0 +1,81 @@
+#include <catch.hpp>
+// --------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include "LogRing.h"
+// --------------------------------------------------------------------------
+using namespace std;
+using namespace uniset;
+// --------------------------------------------------------------------------
+TEST_CASE("LogRing: read", "[LogServer][LogRing]" )
+{
+    LogRing r(5);
+    REQUIRE( r.capacity() == 5 );
+    REQUIRE( r.head() == 0 );
+
+    uint64_t cursor = r.head();
+    std::vector<LogRing::Record> out;
+
+    REQUIRE( r.read(cursor, out, 10) == 0 );
+    REQUIRE( out.empty() );
+
+    r.push("msg1");
+    r.push("msg2");
+    r.push("msg3");
+    REQUIRE( r.pending(cursor) == 3 );
+
+    // читаем частями
+    REQUIRE( r.read(cursor, out, 2) == 0 );
+    REQUIRE( out.size() == 2 );
+    REQUIRE( *out[0] == "msg1" );
+    REQUIRE( *out[1] == "msg2" );
+    REQUIRE( cursor == 2 );
+
+    out.clear();
+    REQUIRE( r.read(cursor, out, 10) == 0 );
+    REQUIRE( out.size() == 1 );
+    REQUIRE( *out[0] == "msg3" );
+    REQUIRE( r.pending(cursor) == 0 );
+
+    REQUIRE( r.getMinSizeMsg() == 4 );
+    REQUIRE( r.getMaxSizeMsg() == 4 );
+}
+// --------------------------------------------------------------------------
+TEST_CASE("LogRing: shared records", "[LogServer][LogRing]" )
+{
+    LogRing r(5);
+    uint64_t c1 = r.head();
+    uint64_t c2 = r.head();
+
+    r.push("msg1");
+
+    std::vector<LogRing::Record> out1;
+    std::vector<LogRing::Record> out2;
+    REQUIRE( r.read(c1, out1, 10) == 0 );
+    REQUIRE( r.read(c2, out2, 10) == 0 );
+    REQUIRE( out1.size() == 1 );
+    REQUIRE( out2.size() == 1 );
+
+    // читатели получают одну и ту же запись (без копирования)
+    REQUIRE( out1[0].get() == out2[0].get() );
+}
+// --------------------------------------------------------------------------
+TEST_CASE("LogRing: lost records", "[LogServer][LogRing]" )
+{
+    LogRing r(3);
+    uint64_t cursor = r.head();
+
+    for( size_t i = 0; i < 10; i++ )
+        r.push("msg" + std::to_string(i));
+
+    REQUIRE( r.pending(cursor) == 3 );
+
+    // медленный читатель "перепрыгивает" на самую старую из оставшихся записей
+    std::vector<LogRing::Record> out;
+    REQUIRE( r.read(cursor, out, 10) == 7 );
+    REQUIRE( out.size() == 3 );
+    REQUIRE( *out[0] == "msg7" );
+    REQUIRE( *out[2] == "msg9" );
+    REQUIRE( cursor == r.head() );
+}
+// --------------------------------------------------------------------------
@@ -4,8 +4,10 @@
 #include <sstream>
 #include <thread>
 #include <future>
+#include <Poco/Net/StreamSocket.h>
 
 #include "Mutex.h"
+#include "PassiveTimer.h"
 #include "UniSetTypes.h"
 #include "LogServer.h"
 #include "LogAgregator.h"
@@ -127,6 +129,185 @@ TEST_CASE("LogAgregator", "[LogServer][LogAgregator]" )
     REQUIRE( lst3.size() == 2 );
 }
 // --------------------------------------------------------------------------
+static std::vector<std::string> la_records;
+void la_recordOnEvent( const DebugStream::Record& r )
+{
+    la_records.push_back(r.logname + ":" + r.text);
+}
+// --------------------------------------------------------------------------
+TEST_CASE("LogAgregator: records", "[LogServer][LogAgregator][binary]" )
+{
+    auto la = make_shared<LogAgregator>();
+    auto log1 = la->create("log1");
+    log1->level(Debug::ANY);
+    log1->disableOnScreen();
+    log1->setStructured(true);
+    log1->showDateTime(false);
+
+    la_records.clear();
+    la->signal_record_event().connect( sigc::ptr_fun(la_recordOnEvent) );
+
+    la_msg.str("");
+    la->signal_stream_event().connect( sigc::ptr_fun(la_logOnEvent) );
+
+    log1->info() << test_msg1 << endl;
+    REQUIRE( la_records.size() == 1 );
+    REQUIRE( la_records[0] == "log1:" + test_msg1 + "\n" );
+
+    // текстовым подписчикам агрегатора запись приходит уже отформатированной
+    REQUIRE( la_msg.str().find(test_msg1) != std::string::npos );
+    REQUIRE( la_msg.str().find("info") != std::string::npos );
+}
+// --------------------------------------------------------------------------
+// текст записей от лога (неструктурированные записи приходят по частям)
+static std::string la_text( const std::string& lname, size_t* num = nullptr )
+{
+    std::string txt;
+    size_t n = 0;
+
+    for( const auto& r : la_records )
+    {
+        if( r.compare(0, lname.size() + 1, lname + ":") == 0 )
+        {
+            txt += r.substr(lname.size() + 1);
+            n++;
+        }
+    }
+
+    if( num )
+        *num = n;
+
+    return txt;
+}
+// --------------------------------------------------------------------------
+TEST_CASE("LogAgregator: nested records", "[LogServer][LogAgregator][binary]" )
+{
+    auto la = make_shared<LogAgregator>("la");
+    auto la2 = make_shared<LogAgregator>("la2");
+    auto la3 = make_shared<LogAgregator>("la3");
+    auto log1 = la3->create("log1");
+    log1->level(Debug::ANY);
+    log1->disableOnScreen();
+    log1->setStructured(true);
+    log1->showDateTime(false);
+
+    for( auto&& a : { la, la2, la3 } )
+    {
+        a->showDateTime(false);
+        a->showLogType(false);
+    }
+
+    la2->add(la3);
+    la->add(la2);
+
+    la_records.clear();
+    la->signal_record_event().connect( sigc::ptr_fun(la_recordOnEvent) );
+
+    la_msg.str("");
+    la->signal_stream_event().connect( sigc::ptr_fun(la_logOnEvent) );
+
+    // текст записанный прямо во вложенные агрегаторы
+    la2->any() << test_msg1 << endl;
+    REQUIRE( la_text("la2") == test_msg1 + "\n" );
+
+    la3->any() << test_msg2 << endl;
+    REQUIRE( la_text("la3") == test_msg2 + "\n" );
+
+    // записи логов приходят один раз (а не ещё и через вложенные агрегаторы)
+    log1->info() << test_msg1 << endl;
+    size_t num = 0;
+    REQUIRE( la_text("log1", &num) == test_msg1 + "\n" );
+    REQUIRE( num == 1 );
+    REQUIRE( la_text("la2") == test_msg1 + "\n" );
+    REQUIRE( la_text("la3") == test_msg2 + "\n" );
+
+    // и в текстовый поток тоже
+    REQUIRE( la_msg.str().find(test_msg1 + "\n" + test_msg2 + "\n") != std::string::npos );
+
+    // текст записанный в сам агрегатор
+    la->any() << test_msg2 << endl;
+    REQUIRE( la_text("la") == test_msg2 + "\n" );
+}
+// --------------------------------------------------------------------------
+TEST_CASE("LogServerTypes: binary records", "[LogServer][binary]" )
+{
+    std::string buf;
+    const std::string lname("log1");
+    const std::string txt(test_msg1 + "\n");
+    const struct timespec tm = { 1000, 500 };
+    LogServerTypes::encodeRecord(buf, DebugStream::Record(lname, txt, tm, Debug::WARN));
+    LogServerTypes::encodeText(buf, test_msg2);
+
+    LogServerTypes::RecordReader rr;
+    LogServerTypes::RecordReader::Data d;
+
+    // данные приходят по частям
+    rr.add(buf.data(), 10);
+    REQUIRE_FALSE( rr.next(d) );
+    rr.add(buf.data() + 10, buf.size() - 10);
+
+    REQUIRE( rr.next(d) );
+    REQUIRE( d.type == LogServerTypes::rtRecord );
+    REQUIRE( d.logname == lname );
+    REQUIRE( d.text == txt );
+    REQUIRE( d.tm.tv_sec == 1000 );
+    REQUIRE( d.tm.tv_nsec == 500 );
+    REQUIRE( d.level == Debug::WARN );
+
+    REQUIRE( rr.next(d) );
+    REQUIRE( d.type == LogServerTypes::rtText );
+    REQUIRE( d.text == test_msg2 );
+
+    REQUIRE_FALSE( rr.next(d) );
+    REQUIRE_FALSE( rr.isTextStream() );
+
+    // сервер не поддерживает бинарный режим (присылает текст)
+    rr.reset();
+    rr.add(test_msg1.data(), test_msg1.size());
+    REQUIRE( rr.next(d) );
+    REQUIRE( rr.isTextStream() );
+    REQUIRE( d.type == LogServerTypes::rtText );
+    REQUIRE( d.text == test_msg1 );
+}
+// --------------------------------------------------------------------------
+TEST_CASE("LogServerTypes: compression", "[LogServer][compress]" )
+{
+    REQUIRE( LogServerTypes::isCompressSupported(LogServerTypes::ctNone) );
+
+    std::string big;
+
+    for( size_t i = 0; i < 100; i++ )
+        big += test_msg1 + "\n";
+
+    std::string buf;
+    LogServerTypes::compress(buf, big.data(), big.size(), LogServerTypes::ctLZ4);
+    // маленький блок (не сжимается)
+    LogServerTypes::compress(buf, test_msg2.data(), test_msg2.size(), LogServerTypes::ctLZ4);
+
+    if( LogServerTypes::isCompressSupported(LogServerTypes::ctLZ4) )
+        REQUIRE( buf.size() < big.size() );
+
+    LogServerTypes::Decompressor z;
+    std::string out;
+
+    // данные приходят по частям
+    z.add(buf.data(), 5);
+    REQUIRE( z.read(out) == 0 );
+    z.add(buf.data() + 5, buf.size() - 5);
+    REQUIRE( z.read(out) == (big.size() + test_msg2.size()) );
+    REQUIRE( out == big + test_msg2 );
+    REQUIRE_FALSE( z.isPlainStream() );
+    REQUIRE_FALSE( z.isError() );
+
+    // сервер не поддерживает сжатие (присылает данные как есть)
+    z.reset();
+    out.clear();
+    z.add(test_msg1.data(), test_msg1.size());
+    REQUIRE( z.read(out) == test_msg1.size() );
+    REQUIRE( z.isPlainStream() );
+    REQUIRE( out == test_msg1 );
+}
+// --------------------------------------------------------------------------
 TEST_CASE("LogServer", "[LogServer]" )
 {
     g_read_cancel = false;
@@ -192,6 +373,173 @@ TEST_CASE("LogServer", "[LogServer]" )
     ret.get();
 }
 // --------------------------------------------------------------------------
+bool readlog_filter_thread()
+{
+    try
+    {
+        LogReader lr;
+        lr.setinTimeout(readTimeout);
+        lr.signal_stream_event().connect( sigc::ptr_fun(rlog1OnEvent) );
+        lr.setReadCount(1);
+        lr.setLogLevel(Debug::ANY);
+        lr.setLevelFilter(Debug::WARN);
+
+        while( !g_read_cancel )
+            lr.readlogs(ip, port);
+
+        return true;
+    }
+    catch( std::exception& ex )
+    {
+    }
+
+    return false;
+}
+// --------------------------------------------------------------------------
+TEST_CASE("LogServer: server side filter", "[LogServer][filter]" )
+{
+    g_read_cancel = false;
+    auto la = make_shared<LogAgregator>();
+    auto log1 = la->create("log1");
+
+    log1->level(Debug::ANY);
+    log1->showDateTime(false);
+    log1->showLogType(false);
+    log1->setStructured(true);
+
+    LogServer ls(la);
+    ls.async_run( ip, port );
+
+    for( int i = 0; i < 3 && !ls.isRunning(); i++ )
+        msleep(600);
+
+    REQUIRE( ls.isRunning() );
+
+    msg.str("");
+    auto ret = std::async(std::launch::async, readlog_filter_thread);
+
+    msleep(500); // пауза на подключение и посылку фильтра
+
+    log1->info() << test_msg1 << endl;
+    log1->warn() << test_msg2 << endl;
+
+    msleep(readTimeout);
+
+    {
+        std::lock_guard<std::mutex> l(r1_mutex);
+        REQUIRE( msg.str() == test_msg2 + "\n" );
+    }
+
+    g_read_cancel = true;
+    ret.get();
+}
+// --------------------------------------------------------------------------
+TEST_CASE("LogServer: session setup commands under load", "[LogServer][binary][compress][filter]" )
+{
+    auto la = make_shared<LogAgregator>();
+    auto log1 = la->create("log1");
+
+    log1->level(Debug::ANY);
+    log1->disableOnScreen();
+    log1->setStructured(true);
+
+    LogServer ls(la);
+    ls.async_run( ip, port );
+
+    for( int i = 0; i < 3 && !ls.isRunning(); i++ )
+        msleep(600);
+
+    REQUIRE( ls.isRunning() );
+
+    // лог пишется непрерывно, чтобы выдача могла начаться в любой момент
+    std::atomic_bool writing = { true };
+    auto writer = std::async(std::launch::async, [&]()
+    {
+        while( writing )
+        {
+            log1->info() << test_msg1 << endl;
+            log1->warn() << test_msg2 << endl;
+        }
+    });
+
+    const bool useCompress = LogServerTypes::isCompressSupported(LogServerTypes::ctLZ4);
+
+    std::vector<LogServerTypes::lsMessage> cmds;
+
+    if( useCompress )
+        cmds.emplace_back(LogServerTypes::cmdCompressMode, LogServerTypes::ctLZ4, "");
+
+    cmds.emplace_back(LogServerTypes::cmdBinaryMode, 0, "");
+    cmds.emplace_back(LogServerTypes::cmdSetFilter, Debug::WARN, "");
+    cmds.emplace_back(LogServerTypes::cmdAddLevel, Debug::ANY, "");
+
+    Poco::Net::StreamSocket sock;
+    sock.connect(Poco::Net::SocketAddress(ip, port));
+
+    // все команды одним пакетом, но последняя приходит по частям
+    const char* cbuf = (const char*)cmds.data();
+    const size_t csize = cmds.size() * sizeof(LogServerTypes::lsMessage);
+    const size_t part = csize - sizeof(LogServerTypes::lsMessage) / 2;
+    sock.sendBytes(cbuf, part);
+    msleep(100);
+    sock.sendBytes(cbuf + part, csize - part);
+
+    LogServerTypes::Decompressor z;
+    LogServerTypes::RecordReader rr;
+    LogServerTypes::RecordReader::Data d;
+    std::string data;
+    char buf[10000];
+    size_t numRecords = 0;
+    size_t numBad = 0;
+
+    PassiveTimer pt(2000);
+
+    while( !pt.checkTime() && numRecords < 100 )
+    {
+        if( !sock.poll(UniSetTimer::millisecToPoco(200), Poco::Net::Socket::SELECT_READ) )
+            continue;
+
+        int n = sock.receiveBytes(buf, sizeof(buf));
+
+        if( n <= 0 )
+            break;
+
+        data.clear();
+
+        if( useCompress )
+        {
+            z.add(buf, n);
+            z.read(data);
+            REQUIRE_FALSE( z.isError() );
+            REQUIRE_FALSE( z.isPlainStream() );
+        }
+        else
+            data.assign(buf, n);
+
+        rr.add(data.data(), data.size());
+
+        while( rr.next(d) )
+        {
+            if( d.type != LogServerTypes::rtRecord )
+                continue;
+
+            numRecords++;
+
+            if( d.level != Debug::WARN || d.text != test_msg2 + "\n" )
+                numBad++;
+        }
+    }
+
+    writing = false;
+    writer.get();
+    sock.close();
+
+    // выдача в бинарном режиме и только записи прошедшие фильтр
+    REQUIRE_FALSE( rr.isTextStream() );
+    REQUIRE( numRecords > 0 );
+    REQUIRE( numBad == 0 );
+}
+// --------------------------------------------------------------------------
 TEST_CASE("MaxSessions", "[LogServer]" )
 {
     g_read_cancel = false;